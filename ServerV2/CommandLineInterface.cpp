@@ -1,5 +1,25 @@
 ﻿#include "CommandLineInterface.h"
 
+namespace {
+    // Comprueba que port sea un puerto serie válido (COM1-COM255 o una ruta /dev/ en Linux) y lo normaliza
+    bool NormalizeComPort(std::string& port) {
+#if !defined(_WIN32) && !defined(_WIN64)
+        if (port.rfind("/dev/", 0) == 0) {
+            return true;
+        }
+#endif
+        for (char& c : port) {
+            c = std::toupper(c);
+        }
+        if (port.size() < 4 || port.size() > 6 || port.substr(0, 3) != "COM" ||
+            port.find_first_not_of("0123456789", 3) != std::string::npos) {
+            return false;
+        }
+        int number = std::stoi(port.substr(3));
+        return number >= 1 && number <= 255;
+    }
+}
+
 void CommandLineInterface::Start(bool showCommander, const std::vector<std::string>& args) {
     if (!args.empty()) {
         for (size_t i = 0; i < args.size(); ++i) {
@@ -60,10 +80,17 @@ void CommandLineInterface::ProcessCommand(const std::string& command) {
             params.push_back(param);
         }
 
+#if defined(_WIN32) || defined(_WIN64)
         std::string sys = "start " + process;
+#else
+        std::string sys = process;
+#endif
         for (const auto& p : params) {
             sys += " " + p;
         }
+#if !defined(_WIN32) && !defined(_WIN64)
+        sys += " &";
+#endif
 
         std::cout << "Ejecutando: " << sys << std::endl;
 
@@ -76,6 +103,117 @@ void CommandLineInterface::ProcessCommand(const std::string& command) {
     else if (cmd == "config" || cmd == "-cf") {
         PrintDefaults();
     }
+    else if (cmd == "clients" || cmd == "-cs") {
+        PrintClients();
+    }
+    else if (cmd == "capture" || cmd == "-ca") {
+        std::string path;
+        iss >> path;
+        UpdateCapture(path);
+    }
+    else if (cmd == "multicast" || cmd == "-mc") {
+        std::string address;
+        std::string ttl;
+        iss >> address >> ttl;
+        UpdateMulticast(address, ttl);
+    }
+    else if (cmd == "history" || cmd == "-hs") {
+        std::string action;
+        iss >> action;
+        std::string rest;
+        std::getline(iss, rest);
+        if (action.empty()) {
+            PrintHistory();
+        }
+        else if (action == "dir") {
+            std::string directory;
+            std::istringstream(rest) >> directory;
+            UpdateHistory(directory);
+        }
+        else {
+            QueryHistory(action == "query" ? rest : action + rest);
+        }
+    }
+    else if (cmd == "replay" || cmd == "-rp") {
+        std::string path;
+        std::string speed;
+        iss >> path >> speed;
+        UpdateReplay(path, speed);
+    }
+    else if (cmd == "synthetic" || cmd == "-sy") {
+        std::string rate;
+        std::string targets;
+        std::string devices;
+        iss >> rate >> targets >> devices;
+        UpdateSynthetic(rate, targets, devices);
+    }
+    else if (cmd == "devices" || cmd == "-dv") {
+        std::string ports;
+        iss >> ports;
+        UpdateDevices(ports);
+    }
+    else if (cmd == "sweep" || cmd == "-sw") {
+        std::string device;
+        iss >> device;
+        PrintSweep(device);
+    }
+    else if (cmd == "delta" || cmd == "-d") {
+        std::vector<std::string> args = { cmd };
+        std::string param;
+        while (iss >> param) {
+            args.push_back(param);
+        }
+        if (args.size() > 1) {
+            UpdateDelta(args);
+        }
+        else {
+            PrintDelta();
+        }
+    }
+    else if (cmd == "objects" || cmd == "-o") {
+        std::string device;
+        iss >> device;
+        PrintObjects(device);
+    }
+    else if (cmd == "grid" || cmd == "-g") {
+        std::string decay;
+        iss >> decay;
+        if (!decay.empty()) {
+            UpdateGrid(decay);
+        }
+        else {
+            PrintGrid();
+        }
+    }
+    else if (cmd == "filter" || cmd == "-f") {
+        std::string stage;
+        std::string value;
+        iss >> stage >> value;
+        if (!stage.empty()) {
+            UpdateFilter(stage, value);
+        }
+        else {
+            PrintFilter();
+        }
+    }
+    else if (cmd == "stats" || cmd == "-st") {
+        PrintStats();
+    }
+    else if (cmd == "latency" || cmd == "-lt") {
+        std::string seconds;
+        iss >> seconds;
+        if (!seconds.empty()) {
+            UpdateLatencyReport(seconds);
+        }
+        else {
+            PrintLatency();
+        }
+    }
+    else if (cmd == "metrics" || cmd == "-mt") {
+        std::string port;
+        iss >> port;
+        UpdateMetricsPort(port);
+    }
     else if (cmd == "help" || cmd == "-h") {
         PrintCommands();
     }
@@ -108,6 +246,11 @@ void CommandLineInterface::ProcessCommand(const std::string& command) {
             UpdateMaxConnections({ cmd, maxConnections });
         }
     }
+    else if (cmd == "slow-client" || cmd == "-sc") {
+        std::string policy;
+        iss >> policy;
+        UpdateSlowClientPolicy(policy);
+    }
     else if (cmd == "run" || cmd == "-r") {
         std::vector<std::string> args;
         std::string arg;
@@ -125,6 +268,8 @@ void CommandLineInterface::ProcessCommand(const std::string& command) {
 }
 
 void CommandLineInterface::PrintCommander() {
+    // El log se escribe en otro hilo: se vacía antes del prompt para no mezclarlos
+    logger->Flush();
     std::cout << color::BOLD + color::BRIGHT_GREEN + "UCENM@ADMIN" + color::BRIGHT_YELLOW + ":~$ " + color::RESET << std::ends;
 }
 
@@ -137,9 +282,20 @@ void CommandLineInterface::PrintDefaults() {
         "------------------------------------------------------------------------------------------------",
         " HOST                    : " + host + " (Dirección Universal Local)",
         " PUERTO TCP              : " + std::to_string(port),
-        " PUERTO ARDUINO          : " + comPort,
+        " PUERTO ARDUINO          : " + (comPorts.empty() ? comPort : PortList()),
         " BAUD RATE               : " + std::to_string(baudRate),
         " MÁXIMO DE CONEXIONES    : " + std::to_string(maxConnections) + " (Clientes)",
+        " CLIENTES LENTOS         : " + std::string(SendQueue::PolicyName(slowClientPolicy)),
+        " ORIGEN DE MUESTRAS      : " + SourceName(),
+        " CAPTURA                 : " + (capturePath.empty() ? std::string("desactivada") : capturePath),
+        " SALIDA UDP              : " + (multicastHost.empty() ? std::string("desactivada") : multicastHost + ":" +
+            std::to_string(multicastPort) + (multicast::IsMulticast(multicastHost) ? " (TTL " + std::to_string(multicastTtl) + ")" : "")),
+        " HISTÓRICO               : " + (historyDirectory.empty() ? std::string("desactivado") : historyDirectory),
+        " MODO DELTA              : umbral " + std::to_string(deltaThreshold) + " cm, fotograma clave cada " + std::to_string(keyframeInterval) + " ms",
+        " REJILLA DE OCUPACIÓN    : -" + std::to_string(gridDecay) + " de intensidad cada " + std::to_string(OccupancyGrid::TICK_MS) + " ms",
+        " FILTRO DE RUIDO         : " + FilterName(),
+        " MÉTRICAS                : " + (metricsPort > 0 ? "http://127.0.0.1:" + std::to_string(metricsPort) + "/metrics" : std::string("desactivadas")),
+        " LATENCIAS               : " + (latencyInterval > 0 ? "cada " + std::to_string(latencyInterval) + " s" : std::string("bajo demanda (latency)")),
         " ESTADO DEL SERVIDOR     : " + serverState,
         " MODO DEPURACIÓN         : " + debugState,
         "------------------------------------------------------------------------------------------------\n",
@@ -150,6 +306,356 @@ void CommandLineInterface::PrintDefaults() {
     }
 }
 
+void CommandLineInterface::PrintClients() {
+    if (protocol == nullptr || !isRunning) {
+        logger->Log("No hay servidores en ejecución.", Logger::INFO);
+        return;
+    }
+
+    auto clients = protocol->Clients();
+    auto now = std::chrono::system_clock::now();
+
+    std::cout << "\n------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " CLIENTES CONECTADOS: " << clients->size() << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
+    for (const auto& client : *clients) {
+        long long seconds = (long long)std::chrono::duration_cast<std::chrono::seconds>(now - client.connectedAt).count();
+        std::cout << " " << client.address
+            << " | " << (client.device.empty() ? "(sin identificar)" : client.device)
+            << " | " << ((client.channel & Protocol::BINARY_CHANNEL) ? "binario" : "texto")
+            << ((client.channel & Protocol::WEBSOCKET_CHANNEL) ? " websocket" : "")
+            << ((client.channel & Protocol::DELTA_CHANNEL) ? " delta" : "")
+            << ((client.channel & Protocol::GRID_CHANNEL) ? " rejilla" : "")
+            << ((client.channel & Protocol::OBJECTS_ONLY_CHANNEL) ? " solo-objetos" :
+                ((client.channel & Protocol::OBJECTS_CHANNEL) ? " objetos" : ""))
+            << (Protocol::Rate(client.channel) != 0 ? " " + std::to_string(Protocol::Rate(client.channel)) + "/s" +
+                ((client.channel & Protocol::NEAREST_CHANNEL) ? " (mínima)" : "") : std::string(""))
+            << (Protocol::View(client.channel) != 0 ? " sectores" : "")
+            << " | " << SubscriptionName(client.channel)
+            << " | conectado hace " << seconds << " s"
+            << " | " << client.bytesSent << " bytes enviados"
+            << " | " << client.dropped << " descartados" << std::endl;
+    }
+    std::cout << "------------------------------------------------------------------------------------------------\n" << std::endl;
+}
+
+void CommandLineInterface::PrintSweep(const std::string& device) {
+    if (protocol == nullptr || !isRunning) {
+        logger->Log("No hay servidores en ejecución.", Logger::INFO);
+        return;
+    }
+
+    size_t radar = 0;
+    if (!device.empty()) {
+        if (device.size() > 2 || device.find_first_not_of("0123456789") != std::string::npos ||
+            (radar = (size_t)std::stoul(device)) >= protocol->DeviceCount()) {
+            logger->Log("Radar inválido: " + device + ". Hay " + std::to_string(protocol->DeviceCount()) + " radares (0 a " +
+                std::to_string(protocol->DeviceCount() - 1) + ").", Logger::ERROR_LOG);
+            return;
+        }
+    }
+
+    SweepFrame sweep;
+    if (!protocol->LastSweep(sweep, radar)) {
+        logger->Log("Todavía no se ha completado ningún barrido.", Logger::INFO);
+        return;
+    }
+
+    // Obstáculo más cercano del barrido
+    uint16_t nearest = SweepFrame::MISSING;
+    uint16_t nearestAngle = 0;
+    for (uint16_t angle = sweep.minAngle; angle <= sweep.maxAngle; ++angle) {
+        if (sweep.distance[angle] < nearest) {
+            nearest = sweep.distance[angle];
+            nearestAngle = angle;
+        }
+    }
+
+    std::cout << "\n------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " BARRIDO #" << sweep.sequence << (sweep.direction > 0 ? " (ascendente)" : " (descendente)");
+    if (protocol->DeviceCount() > 1) {
+        std::cout << " DEL RADAR " << sweep.device;
+    }
+    std::cout << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " Ángulos           : " << sweep.minAngle << " - " << sweep.maxAngle << std::endl;
+    std::cout << " Muestras          : " << sweep.count << std::endl;
+    std::cout << " Duración          : " << (sweep.endTime - sweep.startTime) / 1000 << " ms" << std::endl;
+    if (nearest != SweepFrame::MISSING) {
+        std::cout << " Más cercano       : " << nearest << " cm a " << nearestAngle << " grados" << std::endl;
+    }
+    std::cout << "------------------------------------------------------------------------------------------------\n" << std::endl;
+}
+
+void CommandLineInterface::PrintDelta() {
+    if (protocol == nullptr || !isRunning) {
+        logger->Log("No hay servidores en ejecución.", Logger::INFO);
+        return;
+    }
+
+    // Los contadores se suman sobre todos los radares; umbral e intervalo son comunes
+    DeltaFilter& delta = protocol->Delta();
+    uint64_t sent = 0;
+    uint64_t suppressed = 0;
+    uint64_t keyframes = 0;
+    for (size_t i = 0; i < protocol->DeviceCount(); ++i) {
+        sent += protocol->Delta(i).Sent();
+        suppressed += protocol->Delta(i).Suppressed();
+        keyframes += protocol->Delta(i).KeyframeSamples();
+    }
+    uint64_t total = sent + suppressed;
+
+    std::cout << "\n------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " MODO DELTA (umbral " << delta.Threshold() << " cm, fotograma clave cada " << delta.KeyframeInterval() << " ms)" << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " Muestras enviadas           : " << sent << std::endl;
+    std::cout << " Muestras omitidas           : " << suppressed << std::endl;
+    std::cout << " Muestras en fotogramas clave: " << keyframes << std::endl;
+    if (total > 0) {
+        // Ahorro frente a enviar todas las muestras a los clientes delta
+        long long saved = (long long)suppressed - (long long)keyframes;
+        std::cout << " Ahorro                      : " << (saved * 100 / (long long)total) << " % de las muestras" << std::endl;
+    }
+    std::cout << "------------------------------------------------------------------------------------------------\n" << std::endl;
+}
+
+void CommandLineInterface::PrintGrid() {
+    if (protocol == nullptr || !isRunning) {
+        logger->Log("No hay servidores en ejecución.", Logger::INFO);
+        return;
+    }
+
+    std::cout << "\n------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " REJILLA DE OCUPACIÓN (" << OccupancyGrid::ANGLE_BINS << " x " << OccupancyGrid::RANGE_BINS << " celdas, -"
+        << (int)protocol->Grid().Decay() << " cada " << OccupancyGrid::TICK_MS << " ms)" << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
+    for (size_t i = 0; i < protocol->DeviceCount(); ++i) {
+        OccupancyGrid& grid = protocol->Grid(i);
+        std::cout << " Radar " << i << "             : " << grid.Hits() << " ecos, " << grid.Ticks() << " periodos" << std::endl;
+    }
+    std::cout << "------------------------------------------------------------------------------------------------\n" << std::endl;
+}
+
+void CommandLineInterface::PrintHistory() {
+    if (protocol == nullptr || !isRunning || !protocol->Archive().IsOpen()) {
+        logger->Log(historyDirectory.empty() ? std::string("El histórico está desactivado (history dir <carpeta>).") :
+            "El histórico se abrirá en " + historyDirectory + " al iniciar el servidor.", Logger::INFO);
+        return;
+    }
+
+    const HistoryStore& archive = protocol->Archive();
+    uint64_t samples = archive.Samples();
+    uint64_t written = archive.Stored().Value();
+    uint64_t bytes = archive.Bytes().Value();
+    std::cout << "\n------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " HISTÓRICO EN " << archive.Directory() << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " Muestras          : " << samples << " en " << archive.ChunkCount() << " bloques" << std::endl;
+    if (samples > 0) {
+        std::cout << " Desde             : " << history::FormatTime(archive.FirstTime()) << std::endl;
+        std::cout << " Hasta             : " << history::FormatTime(archive.LastTime()) << std::endl;
+    }
+    std::cout << " Desde el arranque : " << written << " muestras, " << bytes << " bytes";
+    if (bytes > 0) {
+        char ratio[64];
+        snprintf(ratio, sizeof(ratio), " (%.1f bytes por muestra, %.1f:1)", (double)bytes / (double)written,
+            (double)(written * sizeof(RadarSample)) / (double)bytes);
+        std::cout << ratio;
+    }
+    std::cout << std::endl;
+    std::cout << " Descartadas       : " << archive.Dropped().Value() << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------\n" << std::endl;
+}
+
+void CommandLineInterface::QueryHistory(const std::string& request) {
+    if (protocol == nullptr || !isRunning || !protocol->Archive().IsOpen()) {
+        logger->Log("No hay ningún histórico abierto.", Logger::INFO);
+        return;
+    }
+
+    history::Level level;
+    history::Query query;
+    if (!history::ParseRequest(request, level, query)) {
+        logger->Log("Consulta inválida. Usa: history query|minutes|hours <desde> <hasta> [a-b[/d1-d2]].", Logger::ERROR_LOG);
+        return;
+    }
+
+    // Se muestran las primeras líneas; el resto solo se cuenta
+    const size_t shown = 20;
+    query.limit = 100000;
+    history::QueryStats stats;
+    std::vector<std::string> lines;
+    size_t found;
+    if (level == history::SAMPLES) {
+        std::vector<RadarSample> samples;
+        found = protocol->Archive().Query(query, samples, stats);
+        for (size_t i = 0; i < samples.size() && i < shown; ++i) {
+            lines.push_back(history::FormatSample(samples[i]));
+        }
+    }
+    else {
+        std::vector<history::Summary> summaries;
+        found = protocol->Archive().Summarize(level, query, summaries, stats);
+        for (size_t i = 0; i < summaries.size() && i < shown; ++i) {
+            lines.push_back(history::FormatSummary(summaries[i]));
+        }
+    }
+
+    std::cout << "\n------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << (level == history::SAMPLES ? " MUESTRAS" : level == history::MINUTES ? " MINUTOS" : " HORAS") << " DEL "
+        << history::FormatTime(query.from) << " AL " << history::FormatTime(query.to) << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
+    if (level == history::SAMPLES) {
+        std::cout << " instante,radar,ángulo,distancia" << std::endl;
+    }
+    else {
+        std::cout << " comienzo,radar,muestras,mínima,media,máxima" << std::endl;
+    }
+    for (const std::string& line : lines) {
+        std::cout << " " << line;
+    }
+    if (found > lines.size()) {
+        std::cout << " ... y " << found - lines.size() << " más" << std::endl;
+    }
+    std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " Resultados        : " << found << (stats.next != 0 ? " (límite alcanzado; siguen desde " +
+        history::FormatTime(stats.next) + ")" : std::string("")) << std::endl;
+    if (level == history::SAMPLES) {
+        std::cout << " Bloques           : " << stats.read << " leídos, " << stats.skipped << " descartados por su resumen, de "
+            << stats.chunks << " en el intervalo" << (stats.corrupt > 0 ? " (" + std::to_string(stats.corrupt) + " dañados)" :
+            std::string("")) << std::endl;
+    }
+    std::cout << " Bytes leídos      : " << stats.bytes << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------\n" << std::endl;
+}
+
+void CommandLineInterface::PrintFilter() {
+    if (protocol == nullptr || !isRunning) {
+        logger->Log("No hay servidores en ejecución.", Logger::INFO);
+        return;
+    }
+
+    std::cout << "\n------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " FILTRO DE RUIDO: " << FilterName() << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
+    for (size_t i = 0; i < protocol->DeviceCount(); ++i) {
+        NoiseFilter& noise = protocol->Noise(i);
+        std::cout << " Radar " << i << "             : " << noise.Filtered() << " muestras filtradas, " << noise.Rejected()
+            << " lecturas rechazadas" << std::endl;
+    }
+    std::cout << "------------------------------------------------------------------------------------------------\n" << std::endl;
+}
+
+void CommandLineInterface::PrintStats() {
+    if (protocol == nullptr || !isRunning) {
+        logger->Log("No hay servidores en ejecución.", Logger::INFO);
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    double seconds = lastStats.empty() ? 0 : std::chrono::duration<double>(now - lastStatsTime).count();
+    std::map<std::string, double> current;
+
+    std::cout << "\n------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " MÉTRICAS" << (seconds > 0 ? " (ritmo en los últimos " + std::to_string((int)seconds) + " s)" : std::string("")) << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
+    for (const auto& value : metrics->Collect()) {
+        std::string series = value.labels.empty() ? value.name : value.name + "{" + value.labels + "}";
+        char line[128];
+        if (value.type == MetricsRegistry::HISTOGRAM) {
+            snprintf(line, sizeof(line), "n=%llu p50=%llu p99=%llu p999=%llu max=%llu", (unsigned long long)value.count,
+                (unsigned long long)value.p50, (unsigned long long)value.p99, (unsigned long long)value.p999, (unsigned long long)value.max);
+        }
+        else if (value.type == MetricsRegistry::COUNTER && seconds > 0 && lastStats.count(series) != 0) {
+            snprintf(line, sizeof(line), "%.0f (%.1f/s)", value.value, (value.value - lastStats[series]) / seconds);
+        }
+        else {
+            snprintf(line, sizeof(line), "%.0f", value.value);
+        }
+        current[series] = value.value;
+        std::cout << " " << series << " : " << line << std::endl;
+    }
+    std::cout << "------------------------------------------------------------------------------------------------\n" << std::endl;
+
+    lastStats.swap(current);
+    lastStatsTime = now;
+}
+
+void CommandLineInterface::PrintLatency() {
+    if (protocol == nullptr || !isRunning) {
+        logger->Log("No hay servidores en ejecución.", Logger::INFO);
+        return;
+    }
+
+    // Tramado (por puerto serie), cola y envío, más el total de todos los clientes y de cada uno
+    std::cout << "\n------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " LATENCIAS (microsegundos)          medidas       p50       p99      p999       max" << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
+    std::vector<MetricsRegistry::Value> stages;
+    std::vector<MetricsRegistry::Value> clients;
+    for (auto& value : metrics->Collect()) {
+        if (value.type != MetricsRegistry::HISTOGRAM) {
+            continue;
+        }
+        if (value.name == "uar_client_latency_us") {
+            clients.push_back(std::move(value));
+        }
+        else if (value.name.compare(0, 12, "uar_latency_") == 0) {
+            stages.push_back(std::move(value));
+        }
+    }
+    // En el orden en que recorre el servidor cada muestra
+    const char* order[] = { "uar_latency_framing_us", "uar_latency_queueing_us", "uar_latency_send_us", "uar_latency_total_us" };
+    std::stable_sort(stages.begin(), stages.end(), [&order](const MetricsRegistry::Value& a, const MetricsRegistry::Value& b) {
+        return std::find(order, order + 4, a.name) < std::find(order, order + 4, b.name);
+    });
+    stages.insert(stages.end(), clients.begin(), clients.end());
+
+    for (const auto& value : stages) {
+        std::string stage = value.name == "uar_client_latency_us" ? "cliente" : value.name.substr(12, value.name.size() - 15);
+        std::string series = value.labels.empty() ? stage : stage + "{" + value.labels + "}";
+        char line[96];
+        snprintf(line, sizeof(line), "%10llu%10llu%10llu%10llu%10llu", (unsigned long long)value.count, (unsigned long long)value.p50,
+            (unsigned long long)value.p99, (unsigned long long)value.p999, (unsigned long long)value.max);
+        std::cout << " " << series << (series.size() < 34 ? std::string(34 - series.size(), ' ') : std::string(" ")) << line << std::endl;
+    }
+    std::cout << "------------------------------------------------------------------------------------------------\n" << std::endl;
+}
+
+void CommandLineInterface::PrintObjects(const std::string& device) {
+    if (protocol == nullptr || !isRunning) {
+        logger->Log("No hay servidores en ejecución.", Logger::INFO);
+        return;
+    }
+
+    size_t radar = 0;
+    if (!device.empty()) {
+        if (device.size() > 2 || device.find_first_not_of("0123456789") != std::string::npos ||
+            (radar = (size_t)std::stoul(device)) >= protocol->DeviceCount()) {
+            logger->Log("Radar inválido: " + device + ".", Logger::ERROR_LOG);
+            return;
+        }
+    }
+
+    TrackedObject objects[ObjectTracker::MAX_TRACKS];
+    ObjectTracker& tracker = protocol->Tracker(radar);
+    size_t count = tracker.Copy(objects);
+
+    std::cout << "\n------------------------------------------------------------------------------------------------" << std::endl;
+    std::cout << " OBJETOS SEGUIDOS POR EL RADAR " << radar << ": " << count << " (" << tracker.Created() << " detectados en "
+        << tracker.Sweeps() << " barridos)" << std::endl;
+    std::cout << "------------------------------------------------------------------------------------------------" << std::endl;
+    for (size_t i = 0; i < count; ++i) {
+        const TrackedObject& object = objects[i];
+        char line[160];
+        snprintf(line, sizeof(line), " #%-6u %6.1f grados %6.1f cm | %+7.1f cm/s %+7.1f grados/s | %3u-%3u | %u barridos%s",
+            object.id, object.angle, object.distance, object.rangeRate, object.angleRate, object.firstAngle, object.lastAngle,
+            object.hits, object.misses > 0 ? " (sin ver)" : "");
+        std::cout << line << std::endl;
+    }
+    std::cout << "------------------------------------------------------------------------------------------------\n" << std::endl;
+}
+
 void CommandLineInterface::ShowProjectInfo() {
     std::vector<std::string> projectInfo = {
     "\n------------------------------------------------------------------------------------------------",
@@ -185,12 +691,29 @@ void CommandLineInterface::PrintCommands() {
     "------------------------------------------------------------------------------------------------",
     " -cl, clear                      : Limpia la terminal.",
     " -cf, config                     : Muestra la configuración establecida del servidor.",
+    " -cs, clients                    : Muestra los clientes conectados.",
+    " -sw, sweep     [radar]          : Muestra el último barrido completo del radar (0 por defecto).",
     " -h,  help                       : Muestra este menú de ayuda.",
     " -i,  info                       : Muestra más información de este programa.",
     " -p,  port      [puerto]         : Establece el puerto del servidor.",
     " -c,  com-port  [COM]            : Establece el puerto serial de Arduino.",
+    " -dv, devices   [COM,COM,...|off]: Lee de varios Arduinos a la vez, uno por puerto (radar 0, 1, ...).",
     " -b,  baudrate  [baud]           : Establece la tasa de baudios.",
     " -m,  max-cons  [1-10] [--f]     : Establece el número máximo de conexiones.",
+    " -sc, slow-client [política]     : Qué hacer con clientes lentos (drop, latest, disconnect).",
+    " -ca, capture   [archivo|off]    : Graba todas las muestras en un archivo de captura al iniciar.",
+    " -mc, multicast [ip[:puerto]|off] [ttl]: Envía también las muestras por UDP (multicast o difusión) a toda la red local.",
+    " -hs, history   dir [carpeta|off]: Guarda las muestras en un histórico comprimido al iniciar (sin parámetros muestra su estado).",
+    " -hs, history   query|minutes|hours [desde] [hasta] [a-b[/d1-d2]]: Consulta el histórico (segundos desde 1970 o AAAA-MM-DDTHH:MM).",
+    " -rp, replay    [archivo|off] [x]: Reproduce una captura en lugar del Arduino (velocidad 1, N o max).",
+    " -sy, synthetic [ritmo|off] [n] [r]: Genera muestras sintéticas (hasta 1m por segundo, n blancos, r radares).",
+    " -d,  delta     [cm] [ms]        : Umbral e intervalo de fotograma clave del modo delta (sin parámetros muestra los contadores).",
+    " -o,  objects   [radar]          : Muestra los objetos que sigue el radar (0 por defecto).",
+    " -g,  grid      [intensidad]     : Lo que pierde cada celda de la rejilla por periodo, 1-255 (sin parámetros muestra los contadores).",
+    " -f,  filter    [etapa] [valor]  : Filtro por ángulo: outlier [cm|off], median [3|5|off], ema [%|off] u off (sin parámetros muestra los contadores).",
+    " -st, stats                      : Muestra las métricas del servidor (con el ritmo desde el último stats).",
+    " -lt, latency   [segundos|off]   : Latencias por etapa y por cliente (p50/p99/p999/max); con segundos, cada tanto.",
+    " -mt, metrics   [puerto|off]     : Puerto local de las métricas en formato Prometheus (GET /metrics).",
     " -r,  run       [--debug]        : Enciende el servidor TCP y abre las conexiones con Arduino.",
     " -s,  start     [cmd] [args]     : Ejecuta un proceso externo con argumentos opcionales.",
     " -e,  exit                       : Cierra el servidor y por ende el programa.",
@@ -256,6 +779,20 @@ void CommandLineInterface::UpdateComPort(const std::vector<std::string>& args) {
     if (args.size() > 1) {
         std::string comPort = args[1];
 
+#if !defined(_WIN32) && !defined(_WIN64)
+        // En Linux el puerto serie es una ruta de dispositivo (ej. /dev/ttyACM0, /dev/ttyUSB0)
+        if (comPort.rfind("/dev/", 0) == 0) {
+            if (this->comPort == comPort) {
+                logger->Log("El puerto " + comPort + " ya está asignado.", Logger::WARNING);
+                return;
+            }
+
+            this->comPort = comPort;
+            logger->Log("Puerto serie configurado: " + this->comPort, Logger::INFO);
+            return;
+        }
+#endif
+
         for (char& c : comPort) {
             c = std::toupper(c);
         }
@@ -292,18 +829,24 @@ void CommandLineInterface::UpdateBaudRate(const std::vector<std::string>& args)
         try {
             int baudrate = std::stoi(args[1]);
 
-            // Verificar que el baud rate sea uno de los comunes
-            if (std::find(commonBaudRates.begin(), commonBaudRates.end(), baudrate) != commonBaudRates.end()) {
-                if (this->baudRate == baudrate) {
-                    logger->Log("La tasa de baudios " + std::to_string(baudrate) + " ya está asignada.", Logger::WARNING);
-                    return;
-                }
+            if (baudrate < 50 || baudrate > 4000000) {
+                logger->Log("Tasa de baudios no válida para Arduino: " + std::to_string(baudrate), Logger::ERROR_LOG);
+                return;
+            }
+
+            if (this->baudRate == baudrate) {
+                logger->Log("La tasa de baudios " + std::to_string(baudrate) + " ya está asignada.", Logger::WARNING);
+                return;
+            }
+
+            this->baudRate = baudrate;
 
-                this->baudRate = baudrate;
+            // Las tasas no estándar (ej. 250000, 1000000) se aceptan, pero se avisa al usuario
+            if (std::find(commonBaudRates.begin(), commonBaudRates.end(), baudrate) != commonBaudRates.end()) {
                 logger->Log("Tasa de baudios configurada: " + std::to_string(this->baudRate), Logger::INFO);
             }
             else {
-                logger->Log("Tasa de baudios no válida para Arduino: " + std::to_string(baudrate), Logger::ERROR_LOG);
+                logger->Log("Tasa de baudios no estándar configurada: " + std::to_string(this->baudRate), Logger::WARNING);
             }
         }
         catch (const std::invalid_argument&) {
@@ -354,8 +897,448 @@ void CommandLineInterface::UpdateMaxConnections(const std::vector<std::string>&
     }
 }
 
+void CommandLineInterface::UpdateSlowClientPolicy(const std::string& policy) {
+    SendQueue::Policy value;
+    if (!SendQueue::ParsePolicy(policy, value)) {
+        logger->Log("Política inválida: " + policy + ". Usa drop, latest o disconnect.", Logger::ERROR_LOG);
+        return;
+    }
+
+    if (slowClientPolicy == value) {
+        logger->Log("La política " + policy + " ya está asignada.", Logger::WARNING);
+        return;
+    }
+
+    slowClientPolicy = value;
+    logger->Log("Política para clientes lentos configurada: " + policy, Logger::INFO);
+}
+
+void CommandLineInterface::UpdateDelta(const std::vector<std::string>& args) {
+    try {
+        int threshold = std::stoi(args[1]);
+        int interval = args.size() > 2 ? std::stoi(args[2]) : (int)keyframeInterval;
+        if (threshold < 0 || threshold > 1000 || interval < 100) {
+            logger->Log("Debes especificar un umbral entre 0 y 1000 cm y un intervalo de al menos 100 ms.", Logger::ERROR_LOG);
+            return;
+        }
+
+        deltaThreshold = (uint16_t)threshold;
+        keyframeInterval = (uint32_t)interval;
+        if (protocol != nullptr) {
+            for (size_t i = 0; i < protocol->DeviceCount(); ++i) {
+                protocol->Delta(i).Threshold(deltaThreshold);
+                protocol->Delta(i).KeyframeInterval(keyframeInterval);
+            }
+        }
+        logger->Log("Modo delta configurado: umbral " + std::to_string(deltaThreshold) + " cm, fotograma clave cada " +
+            std::to_string(keyframeInterval) + " ms.", Logger::INFO);
+    }
+    catch (const std::exception&) {
+        logger->Log("Parámetros del modo delta inválidos.", Logger::ERROR_LOG);
+    }
+}
+
+void CommandLineInterface::UpdateGrid(const std::string& decay) {
+    int value = 0;
+    try {
+        value = std::stoi(decay);
+    }
+    catch (const std::exception&) {
+        value = 0;
+    }
+    if (value < 1 || value > 255) {
+        logger->Log("Debes especificar una intensidad entre 1 y 255.", Logger::ERROR_LOG);
+        return;
+    }
+
+    gridDecay = (uint8_t)value;
+    if (protocol != nullptr) {
+        for (size_t i = 0; i < protocol->DeviceCount(); ++i) {
+            protocol->Grid(i).Decay(gridDecay);
+        }
+    }
+    logger->Log("Rejilla de ocupación configurada: -" + std::to_string(gridDecay) + " de intensidad cada " +
+        std::to_string(OccupancyGrid::TICK_MS) + " ms.", Logger::INFO);
+}
+
+void CommandLineInterface::UpdateFilter(const std::string& stage, const std::string& value) {
+    uint8_t bit;
+    if (stage == "off") {
+        filterStages = NoiseFilter::NONE;
+        bit = NoiseFilter::NONE;
+    }
+    else if (stage == "outlier") {
+        bit = NoiseFilter::OUTLIER;
+    }
+    else if (stage == "median") {
+        bit = NoiseFilter::MEDIAN;
+    }
+    else if (stage == "ema") {
+        bit = NoiseFilter::EMA;
+    }
+    else {
+        logger->Log("Etapa de filtro inválida: " + stage + " (outlier, median, ema u off).", Logger::ERROR_LOG);
+        return;
+    }
+
+    if (value == "off") {
+        filterStages &= (uint8_t)~bit;
+    }
+    else if (bit != NoiseFilter::NONE) {
+        if (!value.empty()) {
+            int number = 0;
+            try {
+                number = std::stoi(value);
+            }
+            catch (const std::exception&) {
+                number = -1;
+            }
+            if (bit == NoiseFilter::OUTLIER && (number < 1 || number > NoiseFilter::MAX_DISTANCE)) {
+                logger->Log("Debes especificar un salto entre 1 y " + std::to_string(NoiseFilter::MAX_DISTANCE) + " cm.", Logger::ERROR_LOG);
+                return;
+            }
+            if (bit == NoiseFilter::MEDIAN && number != 3 && number != 5) {
+                logger->Log("La ventana de la mediana debe ser 3 o 5.", Logger::ERROR_LOG);
+                return;
+            }
+            if (bit == NoiseFilter::EMA && (number < 1 || number > 100)) {
+                logger->Log("Debes especificar un peso entre 1 y 100 %.", Logger::ERROR_LOG);
+                return;
+            }
+            if (bit == NoiseFilter::OUTLIER) {
+                filterOutlier = (uint16_t)number;
+            }
+            else if (bit == NoiseFilter::MEDIAN) {
+                filterWindow = (uint8_t)number;
+            }
+            else {
+                filterSmoothing = (uint8_t)number;
+            }
+        }
+        filterStages |= bit;
+    }
+
+    if (protocol != nullptr) {
+        for (size_t i = 0; i < protocol->DeviceCount(); ++i) {
+            NoiseFilter& noise = protocol->Noise(i);
+            noise.OutlierThreshold(filterOutlier);
+            noise.Window(filterWindow);
+            noise.Smoothing(filterSmoothing);
+            noise.Stages(filterStages);
+        }
+    }
+    logger->Log("Filtro de ruido configurado: " + FilterName() + ".", Logger::INFO);
+}
+
+void CommandLineInterface::UpdateMetricsPort(const std::string& port) {
+    int value = 0;
+    if (port != "off") {
+        try {
+            value = std::stoi(port);
+        }
+        catch (const std::exception&) {
+            value = -1;
+        }
+        if (value < 1 || value > 65535) {
+            logger->Log("Debes especificar un puerto entre 1 y 65535 (u off).", Logger::ERROR_LOG);
+            return;
+        }
+    }
+
+    metricsPort = value;
+    if (metricsServer->IsRunning()) {
+        metricsServer->Stop();
+        if (metricsPort > 0) {
+            metricsServer->Start(metricsPort);
+        }
+    }
+    logger->Log(metricsPort > 0 ? "Métricas en el puerto local " + std::to_string(metricsPort) + "." : std::string("Métricas desactivadas."),
+        Logger::INFO);
+}
+
+void CommandLineInterface::UpdateLatencyReport(const std::string& seconds) {
+    int value = 0;
+    if (seconds != "off") {
+        try {
+            value = std::stoi(seconds);
+        }
+        catch (const std::exception&) {
+            value = -1;
+        }
+        if (value < 1 || value > 3600) {
+            logger->Log("Debes especificar entre 1 y 3600 segundos (u off).", Logger::ERROR_LOG);
+            return;
+        }
+    }
+
+    latencyInterval = value;
+    if (value == 0) {
+        StopLatencyReport();
+        logger->Log("Informe periódico de latencias desactivado.", Logger::INFO);
+        return;
+    }
+    if (isRunning) {
+        StartLatencyReport();
+    }
+    logger->Log("Latencias cada " + std::to_string(value) + " s mientras el servidor esté en marcha.", Logger::INFO);
+}
+
+void CommandLineInterface::StartLatencyReport() {
+    if (latencyInterval == 0 || latencyReporting) {
+        return;
+    }
+    if (latencyThread.joinable()) {
+        latencyThread.join();
+    }
+
+    // El hilo solo lee el registro de métricas; espera en pasos cortos para detenerse enseguida
+    latencyReporting = true;
+    latencyThread = std::thread([this]() {
+        auto last = std::chrono::steady_clock::now();
+        while (latencyReporting) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            int interval = latencyInterval;
+            if (interval > 0 && std::chrono::steady_clock::now() - last >= std::chrono::seconds(interval)) {
+                PrintLatency();
+                last = std::chrono::steady_clock::now();
+            }
+        }
+    });
+}
+
+void CommandLineInterface::StopLatencyReport() {
+    latencyReporting = false;
+    if (latencyThread.joinable()) {
+        latencyThread.join();
+    }
+}
+
+void CommandLineInterface::UpdateCapture(const std::string& path) {
+    if (path.empty()) {
+        logger->Log("Debes especificar un archivo de captura (u off).", Logger::ERROR_LOG);
+        return;
+    }
+
+    capturePath = path == "off" ? "" : path;
+    logger->Log(capturePath.empty() ? std::string("Captura desactivada.") :
+        "Las muestras se grabarán en " + capturePath + " al iniciar el servidor.", Logger::INFO);
+}
+
+void CommandLineInterface::UpdateHistory(const std::string& directory) {
+    if (directory.empty()) {
+        logger->Log("Debes especificar la carpeta del histórico (u off).", Logger::ERROR_LOG);
+        return;
+    }
+
+    historyDirectory = directory == "off" ? "" : directory;
+    logger->Log(historyDirectory.empty() ? std::string("Histórico desactivado.") :
+        "Las muestras se guardarán en el histórico de " + historyDirectory + " al iniciar el servidor.", Logger::INFO);
+}
+
+void CommandLineInterface::UpdateMulticast(const std::string& address, const std::string& ttl) {
+    if (address.empty()) {
+        logger->Log("Debes especificar una dirección (ip[:puerto]) u off.", Logger::ERROR_LOG);
+        return;
+    }
+    if (address == "off") {
+        multicastHost.clear();
+        logger->Log("Salida UDP desactivada.", Logger::INFO);
+        return;
+    }
+
+    std::string host;
+    int port = 0;
+    if (!multicast::ParseAddress(address, host, port)) {
+        logger->Log("Dirección UDP no válida: " + address + ".", Logger::ERROR_LOG);
+        return;
+    }
+    int hops = 1;
+    if (!ttl.empty()) {
+        try {
+            hops = std::stoi(ttl);
+        }
+        catch (...) {
+            hops = 0;
+        }
+        if (hops < 1 || hops > 255) {
+            logger->Log("El TTL debe estar entre 1 y 255.", Logger::ERROR_LOG);
+            return;
+        }
+    }
+
+    multicastHost = host;
+    multicastPort = port;
+    multicastTtl = hops;
+    logger->Log("Las muestras se enviarán también por UDP a " + host + ":" + std::to_string(port) + " al iniciar el servidor.",
+        Logger::INFO);
+}
+
+void CommandLineInterface::UpdateReplay(const std::string& path, const std::string& speed) {
+    if (path.empty()) {
+        logger->Log("Debes especificar un archivo de captura (u off).", Logger::ERROR_LOG);
+        return;
+    }
+    if (path == "off") {
+        replayPath.clear();
+        logger->Log("Las muestras volverán a leerse del Arduino.", Logger::INFO);
+        return;
+    }
+
+    double value = 1;
+    if (!speed.empty() && !ReplaySource::ParseSpeed(speed, value)) {
+        logger->Log("Velocidad inválida: " + speed + ". Usa 1, un factor como 10 o max.", Logger::ERROR_LOG);
+        return;
+    }
+
+    replayPath = path;
+    replaySpeed = value;
+    syntheticRate = 0;
+    logger->Log("Se reproducirá la captura " + replayPath + " a velocidad " + ReplaySource::SpeedName(replaySpeed) +
+        " al iniciar el servidor.", Logger::INFO);
+}
+
+void CommandLineInterface::UpdateSynthetic(const std::string& rate, const std::string& targets, const std::string& devices) {
+    if (rate.empty()) {
+        logger->Log("Debes especificar un ritmo en muestras por segundo (u off).", Logger::ERROR_LOG);
+        return;
+    }
+    if (rate == "off") {
+        syntheticRate = 0;
+        logger->Log("Las muestras volverán a leerse del Arduino.", Logger::INFO);
+        return;
+    }
+
+    uint32_t value = 0;
+    if (!SyntheticSource::ParseRate(rate, value)) {
+        logger->Log("Ritmo inválido: " + rate + ". Usa un valor entre 1 y 1m, por ejemplo 500, 50k o 1m.", Logger::ERROR_LOG);
+        return;
+    }
+
+    size_t count = syntheticTargets;
+    if (!targets.empty()) {
+        try {
+            count = (size_t)std::stoul(targets);
+        }
+        catch (const std::exception&) {
+            logger->Log("Número de blancos inválido: " + targets, Logger::ERROR_LOG);
+            return;
+        }
+        if (count > SyntheticScene::MAX_TARGETS) {
+            logger->Log("Como máximo se simulan " + std::to_string(SyntheticScene::MAX_TARGETS) + " blancos.", Logger::ERROR_LOG);
+            return;
+        }
+    }
+
+    size_t radars = 1;
+    if (!devices.empty()) {
+        if (devices.size() > 2 || devices.find_first_not_of("0123456789") != std::string::npos ||
+            (radars = (size_t)std::stoul(devices)) < 1 || radars > Protocol::MAX_DEVICES) {
+            logger->Log("Número de radares inválido: " + devices + ". Usa de 1 a " + std::to_string(Protocol::MAX_DEVICES) + ".",
+                Logger::ERROR_LOG);
+            return;
+        }
+    }
+
+    syntheticRate = value;
+    syntheticTargets = count;
+    syntheticDevices = radars;
+    replayPath.clear();
+    logger->Log("Se generarán " + std::to_string(syntheticRate) + " muestras/s sintéticas" +
+        (radars > 1 ? " por radar en " + std::to_string(radars) + " radares" : std::string("")) + " al iniciar el servidor.", Logger::INFO);
+}
+
+void CommandLineInterface::UpdateDevices(const std::string& ports) {
+    if (ports.empty()) {
+        logger->Log("Debes especificar los puertos separados por comas (u off).", Logger::ERROR_LOG);
+        return;
+    }
+    if (ports == "off") {
+        comPorts.clear();
+        logger->Log("Se leerá un único Arduino en " + comPort + ".", Logger::INFO);
+        return;
+    }
+
+    std::vector<std::string> list;
+    std::istringstream iss(ports);
+    std::string port;
+    while (std::getline(iss, port, ',')) {
+        if (!NormalizeComPort(port)) {
+            logger->Log("Puerto inválido: " + port + ". Usa COM1 a COM255 (o /dev/... en Linux).", Logger::ERROR_LOG);
+            return;
+        }
+        if (std::find(list.begin(), list.end(), port) != list.end()) {
+            logger->Log("El puerto " + port + " está repetido.", Logger::ERROR_LOG);
+            return;
+        }
+        list.push_back(port);
+    }
+    if (list.empty() || list.size() > Protocol::MAX_DEVICES) {
+        logger->Log("Debes especificar de 1 a " + std::to_string(Protocol::MAX_DEVICES) + " puertos.", Logger::ERROR_LOG);
+        return;
+    }
+
+    comPorts = list;
+    logger->Log("Se leerá de " + std::to_string(comPorts.size()) + " Arduinos: " + PortList(), Logger::INFO);
+}
+
+std::string CommandLineInterface::PortList() const {
+    std::string list;
+    for (size_t i = 0; i < comPorts.size(); ++i) {
+        list += (i > 0 ? ", " : "") + std::to_string(i) + "=" + comPorts[i];
+    }
+    return list;
+}
+
+std::string CommandLineInterface::SubscriptionName(uint64_t channel) const {
+    uint32_t subscription = Protocol::Subscription(channel);
+    if (subscription == 0) {
+        return "radar 0";
+    }
+
+    std::string list;
+    for (size_t device = 0; device < Protocol::MAX_DEVICES; ++device) {
+        if (subscription & (1u << device)) {
+            list += (list.empty() ? "" : ",") + std::to_string(device);
+        }
+    }
+    return "radares " + list;
+}
+
+std::string CommandLineInterface::FilterName() const {
+    if (filterStages == NoiseFilter::NONE) {
+        return "desactivado";
+    }
+
+    std::string name;
+    if (filterStages & NoiseFilter::OUTLIER) {
+        name += "saltos de más de " + std::to_string(filterOutlier) + " cm";
+    }
+    if (filterStages & NoiseFilter::MEDIAN) {
+        name += (name.empty() ? "" : ", ") + std::string("mediana de ") + std::to_string(filterWindow);
+    }
+    if (filterStages & NoiseFilter::EMA) {
+        name += (name.empty() ? "" : ", ") + std::string("media exponencial al ") + std::to_string(filterSmoothing) + " %";
+    }
+    return name;
+}
+
+std::string CommandLineInterface::SourceName() const {
+    if (syntheticRate > 0) {
+        return "sintético, " + std::to_string(syntheticRate) + " muestras/s y " + std::to_string(syntheticTargets) + " blancos" +
+            (syntheticDevices > 1 ? " en " + std::to_string(syntheticDevices) + " radares" : std::string(""));
+    }
+    if (!replayPath.empty()) {
+        return "captura " + replayPath + " a " + ReplaySource::SpeedName(replaySpeed);
+    }
+    return "Arduino";
+}
+
 void CommandLineInterface::ClearConsole() {
+#if defined(_WIN32) || defined(_WIN64)
     std::system("cls");
+#else
+    std::system("clear");
+#endif
 }
 
 void CommandLineInterface::RunServer(const std::vector<std::string>& args) {
@@ -372,12 +1355,57 @@ void CommandLineInterface::RunServer(const std::vector<std::string>& args) {
 }
 
 void CommandLineInterface::InitServer() {
-    logger = new Logger(debugMode);
-    handler = new Handler(comPort, baudRate, logger, debugMode);
-    protocol = new Protocol(host, port, handler, maxConnections, logger, debugMode);
+    logger->Debug(debugMode);
+    // Sin captura que reproducir ni generador, las muestras vienen del Arduino
+    // Una captura se reproduce siempre como el radar 0
+    sources.clear();
+    if (syntheticRate > 0) {
+        for (size_t i = 0; i < syntheticDevices; ++i) {
+            sources.push_back(new SyntheticSource(syntheticRate, syntheticTargets, logger, debugMode, (uint32_t)(i + 1)));
+        }
+    }
+    else if (!replayPath.empty()) {
+        sources.push_back(new ReplaySource(replayPath, replaySpeed, logger, debugMode));
+    }
+    else if (!comPorts.empty()) {
+        for (const auto& port : comPorts) {
+            sources.push_back(new Handler(port, baudRate, logger, debugMode, metrics));
+        }
+    }
+    else {
+        sources.push_back(new Handler(comPort, baudRate, logger, debugMode, metrics));
+    }
+    protocol = new Protocol(host, port, sources, maxConnections, logger, debugMode, slowClientPolicy, metrics);
+    for (size_t i = 0; i < protocol->DeviceCount(); ++i) {
+        protocol->Delta(i).Threshold(deltaThreshold);
+        protocol->Delta(i).KeyframeInterval(keyframeInterval);
+        protocol->Grid(i).Decay(gridDecay);
+        protocol->Noise(i).OutlierThreshold(filterOutlier);
+        protocol->Noise(i).Window(filterWindow);
+        protocol->Noise(i).Smoothing(filterSmoothing);
+        protocol->Noise(i).Stages(filterStages);
+    }
+    if (!capturePath.empty()) {
+        protocol->Capture(capturePath);
+    }
+    if (!multicastHost.empty()) {
+        protocol->Multicast(multicastHost, multicastPort, multicastTtl);
+    }
+    if (!historyDirectory.empty()) {
+        protocol->History(historyDirectory);
+    }
 
     if (protocol->Start()) {
         isRunning = true;
+        if (metricsPort > 0 && !metricsServer->IsRunning()) {
+            metricsServer->Start(metricsPort);
+        }
+        StartLatencyReport();
+#if !defined(_WIN32) && !defined(_WIN64)
+        // Sin teclas de función en la terminal: el servidor sigue en segundo plano
+        // y la consola vuelve a aceptar comandos (exit lo detiene).
+        logger->Log("Servidor en ejecución. Usa" + color::BRIGHT_RED + " exit " + color::RESET + "para detenerlo.", Logger::INFO);
+#else
         PrintKeyCommands();
 
         while (isRunning) {
@@ -390,7 +1418,9 @@ void CommandLineInterface::InitServer() {
             if (GetAsyncKeyState(VK_F9) & 0x8000) {
                 debugMode = !debugMode;
                 logger->Debug(debugMode);
-                handler->Debug(debugMode);
+                for (SampleSource* source : sources) {
+                    source->Debug(debugMode);
+                }
                 protocol->Debug(debugMode);
                 std::string debugState = (debugMode ? "Activado..." : "Desactivado...");
                 logger->Log("El Modo depuración a sido " + debugState, Logger::WARNING);
@@ -400,9 +1430,10 @@ void CommandLineInterface::InitServer() {
                 StopServer();
             }
         }
+#endif
     }
     else {
-        handler = nullptr;
+        sources.clear();
         protocol = nullptr;
         return;
     }
@@ -416,7 +1447,9 @@ void CommandLineInterface::StopServer() {
     }
     logger->Log("Deteniendo servidor actual, se cerraran todos los clientes...", Logger::WARNING);
     std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    StopLatencyReport();
     protocol->Stop();
+    metricsServer->Stop();
     isRunning = false;
     std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 }
\ No newline at end of file
@@ -1,18 +1,26 @@
 #pragma once
 
 #include <string>
+#include <atomic>
 #include <iostream>
 #include <sstream>
 #include <vector>
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
 #include <cstdlib>
 #include <thread>
 #include <chrono>
+#include <map>
+#if defined(_WIN32) || defined(_WIN64)
 #include <conio.h>
-#include "Logger.h"
-#include "Protocol.h"
-#include "Handler.h"
+#endif
+#include "logger.h"
+#include "protocol.h"
+#include "metricsserver.h"
+#include "handler.h"
+#include "replay.h"
+#include "synthetic.h"
 
 class CommandLineInterface {
 public:
@@ -26,24 +34,83 @@ private:
     void PrintCommands();
     void PrintCommander();
     void PrintKeyCommands();
+    void PrintClients();
+    void PrintSweep(const std::string& device);
+    void PrintDelta();
+    void PrintGrid();
+    void PrintFilter();
+    void PrintStats();
+    void PrintLatency();
+    void PrintObjects(const std::string& device);
+    void PrintHistory();
+    void QueryHistory(const std::string& request);
     void ClearConsole();
 
     void UpdatePort(const std::string& port);
     void UpdateComPort(const std::vector<std::string>& args);
     void UpdateBaudRate(const std::vector<std::string>& args);
     void UpdateMaxConnections(const std::vector<std::string>& args);
+    void UpdateSlowClientPolicy(const std::string& policy);
+    void UpdateDelta(const std::vector<std::string>& args);
+    void UpdateGrid(const std::string& decay);
+    void UpdateFilter(const std::string& stage, const std::string& value);
+    void UpdateMetricsPort(const std::string& port);
+    void UpdateLatencyReport(const std::string& seconds);
+    void StartLatencyReport();
+    void StopLatencyReport();
+    void UpdateCapture(const std::string& path);
+    void UpdateMulticast(const std::string& address, const std::string& ttl);
+    void UpdateHistory(const std::string& directory);
+    void UpdateReplay(const std::string& path, const std::string& speed);
+    void UpdateSynthetic(const std::string& rate, const std::string& targets, const std::string& devices);
+    void UpdateDevices(const std::string& ports);
+    std::string SourceName() const;
+    std::string PortList() const;
+    std::string SubscriptionName(uint64_t channel) const;
+    std::string FilterName() const;
     void InitServer();
     void StopServer();
 
-    Logger* logger = nullptr;
+    Logger* logger = new Logger();
+    MetricsRegistry* metrics = new MetricsRegistry();
+    MetricsServer* metricsServer = new MetricsServer(*metrics, logger);
     Protocol* protocol = nullptr;
-    Handler* handler = nullptr;
+    std::vector<SampleSource*> sources; ///< Un Handler por Arduino, o el ReplaySource o los SyntheticSource.
 
     std::string host = "0.0.0.0";
     int port = 25565;
+#if defined(_WIN32) || defined(_WIN64)
     std::string comPort = "COM3";
+#else
+    std::string comPort = "/dev/ttyACM0";
+#endif
+    std::vector<std::string> comPorts; ///< Puertos de varios radares; vacío para usar solo comPort.
     int baudRate = 9600;
     int maxConnections = 5;
+    SendQueue::Policy slowClientPolicy = SendQueue::DROP_OLDEST;
+    uint16_t deltaThreshold = DeltaFilter::DEFAULT_THRESHOLD;
+    uint32_t keyframeInterval = DeltaFilter::DEFAULT_KEYFRAME_MS;
+    uint8_t gridDecay = OccupancyGrid::DEFAULT_DECAY;
+    uint8_t filterStages = NoiseFilter::NONE;
+    uint8_t filterWindow = NoiseFilter::DEFAULT_WINDOW;
+    uint8_t filterSmoothing = NoiseFilter::DEFAULT_SMOOTHING;
+    uint16_t filterOutlier = NoiseFilter::DEFAULT_OUTLIER_CM;
+    int metricsPort = MetricsServer::DEFAULT_PORT; ///< 0 para no publicar las métricas por HTTP.
+    std::map<std::string, double> lastStats;      ///< Valores del último stats, para mostrar el ritmo.
+    std::chrono::steady_clock::time_point lastStatsTime;
+    std::atomic<int> latencyInterval{ 0 };        ///< Segundos entre informes de latencia; 0 solo bajo demanda.
+    std::atomic<bool> latencyReporting{ false };
+    std::thread latencyThread;                    ///< Imprime las latencias periódicamente mientras el servidor está en marcha.
+    std::string capturePath;  ///< Vacío si no se graba.
+    std::string multicastHost; ///< Vacío sin salida UDP.
+    int multicastPort = multicast::DEFAULT_PORT;
+    int multicastTtl = 1;
+    std::string historyDirectory; ///< Vacío si no se guarda el histórico.
+    std::string replayPath;   ///< Vacío para leer del Arduino.
+    double replaySpeed = 1;   ///< 0 reproduce sin esperas.
+    uint32_t syntheticRate = 0; ///< Muestras por segundo del generador; 0 para no usarlo.
+    size_t syntheticTargets = 3;
+    size_t syntheticDevices = 1; ///< Radares sintéticos, cada uno con su propia escena.
     bool debugMode = false;
     bool isRunning = false;
 };
\ No newline at end of file
@@ -0,0 +1,98 @@
+﻿// Benchmark del modo delta.
+//
+// Simula barridos de 15 a 165 grados sobre una escena fija: la mayoría de ángulos sin eco
+// (el sketch devuelve la distancia máxima), algunos obstáculos con ruido de medida de
+// +-1 cm y un objeto que se mueve. Para varios umbrales compara los bytes en texto que
+// recibiría un cliente completo y uno delta (incluidos los fotogramas clave) y mide el
+// coste de DeltaFilter::Accept por muestra.
+//
+// Compilar:
+//   g++ -std=c++17 -O2 -I.. bench_delta.cpp ../deltafilter.cpp -o bench_delta
+// Uso:
+//   ./bench_delta [barridos=2000] [muestras_por_segundo=50]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "deltafilter.h"
+
+namespace {
+    const uint16_t MAX_DISTANCE = 400;
+
+    std::vector<RadarSample> MakeSweeps(size_t sweeps, uint32_t perSecond) {
+        std::vector<RadarSample> samples;
+        uint32_t seed = 2024;
+        uint32_t sequence = 0;
+        uint64_t step = 1000000 / perSecond;
+
+        for (size_t sweep = 0; sweep < sweeps; ++sweep) {
+            bool up = sweep % 2 == 0;
+            uint16_t moving = (uint16_t)(40 + (sweep * 3) % 100);
+            for (int i = 0; i <= 150; ++i) {
+                uint16_t angle = (uint16_t)(up ? 15 + i : 165 - i);
+                seed = seed * 1103515245u + 12345u;
+                int noise = (int)((seed >> 16) % 3) - 1;
+
+                uint16_t distance = MAX_DISTANCE;
+                if (angle >= 30 && angle < 45) {
+                    distance = (uint16_t)(120 + noise);  // pared
+                }
+                else if (angle >= 100 && angle < 110) {
+                    distance = (uint16_t)(60 + noise);   // mueble
+                }
+                else if (angle >= moving && angle < moving + 5) {
+                    distance = (uint16_t)(30 + sweep % 50); // persona que se acerca y se aleja
+                }
+
+                RadarSample sample;
+                sample.angle = angle;
+                sample.distance = distance;
+                sample.sequence = sequence;
+                sample.timestamp = sequence * step;
+                sequence++;
+                samples.push_back(sample);
+            }
+        }
+        return samples;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t sweeps = argc > 1 ? (size_t)atoi(argv[1]) : 2000;
+    uint32_t perSecond = argc > 2 ? (uint32_t)atoi(argv[2]) : 50;
+
+    std::vector<RadarSample> samples = MakeSweeps(sweeps, perSecond);
+    size_t fullBytes = 0;
+    char text[16];
+    for (const RadarSample& sample : samples) {
+        fullBytes += FormatSample(sample, text);
+    }
+
+    printf("%-8s %12s %12s %12s %10s %10s\n", "umbral", "bytes_full", "bytes_delta", "ahorro_%", "clave", "ns/muestra");
+    for (uint16_t threshold : { (uint16_t)0, (uint16_t)1, (uint16_t)2, (uint16_t)5 }) {
+        DeltaFilter filter;
+        filter.Threshold(threshold);
+        std::vector<RadarSample> keyframe(DeltaFilter::ANGLES);
+
+        size_t deltaBytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const RadarSample& sample : samples) {
+            if (filter.Accept(sample)) {
+                deltaBytes += FormatSample(sample, text);
+            }
+            if (filter.KeyframeDue(sample.timestamp)) {
+                size_t count = filter.Keyframe(keyframe.data(), sample.timestamp);
+                for (size_t i = 0; i < count; ++i) {
+                    deltaBytes += FormatSample(keyframe[i], text);
+                }
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        printf("%-8u %12zu %12zu %12.1f %10llu %10.1f\n", threshold, fullBytes, deltaBytes,
+            100.0 * (1.0 - (double)deltaBytes / fullBytes), (unsigned long long)filter.KeyframeSamples(),
+            seconds * 1e9 / samples.size());
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+﻿// Benchmark de la lectura de varios radares a la vez (solo Linux).
+//
+// Arranca Protocol con N orígenes sintéticos (un hilo lector por radar) para N = 1, 2,
+// 4, ... hasta el máximo pedido, conecta un cliente binario suscrito a todos los radares
+// ("SUBSCRIBE ALL") y mide durante unos segundos:
+//   - muestras por segundo que recibe el cliente (agregado de todos los radares),
+//   - muestras perdidas (huecos en el número de muestra de cada radar) y descartadas por cola llena,
+//   - tramas fuera de orden: el flujo mezclado debe llegar ordenado por instante de lectura,
+//   - uso de CPU del proceso.
+//
+// Compilar (enlaza casi todo el servidor, así que con CMake, desde ServerV2):
+//   cmake -S . -B build && cmake --build build --target bench_devices
+// Uso:
+//   ./bench_devices [max_radares=32] [muestras_por_segundo_y_radar=10000] [segundos=2]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/resource.h>
+#include "protocol.h"
+#include "synthetic.h"
+#include "wireformat.h"
+
+namespace {
+    const int PORT = 27014;
+
+    double CpuSeconds() {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+            usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    }
+
+    SOCKET Connect(int port) {
+        SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            perror("connect");
+            exit(1);
+        }
+        timeval timeout = { 0, 100000 };
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return s;
+    }
+
+    struct Result {
+        uint64_t received = 0;
+        uint64_t lost = 0;
+        uint64_t disorder = 0;
+        bool subscribed = false;
+    };
+
+    struct Client {
+        SOCKET socket;
+        std::string buffer;
+        bool binary = false;
+        std::vector<int64_t> nextSequence;
+        uint64_t lastTime = 0;
+    };
+
+    /// Lee del cliente hasta deadline: la respuesta de texto a PROTO y luego tramas binarias.
+    void ReadClient(Client& client, std::chrono::steady_clock::time_point deadline, Result& result) {
+        SOCKET s = client.socket;
+        size_t devices = client.nextSequence.size();
+        std::string& buffer = client.buffer;
+        std::vector<int64_t>& nextSequence = client.nextSequence;
+        uint64_t& lastTime = client.lastTime;
+        bool& binary = client.binary;
+        char chunk[65536];
+        wire::Message message;
+
+        while (std::chrono::steady_clock::now() < deadline) {
+            ssize_t n = recv(s, chunk, sizeof(chunk), 0);
+            if (n == 0) {
+                break;
+            }
+            if (n < 0) {
+                continue;
+            }
+            buffer.append(chunk, (size_t)n);
+
+            // Hasta la respuesta a PROTO llegan muestras en texto, que se ignoran
+            size_t start = 0;
+            size_t end;
+            while (!binary && (end = buffer.find('\n', start)) != std::string::npos) {
+                binary = buffer.compare(start, end - start, "PROTO BIN/1") == 0;
+                start = end + 1;
+            }
+            if (!binary) {
+                buffer.erase(0, start);
+                continue;
+            }
+
+            size_t consumed = 0;
+            while (true) {
+                message.samples.clear();
+                wire::DecodeResult decoded = wire::DecodeFrame(buffer.data() + start, buffer.size() - start, consumed, message);
+                if (decoded == wire::INVALID) {
+                    fprintf(stderr, "trama inválida\n");
+                    exit(1);
+                }
+                if (decoded == wire::INCOMPLETE) {
+                    break;
+                }
+                start += consumed;
+
+                if (message.header.type == wire::TEXT) {
+                    result.subscribed = result.subscribed || message.text.rfind("SUBSCRIBE", 0) == 0;
+                }
+                for (const RadarSample& sample : message.samples) {
+                    if (sample.device >= devices) {
+                        continue;
+                    }
+                    int64_t& expected = nextSequence[sample.device];
+                    if (expected >= 0 && sample.sequence > expected) {
+                        result.lost += sample.sequence - (uint64_t)expected;
+                    }
+                    expected = (int64_t)sample.sequence + 1;
+                    if (sample.timestamp < lastTime) {
+                        result.disorder++;
+                    }
+                    lastTime = sample.timestamp;
+                    result.received++;
+                }
+            }
+            buffer.erase(0, start);
+        }
+    }
+
+    void RunScenario(size_t devices, uint32_t rate, int seconds, Logger* logger) {
+        std::vector<std::unique_ptr<SyntheticSource>> owned;
+        std::vector<SampleSource*> sources;
+        for (size_t i = 0; i < devices; ++i) {
+            owned.emplace_back(new SyntheticSource(rate, 3, logger, false, (uint32_t)(i + 1)));
+            sources.push_back(owned.back().get());
+        }
+
+        Protocol protocol("127.0.0.1", PORT, sources, 4, logger, false, SendQueue::DROP_OLDEST);
+        if (!protocol.Start()) {
+            fprintf(stderr, "no se pudo iniciar el servidor en el puerto %d\n", PORT);
+            exit(1);
+        }
+
+        Client client;
+        client.socket = Connect(PORT);
+        client.nextSequence.assign(devices, -1);
+        std::string hello = "PROTO BIN/1\nSUBSCRIBE ALL\n";
+        send(client.socket, hello.data(), hello.size(), 0);
+
+        // Se descarta el primer medio segundo (arranque de los hilos y de la conexión)
+        Result warmup;
+        ReadClient(client, std::chrono::steady_clock::now() + std::chrono::milliseconds(500), warmup);
+
+        Result result;
+        double cpuStart = CpuSeconds();
+        auto start = std::chrono::steady_clock::now();
+        uint64_t droppedStart = protocol.DroppedSamples();
+        ReadClient(client, start + std::chrono::seconds(seconds), result);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double cpu = CpuSeconds() - cpuStart;
+        uint64_t dropped = protocol.DroppedSamples() - droppedStart;
+
+        closesocket(client.socket);
+        protocol.Stop();
+
+        printf("%7zu %12u %12.0f %9.2f%% %10llu %9llu %7.0f%% %s\n", devices, (unsigned)(rate * devices),
+            result.received / elapsed,
+            result.received + result.lost > 0 ? 100.0 * result.lost / (result.received + result.lost) : 0.0,
+            (unsigned long long)dropped, (unsigned long long)result.disorder, 100.0 * cpu / elapsed,
+            warmup.subscribed || result.subscribed ? "" : "(sin respuesta a SUBSCRIBE)");
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxDevices = argc > 1 ? (size_t)atoi(argv[1]) : 32;
+    uint32_t rate = argc > 2 ? (uint32_t)atoi(argv[2]) : 10000;
+    int seconds = argc > 3 ? atoi(argv[3]) : 2;
+    maxDevices = std::min<size_t>(maxDevices, Protocol::MAX_DEVICES);
+
+    signal(SIGPIPE, SIG_IGN);
+
+    // Los avisos del Logger no forman parte de la medida.
+    std::cout.rdbuf(nullptr);
+    Logger logger(false);
+
+    printf("%7s %12s %12s %10s %10s %9s %8s\n", "radares", "ofrecido/s", "recibido/s", "perdido", "cola_llena", "desorden", "cpu");
+    for (size_t devices = 1; devices <= maxDevices; devices *= 2) {
+        RunScenario(devices, rate, seconds, &logger);
+    }
+    return 0;
+}
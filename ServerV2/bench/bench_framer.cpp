@@ -0,0 +1,156 @@
+﻿// Microbenchmark del separador de tramas serie.
+//
+// Compara el bucle anterior de Handler::ReadFromArduino (un readChar por byte, std::string
+// nueva por muestra, remove_if de "\r\n" y un segundo remove de '.' en Protocol) con el
+// Framer (lecturas en bloque sobre un anillo fijo y búsqueda SIMD de terminadores).
+// Ambos leen de memoria, así que el coste de las llamadas al sistema queda fuera: en el
+// puerto real la diferencia es mayor (una lectura por byte frente a una por bloque).
+//
+// Compilar:
+//   g++ -std=c++17 -O2 -march=native -I.. bench_framer.cpp ../framer.cpp -o bench_framer
+// Uso:
+//   ./bench_framer [muestras=2000000]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "framer.h"
+
+namespace {
+    /// Fuente en memoria con la misma interfaz de lectura que Serial.
+    class MemorySource {
+    public:
+        explicit MemorySource(const std::string& data) : data(data), position(0) {}
+
+        int readChar(char* byte) {
+            if (position >= data.size()) return 0;
+            *byte = data[position++];
+            return 1;
+        }
+
+        int readBytes(void* buffer, unsigned int maxNbBytes) {
+            size_t count = std::min<size_t>(maxNbBytes, data.size() - position);
+            memcpy(buffer, data.data() + position, count);
+            position += count;
+            return (int)count;
+        }
+
+        bool done() const {
+            return position >= data.size();
+        }
+
+    private:
+        const std::string& data;
+        size_t position;
+    };
+
+    /// Salida del sketch de Arduino: barrido 15-165-15 con "ángulo,distancia.\r\n".
+    std::string GenerateStream(size_t samples) {
+        std::string stream;
+        stream.reserve(samples * 10);
+        int angle = 15;
+        int step = 1;
+        for (size_t i = 0; i < samples; ++i) {
+            int distance = (i % 7 == 0) ? 50 : (int)(3 + (i * 37) % 47);
+            stream += std::to_string(angle) + "," + std::to_string(distance) + ".\r\n";
+            angle += step;
+            if (angle >= 165 || angle <= 15) step = -step;
+        }
+        return stream;
+    }
+
+    /// Copia del código anterior de ReadFromArduino + ReadAndBroadcastArduinoData.
+    std::string LegacyRead(MemorySource& source) {
+        std::string data;
+        char currentChar;
+        for (int i = 0; i < 180; ++i) {
+            if (source.readChar(&currentChar) <= 0) break;
+            data += currentChar;
+            if (currentChar == '.') break;
+        }
+        if (!data.empty() && data.back() == '.') data.pop_back();
+        data.erase(std::remove_if(data.begin(), data.end(), [](char c) {
+            return c == '\n' || c == '\r';
+            }), data.end());
+        return data;
+    }
+
+    double Seconds(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t samples = argc > 1 ? (size_t)atoll(argv[1]) : 2000000;
+    std::string stream = GenerateStream(samples);
+    volatile size_t sink = 0;
+
+    // Bucle anterior
+    size_t legacyCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        MemorySource source(stream);
+        while (!source.done()) {
+            std::string arduinoData = LegacyRead(source);
+            if (!arduinoData.empty()) {
+                arduinoData.erase(std::remove(arduinoData.begin(), arduinoData.end(), '.'), arduinoData.end());
+                std::string message = arduinoData + '\n';
+                sink += message.size();
+                legacyCount++;
+            }
+        }
+    }
+    double legacySeconds = Seconds(start);
+
+    // Framer con lecturas de tamaño variable (las líneas quedan partidas entre lecturas)
+    size_t framerCount = 0;
+    start = std::chrono::steady_clock::now();
+    {
+        MemorySource source(stream);
+        Framer framer;
+        RadarSample sample;
+        char text[16];
+        unsigned chunk = 1;
+        while (!source.done() || framer.Buffered() > 0) {
+            while (framer.Next(sample)) {
+                sink += FormatSample(sample, text);
+                framerCount++;
+            }
+            if (source.done()) break;
+            size_t available;
+            char* buffer = framer.WriteBuffer(available);
+            chunk = chunk * 1103515245u + 12345u;
+            unsigned request = 1 + (chunk >> 16) % 256;
+            framer.Commit((size_t)source.readBytes(buffer, (unsigned)std::min<size_t>(request, available)));
+        }
+    }
+    double framerSeconds = Seconds(start);
+
+    // Búsqueda de terminadores aislada sobre el flujo completo
+    start = std::chrono::steady_clock::now();
+    size_t terminators = 0;
+    for (size_t i = 0; i < stream.size();) {
+        size_t index = FindTerminator(stream.data() + i, stream.size() - i);
+        if (index == stream.size() - i) break;
+        terminators++;
+        i += index + 1;
+    }
+    double scanSeconds = Seconds(start);
+
+    printf("%-22s %12s %14s\n", "ruta", "muestras", "muestras/s");
+    printf("%-22s %12zu %14.0f\n", "bucle-anterior", legacyCount, legacyCount / legacySeconds);
+    printf("%-22s %12zu %14.0f\n", "framer", framerCount, framerCount / framerSeconds);
+    printf("%-22s %12zu %14.0f  (%.2f GB/s)\n", "solo-terminadores", terminators, terminators / scanSeconds,
+        stream.size() / scanSeconds / 1e9);
+    printf("aceleracion framer: %.1fx\n", (framerCount / framerSeconds) / (legacyCount / legacySeconds));
+
+    if (legacyCount != framerCount) {
+        fprintf(stderr, "las rutas no coinciden: %zu frente a %zu muestras\n", legacyCount, framerCount);
+        return 1;
+    }
+    return sink == 0;
+}
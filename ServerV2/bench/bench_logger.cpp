@@ -0,0 +1,163 @@
+﻿// Benchmark del Logger (solo Linux).
+//
+// Compara el Logger anterior (formato con varias std::string temporales, std::cout y
+// std::endl en el hilo que registra) con el Logger asíncrono (registro de tamaño fijo en
+// una cola MPSC y escritura por lotes en un hilo propio). Mide:
+//   - coste por llamada en el hilo que registra (p50/p99) con un solo hilo,
+//   - mensajes por segundo con varios hilos registrando a la vez,
+//   - coste de un mensaje DEBUG desactivado construido en la llamada frente a LOG_DEBUG.
+// La salida se redirige a /dev/null durante las medidas.
+//
+// Compilar:
+//   g++ -std=c++17 -O2 -pthread -I.. bench_logger.cpp ../logger.cpp ../color.cpp -o bench_logger
+// Uso:
+//   ./bench_logger [mensajes=200000] [hilos=4]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "logger.h"
+
+namespace {
+    uint64_t NowNs() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Copia del Logger anterior, síncrono.
+    class LegacyLogger {
+    public:
+        explicit LegacyLogger(bool debug) : debug(debug) {}
+
+        void Log(const std::string& message, Logger::Severity severity) {
+            std::string severityStr;
+            std::string colorStr;
+            switch (severity) {
+            case Logger::WARNING:
+                severityStr = "WARNING";
+                colorStr = color::yellow(severityStr, true);
+                break;
+            case Logger::ERROR_LOG:
+                severityStr = "ERROR";
+                colorStr = color::red(severityStr, true);
+                break;
+            case Logger::DEBUG:
+                if (!debug) return;
+                severityStr = "DEBUG";
+                colorStr = color::green(severityStr, true);
+                break;
+            default:
+                severityStr = "INFO";
+                colorStr = color::cyan(severityStr, true);
+                break;
+            }
+            std::cout << color::white(" [") << colorStr << color::white("] ") << color::RESET << message << std::endl;
+        }
+
+    private:
+        bool debug;
+    };
+
+    struct Percentiles {
+        double p50;
+        double p99;
+        double perSecond;
+    };
+
+    template <typename LogFn>
+    Percentiles MeasureCalls(size_t messages, LogFn log) {
+        std::vector<uint32_t> costs(messages);
+        uint64_t start = NowNs();
+        for (size_t i = 0; i < messages; ++i) {
+            uint64_t before = NowNs();
+            log(i);
+            costs[i] = (uint32_t)std::min<uint64_t>(NowNs() - before, 0xFFFFFFFFu);
+        }
+        double seconds = (NowNs() - start) / 1e9;
+        std::sort(costs.begin(), costs.end());
+        return { (double)costs[messages / 2], (double)costs[std::min(messages - 1, messages * 99 / 100)], messages / seconds };
+    }
+
+    template <typename LogFn>
+    double MeasureThreads(size_t messages, size_t threads, LogFn log) {
+        std::vector<std::thread> workers;
+        uint64_t start = NowNs();
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                for (size_t i = 0; i < messages / threads; ++i) {
+                    log(t * messages + i);
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        return messages / ((NowNs() - start) / 1e9);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t messages = argc > 1 ? (size_t)atoll(argv[1]) : 200000;
+    size_t threads = argc > 2 ? (size_t)atoi(argv[2]) : 4;
+
+    // Todo lo que escriban los loggers va a /dev/null; los resultados, a la salida original.
+    fflush(stdout);
+    int original = dup(STDOUT_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+
+    LegacyLogger legacy(false);
+    Percentiles legacyCalls = MeasureCalls(messages, [&](size_t i) {
+        legacy.Log("Cliente conectado desde 192.168.1." + std::to_string(i % 255) + ":5000.", Logger::INFO);
+    });
+    double legacyThreads = MeasureThreads(messages, threads, [&](size_t i) {
+        legacy.Log("Cliente conectado desde 192.168.1." + std::to_string(i % 255) + ":5000.", Logger::INFO);
+    });
+    Percentiles legacyDebug = MeasureCalls(messages, [&](size_t i) {
+        legacy.Log("Datos de Arduino: " + std::to_string(i % 180) + "," + std::to_string(i % 400), Logger::DEBUG);
+    });
+
+    Percentiles asyncCalls;
+    double asyncThreads;
+    Percentiles asyncDebug;
+    uint64_t dropped;
+    double drainSeconds;
+    {
+        Logger logger(false);
+        asyncCalls = MeasureCalls(messages, [&](size_t i) {
+            logger.Log("Cliente conectado desde 192.168.1." + std::to_string(i % 255) + ":5000.", Logger::INFO);
+        });
+        asyncThreads = MeasureThreads(messages, threads, [&](size_t i) {
+            logger.Log("Cliente conectado desde 192.168.1." + std::to_string(i % 255) + ":5000.", Logger::INFO);
+        });
+        asyncDebug = MeasureCalls(messages, [&](size_t i) {
+            LOG_DEBUG(&logger, "Datos de Arduino: " + std::to_string(i % 180) + "," + std::to_string(i % 400));
+        });
+        uint64_t start = NowNs();
+        logger.Flush();
+        drainSeconds = (NowNs() - start) / 1e9;
+        dropped = logger.Dropped();
+    }
+
+    fflush(stdout);
+    dup2(original, STDOUT_FILENO);
+    close(devNull);
+    close(original);
+
+    printf("%-28s %10s %10s %14s\n", "caso", "p50_ns", "p99_ns", "mensajes/s");
+    printf("%-28s %10.0f %10.0f %14.0f\n", "anterior/info", legacyCalls.p50, legacyCalls.p99, legacyCalls.perSecond);
+    printf("%-28s %10.0f %10.0f %14.0f\n", "asincrono/info", asyncCalls.p50, asyncCalls.p99, asyncCalls.perSecond);
+    printf("%-28s %10s %10s %14.0f\n", ("anterior/" + std::to_string(threads) + "-hilos").c_str(), "-", "-", legacyThreads);
+    printf("%-28s %10s %10s %14.0f\n", ("asincrono/" + std::to_string(threads) + "-hilos").c_str(), "-", "-", asyncThreads);
+    printf("%-28s %10.0f %10.0f %14.0f\n", "anterior/debug-desactivado", legacyDebug.p50, legacyDebug.p99, legacyDebug.perSecond);
+    printf("%-28s %10.0f %10.0f %14.0f\n", "LOG_DEBUG/desactivado", asyncDebug.p50, asyncDebug.p99, asyncDebug.perSecond);
+    printf("descartados por cola llena: %llu, vaciado final: %.1f ms\n", (unsigned long long)dropped, drainSeconds * 1e3);
+    return 0;
+}
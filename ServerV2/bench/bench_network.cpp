@@ -0,0 +1,374 @@
+﻿// Benchmark del motor de red de Protocol (solo Linux).
+//
+// Compara el bucle de eventos (EventLoop sobre epoll) con el esquema anterior de un
+// hilo por cliente y send() bloqueante. Para cada motor conecta N clientes desde un
+// proceso hijo y mide:
+//   - uso de CPU del servidor con los clientes conectados sin tráfico (inactivo),
+//   - uso de CPU y latencia de entrega (p50/p99/max) difundiendo R mensajes por segundo (activo).
+//
+// Compilar:
+//   g++ -std=c++17 -O2 -pthread -I.. bench_network.cpp ../eventloop.cpp ../poller.cpp ../sendqueue.cpp ../metrics.cpp ../logger.cpp ../color.cpp -o bench_network
+// Uso:
+//   ./bench_network [clientes=1000] [mensajes_por_segundo=100] [segundos=3]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "eventloop.h"
+
+namespace {
+    const size_t MAX_MESSAGES = 1 << 20;
+
+    uint64_t NowNs() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    double CpuSeconds() {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+            usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    }
+
+    void RaiseFileLimit(size_t needed) {
+        rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < needed) {
+            limit.rlim_cur = std::min<rlim_t>(needed, limit.rlim_max);
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+
+    /// Interfaz común de los dos motores comparados.
+    class Server {
+    public:
+        virtual ~Server() {}
+        virtual bool Start(SOCKET listenSocket) = 0;
+        virtual void Broadcast(const std::string& message) = 0;
+        virtual void Stop() = 0;
+        virtual size_t Clients() = 0;
+        virtual const char* Name() const = 0;
+    };
+
+    /// Reproducción del Protocol anterior: un hilo por cliente y send() bloqueante
+    /// desde el hilo que difunde. Se añade un mutex sobre la lista de clientes solo
+    /// para que el benchmark no falle por la carrera de datos del código original.
+    class ThreadPerClientServer : public Server {
+    public:
+        bool Start(SOCKET listenSocket) override {
+            this->listenSocket = listenSocket;
+            running = true;
+            threads = 1;
+            std::thread(&ThreadPerClientServer::AcceptClients, this).detach();
+            return true;
+        }
+
+        void Broadcast(const std::string& message) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (SOCKET client : clients) {
+                send(client, message.c_str(), message.length(), net::SEND_FLAGS);
+            }
+        }
+
+        void Stop() override {
+            running = false;
+            shutdown(listenSocket, SHUT_RDWR);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (SOCKET client : clients) {
+                    shutdown(client, SHUT_RDWR);
+                }
+            }
+            while (threads > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        size_t Clients() override {
+            std::lock_guard<std::mutex> lock(mutex);
+            return clients.size();
+        }
+
+        const char* Name() const override {
+            return "hilo-por-cliente";
+        }
+
+    private:
+        void AcceptClients() {
+            while (running) {
+                SOCKET clientSocket = accept(listenSocket, nullptr, nullptr);
+                if (clientSocket == INVALID_SOCKET) {
+                    continue;
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                clients.push_back(clientSocket);
+                threads++;
+                std::thread(&ThreadPerClientServer::HandleClient, this, clientSocket).detach();
+            }
+            threads--;
+        }
+
+        void HandleClient(SOCKET clientSocket) {
+            char buffer[1024];
+            while (recv(clientSocket, buffer, sizeof(buffer), 0) > 0) {
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            clients.erase(std::remove(clients.begin(), clients.end(), clientSocket), clients.end());
+            closesocket(clientSocket);
+            threads--;
+        }
+
+        SOCKET listenSocket = INVALID_SOCKET;
+        std::atomic<bool> running{ false };
+        std::atomic<int> threads{ 0 };
+        std::mutex mutex;
+        std::vector<SOCKET> clients;
+    };
+
+    /// Motor actual de Protocol.
+    class EventLoopServer : public Server {
+    public:
+        EventLoopServer(Logger* logger, int maxConnections) : loop(logger, maxConnections) {}
+
+        bool Start(SOCKET listenSocket) override {
+            return loop.Start(listenSocket);
+        }
+
+        void Broadcast(const std::string& message) override {
+            loop.Broadcast(MakeFrame(message));
+        }
+
+        void Stop() override {
+            loop.Stop();
+        }
+
+        size_t Clients() override {
+            return loop.ClientCount();
+        }
+
+        const char* Name() const override {
+            return "epoll";
+        }
+
+    private:
+        EventLoop loop;
+    };
+
+    struct Summary {
+        uint64_t received;
+        uint64_t p50Ns;
+        uint64_t p99Ns;
+        uint64_t maxNs;
+    };
+
+    /// Proceso hijo: conecta los clientes, lee las líneas "ángulo,secuencia\n" y calcula
+    /// la latencia con la marca de tiempo que el padre guardó en memoria compartida.
+    void RunClients(int port, size_t count, const std::atomic<uint64_t>* sendTimes, int controlFd, int resultFd) {
+        RaiseFileLimit(count + 64);
+
+        int epollFd = epoll_create1(0);
+        std::unordered_map<int, std::string> partial;
+        for (size_t i = 0; i < count; ++i) {
+            SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons((uint16_t)port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+                perror("connect");
+                _exit(1);
+            }
+            net::SetNonBlocking(s);
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.fd = s;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, s, &ev);
+            partial[s];
+        }
+
+        epoll_event control = {};
+        control.events = EPOLLIN;
+        control.data.fd = controlFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, controlFd, &control);
+
+        std::vector<uint64_t> latencies;
+        latencies.reserve(1 << 20);
+        std::vector<epoll_event> events(512);
+        char buffer[4096];
+        bool done = false;
+        uint64_t doneAt = 0;
+
+        while (!done || NowNs() - doneAt < 200000000ull) {
+            int ready = epoll_wait(epollFd, events.data(), (int)events.size(), 50);
+            for (int i = 0; i < ready; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == controlFd) {
+                    done = true;
+                    doneAt = NowNs();
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, controlFd, nullptr);
+                    continue;
+                }
+
+                ssize_t n;
+                while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+                    uint64_t now = NowNs();
+                    std::string& line = partial[fd];
+                    line.append(buffer, (size_t)n);
+                    size_t start = 0, end;
+                    while ((end = line.find('\n', start)) != std::string::npos) {
+                        size_t comma = line.find(',', start);
+                        if (comma != std::string::npos && comma < end) {
+                            uint64_t seq = strtoull(line.c_str() + comma + 1, nullptr, 10);
+                            if (seq < MAX_MESSAGES) {
+                                latencies.push_back(now - sendTimes[seq].load(std::memory_order_acquire));
+                            }
+                        }
+                        start = end + 1;
+                    }
+                    line.erase(0, start);
+                }
+            }
+        }
+
+        Summary summary = {};
+        summary.received = latencies.size();
+        if (!latencies.empty()) {
+            std::sort(latencies.begin(), latencies.end());
+            summary.p50Ns = latencies[latencies.size() / 2];
+            summary.p99Ns = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+            summary.maxNs = latencies.back();
+        }
+        ssize_t written = write(resultFd, &summary, sizeof(summary));
+        (void)written;
+        _exit(0);
+    }
+
+    SOCKET Listen(int& port) {
+        SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t length = sizeof(addr);
+        if (bind(listenSocket, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenSocket, SOMAXCONN) != 0 ||
+            getsockname(listenSocket, (sockaddr*)&addr, &length) != 0) {
+            perror("listen");
+            exit(1);
+        }
+        port = ntohs(addr.sin_port);
+        return listenSocket;
+    }
+
+    void RunScenario(Server& server, size_t clients, int rate, int seconds, std::atomic<uint64_t>* sendTimes) {
+        int port = 0;
+        SOCKET listenSocket = Listen(port);
+        server.Start(listenSocket);
+
+        int controlPipe[2], resultPipe[2];
+        if (pipe(controlPipe) != 0 || pipe(resultPipe) != 0) {
+            perror("pipe");
+            exit(1);
+        }
+
+        pid_t child = fork();
+        if (child == 0) {
+            close(controlPipe[1]);
+            close(resultPipe[0]);
+            RunClients(port, clients, sendTimes, controlPipe[0], resultPipe[1]);
+        }
+        close(controlPipe[0]);
+        close(resultPipe[1]);
+
+        uint64_t deadline = NowNs() + 30000000000ull;
+        while (server.Clients() < clients && NowNs() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (server.Clients() < clients) {
+            fprintf(stderr, "%s: solo se conectaron %zu de %zu clientes\n", server.Name(), server.Clients(), clients);
+        }
+
+        // Fase inactiva: clientes conectados sin tráfico.
+        double cpuStart = CpuSeconds();
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        double idleCpu = (CpuSeconds() - cpuStart) / seconds;
+
+        // Fase activa: difusión a ritmo constante, mismo formato de texto que el radar.
+        uint64_t period = 1000000000ull / (uint64_t)rate;
+        uint64_t messages = std::min<uint64_t>((uint64_t)rate * (uint64_t)seconds, MAX_MESSAGES);
+        cpuStart = CpuSeconds();
+        uint64_t next = NowNs();
+        for (uint64_t seq = 0; seq < messages; ++seq) {
+            while (NowNs() < next) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            std::string message = std::to_string(15 + seq % 151) + "," + std::to_string(seq) + "\n";
+            sendTimes[seq].store(NowNs(), std::memory_order_release);
+            server.Broadcast(message);
+            next += period;
+        }
+        double activeCpu = (CpuSeconds() - cpuStart) / seconds;
+
+        close(controlPipe[1]);
+        Summary summary = {};
+        ssize_t readBytes = read(resultPipe[0], &summary, sizeof(summary));
+        (void)readBytes;
+        close(resultPipe[0]);
+        waitpid(child, nullptr, 0);
+
+        server.Stop();
+        closesocket(listenSocket);
+
+        uint64_t expected = messages * clients;
+        printf("%-17s %8zu %10s %10.1f %10s %8s %8s %8s\n", server.Name(), clients, "inactivo", idleCpu * 1000.0, "-", "-", "-", "-");
+        printf("%-17s %8zu %10s %10.1f %9.1f%% %8.1f %8.1f %8.1f\n", server.Name(), clients, "activo", activeCpu * 1000.0,
+            expected ? 100.0 * summary.received / expected : 0.0,
+            summary.p50Ns / 1e3, summary.p99Ns / 1e3, summary.maxNs / 1e3);
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t clients = argc > 1 ? (size_t)atoi(argv[1]) : 1000;
+    int rate = argc > 2 ? atoi(argv[2]) : 100;
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+
+    signal(SIGPIPE, SIG_IGN);
+    RaiseFileLimit(clients * 2 + 64);
+
+    // Marcas de tiempo de envío compartidas con el proceso hijo.
+    void* shared = mmap(nullptr, MAX_MESSAGES * sizeof(std::atomic<uint64_t>), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    auto* sendTimes = static_cast<std::atomic<uint64_t>*>(shared);
+
+    // Los mensajes de conexión del Logger no forman parte de la medida.
+    std::cout.rdbuf(nullptr);
+    Logger logger(false);
+
+    printf("%-17s %8s %10s %10s %10s %8s %8s %8s\n", "motor", "clientes", "fase", "cpu_ms/s", "entregado", "p50_us", "p99_us", "max_us");
+
+    {
+        ThreadPerClientServer server;
+        RunScenario(server, clients, rate, seconds, sendTimes);
+    }
+    {
+        EventLoopServer server(&logger, (int)clients + 16);
+        RunScenario(server, clients, rate, seconds, sendTimes);
+    }
+
+    munmap(shared, MAX_MESSAGES * sizeof(std::atomic<uint64_t>));
+    return 0;
+}
@@ -0,0 +1,212 @@
+﻿// Benchmark y prueba de carga del registro de clientes (solo Linux).
+//
+// 1) Microbenchmark de SlotMap frente a std::unordered_map<SOCKET, ...> (el contenedor
+//    anterior de EventLoop): altas/bajas aleatorias y recorrido completo como en una difusión.
+// 2) Rotación de clientes contra un EventLoop real: varios hilos conectan, envían la
+//    identificación del dispositivo y desconectan miles de veces mientras otro hilo difunde
+//    y otro lee la instantánea de Clients(). Al final no debe quedar ningún cliente.
+//
+// Compilar:
+//   g++ -std=c++17 -O2 -pthread -I.. bench_registry.cpp ../eventloop.cpp ../poller.cpp ../sendqueue.cpp ../metrics.cpp ../logger.cpp ../color.cpp -o bench_registry
+// Con ThreadSanitizer (la rotación es la parte interesante), desde ServerV2:
+//   cmake -S . -B build-tsan -DUAR_SANITIZE=thread && cmake --build build-tsan --target bench_registry
+// Uso:
+//   ./bench_registry [ciclos_por_hilo=2000] [hilos=4]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <signal.h>
+#include "eventloop.h"
+#include "slotmap.h"
+
+namespace {
+    double Seconds(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    struct Entry {
+        uint64_t bytes = 0;
+        char padding[56] = {};
+    };
+
+    /// Altas y bajas aleatorias con unos 1000 elementos vivos y un recorrido cada 8 operaciones.
+    void RunContainers(size_t operations) {
+        const size_t LIVE = 1000;
+        volatile uint64_t sink = 0;
+
+        {
+            SlotMap<Entry> map;
+            std::vector<SlotMap<Entry>::Handle> handles;
+            uint32_t seed = 12345;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < operations; ++i) {
+                seed = seed * 1103515245u + 12345u;
+                if (handles.size() < LIVE || (seed >> 16) % 2 == 0) {
+                    handles.push_back(map.Insert());
+                }
+                else {
+                    size_t victim = (seed >> 8) % handles.size();
+                    map.Remove(handles[victim]);
+                    handles[victim] = handles.back();
+                    handles.pop_back();
+                }
+                if (i % 8 == 0) {
+                    for (size_t j = 0; j < map.Size(); ++j) {
+                        map.At(j).bytes += 1;
+                    }
+                }
+            }
+            sink += map.Size();
+            printf("%-26s %12.0f ops/s\n", "slotmap", operations / Seconds(start));
+        }
+
+        {
+            std::unordered_map<int, Entry> map;
+            std::vector<int> keys;
+            int nextKey = 0;
+            uint32_t seed = 12345;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < operations; ++i) {
+                seed = seed * 1103515245u + 12345u;
+                if (keys.size() < LIVE || (seed >> 16) % 2 == 0) {
+                    map[nextKey];
+                    keys.push_back(nextKey++);
+                }
+                else {
+                    size_t victim = (seed >> 8) % keys.size();
+                    map.erase(keys[victim]);
+                    keys[victim] = keys.back();
+                    keys.pop_back();
+                }
+                if (i % 8 == 0) {
+                    for (auto& entry : map) {
+                        entry.second.bytes += 1;
+                    }
+                }
+            }
+            sink += map.size();
+            printf("%-26s %12.0f ops/s\n", "unordered_map", operations / Seconds(start));
+        }
+        (void)sink;
+    }
+
+    SOCKET Listen(int& port) {
+        SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        if (bind(listenSocket, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenSocket, SOMAXCONN) != 0 ||
+            getsockname(listenSocket, (sockaddr*)&addr, &length) != 0) {
+            perror("listen");
+            exit(1);
+        }
+        port = ntohs(addr.sin_port);
+        return listenSocket;
+    }
+
+    /// Devuelve false si la prueba de rotación deja clientes colgados.
+    bool RunChurn(size_t cycles, size_t threads, Logger* logger) {
+        int port = 0;
+        SOCKET listenSocket = Listen(port);
+        EventLoop loop(logger, (int)threads * 4 + 16);
+        std::atomic<uint64_t> devices{ 0 };
+        loop.OnData([&](EventLoop::ClientId client, const char* data, size_t length) {
+            if (!loop.HasDevice(client)) {
+                loop.SetDevice(client, std::string(data, length));
+                devices++;
+            }
+        });
+        loop.Start(listenSocket);
+
+        std::atomic<bool> running{ true };
+        std::thread broadcaster([&]() {
+            Frame frame = MakeFrame("90,42\n");
+            while (running) {
+                loop.Broadcast(frame);
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+        std::atomic<uint64_t> snapshots{ 0 };
+        std::thread reader([&]() {
+            while (running) {
+                auto clients = loop.Clients();
+                for (const auto& client : *clients) {
+                    snapshots += client.device.size() > 0 ? 1 : 0;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        });
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        std::atomic<uint64_t> failures{ 0 };
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                std::string device = "Android-" + std::to_string(t) + "\n";
+                char buffer[256];
+                for (size_t i = 0; i < cycles; ++i) {
+                    SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+                    sockaddr_in addr = {};
+                    addr.sin_family = AF_INET;
+                    addr.sin_port = htons((uint16_t)port);
+                    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                    if (connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+                        failures++;
+                        closesocket(s);
+                        continue;
+                    }
+                    send(s, device.data(), device.size(), MSG_NOSIGNAL);
+                    // Algunos ciclos leen una difusión antes de cerrar, otros cierran al instante.
+                    if (i % 2 == 0) {
+                        recv(s, buffer, sizeof(buffer), MSG_DONTWAIT);
+                    }
+                    closesocket(s);
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        double churnSeconds = Seconds(start);
+
+        // El bucle procesa los cierres pendientes.
+        for (int i = 0; i < 200 && loop.ClientCount() > 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        size_t remaining = loop.ClientCount();
+
+        running = false;
+        broadcaster.join();
+        reader.join();
+        loop.Stop();
+        closesocket(listenSocket);
+
+        size_t total = cycles * threads;
+        printf("%-26s %12.0f conexiones/s  (%zu ciclos, %llu dispositivos, %llu fallos, %zu restantes)\n", "rotacion-eventloop",
+            total / churnSeconds, total, (unsigned long long)devices.load(), (unsigned long long)failures.load(), remaining);
+        return remaining == 0;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t cycles = argc > 1 ? (size_t)atoi(argv[1]) : 2000;
+    size_t threads = argc > 2 ? (size_t)atoi(argv[2]) : 4;
+
+    signal(SIGPIPE, SIG_IGN);
+    std::cout.rdbuf(nullptr);
+    Logger logger(false);
+
+    RunContainers(2000000);
+    if (!RunChurn(cycles, threads, &logger)) {
+        fprintf(stderr, "quedaron clientes registrados tras la rotación\n");
+        return 1;
+    }
+    return 0;
+}
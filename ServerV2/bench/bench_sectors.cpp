@@ -0,0 +1,269 @@
+﻿// Benchmark de las suscripciones por sectores (solo Linux).
+//
+// 1) Reparto de un lote entre V vistas con sectores solapados: SectorIndex::Select (índice
+//    por ángulo) frente a recorrer todas las vistas y sus sectores por cada muestra, para
+//    V = 10, 100 y 255. Ambos repartos deben coincidir.
+// 2) Prueba de extremo a extremo: Protocol con un origen sintético y muchos clientes de texto,
+//    cada uno con "SECTOR" y unos sectores elegidos de un conjunto de combinaciones (varios
+//    clientes comparten vista). Se comprueba que cada cliente solo recibe muestras de sus
+//    sectores y se compara la CPU del proceso con la de los mismos clientes sin sectores.
+//
+// Compilar (enlaza casi todo el servidor, así que con CMake, desde ServerV2):
+//   cmake -S . -B build && cmake --build build --target bench_sectors
+// Uso:
+//   ./bench_sectors [clientes=200] [muestras_por_segundo=20000] [segundos=2]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include "protocol.h"
+#include "sectorindex.h"
+#include "synthetic.h"
+
+namespace {
+    const int PORT = 27015;
+
+    double CpuSeconds() {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+            usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    }
+
+    /// De 1 a 3 sectores de 20 a 90 grados, la mitad con banda de distancias.
+    std::vector<Sector> RandomSectors(std::mt19937& random) {
+        std::vector<Sector> sectors;
+        size_t count = 1 + random() % 3;
+        for (size_t i = 0; i < count; ++i) {
+            uint16_t width = (uint16_t)(20 + random() % 71);
+            uint16_t start = (uint16_t)(random() % (SweepFrame::MAX_ANGLE + 1 - width));
+            Sector sector = { start, (uint16_t)(start + width), 0, Sector::MAX_DISTANCE };
+            if (random() % 2 == 0) {
+                sector.minDistance = (uint16_t)(random() % 100);
+                sector.maxDistance = (uint16_t)(sector.minDistance + 50 + random() % 200);
+            }
+            sectors.push_back(sector);
+        }
+        return sectors;
+    }
+
+    bool Contains(const std::vector<Sector>& sectors, const RadarSample& sample) {
+        for (const Sector& sector : sectors) {
+            if (sample.angle >= sector.minAngle && sample.angle <= sector.maxAngle && sample.distance >= sector.minDistance &&
+                sample.distance <= sector.maxDistance) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void RunSelect(size_t viewCount, size_t rounds) {
+        std::mt19937 random(7);
+        SectorIndex index;
+        std::vector<std::vector<Sector>> views(1);
+        while (index.Views() < viewCount) {
+            std::vector<Sector> sectors = RandomSectors(random);
+            uint32_t view = index.Acquire(sectors);
+            if (view >= views.size()) {
+                views.resize(view + 1);
+            }
+            views[view] = sectors;
+        }
+
+        // Un barrido de ida y vuelta con distancias variadas, como llega del radar
+        RadarSample batch[256];
+        for (size_t i = 0; i < 256; ++i) {
+            batch[i] = RadarSample();
+            batch[i].angle = (uint16_t)(i <= 180 ? i : 360 - i);
+            batch[i].distance = (uint16_t)(random() % 400);
+        }
+
+        SectorIndex::Selection selection;
+        auto start = std::chrono::steady_clock::now();
+        size_t selected = 0;
+        for (size_t round = 0; round < rounds; ++round) {
+            index.Select(batch, 256, selection);
+            selected += selection.Count(1 + round % viewCount);
+        }
+        double indexed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (rounds * 256.0);
+
+        std::vector<std::vector<RadarSample>> naive(views.size());
+        start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            for (auto& samples : naive) {
+                samples.clear();
+            }
+            for (size_t i = 0; i < 256; ++i) {
+                for (size_t view = 1; view < views.size(); ++view) {
+                    if (Contains(views[view], batch[i])) {
+                        naive[view].push_back(batch[i]);
+                    }
+                }
+            }
+            selected += naive[1 + round % viewCount].size();
+        }
+        double scanned = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (rounds * 256.0);
+
+        size_t mismatches = 0;
+        for (uint32_t view = 1; view < views.size(); ++view) {
+            mismatches += selection.Count(view) != naive[view].size();
+        }
+        printf("%6zu %14.1f %14.1f %9.1fx %10zu%s\n", viewCount, indexed, scanned, scanned / indexed, mismatches,
+            selected == 0 ? " (vacío)" : "");
+    }
+
+    struct Client {
+        SOCKET socket;
+        std::vector<Sector> sectors;  ///< Vacío: recibe todos los ángulos.
+        std::string buffer;
+        bool confirmed = false;       ///< Ya llegó la respuesta a SECTOR.
+        uint64_t received = 0;
+        uint64_t outside = 0;
+    };
+
+    SOCKET Connect(int port) {
+        SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            perror("connect");
+            exit(1);
+        }
+        return s;
+    }
+
+    /// Lee de todos los clientes hasta deadline; las muestras anteriores a la respuesta no cuentan.
+    void ReadClients(std::vector<Client>& clients, std::chrono::steady_clock::time_point deadline, bool count) {
+        std::vector<pollfd> fds(clients.size());
+        for (size_t i = 0; i < clients.size(); ++i) {
+            fds[i] = { clients[i].socket, POLLIN, 0 };
+        }
+        char chunk[65536];
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (poll(fds.data(), fds.size(), 100) <= 0) {
+                continue;
+            }
+            for (size_t i = 0; i < clients.size(); ++i) {
+                if (!(fds[i].revents & POLLIN)) {
+                    continue;
+                }
+                Client& client = clients[i];
+                ssize_t n = recv(client.socket, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    continue;
+                }
+                client.buffer.append(chunk, (size_t)n);
+
+                size_t start = 0;
+                size_t end;
+                while ((end = client.buffer.find('\n', start)) != std::string::npos) {
+                    const char* line = client.buffer.c_str() + start;
+                    if (client.buffer.compare(start, 7, "SECTOR ") == 0) {
+                        client.confirmed = true;
+                    }
+                    else if (client.confirmed && count) {
+                        RadarSample sample = RadarSample();
+                        sample.angle = (uint16_t)atoi(line);
+                        const char* comma = strchr(line, ',');
+                        sample.distance = comma != nullptr ? (uint16_t)atoi(comma + 1) : 0;
+                        client.received++;
+                        client.outside += !client.sectors.empty() && !Contains(client.sectors, sample);
+                    }
+                    start = end + 1;
+                }
+                client.buffer.erase(0, start);
+            }
+        }
+    }
+
+    void RunClients(size_t clientCount, uint32_t rate, int seconds, bool sectored, Logger* logger) {
+        SyntheticSource source(rate, 3, logger);
+        std::vector<SampleSource*> sources = { &source };
+        Protocol protocol("127.0.0.1", PORT, sources, (int)clientCount, logger, false, SendQueue::DROP_OLDEST);
+        if (!protocol.Start()) {
+            fprintf(stderr, "no se pudo iniciar el servidor en el puerto %d\n", PORT);
+            exit(1);
+        }
+
+        // 40 combinaciones de sectores repartidas entre todos los clientes
+        std::mt19937 random(11);
+        std::vector<std::vector<Sector>> combinations;
+        for (int i = 0; i < 40; ++i) {
+            combinations.push_back(RandomSectors(random));
+        }
+
+        std::vector<Client> clients(clientCount);
+        for (size_t i = 0; i < clientCount; ++i) {
+            Client& client = clients[i];
+            client.socket = Connect(PORT);
+            std::string request = "SECTOR OFF\n";
+            if (sectored) {
+                client.sectors = combinations[i % combinations.size()];
+                request = "SECTOR ";
+                for (const Sector& sector : client.sectors) {
+                    request += (request.size() > 7 ? "," : "") + std::to_string(sector.minAngle) + "-" + std::to_string(sector.maxAngle) +
+                        "/" + std::to_string(sector.minDistance) + "-" + std::to_string(sector.maxDistance);
+                }
+                request += "\n";
+            }
+            send(client.socket, request.data(), request.size(), 0);
+        }
+
+        // Medio segundo para que todos se conecten y reciban la respuesta
+        ReadClients(clients, std::chrono::steady_clock::now() + std::chrono::milliseconds(500), false);
+
+        double cpuStart = CpuSeconds();
+        auto start = std::chrono::steady_clock::now();
+        ReadClients(clients, start + std::chrono::seconds(seconds), true);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double cpu = CpuSeconds() - cpuStart;
+
+        uint64_t received = 0;
+        uint64_t outside = 0;
+        size_t confirmed = 0;
+        for (Client& client : clients) {
+            received += client.received;
+            outside += client.outside;
+            confirmed += client.confirmed;
+            closesocket(client.socket);
+        }
+        protocol.Stop();
+
+        printf("%-12s %8zu %11zu %14.0f %10llu %7.0f%%\n", sectored ? "sectores" : "sin sectores", clientCount, confirmed,
+            received / elapsed, (unsigned long long)outside, 100.0 * cpu / elapsed);
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t clients = argc > 1 ? (size_t)atoi(argv[1]) : 200;
+    uint32_t rate = argc > 2 ? (uint32_t)atoi(argv[2]) : 20000;
+    int seconds = argc > 3 ? atoi(argv[3]) : 2;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("%6s %14s %14s %10s %10s\n", "vistas", "indice_ns", "recorrido_ns", "mejora", "distintos");
+    for (size_t views : { 10, 100, 255 }) {
+        RunSelect(views, 20000);
+    }
+    printf("\n");
+
+    // Los avisos del Logger no forman parte de la medida.
+    std::cout.rdbuf(nullptr);
+    Logger logger(false);
+
+    printf("%-12s %8s %11s %14s %10s %8s\n", "modo", "clientes", "confirmados", "muestras/s", "fuera", "cpu");
+    RunClients(clients, rate, seconds, false, &logger);
+    RunClients(clients, rate, seconds, true, &logger);
+    return 0;
+}
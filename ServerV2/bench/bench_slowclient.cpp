@@ -0,0 +1,202 @@
+﻿// Benchmark de clientes lentos del bucle de eventos (solo Linux).
+//
+// Conecta F clientes rápidos y uno lento que nunca lee (con un buffer de recepción
+// mínimo) y difunde R mensajes por segundo. Para cada política de SendQueue mide la
+// latencia de entrega de los clientes rápidos, lo que recibieron y si el lento siguió
+// conectado. Con la cola acotada la latencia de los rápidos no debe cambiar respecto al
+// caso sin cliente lento, y la memoria del lento queda limitada a SendQueue::MAX_BYTES.
+//
+// Compilar:
+//   g++ -std=c++17 -O2 -pthread -I.. bench_slowclient.cpp ../eventloop.cpp ../poller.cpp ../sendqueue.cpp ../metrics.cpp ../logger.cpp ../color.cpp -o bench_slowclient
+// Uso:
+//   ./bench_slowclient [clientes_rapidos=10] [mensajes_por_segundo=20000] [segundos=2]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <signal.h>
+#include <sys/epoll.h>
+#include "eventloop.h"
+
+namespace {
+    const size_t MAX_MESSAGES = 1 << 20;
+
+    uint64_t NowNs() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    SOCKET Listen(int& port) {
+        SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(addr);
+        if (bind(listenSocket, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenSocket, SOMAXCONN) != 0 ||
+            getsockname(listenSocket, (sockaddr*)&addr, &length) != 0) {
+            perror("listen");
+            exit(1);
+        }
+        port = ntohs(addr.sin_port);
+        return listenSocket;
+    }
+
+    SOCKET Connect(int port, int receiveBuffer) {
+        SOCKET s = socket(AF_INET, SOCK_STREAM, 0);
+        if (receiveBuffer > 0) {
+            setsockopt(s, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+        }
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            perror("connect");
+            exit(1);
+        }
+        return s;
+    }
+
+    struct Result {
+        uint64_t received = 0;
+        uint64_t p50Ns = 0;
+        uint64_t p99Ns = 0;
+        uint64_t maxNs = 0;
+    };
+
+    /// Lee las líneas "ángulo,secuencia,relleno\n" de los clientes rápidos y calcula la latencia.
+    void ReadFastClients(const std::vector<SOCKET>& sockets, const std::vector<uint64_t>& sendTimes,
+        std::atomic<bool>& running, Result& result) {
+        int epollFd = epoll_create1(0);
+        std::unordered_map<int, std::string> partial;
+        for (SOCKET s : sockets) {
+            net::SetNonBlocking(s);
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.fd = s;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, s, &ev);
+        }
+
+        std::vector<uint64_t> latencies;
+        latencies.reserve(1 << 20);
+        epoll_event events[64];
+        char buffer[8192];
+        while (running) {
+            int ready = epoll_wait(epollFd, events, 64, 20);
+            for (int i = 0; i < ready; ++i) {
+                int fd = events[i].data.fd;
+                ssize_t n;
+                while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+                    uint64_t now = NowNs();
+                    std::string& line = partial[fd];
+                    line.append(buffer, (size_t)n);
+                    size_t start = 0, end;
+                    while ((end = line.find('\n', start)) != std::string::npos) {
+                        size_t comma = line.find(',', start);
+                        if (comma != std::string::npos && comma < end) {
+                            uint64_t seq = strtoull(line.c_str() + comma + 1, nullptr, 10);
+                            if (seq < sendTimes.size()) {
+                                latencies.push_back(now - sendTimes[seq]);
+                            }
+                        }
+                        start = end + 1;
+                    }
+                    line.erase(0, start);
+                }
+            }
+        }
+        close(epollFd);
+
+        result.received = latencies.size();
+        if (!latencies.empty()) {
+            std::sort(latencies.begin(), latencies.end());
+            result.p50Ns = latencies[latencies.size() / 2];
+            result.p99Ns = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+            result.maxNs = latencies.back();
+        }
+    }
+
+    void RunScenario(const char* name, SendQueue::Policy policy, bool withSlowClient, size_t fastClients,
+        int rate, int seconds, Logger* logger) {
+        int port = 0;
+        SOCKET listenSocket = Listen(port);
+        EventLoop loop(logger, (int)fastClients + 2, policy);
+        loop.Start(listenSocket);
+
+        std::vector<SOCKET> fast;
+        for (size_t i = 0; i < fastClients; ++i) {
+            fast.push_back(Connect(port, 0));
+        }
+        SOCKET slow = withSlowClient ? Connect(port, 4096) : INVALID_SOCKET;
+        size_t expectedClients = fastClients + (withSlowClient ? 1 : 0);
+        while (loop.ClientCount() < expectedClients) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        uint64_t messages = std::min<uint64_t>((uint64_t)rate * (uint64_t)seconds, MAX_MESSAGES);
+        std::vector<uint64_t> sendTimes(messages, 0);
+        std::atomic<bool> running{ true };
+        Result result;
+        std::string padding(100, 'x');
+        std::thread reader(ReadFastClients, std::cref(fast), std::cref(sendTimes), std::ref(running), std::ref(result));
+
+        uint64_t period = 1000000000ull / (uint64_t)rate;
+        uint64_t next = NowNs();
+        for (uint64_t seq = 0; seq < messages; ++seq) {
+            while (NowNs() < next) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            // Relleno para que el cliente lento llene antes los buffers del kernel.
+            std::string message = std::to_string(15 + seq % 151) + "," + std::to_string(seq) + "," + padding + "\n";
+            sendTimes[seq] = NowNs();
+            loop.Broadcast(MakeFrame(message));
+            next += period;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        size_t connected = loop.ClientCount();
+        running = false;
+        reader.join();
+
+        loop.Stop();
+        for (SOCKET s : fast) {
+            closesocket(s);
+        }
+        if (slow != INVALID_SOCKET) {
+            closesocket(slow);
+        }
+        closesocket(listenSocket);
+
+        uint64_t expected = messages * fastClients;
+        const char* slowState = !withSlowClient ? "-" : (connected == expectedClients ? "conectado" : "cerrado");
+        printf("%-24s %10.1f%% %9.1f %9.1f %9.1f %12s\n", name,
+            expected ? 100.0 * result.received / expected : 0.0,
+            result.p50Ns / 1e3, result.p99Ns / 1e3, result.maxNs / 1e3, slowState);
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t fastClients = argc > 1 ? (size_t)atoi(argv[1]) : 10;
+    int rate = argc > 2 ? atoi(argv[2]) : 20000;
+    int seconds = argc > 3 ? atoi(argv[3]) : 2;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    // Los avisos del Logger no forman parte de la medida.
+    std::cout.rdbuf(nullptr);
+    Logger logger(false);
+
+    printf("%-24s %11s %9s %9s %9s %12s\n", "escenario", "entregado", "p50_us", "p99_us", "max_us", "cliente_lento");
+    RunScenario("sin-cliente-lento", SendQueue::DROP_OLDEST, false, fastClients, rate, seconds, &logger);
+    RunScenario("lento/drop", SendQueue::DROP_OLDEST, true, fastClients, rate, seconds, &logger);
+    RunScenario("lento/latest", SendQueue::COALESCE_LATEST, true, fastClients, rate, seconds, &logger);
+    RunScenario("lento/disconnect", SendQueue::DISCONNECT, true, fastClients, rate, seconds, &logger);
+    return 0;
+}
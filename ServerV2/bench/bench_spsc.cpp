@@ -0,0 +1,200 @@
+﻿// Benchmark del paso de muestras entre el lector serie y el hilo de red.
+//
+// Compara el bucle anterior de Protocol (leer una muestra, difundirla y dormir 1 ms)
+// con el anillo SpscRing despertando al consumidor por el Poller (eventfd en Linux).
+// Un hilo productor genera muestras con marca de tiempo al ritmo indicado, como haría
+// el puerto serie, y el consumidor mide la latencia añadida hasta que la recibe.
+//   - Con ritmo 0 el productor va a máxima velocidad y se mide el caudal sostenido.
+//
+// Compilar:
+//   g++ -std=c++17 -O2 -pthread -I.. bench_spsc.cpp ../poller.cpp -o bench_spsc
+// Uso:
+//   ./bench_spsc [segundos=2]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "poller.h"
+#include "sample.h"
+#include "spscring.h"
+
+namespace {
+    uint64_t NowNs() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct StampedSample {
+        RadarSample sample;
+        uint64_t stamp;
+    };
+
+    struct Result {
+        uint64_t produced = 0;
+        uint64_t consumed = 0;
+        uint64_t dropped = 0;
+        double seconds = 0;
+        std::vector<uint64_t> latencies;
+    };
+
+    /// Genera muestras al ritmo indicado (0 = sin pausa) y las entrega con push().
+    template <typename PushFn>
+    uint64_t Produce(int rate, int seconds, std::atomic<bool>& running, PushFn push) {
+        uint64_t period = rate > 0 ? 1000000000ull / (uint64_t)rate : 0;
+        uint64_t end = NowNs() + (uint64_t)seconds * 1000000000ull;
+        uint64_t next = NowNs();
+        uint64_t produced = 0;
+        uint16_t angle = 15;
+
+        while (NowNs() < end) {
+            if (period > 0) {
+                while (NowNs() < next) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(20));
+                }
+                next += period;
+            }
+            StampedSample item = {};
+            item.sample.angle = angle;
+            item.sample.distance = (uint16_t)(produced % 400);
+            item.stamp = NowNs();
+            push(item);
+            produced++;
+            angle = angle >= 165 ? 15 : (uint16_t)(angle + 1);
+        }
+        running = false;
+        return produced;
+    }
+
+    /// Bucle anterior: el mismo hilo lee una muestra, la "difunde" y duerme 1 ms.
+    /// El buffer del controlador serie se modela con una cola protegida por mutex.
+    Result RunLegacy(int rate, int seconds) {
+        Result result;
+        std::mutex mutex;
+        std::deque<StampedSample> driver;
+        std::atomic<bool> running{ true };
+
+        std::thread consumer([&]() {
+            char text[16];
+            while (running) {
+                StampedSample item;
+                bool got = false;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!driver.empty()) {
+                        item = driver.front();
+                        driver.pop_front();
+                        got = true;
+                    }
+                }
+                if (got) {
+                    FormatSample(item.sample, text);
+                    result.latencies.push_back(NowNs() - item.stamp);
+                    result.consumed++;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        uint64_t start = NowNs();
+        result.produced = Produce(rate, seconds, running, [&](const StampedSample& item) {
+            std::lock_guard<std::mutex> lock(mutex);
+            driver.push_back(item);
+        });
+
+        // Lo que quede en el buffer ya no cuenta: se mide lo entregado en el tiempo de la prueba.
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            result.dropped = driver.size();
+            driver.clear();
+        }
+        consumer.join();
+        result.seconds = (NowNs() - start) / 1e9;
+        return result;
+    }
+
+    /// Ruta actual: SpscRing + despertar por eventfd (Poller::Wakeup), como el hilo de red.
+    Result RunRing(int rate, int seconds) {
+        Result result;
+        static SpscRing<StampedSample, 4096> ring;
+        Poller poller;
+        poller.Open();
+        std::atomic<bool> running{ true };
+        uint64_t overrunsBefore = ring.Overruns();
+
+        std::thread consumer([&]() {
+            std::vector<Poller::PollEvent> events;
+            StampedSample batch[256];
+            char text[256 * 16];
+            while (true) {
+                poller.Wait(events, 50);
+                ring.ResetSignal();
+                size_t count;
+                while ((count = ring.Pop(batch, 256)) > 0) {
+                    uint64_t now = NowNs();
+                    size_t length = 0;
+                    for (size_t i = 0; i < count; ++i) {
+                        length += FormatSample(batch[i].sample, text + length);
+                        result.latencies.push_back(now - batch[i].stamp);
+                    }
+                    result.consumed += count;
+                }
+                if (!running && ring.Size() == 0) {
+                    break;
+                }
+            }
+        });
+
+        uint64_t start = NowNs();
+        result.produced = Produce(rate, seconds, running, [&](const StampedSample& item) {
+            if (ring.Push(item) && ring.NeedsSignal()) {
+                poller.Wakeup();
+            }
+        });
+        poller.Wakeup();
+        consumer.join();
+        result.seconds = (NowNs() - start) / 1e9;
+        result.dropped = ring.Overruns() - overrunsBefore;
+        return result;
+    }
+
+    void Print(const char* name, int rate, Result& result) {
+        std::vector<uint64_t>& l = result.latencies;
+        std::sort(l.begin(), l.end());
+        auto percentile = [&](double p) -> double {
+            if (l.empty()) return 0.0;
+            return l[std::min(l.size() - 1, (size_t)(l.size() * p))] / 1e3;
+        };
+        char rateText[16];
+        snprintf(rateText, sizeof(rateText), "%s", rate > 0 ? std::to_string(rate).c_str() : "max");
+        printf("%-16s %8s %12.0f %10llu %10.1f %10.1f %10.1f %10.1f\n", name, rateText,
+            result.consumed / result.seconds, (unsigned long long)result.dropped,
+            percentile(0.50), percentile(0.99), percentile(0.999), l.empty() ? 0.0 : l.back() / 1e3);
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 2;
+    const int rates[] = { 1000, 10000, 100000, 0 };
+
+    printf("%-16s %8s %12s %10s %10s %10s %10s %10s\n", "ruta", "ritmo", "muestras/s", "perdidas", "p50_us", "p99_us", "p999_us", "max_us");
+    for (int rate : rates) {
+        // A máxima velocidad el bucle anterior solo acumularía cola: se omite.
+        if (rate == 0 || rate > 10000) {
+            continue;
+        }
+        Result legacy = RunLegacy(rate, seconds);
+        Print("sleep-1ms", rate, legacy);
+    }
+    for (int rate : rates) {
+        Result ring = RunRing(rate, seconds);
+        Print("spsc+eventfd", rate, ring);
+    }
+    return 0;
+}
@@ -0,0 +1,189 @@
+﻿// Benchmark del formato binario frente al de texto (solo Linux).
+//
+// Para distintos tamaños de lote mide:
+//   - bytes por muestra en el cable,
+//   - coste por muestra de codificar el lote, crear el Frame y enviarlo por un socket TCP
+//     local (un hilo lee y descarta al otro lado),
+//   - coste por muestra de decodificarlo en el cliente (texto con un análisis sencillo
+//     de "ángulo,distancia\n", binario con wire::DecodeFrame).
+//
+// Compilar:
+//   g++ -std=c++17 -O2 -pthread -I.. bench_wire.cpp ../wireformat.cpp ../sweep.cpp -o bench_wire
+// Uso:
+//   ./bench_wire [muestras=2000000]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include "network.h"
+#include "frame.h"
+#include "wireformat.h"
+
+namespace {
+    double Seconds(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::vector<RadarSample> MakeSamples(size_t count) {
+        std::vector<RadarSample> samples(count);
+        for (size_t i = 0; i < count; ++i) {
+            // Barrido de 15 a 165 grados con distancias de 2 a 400 cm, una muestra cada 20 ms
+            samples[i].angle = (uint16_t)(15 + i % 151);
+            samples[i].distance = (uint16_t)(2 + (i * 37) % 399);
+            samples[i].sequence = (uint32_t)i;
+            samples[i].timestamp = (uint64_t)i * 20000;
+        }
+        return samples;
+    }
+
+    /// Par de sockets TCP conectados por loopback; el extremo lector se vacía en otro hilo.
+    struct Loopback {
+        SOCKET writer = INVALID_SOCKET;
+        SOCKET reader = INVALID_SOCKET;
+        std::thread drain;
+        std::atomic<bool> running{ true };
+
+        Loopback() {
+            SOCKET listener = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t length = sizeof(addr);
+            bind(listener, (sockaddr*)&addr, sizeof(addr));
+            listen(listener, 1);
+            getsockname(listener, (sockaddr*)&addr, &length);
+            writer = socket(AF_INET, SOCK_STREAM, 0);
+            if (connect(writer, (sockaddr*)&addr, sizeof(addr)) != 0) {
+                perror("connect");
+                exit(1);
+            }
+            reader = accept(listener, nullptr, nullptr);
+            closesocket(listener);
+            net::SetNoDelay(writer);
+
+            drain = std::thread([this]() {
+                char buffer[65536];
+                while (recv(reader, buffer, sizeof(buffer), 0) > 0) {
+                }
+            });
+        }
+
+        ~Loopback() {
+            shutdown(writer, SHUT_WR);
+            drain.join();
+            closesocket(writer);
+            closesocket(reader);
+        }
+
+        void Send(const Frame& frame) {
+            size_t offset = 0;
+            while (offset < frame->size()) {
+                ssize_t sent = send(writer, frame->data() + offset, frame->size() - offset, MSG_NOSIGNAL);
+                if (sent <= 0) {
+                    perror("send");
+                    exit(1);
+                }
+                offset += (size_t)sent;
+            }
+        }
+    };
+
+    Frame EncodeText(const RadarSample* samples, size_t count, char* buffer) {
+        size_t length = 0;
+        for (size_t i = 0; i < count; ++i) {
+            length += FormatSample(samples[i], buffer + length);
+        }
+        return MakeFrame(buffer, length);
+    }
+
+    Frame EncodeBinary(const RadarSample* samples, size_t count, char* buffer) {
+        return MakeFrame(buffer, wire::EncodeSamples(samples, count, buffer));
+    }
+
+    /// Análisis mínimo de las líneas de texto, equivalente a readLine + split + toInt del cliente.
+    size_t DecodeText(const std::string& data, std::vector<RadarSample>& out) {
+        RadarSample sample = {};
+        unsigned value = 0;
+        for (char c : data) {
+            if (c >= '0' && c <= '9') {
+                value = value * 10 + (unsigned)(c - '0');
+            }
+            else if (c == ',') {
+                sample.angle = (uint16_t)value;
+                value = 0;
+            }
+            else if (c == '\n') {
+                sample.distance = (uint16_t)value;
+                out.push_back(sample);
+                value = 0;
+            }
+        }
+        return out.size();
+    }
+
+    size_t DecodeBinary(const std::string& data, std::vector<RadarSample>& out) {
+        size_t offset = 0;
+        size_t consumed = 0;
+        wire::Message message;
+        message.samples.swap(out);
+        while (offset < data.size() &&
+            wire::DecodeFrame(data.data() + offset, data.size() - offset, consumed, message) == wire::DECODED) {
+            offset += consumed;
+        }
+        message.samples.swap(out);
+        return out.size();
+    }
+
+    template <typename Encode, typename Decode>
+    void Run(const char* name, const std::vector<RadarSample>& samples, size_t batch, Encode encode, Decode decode) {
+        std::vector<char> buffer(wire::SamplesFrameSize(batch) + batch * 16);
+        size_t bytes = 0;
+
+        // Codificar y enviar
+        double sendSeconds;
+        {
+            Loopback loopback;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i + batch <= samples.size(); i += batch) {
+                Frame frame = encode(&samples[i], batch, buffer.data());
+                bytes += frame->size();
+                loopback.Send(frame);
+            }
+            sendSeconds = Seconds(start);
+        }
+        size_t sent = samples.size() / batch * batch;
+
+        // Decodificar lo mismo en memoria, por trozos de 64 KiB como llegarían al cliente
+        std::string stream;
+        for (size_t i = 0; i + batch <= samples.size() && stream.size() < 64 * 1024 * 1024; i += batch) {
+            Frame frame = encode(&samples[i], batch, buffer.data());
+            stream += *frame;
+        }
+        std::vector<RadarSample> decoded;
+        decoded.reserve(samples.size());
+        auto start = std::chrono::steady_clock::now();
+        size_t count = decode(stream, decoded);
+        double decodeSeconds = Seconds(start);
+
+        printf("%-8s %6zu %14.2f %16.1f %16.1f\n", name, batch, (double)bytes / sent, sendSeconds * 1e9 / sent,
+            decodeSeconds * 1e9 / (count > 0 ? count : 1));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t total = argc > 1 ? (size_t)atoll(argv[1]) : 2000000;
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<RadarSample> samples = MakeSamples(total);
+    printf("%-8s %6s %14s %16s %16s\n", "formato", "lote", "bytes/muestra", "envio_ns/muestra", "decod_ns/muestra");
+    for (size_t batch : { (size_t)1, (size_t)16, (size_t)256 }) {
+        Run("texto", samples, batch, EncodeText, DecodeText);
+        Run("binario", samples, batch, EncodeBinary, DecodeBinary);
+    }
+    return 0;
+}
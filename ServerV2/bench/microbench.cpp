@@ -0,0 +1,666 @@
+﻿// Microbenchmarks de los caminos críticos del servidor (Google Benchmark, solo Linux).
+//
+//  - Framing: separar y convertir las líneas "ángulo,distancia.\r\n" del puerto serie con
+//    Framer (lo que hace Handler::ReadSample) frente al bucle anterior de
+//    Handler::ReadFromArduino (un carácter por llamada, std::string y stoi).
+//  - Message: construir el mensaje de un lote de muestras como lo hace
+//    Protocol::PublishBatch (texto y binario) frente a la concatenación de
+//    std::string del antiguo ReadAndBroadcastArduinoData.
+//  - FanOut: difundir un Frame con EventLoop a 1, 10, 100 y 1000 clientes conectados por
+//    loopback (el sucesor de BroadcastToClients). El tiempo incluye leer el mensaje en todos
+//    los clientes, de modo que cada iteración es una entrega completa.
+//  - Grid: marcar ecos en OccupancyGrid y el envejecimiento de toda la rejilla con
+//    OccupancyGrid::Fade (SSE2/NEON) frente al mismo bucle escalar sin vectorizar.
+//  - Tracker: agrupar y seguir los objetos de barridos de la escena sintética con
+//    ObjectTracker (coste por muestra del barrido).
+//  - Filter: coste por muestra de cada etapa de NoiseFilter, muestra a muestra (Apply, lo que
+//    pasa con un Arduino a su ritmo) y por barridos enteros (Filter, tramos de ángulos
+//    consecutivos con SSE2). Argumentos: etapas (1 outlier, 2 mediana, 4 EMA) y ventana.
+//  - Decimator: coste por muestra de reducir el flujo a una ventana por periodo para los
+//    clientes con "RATE" (una vez por clase de tasa). Argumentos: entregas por segundo y
+//    modo (0 último valor, 1 distancia mínima); las muestras llegan a 100000 por segundo.
+//  - Metrics: lo que cuesta actualizar un Counter y un Histogram en el camino crítico, con
+//    uno y con cuatro hilos escribiendo en la misma métrica.
+//  - Logger: Logger::Log con el nivel activo y LOG_DEBUG con la depuración activada y
+//    desactivada. La salida de Logger se desvía a un buffer nulo y se espera al hilo
+//    escritor cada FLUSH_EVERY mensajes, así que se mide lo que da abasto a escribir.
+//
+// Compilar (desde ServerV2):
+//   cmake -S . -B build -DCMAKE_BUILD_TYPE=Release && cmake --build build --target uar_microbench
+// Uso:
+//   ./build/uar_microbench [--benchmark_filter=FanOut] [--benchmark_format=json]
+//   ./build/uar_microbench --benchmark_out=resultados.json --benchmark_out_format=json
+//   cmake --build build --target bench_json    (deja build/microbench.json)
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <benchmark/benchmark.h>
+#include "decimator.h"
+#include "eventloop.h"
+#include "framer.h"
+#include "frame.h"
+#include "logger.h"
+#include "metrics.h"
+#include "noisefilter.h"
+#include "occupancy.h"
+#include "sample.h"
+#include "scene.h"
+#include "tracker.h"
+#include "wireformat.h"
+
+#ifndef UAR_REVISION
+#define UAR_REVISION "desconocida"
+#endif
+
+namespace {
+    const size_t STREAM_SAMPLES = 4096;
+    const size_t SERIAL_READ = 64;   // Bytes por lectura del puerto, como el buffer del driver
+    const int64_t FLUSH_EVERY = 128; // Mensajes por hilo entre Flush: mide el ritmo sostenido, no los descartes
+
+    /// Salida del sketch: barrido 15-165-15 con "ángulo,distancia.\r\n".
+    const std::string& SerialStream() {
+        static std::string stream;
+        if (stream.empty()) {
+            int angle = 15;
+            int step = 1;
+            for (size_t i = 0; i < STREAM_SAMPLES; ++i) {
+                int distance = (i % 7 == 0) ? 50 : (int)(3 + (i * 37) % 47);
+                stream += std::to_string(angle) + "," + std::to_string(distance) + ".\r\n";
+                angle += step;
+                if (angle >= 165 || angle <= 15) {
+                    step = -step;
+                }
+            }
+        }
+        return stream;
+    }
+
+    std::vector<RadarSample> MakeSamples(size_t count) {
+        std::vector<RadarSample> samples(count);
+        for (size_t i = 0; i < count; ++i) {
+            samples[i].angle = (uint16_t)(15 + i % 151);
+            samples[i].distance = (uint16_t)(3 + (i * 37) % 47);
+            samples[i].sequence = (uint32_t)i;
+            samples[i].timestamp = 1000000 + i * 30000;
+        }
+        return samples;
+    }
+
+    /// Buffer de salida que descarta todo, para medir Logger sin la consola.
+    class NullBuffer : public std::streambuf {
+    protected:
+        std::streamsize xsputn(const char*, std::streamsize count) override {
+            return count;
+        }
+        int overflow(int c) override {
+            return traits_type::not_eof(c);
+        }
+    };
+
+    Logger& QuietLogger() {
+        static Logger logger;
+        return logger;
+    }
+}
+
+// ---------------------------------------------------------------------------------------
+// Framing del puerto serie
+
+static void BM_Framing_Framer(benchmark::State& state) {
+    const std::string& stream = SerialStream();
+    Framer framer;
+    RadarSample sample;
+    uint64_t parsed = 0;
+
+    for (auto _ : state) {
+        size_t position = 0;
+        while (position < stream.size()) {
+            size_t chunk = std::min(SERIAL_READ, stream.size() - position);
+            position += framer.Write(stream.data() + position, chunk);
+            while (framer.Next(sample)) {
+                parsed++;
+            }
+        }
+        benchmark::DoNotOptimize(sample);
+    }
+    state.SetItemsProcessed((int64_t)parsed);
+    state.SetBytesProcessed((int64_t)(state.iterations() * stream.size()));
+}
+BENCHMARK(BM_Framing_Framer);
+
+static void BM_Framing_Legacy(benchmark::State& state) {
+    const std::string& stream = SerialStream();
+    uint64_t parsed = 0;
+
+    for (auto _ : state) {
+        size_t position = 0;
+        while (position < stream.size()) {
+            // Copia del bucle anterior: un readChar por byte hasta el '.'
+            std::string data;
+            for (int i = 0; i < 180 && position < stream.size(); ++i) {
+                char currentChar = stream[position++];
+                data += currentChar;
+                if (currentChar == '.') {
+                    break;
+                }
+            }
+            if (!data.empty() && data.back() == '.') {
+                data.pop_back();
+            }
+            data.erase(std::remove_if(data.begin(), data.end(), [](char c) {
+                return c == '\n' || c == '\r';
+                }), data.end());
+
+            size_t comma = data.find(',');
+            if (comma != std::string::npos) {
+                int angle = std::stoi(data.substr(0, comma));
+                int distance = std::stoi(data.substr(comma + 1));
+                benchmark::DoNotOptimize(angle + distance);
+                parsed++;
+            }
+        }
+    }
+    state.SetItemsProcessed((int64_t)parsed);
+    state.SetBytesProcessed((int64_t)(state.iterations() * stream.size()));
+}
+BENCHMARK(BM_Framing_Legacy);
+
+// ---------------------------------------------------------------------------------------
+// Construcción del mensaje de un lote (argumento: muestras por lote)
+
+static void BM_Message_Text(benchmark::State& state) {
+    std::vector<RadarSample> samples = MakeSamples((size_t)state.range(0));
+    std::vector<char> buffer(samples.size() * 16);
+
+    for (auto _ : state) {
+        size_t length = 0;
+        for (const RadarSample& sample : samples) {
+            length += FormatSample(sample, buffer.data() + length);
+        }
+        Frame frame = MakeFrame(buffer.data(), length);
+        benchmark::DoNotOptimize(frame);
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * samples.size()));
+}
+BENCHMARK(BM_Message_Text)->Arg(1)->Arg(16)->Arg(256);
+
+static void BM_Message_Binary(benchmark::State& state) {
+    std::vector<RadarSample> samples = MakeSamples((size_t)state.range(0));
+    std::vector<char> buffer(wire::SamplesFrameSize(samples.size()));
+
+    for (auto _ : state) {
+        Frame frame = MakeFrame(buffer.data(), wire::EncodeSamples(samples.data(), samples.size(), buffer.data()));
+        benchmark::DoNotOptimize(frame);
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * samples.size()));
+}
+BENCHMARK(BM_Message_Binary)->Arg(1)->Arg(16)->Arg(256);
+
+static void BM_Message_Legacy(benchmark::State& state) {
+    std::vector<RadarSample> samples = MakeSamples((size_t)state.range(0));
+
+    for (auto _ : state) {
+        // Como ReadAndBroadcastArduinoData: un std::string por muestra, concatenado
+        std::string message;
+        for (const RadarSample& sample : samples) {
+            std::string line = std::to_string(sample.angle) + "," + std::to_string(sample.distance);
+            message += line + "\n";
+        }
+        benchmark::DoNotOptimize(message);
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * samples.size()));
+}
+BENCHMARK(BM_Message_Legacy)->Arg(1)->Arg(16)->Arg(256);
+
+// ---------------------------------------------------------------------------------------
+// Rejilla de ocupación
+
+static void BM_Grid_Add(benchmark::State& state) {
+    std::unique_ptr<OccupancyGrid> grid(new OccupancyGrid());
+    std::vector<RadarSample> samples = MakeSamples(1024);
+    for (auto _ : state) {
+        for (const RadarSample& sample : samples) {
+            grid->Add(sample);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)samples.size());
+}
+BENCHMARK(BM_Grid_Add);
+
+static void BM_Grid_Fade(benchmark::State& state) {
+    alignas(64) static uint8_t cells[OccupancyGrid::CELLS];
+    memset(cells, 200, sizeof(cells));
+    for (auto _ : state) {
+        OccupancyGrid::Fade(cells, OccupancyGrid::CELLS, 1);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)OccupancyGrid::CELLS);
+}
+BENCHMARK(BM_Grid_Fade);
+
+// Referencia: el mismo envejecimiento celda a celda, sin que el compilador lo vectorice
+__attribute__((optimize("no-tree-vectorize")))
+static void FadeScalar(uint8_t* cells, size_t count, uint8_t amount) {
+    for (size_t i = 0; i < count; ++i) {
+        cells[i] = (uint8_t)(cells[i] > amount ? cells[i] - amount : 0);
+    }
+}
+
+static void BM_Grid_FadeScalar(benchmark::State& state) {
+    alignas(64) static uint8_t cells[OccupancyGrid::CELLS];
+    memset(cells, 200, sizeof(cells));
+    for (auto _ : state) {
+        FadeScalar(cells, OccupancyGrid::CELLS, 1);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)OccupancyGrid::CELLS);
+}
+BENCHMARK(BM_Grid_FadeScalar);
+
+// Un periodo completo: ecos de un barrido, envejecimiento y celdas a enviar
+static void BM_Grid_Tick(benchmark::State& state) {
+    std::unique_ptr<OccupancyGrid> grid(new OccupancyGrid());
+    std::vector<RadarSample> samples = MakeSamples(151);
+    std::vector<GridCell> cells(OccupancyGrid::CELLS);
+    uint64_t now = 0;
+    uint8_t decay = 0;
+    for (auto _ : state) {
+        for (RadarSample& sample : samples) {
+            sample.timestamp = now;
+            grid->Add(sample);
+        }
+        now += OccupancyGrid::TICK_MS * 1000;
+        benchmark::DoNotOptimize(grid->Tick(now, cells.data(), decay));
+    }
+}
+BENCHMARK(BM_Grid_Tick);
+
+// ---------------------------------------------------------------------------------------
+// Detección y seguimiento de objetos
+
+namespace {
+    /// Barridos completos de la escena sintética, como los que entrega SweepAssembler.
+    std::vector<SweepFrame> MakeSweeps(size_t count) {
+        SyntheticScene scene(SyntheticScene::MAX_TARGETS, 7);
+        std::unique_ptr<SweepAssembler> assembler(new SweepAssembler());
+        std::vector<SweepFrame> sweeps;
+        RadarSample sample = {};
+        while (sweeps.size() < count) {
+            scene.Next(sample);
+            sample.timestamp += 30000;
+            sample.sequence++;
+            if (assembler->Add(sample)) {
+                sweeps.push_back(assembler->Last());
+            }
+        }
+        return sweeps;
+    }
+}
+
+static void BM_Tracker_Cluster(benchmark::State& state) {
+    std::unique_ptr<ObjectTracker> tracker(new ObjectTracker());
+    std::vector<SweepFrame> sweeps = MakeSweeps(64);
+    SweepCluster clusters[ObjectTracker::MAX_CLUSTERS];
+    size_t next = 0;
+    int64_t samples = 0;
+    for (auto _ : state) {
+        const SweepFrame& sweep = sweeps[next++ % sweeps.size()];
+        benchmark::DoNotOptimize(tracker->Cluster(sweep, clusters));
+        samples += sweep.maxAngle - sweep.minAngle + 1;
+    }
+    state.SetItemsProcessed(samples);
+}
+BENCHMARK(BM_Tracker_Cluster);
+
+static void BM_Tracker_Update(benchmark::State& state) {
+    std::unique_ptr<ObjectTracker> tracker(new ObjectTracker());
+    std::vector<SweepFrame> sweeps = MakeSweeps(256);
+    TrackedObject objects[ObjectTracker::MAX_TRACKS];
+    size_t next = 0;
+    int64_t samples = 0;
+    for (auto _ : state) {
+        // Al dar la vuelta a la lista el tiempo retrocede: se empieza de cero como en un arranque
+        if (next % sweeps.size() == 0) {
+            state.PauseTiming();
+            tracker.reset(new ObjectTracker());
+            state.ResumeTiming();
+        }
+        const SweepFrame& sweep = sweeps[next++ % sweeps.size()];
+        benchmark::DoNotOptimize(tracker->Update(sweep, objects));
+        samples += sweep.maxAngle - sweep.minAngle + 1;
+    }
+    state.SetItemsProcessed(samples);
+}
+BENCHMARK(BM_Tracker_Update);
+
+// ---------------------------------------------------------------------------------------
+// Filtro de ruido por ángulo (argumentos: etapas y ventana de la mediana)
+
+namespace {
+    /// Muestras seguidas de la escena sintética con un 5 % de lecturas sin eco, como las del sketch.
+    std::vector<RadarSample> MakeNoisySamples(size_t count) {
+        SyntheticScene scene(SyntheticScene::MAX_TARGETS, 7);
+        std::vector<RadarSample> samples(count);
+        for (size_t i = 0; i < count; ++i) {
+            scene.Next(samples[i]);
+            if (i % 20 == 7) {
+                samples[i].distance = OccupancyGrid::DEFAULT_MAX_RANGE;
+            }
+        }
+        return samples;
+    }
+
+    void ConfigureFilter(NoiseFilter& filter, benchmark::State& state) {
+        filter.Window((uint8_t)state.range(1));
+        filter.Stages((uint8_t)state.range(0));
+        std::string label = std::string(state.range(0) & NoiseFilter::OUTLIER ? " outlier" : "") +
+            (state.range(0) & NoiseFilter::MEDIAN ? " median" + std::to_string(state.range(1)) : "") +
+            (state.range(0) & NoiseFilter::EMA ? " ema" : "");
+        state.SetLabel(label.substr(1));
+    }
+}
+
+static void BM_Filter_Sample(benchmark::State& state) {
+    std::unique_ptr<NoiseFilter> filter(new NoiseFilter());
+    ConfigureFilter(*filter, state);
+    std::vector<RadarSample> samples = MakeNoisySamples(181 * 64);
+    size_t next = 0;
+    for (auto _ : state) {
+        const RadarSample& sample = samples[next++ % samples.size()];
+        benchmark::DoNotOptimize(filter->Apply(sample.angle, sample.distance));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Filter_Sample)->Args({ 1, 3 })->Args({ 2, 3 })->Args({ 2, 5 })->Args({ 4, 3 })->Args({ 7, 5 });
+
+static void BM_Filter_Sweep(benchmark::State& state) {
+    std::unique_ptr<NoiseFilter> filter(new NoiseFilter());
+    ConfigureFilter(*filter, state);
+
+    // Un lote por barrido de ida o de vuelta, como llegan al hilo de red a ritmo alto. Se
+    // filtran en su sitio una y otra vez: el coste no depende de los valores
+    std::vector<RadarSample> samples = MakeNoisySamples(181 * 64);
+    std::vector<std::vector<RadarSample>> sweeps;
+    size_t start = 0;
+    for (size_t i = 2; i <= samples.size(); ++i) {
+        if (i == samples.size() || (samples[i].angle > samples[i - 1].angle) != (samples[i - 1].angle > samples[i - 2].angle)) {
+            sweeps.emplace_back(samples.begin() + start, samples.begin() + i);
+            start = i;
+        }
+    }
+
+    size_t next = 0;
+    int64_t processed = 0;
+    for (auto _ : state) {
+        std::vector<RadarSample>& sweep = sweeps[next++ % sweeps.size()];
+        filter->Filter(sweep.data(), sweep.size());
+        benchmark::DoNotOptimize(sweep.data());
+        processed += (int64_t)sweep.size();
+    }
+    state.SetItemsProcessed(processed);
+}
+BENCHMARK(BM_Filter_Sweep)->Args({ 1, 3 })->Args({ 2, 3 })->Args({ 2, 5 })->Args({ 4, 3 })->Args({ 7, 5 });
+
+// ---------------------------------------------------------------------------------------
+// Reducción por tasa (argumentos: entregas por segundo y modo)
+
+static void BM_Decimator(benchmark::State& state) {
+    Decimator::Mode mode = state.range(1) ? Decimator::NEAREST : Decimator::LATEST;
+    Decimator decimator((uint32_t)state.range(0), mode, 1);
+    state.SetLabel(mode == Decimator::NEAREST ? "nearest" : "latest");
+
+    // Los instantes siguen creciendo entre vueltas para que las ventanas se sigan cerrando
+    std::vector<RadarSample> samples = MakeNoisySamples(181 * 64);
+    uint64_t timestamp = 0;
+    size_t next = 0;
+    int64_t windows = 0;
+    for (auto _ : state) {
+        RadarSample sample = samples[next++ % samples.size()];
+        sample.timestamp = timestamp += 10;
+        if (decimator.Add(sample)) {
+            windows++;
+            benchmark::DoNotOptimize(decimator.Closed().data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["ventanas"] = (double)windows;
+}
+BENCHMARK(BM_Decimator)->Args({ 2, 0 })->Args({ 2, 1 })->Args({ 50, 0 })->Args({ 1000, 0 });
+
+// ---------------------------------------------------------------------------------------
+// Métricas (misma instancia compartida por todos los hilos)
+
+static Counter benchCounter;
+static Histogram benchHistogram;
+
+static void BM_Metrics_Counter(benchmark::State& state) {
+    for (auto _ : state) {
+        benchCounter.Add();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Metrics_Counter)->Threads(1)->Threads(4)->UseRealTime();
+
+static void BM_Metrics_Histogram(benchmark::State& state) {
+    uint64_t value = 1;
+    for (auto _ : state) {
+        benchHistogram.Record(value);
+        value = value * 2862933555777941757ull + 3037000493ull;
+        value &= 0xFFFFF;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Metrics_Histogram)->Threads(1)->Threads(4)->UseRealTime();
+
+// ---------------------------------------------------------------------------------------
+// Difusión a N clientes por loopback (argumento: clientes)
+
+namespace {
+    /// EventLoop escuchando en loopback con N clientes conectados y registrados en epoll.
+    class FanOutBench {
+    public:
+        explicit FanOutBench(size_t count) : loop(&QuietLogger(), (int)count + 16), epollFd(epoll_create1(0)) {
+            rlimit limit;
+            if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < 2 * count + 64) {
+                limit.rlim_cur = std::min<rlim_t>(2 * count + 64, limit.rlim_max);
+                setrlimit(RLIMIT_NOFILE, &limit);
+            }
+
+            listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t length = sizeof(addr);
+            if (bind(listenSocket, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenSocket, SOMAXCONN) != 0 ||
+                getsockname(listenSocket, (sockaddr*)&addr, &length) != 0 || !loop.Start(listenSocket)) {
+                return;
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                SOCKET client = socket(AF_INET, SOCK_STREAM, 0);
+                if (connect(client, (sockaddr*)&addr, sizeof(addr)) != 0) {
+                    closesocket(client);
+                    return;
+                }
+                net::SetNonBlocking(client);
+                epoll_event event = {};
+                event.events = EPOLLIN;
+                event.data.fd = client;
+                epoll_ctl(epollFd, EPOLL_CTL_ADD, client, &event);
+                clients.push_back(client);
+            }
+            while (loop.ClientCount() < count) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            events.resize(clients.size());
+        }
+
+        ~FanOutBench() {
+            loop.Stop();
+            for (SOCKET client : clients) {
+                closesocket(client);
+            }
+            closesocket(listenSocket);
+            close(epollFd);
+        }
+
+        bool Ready(size_t count) const {
+            return clients.size() == count;
+        }
+
+        /// Difunde el mensaje y espera a que todos los clientes lo hayan leído entero.
+        void Deliver(const Frame& frame) {
+            loop.Broadcast(frame);
+
+            size_t expected = frame->size() * clients.size();
+            size_t received = 0;
+            while (received < expected) {
+                int ready = epoll_wait(epollFd, events.data(), (int)events.size(), 1000);
+                if (ready <= 0) {
+                    return;
+                }
+                for (int i = 0; i < ready; ++i) {
+                    ssize_t n;
+                    while ((n = recv(events[i].data.fd, buffer, sizeof(buffer), 0)) > 0) {
+                        received += (size_t)n;
+                    }
+                }
+            }
+        }
+
+    private:
+        EventLoop loop;
+        SOCKET listenSocket = INVALID_SOCKET;
+        int epollFd;
+        std::vector<SOCKET> clients;
+        std::vector<epoll_event> events;
+        char buffer[4096];
+    };
+}
+
+static void BM_FanOut(benchmark::State& state) {
+    size_t count = (size_t)state.range(0);
+    FanOutBench bench(count);
+    if (!bench.Ready(count)) {
+        state.SkipWithError("No se pudieron conectar los clientes");
+        return;
+    }
+
+    // Un lote típico: 16 muestras en texto
+    std::vector<RadarSample> samples = MakeSamples(16);
+    char buffer[16 * 16];
+    size_t length = 0;
+    for (const RadarSample& sample : samples) {
+        length += FormatSample(sample, buffer + length);
+    }
+    Frame frame = MakeFrame(buffer, length);
+
+    for (auto _ : state) {
+        bench.Deliver(frame);
+    }
+    state.SetItemsProcessed((int64_t)(state.iterations() * count));
+    state.SetBytesProcessed((int64_t)(state.iterations() * count * length));
+    state.counters["clients"] = (double)count;
+}
+BENCHMARK(BM_FanOut)->Arg(1)->Arg(10)->Arg(100)->Arg(1000)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// ---------------------------------------------------------------------------------------
+// Logger (con varios hilos registrando a la vez)
+
+static void BM_Logger_Info(benchmark::State& state) {
+    Logger& logger = QuietLogger();
+    logger.Debug(false);
+    uint64_t droppedBefore = logger.Dropped();
+
+    int64_t count = 0;
+    for (auto _ : state) {
+        logger.Log("Cliente conectado desde 127.0.0.1:50000", Logger::INFO);
+        if (++count % FLUSH_EVERY == 0) {
+            logger.Flush();
+        }
+    }
+    if (state.thread_index() == 0) {
+        logger.Flush();
+        state.counters["dropped"] = (double)(logger.Dropped() - droppedBefore);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Logger_Info)->Threads(1)->Threads(4)->UseRealTime();
+
+static void BM_Logger_DebugOff(benchmark::State& state) {
+    Logger& logger = QuietLogger();
+    logger.Debug(false);
+    RadarSample sample = MakeSamples(1)[0];
+
+    for (auto _ : state) {
+        LOG_DEBUG(&logger, "Datos de Arduino: " + std::to_string(sample.angle) + "," + std::to_string(sample.distance));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Logger_DebugOff)->Threads(1)->Threads(4)->UseRealTime();
+
+static void BM_Logger_DebugOn(benchmark::State& state) {
+    Logger& logger = QuietLogger();
+    logger.Debug(true);
+    RadarSample sample = MakeSamples(1)[0];
+    uint64_t droppedBefore = logger.Dropped();
+
+    int64_t count = 0;
+    for (auto _ : state) {
+        LOG_DEBUG(&logger, "Datos de Arduino: " + std::to_string(sample.angle) + "," + std::to_string(sample.distance));
+        if (++count % FLUSH_EVERY == 0) {
+            logger.Flush();
+        }
+    }
+    if (state.thread_index() == 0) {
+        logger.Flush();
+        logger.Debug(false);
+        state.counters["dropped"] = (double)(logger.Dropped() - droppedBefore);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Logger_DebugOn)->Threads(1)->Threads(4)->UseRealTime();
+
+int main(int argc, char** argv) {
+    // El formato se decide aquí porque el informe no puede escribir en std::cout
+    std::string format = "console";
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--benchmark_format=", 19) == 0) {
+            format = argv[i] + 19;
+        }
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::AddCustomContext("uar_revision", UAR_REVISION);
+
+    // Logger escribe en std::cout: se desvía a un buffer nulo y el informe usa la salida original
+    std::ostream console(std::cout.rdbuf());
+    NullBuffer null;
+    std::cout.rdbuf(&null);
+
+    std::unique_ptr<benchmark::BenchmarkReporter> reporter;
+    if (format == "json") {
+        reporter.reset(new benchmark::JSONReporter());
+    }
+    else {
+        reporter.reset(new benchmark::ConsoleReporter());
+    }
+    reporter->SetOutputStream(&console);
+    reporter->SetErrorStream(&console);
+
+    benchmark::RunSpecifiedBenchmarks(reporter.get());
+    benchmark::Shutdown();
+
+    QuietLogger().Flush();
+    std::cout.rdbuf(console.rdbuf());
+    return 0;
+}
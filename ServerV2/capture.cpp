@@ -0,0 +1,117 @@
+﻿#include "capture.h"
+#include <chrono>
+#include <cstring>
+
+namespace {
+    uint64_t WallClockMicros() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+CaptureWriter::CaptureWriter()
+    : used(0), syncedBytes(0), samples(0), blockSamples(0), blockChecksum(capture::CHECKSUM_SEED) {}
+
+CaptureWriter::~CaptureWriter() {
+    Close();
+}
+
+bool CaptureWriter::Open(const std::string& path) {
+    Close();
+    if (!file.Open(path, true) || !file.Resize(GROW_SIZE)) {
+        file.Close();
+        return false;
+    }
+
+    capture::Header header = {};
+    memcpy(header.magic, capture::MAGIC, sizeof(header.magic));
+    header.version = capture::VERSION;
+    header.headerSize = sizeof(capture::Header);
+    header.recordSize = sizeof(RadarSample);
+    header.syncInterval = capture::SYNC_INTERVAL;
+    header.startTime = WallClockMicros();
+    header.records = 0;
+    memcpy(file.Data(), &header, sizeof(header));
+
+    this->path = path;
+    used = sizeof(capture::Header);
+    syncedBytes = used;
+    samples = 0;
+    blockSamples = 0;
+    blockChecksum = capture::CHECKSUM_SEED;
+    return true;
+}
+
+bool CaptureWriter::Append(const RadarSample& sample) {
+    if (!file.IsOpen() || !Reserve()) {
+        return false;
+    }
+
+    memcpy(file.Data() + used, &sample, sizeof(sample));
+    used += sizeof(sample);
+    samples++;
+    blockChecksum = capture::Checksum(blockChecksum, sample);
+
+    if (++blockSamples == capture::SYNC_INTERVAL) {
+        WriteSync();
+    }
+    return true;
+}
+
+void CaptureWriter::Close() {
+    if (!file.IsOpen()) {
+        return;
+    }
+
+    if (blockSamples > 0 && Reserve()) {
+        WriteSync();
+    }
+    file.Close(syncedBytes);
+}
+
+bool CaptureWriter::IsOpen() const {
+    return file.IsOpen();
+}
+
+uint64_t CaptureWriter::Samples() const {
+    return samples;
+}
+
+const std::string& CaptureWriter::Path() const {
+    return path;
+}
+
+bool CaptureWriter::Reserve() {
+    // Siempre queda sitio para la muestra y el punto de sincronización que pueda seguirla
+    if (used + 2 * sizeof(RadarSample) <= file.Size()) {
+        return true;
+    }
+    if (file.Resize(file.Size() + GROW_SIZE)) {
+        return true;
+    }
+
+    // Sin espacio: se conserva lo grabado hasta el último punto de sincronización
+    file.Close(syncedBytes);
+    return false;
+}
+
+void CaptureWriter::WriteSync() {
+    RadarSample sync;
+    sync.angle = capture::SYNC_ANGLE;
+    sync.distance = 0;
+    sync.device = 0;
+    sync.sequence = blockChecksum;
+    sync.timestamp = WallClockMicros();
+    memcpy(file.Data() + used, &sync, sizeof(sync));
+    used += sizeof(sync);
+
+    // La cabecera se actualiza después del bloque para que nunca cuente registros sin escribir
+    uint64_t records = (used - sizeof(capture::Header)) / sizeof(RadarSample);
+    memcpy(file.Data() + offsetof(capture::Header, records), &records, sizeof(records));
+    file.Sync(syncedBytes, used - syncedBytes);
+    file.Sync(0, sizeof(capture::Header));
+
+    syncedBytes = used;
+    blockSamples = 0;
+    blockChecksum = capture::CHECKSUM_SEED;
+}
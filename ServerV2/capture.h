@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "mappedfile.h"
+#include "sample.h"
+
+/// <summary>
+/// Formato de los archivos de captura (.uarcap): una cabecera de 64 bytes seguida de
+/// registros con la misma disposición que RadarSample (ángulo, distancia, número de
+/// muestra, instante monotónico en microsegundos y radar), en el orden de bytes del
+/// equipo que grabó (little-endian en todas las plataformas soportadas). La versión 1
+/// tenía registros de 16 bytes, sin radar; ReplaySource las sigue leyendo.
+///
+/// Cada SYNC_INTERVAL muestras se escribe un punto de sincronización: un registro con
+/// angle == SYNC_ANGLE, la suma de comprobación de las muestras del bloque en sequence y
+/// la hora real en timestamp. Solo en esos puntos se actualiza el número de registros
+/// de la cabecera, así que tras un corte el archivo sigue siendo legible hasta el último
+/// punto de sincronización.
+/// </summary>
+namespace capture {
+    const char MAGIC[8] = { 'U', 'A', 'R', 'C', 'A', 'P', '\0', '\0' };
+    const uint32_t VERSION = 2;
+    const uint32_t RECORD_SIZE_V1 = 16;   ///< Registros de la versión 1 (sin radar).
+    const uint16_t SYNC_ANGLE = 0xFFFF;
+    const uint32_t SYNC_INTERVAL = 1024;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;   ///< sizeof(Header); los registros empiezan aquí.
+        uint32_t recordSize;   ///< sizeof(RadarSample).
+        uint32_t syncInterval; ///< Muestras entre puntos de sincronización.
+        uint64_t startTime;    ///< Hora real del inicio de la grabación (microsegundos desde 1970).
+        uint64_t records;      ///< Registros válidos, incluidos los de sincronización.
+        uint8_t reserved[24];
+    };
+
+    static_assert(sizeof(Header) == 64, "La cabecera de captura debe ocupar 64 bytes");
+    static_assert(sizeof(RadarSample) == 24, "Los registros de captura son RadarSample de 24 bytes");
+
+    /**
+     * @brief Suma de comprobación (FNV-1a) de un registro de size bytes, acumulada sobre hash.
+     */
+    inline uint32_t Checksum(uint32_t hash, const void* record, size_t size) {
+        const unsigned char* bytes = (const unsigned char*)record;
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    inline uint32_t Checksum(uint32_t hash, const RadarSample& record) {
+        return Checksum(hash, &record, sizeof(record));
+    }
+
+    const uint32_t CHECKSUM_SEED = 2166136261u;
+}
+
+/// <summary>
+/// Graba muestras en un archivo de captura proyectado en memoria. Añadir una muestra es
+/// copiar un registro; el archivo crece de GROW_SIZE en GROW_SIZE y en cada punto de
+/// sincronización se pide al sistema que lo escriba en disco sin esperar.
+/// Solo debe usarse desde un hilo (el de red, donde se juntan las muestras de todos los radares).
+/// </summary>
+class CaptureWriter {
+public:
+    static const size_t GROW_SIZE = 4 << 20;
+
+    CaptureWriter();
+    ~CaptureWriter();
+
+    /**
+     * @brief Crea (o vacía) el archivo de captura y escribe la cabecera.
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * @brief Añade una muestra. Devuelve false si no se pudo ampliar el archivo (la captura se cierra).
+     */
+    bool Append(const RadarSample& sample);
+
+    /**
+     * @brief Escribe el último punto de sincronización y recorta el archivo.
+     */
+    void Close();
+
+    bool IsOpen() const;
+    uint64_t Samples() const;   ///< Muestras grabadas (sin contar los puntos de sincronización).
+    const std::string& Path() const;
+
+private:
+    bool Reserve();
+    void WriteSync();
+
+    MappedFile file;
+    std::string path;
+    size_t used;          ///< Bytes escritos, cabecera incluida.
+    size_t syncedBytes;   ///< Bytes hasta el último punto de sincronización.
+    uint64_t samples;
+    uint32_t blockSamples;
+    uint32_t blockChecksum;
+};
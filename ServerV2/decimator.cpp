@@ -0,0 +1,57 @@
+﻿#include "decimator.h"
+
+Decimator::Decimator(uint32_t rate, Mode mode, size_t devices)
+    : rate(rate < 1 ? 1 : rate > MAX_RATE ? MAX_RATE : rate), mode(mode), devices(devices), windowEnd(0),
+      slots(devices * ANGLES, EMPTY) {
+    period = 1000000 / this->rate;
+    window.reserve(devices * ANGLES);
+    closed.reserve(devices * ANGLES);
+}
+
+bool Decimator::Add(const RadarSample& sample) {
+    if (sample.angle >= ANGLES || sample.device >= devices) {
+        return false;
+    }
+
+    // La primera muestra de otra ventana cierra la actual; las ventanas vacías no se entregan
+    bool rolled = false;
+    if (sample.timestamp >= windowEnd) {
+        windowEnd = (sample.timestamp / period + 1) * period;
+        rolled = Close();
+    }
+
+    // Solo se toca el hueco del ángulo: el coste por muestra no depende de la tasa
+    uint32_t& slot = slots[sample.device * ANGLES + sample.angle];
+    if (slot == EMPTY) {
+        slot = (uint32_t)window.size();
+        window.push_back(sample);
+    }
+    else if (mode == LATEST || sample.distance < window[slot].distance) {
+        window[slot] = sample;
+    }
+    return rolled;
+}
+
+bool Decimator::Flush(uint64_t now) {
+    return now >= windowEnd && Close();
+}
+
+uint64_t Decimator::Deadline() const {
+    return window.empty() ? 0 : windowEnd;
+}
+
+bool Decimator::Close() {
+    if (window.empty()) {
+        return false;
+    }
+    for (const RadarSample& kept : window) {
+        slots[kept.device * ANGLES + kept.angle] = EMPTY;
+    }
+    closed.swap(window);
+    window.clear();
+    return true;
+}
+
+const std::vector<RadarSample>& Decimator::Closed() const {
+    return closed;
+}
@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "sample.h"
+#include "sweep.h"
+
+/// <summary>
+/// Reduce el flujo de muestras a una entrega por ventana de 1/rate segundos para los clientes
+/// que piden una tasa máxima ("RATE"). En cada ventana guarda una muestra por radar y ángulo:
+/// la última (LATEST) o la de menor distancia (NEAREST), y al cerrarla entrega las guardadas
+/// en el orden en que apareció cada ángulo. Protocol usa un Decimator por clase de tasa (tasa
+/// y modo), no por cliente, así que cada ventana se calcula y codifica una sola vez. Las
+/// ventanas se alinean a múltiplos del periodo en la escala de RadarSample::timestamp, de modo
+/// que dos clases con la misma tasa cierran a la vez. Solo desde el hilo de red.
+/// </summary>
+class Decimator {
+public:
+    enum Mode {
+        LATEST,  ///< Última muestra de cada ángulo en la ventana.
+        NEAREST  ///< Muestra con la menor distancia de cada ángulo en la ventana.
+    };
+
+    static const uint32_t MAX_RATE = 1000;  ///< Entregas por segundo como máximo.
+    static const size_t ANGLES = SweepFrame::MAX_ANGLE + 1;
+
+    /**
+     * @param rate Entregas por segundo (1 a MAX_RATE).
+     * @param devices Radares cuyas muestras pueden llegar (identificadores 0 a devices - 1).
+     */
+    Decimator(uint32_t rate, Mode mode, size_t devices);
+
+    /**
+     * @brief Añade una muestra a la ventana en curso. Las muestras de ángulos fuera de rango o
+     *        de radares desconocidos se ignoran.
+     * @return true si la muestra abrió una ventana nueva y la anterior, con alguna muestra,
+     *         quedó en Closed() hasta el siguiente Add.
+     */
+    bool Add(const RadarSample& sample);
+
+    /**
+     * @brief Cierra la ventana en curso si now (en la escala de RadarSample::timestamp) ya pasó de
+     *        su final, para no esperar a la primera muestra de la siguiente cuando el radar se para.
+     * @return true si la ventana tenía alguna muestra y quedó en Closed().
+     */
+    bool Flush(uint64_t now);
+
+    /**
+     * @brief Instante en que se cierra la ventana en curso, o 0 si no tiene muestras.
+     */
+    uint64_t Deadline() const;
+
+    /**
+     * @brief Muestras de la última ventana cerrada.
+     */
+    const std::vector<RadarSample>& Closed() const;
+
+private:
+    static const uint32_t EMPTY = 0xFFFFFFFFu;
+
+    bool Close();
+
+    uint32_t rate;
+    Mode mode;
+    size_t devices;
+    uint64_t period;                 ///< Microsegundos por ventana.
+    uint64_t windowEnd;              ///< Instante en que se cierra la ventana en curso (0 antes de la primera muestra).
+    std::vector<uint32_t> slots;     ///< Posición en window de cada radar y ángulo, o EMPTY.
+    std::vector<RadarSample> window; ///< Muestras de la ventana en curso, por orden de aparición.
+    std::vector<RadarSample> closed; ///< Última ventana cerrada.
+};
@@ -0,0 +1,79 @@
+﻿#include "deltafilter.h"
+
+DeltaFilter::DeltaFilter()
+    : lastKeyframe(0), keyframeRequested(true), threshold(DEFAULT_THRESHOLD), keyframeInterval(DEFAULT_KEYFRAME_MS),
+      sent(0), suppressed(0), keyframeSamples(0) {
+    for (size_t angle = 0; angle < ANGLES; ++angle) {
+        known[angle] = false;
+    }
+}
+
+bool DeltaFilter::Accept(const RadarSample& sample) {
+    // Un ángulo fuera de rango no se puede recordar: se envía siempre
+    if (sample.angle >= ANGLES) {
+        sent.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    RadarSample& previous = last[sample.angle];
+    int change = (int)sample.distance - (int)previous.distance;
+    if (known[sample.angle] && (change < 0 ? -change : change) <= (int)threshold.load(std::memory_order_relaxed)) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    previous = sample;
+    known[sample.angle] = true;
+    sent.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool DeltaFilter::KeyframeDue(uint64_t now) const {
+    return keyframeRequested || now - lastKeyframe >= (uint64_t)keyframeInterval.load(std::memory_order_relaxed) * 1000;
+}
+
+size_t DeltaFilter::Keyframe(RadarSample* out, uint64_t now) {
+    size_t count = 0;
+    for (size_t angle = 0; angle < ANGLES; ++angle) {
+        if (known[angle]) {
+            out[count++] = last[angle];
+        }
+    }
+
+    lastKeyframe = now;
+    keyframeRequested = false;
+    keyframeSamples.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+void DeltaFilter::RequestKeyframe() {
+    keyframeRequested = true;
+}
+
+uint16_t DeltaFilter::Threshold() const {
+    return threshold;
+}
+
+void DeltaFilter::Threshold(uint16_t value) {
+    threshold = value;
+}
+
+uint32_t DeltaFilter::KeyframeInterval() const {
+    return keyframeInterval;
+}
+
+void DeltaFilter::KeyframeInterval(uint32_t value) {
+    keyframeInterval = value;
+}
+
+uint64_t DeltaFilter::Sent() const {
+    return sent;
+}
+
+uint64_t DeltaFilter::Suppressed() const {
+    return suppressed;
+}
+
+uint64_t DeltaFilter::KeyframeSamples() const {
+    return keyframeSamples;
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "sample.h"
+#include "sweep.h"
+
+/// <summary>
+/// Filtro del modo delta: recuerda la última muestra enviada de cada ángulo y solo deja
+/// pasar las que cambian más que un umbral (la mayoría repiten la distancia anterior, sobre
+/// todo la distancia máxima que el sketch devuelve cuando no hay eco). Cada cierto tiempo
+/// genera un fotograma clave con todos los ángulos para que los clientes se resincronicen.
+/// Accept, KeyframeDue y Keyframe solo desde el hilo de red; la configuración y los
+/// contadores se pueden usar desde cualquier hilo.
+/// </summary>
+class DeltaFilter {
+public:
+    static const uint16_t DEFAULT_THRESHOLD = 2;        ///< Cambio mínimo en centímetros.
+    static const uint32_t DEFAULT_KEYFRAME_MS = 30000;  ///< Intervalo entre fotogramas clave.
+    static const size_t ANGLES = SweepFrame::MAX_ANGLE + 1;
+
+    DeltaFilter();
+
+    /**
+     * @brief Decide si la muestra se envía a los clientes delta.
+     * @return true si el ángulo no tenía valor o la distancia cambió más que el umbral;
+     *         en ese caso pasa a ser el último valor enviado del ángulo.
+     */
+    bool Accept(const RadarSample& sample);
+
+    /**
+     * @brief Indica si toca enviar un fotograma clave.
+     * @param now Instante de la última muestra (microsegundos, como RadarSample::timestamp).
+     */
+    bool KeyframeDue(uint64_t now) const;
+
+    /**
+     * @brief Copia el último valor enviado de cada ángulo conocido y reinicia el intervalo.
+     * @param out Buffer de al menos ANGLES muestras.
+     * @return Número de muestras copiadas.
+     */
+    size_t Keyframe(RadarSample* out, uint64_t now);
+
+    /**
+     * @brief Fuerza un fotograma clave en la próxima publicación (por ejemplo, al entrar un cliente).
+     */
+    void RequestKeyframe();
+
+    /**
+     * @brief Propiedad del umbral de cambio en centímetros.
+     */
+    uint16_t Threshold() const;
+    void Threshold(uint16_t value);
+
+    /**
+     * @brief Propiedad del intervalo entre fotogramas clave en milisegundos.
+     */
+    uint32_t KeyframeInterval() const;
+    void KeyframeInterval(uint32_t value);
+
+    uint64_t Sent() const;            ///< Muestras que pasaron el filtro.
+    uint64_t Suppressed() const;      ///< Muestras omitidas por no cambiar lo suficiente.
+    uint64_t KeyframeSamples() const; ///< Muestras enviadas dentro de fotogramas clave.
+
+private:
+    RadarSample last[ANGLES];  ///< Último valor enviado de cada ángulo.
+    bool known[ANGLES];        ///< El ángulo ya tiene un valor enviado.
+    uint64_t lastKeyframe;
+    bool keyframeRequested;
+
+    std::atomic<uint16_t> threshold;
+    std::atomic<uint32_t> keyframeInterval;
+    std::atomic<uint64_t> sent;
+    std::atomic<uint64_t> suppressed;
+    std::atomic<uint64_t> keyframeSamples;
+};
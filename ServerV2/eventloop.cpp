@@ -0,0 +1,526 @@
+﻿#include "eventloop.h"
+#include <algorithm>
+#include <climits>
+
+EventLoop::EventLoop(Logger* logger, int maxConnections, SendQueue::Policy policy)
+    : logger(logger), maxConnections(maxConnections), policy(policy), listenSocket(INVALID_SOCKET),
+      acceptPaused(false), isRunning(false), clientCount(0), bytesSent(0), messagesSent(0), droppedMessages(0), sendErrors(0), accepted(0),
+      wakeAt(0), snapshot(std::make_shared<const std::vector<ClientInfo>>()), snapshotDirty(false) {}
+
+EventLoop::~EventLoop() {
+    Stop();
+}
+
+bool EventLoop::Start(SOCKET listenSocket) {
+    if (isRunning) {
+        return false;
+    }
+
+    if (!poller.Open()) {
+        logger->Log("No se pudo inicializar el multiplexor de eventos.", Logger::ERROR_LOG);
+        return false;
+    }
+
+    this->listenSocket = listenSocket;
+    if (!net::SetNonBlocking(listenSocket) || !poller.Add(listenSocket, Poller::READ, LISTEN_TAG)) {
+        logger->Log("No se pudo registrar el socket del servidor en el bucle de eventos.", Logger::ERROR_LOG);
+        poller.Close();
+        return false;
+    }
+    acceptPaused = false;
+
+    isRunning = true;
+    thread = std::thread(&EventLoop::Run, this);
+    return true;
+}
+
+void EventLoop::Stop() {
+    if (!isRunning.exchange(false)) {
+        return;
+    }
+
+    poller.Wakeup();
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < clients.Size(); ++i) {
+        closesocket(clients.At(i).socket);
+    }
+    clients.Clear();
+    groups.clear();
+    clientCount = 0;
+    std::atomic_store(&snapshot, std::make_shared<const std::vector<ClientInfo>>());
+    poller.Close();
+}
+
+void EventLoop::Broadcast(const Frame& frame, Channel channel, uint64_t stamp) {
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        wasEmpty = pending.empty();
+        pending.push_back({ frame, channel, stamp });
+    }
+
+    // Si ya había mensajes pendientes, el bucle ya fue despertado y los tomará todos juntos.
+    if (wasEmpty) {
+        poller.Wakeup();
+    }
+}
+
+void EventLoop::Publish(const Frame& frame, Channel channel, uint64_t stamp) {
+    draining.push_back({ frame, channel, stamp });
+}
+
+void EventLoop::Wakeup() {
+    poller.Wakeup();
+}
+
+void EventLoop::WakeAt(uint64_t deadline) {
+    wakeAt = deadline;
+}
+
+void EventLoop::Send(ClientId client, const std::string& message) {
+    Client* target = clients.Get(client);
+    if (target == nullptr || target->closing) {
+        return;
+    }
+
+    Enqueue(*target, MakeFrame(message));
+    FlushClient(*target);
+}
+
+void EventLoop::OnData(DataCallback callback) {
+    onData = std::move(callback);
+}
+
+void EventLoop::OnWakeup(WakeupCallback callback) {
+    onWakeup = std::move(callback);
+}
+
+void EventLoop::OnAccept(ClientCallback callback) {
+    onAccept = std::move(callback);
+}
+
+void EventLoop::OnClose(ClientCallback callback) {
+    onClose = std::move(callback);
+}
+
+void EventLoop::Disconnect(ClientId client) {
+    Client* target = clients.Get(client);
+    if (target != nullptr) {
+        FlushClient(*target);
+        MarkClosing(*target);
+    }
+}
+
+void EventLoop::SetDevice(ClientId client, const std::string& device) {
+    Client* target = clients.Get(client);
+    if (target != nullptr) {
+        target->device = device;
+        snapshotDirty = true;
+    }
+}
+
+bool EventLoop::HasDevice(ClientId client) {
+    Client* target = clients.Get(client);
+    return target != nullptr && !target->device.empty();
+}
+
+void EventLoop::SetChannel(ClientId client, Channel channel) {
+    Client* target = clients.Get(client);
+    if (target != nullptr && target->channel != channel) {
+        Leave(*target);
+        Join(*target, channel);
+        snapshotDirty = true;
+    }
+}
+
+bool EventLoop::IsConnected(ClientId client) {
+    Client* target = clients.Get(client);
+    return target != nullptr && !target->closing;
+}
+
+EventLoop::Channel EventLoop::GetChannel(ClientId client) {
+    Client* target = clients.Get(client);
+    return target != nullptr ? target->channel : 0;
+}
+
+bool EventLoop::HasClients(Channel channel) {
+    return FindGroup(channel) != groups.end();
+}
+
+void EventLoop::Channels(std::vector<Channel>& out) {
+    out.clear();
+    for (const Group& group : groups) {
+        out.push_back(group.channel);
+    }
+}
+
+size_t EventLoop::ClientCount() const {
+    return clientCount;
+}
+
+uint64_t EventLoop::BytesSent() const {
+    return bytesSent.load(std::memory_order_relaxed);
+}
+
+uint64_t EventLoop::MessagesSent() const {
+    return messagesSent.load(std::memory_order_relaxed);
+}
+
+uint64_t EventLoop::DroppedMessages() const {
+    return droppedMessages.load(std::memory_order_relaxed);
+}
+
+uint64_t EventLoop::SendErrors() const {
+    return sendErrors.load(std::memory_order_relaxed);
+}
+
+uint64_t EventLoop::Accepted() const {
+    return accepted.load(std::memory_order_relaxed);
+}
+
+const Histogram& EventLoop::SendLatency() const {
+    return sendLatency;
+}
+
+const Histogram& EventLoop::TotalLatency() const {
+    return totalLatency;
+}
+
+std::shared_ptr<const std::vector<EventLoop::ClientInfo>> EventLoop::Clients() const {
+    return std::atomic_load(&snapshot);
+}
+
+void EventLoop::Run() {
+    std::vector<Poller::PollEvent> events;
+
+    while (isRunning) {
+        // Sin nada programado se espera sin límite; si no, hasta el milisegundo en que toca
+        int timeout = -1;
+        if (wakeAt != 0) {
+            uint64_t now = MonotonicMicros();
+            timeout = now >= wakeAt ? 0 : (int)std::min<uint64_t>((wakeAt - now + 999) / 1000, INT_MAX);
+        }
+        if (poller.Wait(events, timeout) < 0) {
+            logger->Log("Error al esperar eventos de red.", Logger::ERROR_LOG);
+            break;
+        }
+
+        for (const Poller::PollEvent& event : events) {
+            if (event.tag == Poller::WAKEUP_TAG) {
+                DrainBroadcasts();
+                continue;
+            }
+
+            if (event.tag == LISTEN_TAG) {
+                AcceptClients();
+                continue;
+            }
+
+            // Un evento de un cliente que ya se cerró trae una generación antigua y se ignora.
+            Client* client = clients.Get(event.tag);
+            if (client == nullptr) {
+                continue;
+            }
+
+            if (event.events & (Poller::READ | Poller::HANGUP)) {
+                ReadClient(*client);
+            }
+            if ((event.events & Poller::WRITE) && !client->closing) {
+                FlushClient(*client);
+            }
+        }
+
+        if (wakeAt != 0 && MonotonicMicros() >= wakeAt) {
+            wakeAt = 0;
+            DrainBroadcasts();
+        }
+
+        // Los cierres se aplican al final para no invalidar los clientes en uso.
+        for (ClientId id : closing) {
+            CloseClient(id);
+        }
+        closing.clear();
+
+        if (snapshotDirty || (clients.Size() > 0 &&
+            std::chrono::steady_clock::now() - snapshotTime >= std::chrono::milliseconds((int)SNAPSHOT_INTERVAL_MS))) {
+            PublishSnapshot();
+        }
+    }
+}
+
+void EventLoop::AcceptClients() {
+    while (true) {
+        if ((int)clients.Size() >= maxConnections) {
+            logger->Log("Número máximo de conexiones alcanzado.", Logger::WARNING);
+            PauseAccept(true);
+            return;
+        }
+
+        sockaddr_in remote = {};
+        socklen_t remoteLength = sizeof(remote);
+        SOCKET clientSocket = accept(listenSocket, (sockaddr*)&remote, &remoteLength);
+        if (clientSocket == INVALID_SOCKET) {
+            int error = net::LastError();
+            if (net::Interrupted(error)) {
+                continue;
+            }
+            if (!net::WouldBlock(error)) {
+                LOG_LIMITED(logger, "Error al aceptar la conexión del cliente.", Logger::ERROR_LOG);
+            }
+            return;
+        }
+
+        ClientId id = clients.Insert();
+        if (!net::SetNonBlocking(clientSocket) || !poller.Add(clientSocket, Poller::READ, id)) {
+            logger->Log("Error al registrar el cliente en el bucle de eventos.", Logger::ERROR_LOG);
+            clients.Remove(id);
+            closesocket(clientSocket);
+            continue;
+        }
+        net::SetNoDelay(clientSocket);
+
+        Client& client = *clients.Get(id);
+        client.id = id;
+        client.socket = clientSocket;
+        client.address = net::FormatAddress(remote);
+        client.connectedAt = std::chrono::system_clock::now();
+        client.latency = std::make_shared<Histogram>();
+        Join(client, 0);
+        clientCount = clients.Size();
+        accepted.fetch_add(1, std::memory_order_relaxed);
+        snapshotDirty = true;
+        logger->Log("Cliente conectado desde " + client.address + ".", Logger::INFO);
+        if (onAccept) {
+            onAccept(id);
+        }
+    }
+}
+
+void EventLoop::ReadClient(Client& client) {
+    char buffer[1024];
+
+    while (!client.closing) {
+        int bytesRead = recv(client.socket, buffer, sizeof(buffer), 0);
+        if (bytesRead > 0) {
+            if (onData) {
+                onData(client.id, buffer, (size_t)bytesRead);
+            }
+            if (bytesRead < (int)sizeof(buffer)) {
+                return;
+            }
+            continue;
+        }
+
+        if (bytesRead < 0) {
+            int error = net::LastError();
+            if (net::Interrupted(error)) {
+                continue;
+            }
+            if (net::WouldBlock(error)) {
+                return;
+            }
+        }
+
+        MarkClosing(client);
+        return;
+    }
+}
+
+void EventLoop::Enqueue(Client& client, const Frame& frame, uint64_t stamp, uint64_t queuedAt) {
+    uint64_t dropped = client.queue.Dropped();
+
+    if (!client.queue.Push(frame, policy, stamp, queuedAt)) {
+        LOG_LIMITED(logger, "Cliente demasiado lento, se cerrará la conexión.", Logger::WARNING);
+        MarkClosing(client);
+        return;
+    }
+
+    if (client.queue.Dropped() != dropped) {
+        droppedMessages.fetch_add(client.queue.Dropped() - dropped, std::memory_order_relaxed);
+    }
+
+    // Se avisa una sola vez por cliente para no inundar el log mientras siga atrasado.
+    if (client.queue.Dropped() != dropped && !client.lagging) {
+        client.lagging = true;
+        LOG_LIMITED(logger, "Cliente demasiado lento, se descartarán mensajes antiguos (política " +
+            std::string(SendQueue::PolicyName(policy)) + ").", Logger::WARNING);
+    }
+}
+
+void EventLoop::FlushClient(Client& client) {
+    if (client.closing) {
+        return;
+    }
+
+    uint64_t sent = client.queue.Sent();
+    uint64_t messages = client.queue.Messages();
+    SendQueue::Latency latency = { &sendLatency, &totalLatency, client.latency.get() };
+    SendQueue::FlushResult result = client.queue.Flush(client.socket, &latency);
+    if (client.queue.Sent() != sent) {
+        bytesSent.fetch_add(client.queue.Sent() - sent, std::memory_order_relaxed);
+        messagesSent.fetch_add(client.queue.Messages() - messages, std::memory_order_relaxed);
+    }
+    if (result == SendQueue::FAILED) {
+        sendErrors.fetch_add(1, std::memory_order_relaxed);
+        MarkClosing(client);
+        return;
+    }
+    if (result == SendQueue::FLUSHED) {
+        client.lagging = false;
+    }
+
+    // Solo se vigila WRITE mientras haya datos que el kernel no aceptó.
+    bool wantWrite = result == SendQueue::PENDING;
+    if (wantWrite != client.writing) {
+        poller.Modify(client.socket, Poller::READ | (wantWrite ? (unsigned)Poller::WRITE : 0u), client.id);
+        client.writing = wantWrite;
+    }
+}
+
+void EventLoop::MarkClosing(Client& client) {
+    if (!client.closing) {
+        client.closing = true;
+        closing.push_back(client.id);
+    }
+}
+
+void EventLoop::CloseClient(ClientId id) {
+    Client* client = clients.Get(id);
+    if (client == nullptr) {
+        return;
+    }
+
+    if (onClose) {
+        onClose(id);
+    }
+    std::string address = client->address;
+    Leave(*client);
+    poller.Remove(client->socket);
+    closesocket(client->socket);
+    clients.Remove(id);
+    clientCount = clients.Size();
+    snapshotDirty = true;
+    logger->Log("Cliente desconectado (" + address + ").", Logger::WARNING);
+
+    if (acceptPaused && (int)clients.Size() < maxConnections) {
+        PauseAccept(false);
+    }
+}
+
+void EventLoop::DrainBroadcasts() {
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        draining.swap(pending);
+    }
+
+    // El callback añade a draining lo que publique con Publish().
+    if (onWakeup) {
+        onWakeup();
+    }
+
+    if (draining.empty()) {
+        return;
+    }
+
+    // La etapa de envío empieza aquí, con todos los mensajes de esta vuelta ya construidos
+    uint64_t queuedAt = MonotonicMicros();
+
+    // Se agrupan las difusiones por canal sin alterar su orden dentro de cada uno; así cada
+    // tramo solo recorre a los clientes de su canal y los demás ni se tocan. Cada cliente
+    // recibe referencias a los mismos Frames y los envía en una sola llamada.
+    std::stable_sort(draining.begin(), draining.end(), [](const Outgoing& a, const Outgoing& b) { return a.channel < b.channel; });
+    for (size_t first = 0; first < draining.size();) {
+        size_t last = first + 1;
+        while (last < draining.size() && draining[last].channel == draining[first].channel) {
+            last++;
+        }
+
+        auto group = FindGroup(draining[first].channel);
+        if (group != groups.end()) {
+            for (ClientId id : group->members) {
+                Client& client = *clients.Get(id);
+                for (size_t i = first; i < last && !client.closing; ++i) {
+                    Enqueue(client, draining[i].frame, draining[i].stamp, queuedAt);
+                }
+                FlushClient(client);
+            }
+        }
+        first = last;
+    }
+
+    if (logger->Enabled(Logger::DEBUG)) {
+        // Solo se muestra el canal 0; el resto puede no ser texto.
+        for (const Outgoing& outgoing : draining) {
+            if (outgoing.channel == 0) {
+                LOG_DEBUG(logger, "Mensaje enviado a " + std::to_string(clients.Size()) + " clientes: " + *outgoing.frame);
+            }
+        }
+    }
+
+    draining.clear();
+}
+
+void EventLoop::PauseAccept(bool pause) {
+    if (pause == acceptPaused) {
+        return;
+    }
+
+    if (pause) {
+        poller.Remove(listenSocket);
+    }
+    else {
+        poller.Add(listenSocket, Poller::READ, LISTEN_TAG);
+    }
+    acceptPaused = pause;
+}
+
+std::vector<EventLoop::Group>::iterator EventLoop::FindGroup(Channel channel) {
+    auto group = std::lower_bound(groups.begin(), groups.end(), channel,
+        [](const Group& group, Channel channel) { return group.channel < channel; });
+    return group != groups.end() && group->channel == channel ? group : groups.end();
+}
+
+void EventLoop::Join(Client& client, Channel channel) {
+    auto group = std::lower_bound(groups.begin(), groups.end(), channel,
+        [](const Group& group, Channel channel) { return group.channel < channel; });
+    if (group == groups.end() || group->channel != channel) {
+        group = groups.insert(group, Group{ channel, {} });
+    }
+    client.channel = channel;
+    client.member = group->members.size();
+    group->members.push_back(client.id);
+}
+
+void EventLoop::Leave(Client& client) {
+    auto group = FindGroup(client.channel);
+    if (group == groups.end()) {
+        return;
+    }
+
+    // El último miembro ocupa el hueco, así que salir no depende del tamaño del grupo
+    ClientId moved = group->members.back();
+    group->members[client.member] = moved;
+    clients.Get(moved)->member = client.member;
+    group->members.pop_back();
+    if (group->members.empty()) {
+        groups.erase(group);
+    }
+}
+
+void EventLoop::PublishSnapshot() {
+    auto next = std::make_shared<std::vector<ClientInfo>>();
+    next->reserve(clients.Size());
+    for (size_t i = 0; i < clients.Size(); ++i) {
+        const Client& client = clients.At(i);
+        next->push_back({ client.id, client.address, client.device, client.connectedAt,
+            client.queue.Sent(), client.queue.Dropped(), client.channel, client.queue.Messages(), client.queue.Count(),
+            client.queue.Bytes(), client.latency });
+    }
+
+    std::atomic_store(&snapshot, std::shared_ptr<const std::vector<ClientInfo>>(std::move(next)));
+    snapshotDirty = false;
+    snapshotTime = std::chrono::steady_clock::now();
+}
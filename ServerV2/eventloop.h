@@ -0,0 +1,279 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "network.h"
+#include "poller.h"
+#include "frame.h"
+#include "sendqueue.h"
+#include "slotmap.h"
+#include "logger.h"
+
+/// <summary>
+/// Bucle de eventos de red: un único hilo acepta clientes, lee sus datos y envía
+/// las difusiones con sockets no bloqueantes (epoll en Linux, WSAPoll en Windows).
+/// Sustituye al esquema de un hilo por cliente de Protocol.
+/// </summary>
+class EventLoop {
+public:
+    /// Identificador de cliente con generación: deja de ser válido cuando el cliente se
+    /// desconecta, aunque el sistema reutilice el mismo socket para otra conexión.
+    using ClientId = uint64_t;
+
+    /// Canal de difusión: cada difusión llega solo a los clientes de su canal (por ejemplo,
+    /// los que reciben texto y los que negociaron el formato binario). Todos empiezan en el 0.
+    /// Protocol guarda en él el formato, el modo y los radares a los que está suscrito el cliente.
+    using Channel = uint64_t;
+
+    /// Datos de un cliente conectado, tal como se ven desde otros hilos.
+    struct ClientInfo {
+        ClientId id;
+        std::string address;                              ///< IP:puerto remoto.
+        std::string device;                               ///< Identificación que envió la aplicación al conectarse.
+        std::chrono::system_clock::time_point connectedAt;
+        uint64_t bytesSent;                               ///< Bytes entregados al kernel.
+        uint64_t dropped;                                 ///< Mensajes descartados por ser lento.
+        Channel channel;
+        uint64_t messagesSent;                            ///< Mensajes entregados al kernel por completo.
+        size_t queued;                                    ///< Mensajes en su cola de envío.
+        size_t queuedBytes;                               ///< Bytes en su cola de envío.
+        std::shared_ptr<const Histogram> latency;         ///< Microsegundos desde que se completa la trama de una
+                                                          ///< muestra hasta que sus bytes llegan al kernel.
+    };
+
+    /// Se invoca en el hilo del bucle cuando un cliente envía datos.
+    using DataCallback = std::function<void(ClientId client, const char* data, size_t length)>;
+
+    /// Se invoca en el hilo del bucle cada vez que otro hilo llama a Wakeup().
+    using WakeupCallback = std::function<void()>;
+
+    /// Se invoca en el hilo del bucle al aceptar un cliente (ya en el canal 0) o al cerrarlo.
+    using ClientCallback = std::function<void(ClientId client)>;
+
+    /**
+     * @brief Constructor de EventLoop.
+     * @param logger Instancia del logger para manejar mensajes de log.
+     * @param maxConnections Número máximo de clientes conectados a la vez.
+     * @param policy Qué hacer con los clientes que no consumen los mensajes a tiempo.
+     */
+    EventLoop(Logger* logger, int maxConnections, SendQueue::Policy policy = SendQueue::DROP_OLDEST);
+    ~EventLoop();
+
+    /**
+     * @brief Inicia el hilo del bucle sobre un socket que ya está escuchando.
+     * @param listenSocket Socket del servidor (se cambia a modo no bloqueante).
+     * @return true si el bucle quedó en ejecución.
+     */
+    bool Start(SOCKET listenSocket);
+
+    /**
+     * @brief Detiene el bucle y cierra todos los clientes. No cierra el socket de escucha.
+     */
+    void Stop();
+
+    /**
+     * @brief Encola un mensaje para todos los clientes del canal. Se puede llamar desde cualquier hilo.
+     *        El Frame se comparte entre todas las colas, sin copiar los bytes.
+     * @param stamp Instante (MonotonicMicros) en que se completó la trama de la muestra más antigua
+     *        del mensaje, para medir su latencia hasta cada cliente; 0 si no se mide.
+     */
+    void Broadcast(const Frame& frame, Channel channel = 0, uint64_t stamp = 0);
+
+    /**
+     * @brief Difunde un mensaje desde el hilo del bucle (normalmente dentro del WakeupCallback),
+     *        sin pasar por el mutex de Broadcast. Se envía al terminar el callback.
+     */
+    void Publish(const Frame& frame, Channel channel = 0, uint64_t stamp = 0);
+
+    /**
+     * @brief Despierta el bucle para que ejecute el WakeupCallback. Se puede llamar desde cualquier hilo.
+     */
+    void Wakeup();
+
+    /**
+     * @brief Programa una ejecución del WakeupCallback para el instante indicado (MonotonicMicros)
+     *        aunque nadie llame a Wakeup(); 0 la cancela. Solo desde el hilo del bucle: cada llamada
+     *        sustituye a la anterior.
+     */
+    void WakeAt(uint64_t deadline);
+
+    /**
+     * @brief Envía datos a un único cliente. Solo debe llamarse desde el hilo del bucle
+     *        (por ejemplo, dentro del DataCallback).
+     */
+    void Send(ClientId client, const std::string& message);
+
+    /**
+     * @brief Establece la función que recibe los datos enviados por los clientes.
+     */
+    void OnData(DataCallback callback);
+
+    /**
+     * @brief Establece la función que se ejecuta en el hilo del bucle tras cada Wakeup().
+     *        Permite consumir colas propias (por ejemplo, el anillo de muestras) sin mutex.
+     */
+    void OnWakeup(WakeupCallback callback);
+
+    /**
+     * @brief Establecen las funciones que se ejecutan al aceptar y al cerrar cada cliente, para
+     *        quien guarde estado propio por cliente.
+     */
+    void OnAccept(ClientCallback callback);
+    void OnClose(ClientCallback callback);
+
+    /**
+     * @brief Cierra un cliente al terminar la iteración, después de intentar enviar lo que
+     *        tenga en cola. Solo desde el hilo del bucle.
+     */
+    void Disconnect(ClientId client);
+
+    /**
+     * @brief Guarda la identificación del dispositivo de un cliente. Solo desde el hilo del bucle.
+     */
+    void SetDevice(ClientId client, const std::string& device);
+
+    /**
+     * @brief Indica si el cliente ya envió su identificación. Solo desde el hilo del bucle.
+     */
+    bool HasDevice(ClientId client);
+
+    /**
+     * @brief Cambia el canal de difusión de un cliente. Solo desde el hilo del bucle; lo que ya
+     *        estaba en su cola se envía antes que las difusiones del canal nuevo.
+     */
+    void SetChannel(ClientId client, Channel channel);
+
+    /**
+     * @brief Canal de difusión de un cliente (0 si no existe). Solo desde el hilo del bucle.
+     */
+    Channel GetChannel(ClientId client);
+
+    /**
+     * @brief Indica si el cliente sigue conectado y no está marcado para cerrarse. Solo desde el
+     *        hilo del bucle; sirve para no preparar mensajes a clientes que ya se fueron.
+     */
+    bool IsConnected(ClientId client);
+
+    /**
+     * @brief Indica si algún cliente está en el canal. Solo desde el hilo del bucle; permite no
+     *        codificar mensajes que nadie va a recibir.
+     */
+    bool HasClients(Channel channel);
+
+    /**
+     * @brief Canales distintos en los que hay algún cliente, sin repetir. Solo desde el hilo del bucle.
+     */
+    void Channels(std::vector<Channel>& out);
+
+    /**
+     * @brief Número de clientes conectados actualmente.
+     */
+    size_t ClientCount() const;
+
+    /**
+     * @brief Copia de los clientes conectados. Se puede llamar desde cualquier hilo sin
+     *        bloquear al bucle: lee la última instantánea publicada (los contadores de bytes
+     *        se actualizan como mucho cada SNAPSHOT_INTERVAL_MS).
+     */
+    std::shared_ptr<const std::vector<ClientInfo>> Clients() const;
+
+    // Totales desde el arranque, incluidos los clientes ya desconectados (cualquier hilo)
+    uint64_t BytesSent() const;
+    uint64_t MessagesSent() const;
+    uint64_t DroppedMessages() const;
+    uint64_t SendErrors() const;      ///< Envíos fallidos (el cliente se cierra).
+    uint64_t Accepted() const;        ///< Conexiones aceptadas.
+
+    // Latencias de los mensajes fechados de todos los clientes, en microsegundos (cualquier hilo)
+    const Histogram& SendLatency() const;   ///< Desde que se encolan hasta que llegan al kernel.
+    const Histogram& TotalLatency() const;  ///< Desde que se completó la trama hasta que llegan al kernel.
+
+private:
+    /// Estado de cada cliente conectado.
+    struct Client {
+        ClientId id = 0;
+        SOCKET socket = INVALID_SOCKET;
+        std::string address;
+        std::string device;
+        std::chrono::system_clock::time_point connectedAt;
+        SendQueue queue;       ///< Mensajes pendientes de enviar.
+        Channel channel = 0;   ///< Canal de difusión del cliente.
+        size_t member = 0;     ///< Posición del cliente en los miembros del grupo de su canal.
+        bool writing = false;  ///< Indica si se está esperando el evento WRITE.
+        bool closing = false;  ///< Marcado para cerrarse al final de la iteración.
+        bool lagging = false;  ///< Ya se avisó de que el cliente pierde mensajes.
+        std::shared_ptr<Histogram> latency;  ///< Compartido con las instantáneas, que pueden sobrevivir al cliente.
+    };
+
+    /// Difusión pendiente, el canal al que va dirigida y el instante de su muestra más antigua.
+    struct Outgoing {
+        Frame frame;
+        Channel channel;
+        uint64_t stamp;
+    };
+
+    /// Clientes de un mismo canal: cada difusión recorre solo a los de su canal.
+    struct Group {
+        Channel channel;
+        std::vector<ClientId> members;
+    };
+
+    static const uint64_t LISTEN_TAG = ~0ull - 1;   ///< Etiqueta del socket de escucha en el Poller.
+    static const int SNAPSHOT_INTERVAL_MS = 1000;   ///< Refresco máximo de la instantánea de clientes.
+
+    void Run();
+    void AcceptClients();
+    void ReadClient(Client& client);
+    void Enqueue(Client& client, const Frame& frame, uint64_t stamp = 0, uint64_t queuedAt = 0);
+    void FlushClient(Client& client);
+    void MarkClosing(Client& client);
+    void CloseClient(ClientId id);
+    void DrainBroadcasts();
+    void PauseAccept(bool pause);
+    void PublishSnapshot();
+    void Join(Client& client, Channel channel);
+    void Leave(Client& client);
+    std::vector<Group>::iterator FindGroup(Channel channel);
+
+    Poller poller;
+    Logger* logger;
+    int maxConnections;
+    SendQueue::Policy policy;
+    SOCKET listenSocket;
+    bool acceptPaused;
+    std::atomic<bool> isRunning;
+    std::atomic<size_t> clientCount;
+    std::atomic<uint64_t> bytesSent;
+    std::atomic<uint64_t> messagesSent;
+    std::atomic<uint64_t> droppedMessages;
+    std::atomic<uint64_t> sendErrors;
+    std::atomic<uint64_t> accepted;
+    Histogram sendLatency;
+    Histogram totalLatency;
+    std::thread thread;
+
+    SlotMap<Client> clients;               ///< Solo se accede desde el hilo del bucle.
+    std::vector<Group> groups;             ///< Clientes por canal, ordenados por canal (hilo del bucle).
+    std::vector<ClientId> closing;         ///< Clientes a cerrar al terminar la iteración actual.
+    uint64_t wakeAt;                       ///< Próxima ejecución programada con WakeAt; 0 si no hay (hilo del bucle).
+    DataCallback onData;
+    WakeupCallback onWakeup;
+    ClientCallback onAccept;
+    ClientCallback onClose;
+
+    std::mutex pendingMutex;               ///< Protege pending.
+    std::vector<Outgoing> pending;         ///< Difusiones encoladas por otros hilos.
+    std::vector<Outgoing> draining;        ///< Copia local de pending más lo publicado en el bucle.
+
+    // Instantánea de clientes al estilo RCU: el bucle publica una copia nueva y los lectores
+    // se quedan con la que tenían mientras la usan.
+    std::shared_ptr<const std::vector<ClientInfo>> snapshot;
+    bool snapshotDirty;
+    std::chrono::steady_clock::time_point snapshotTime;
+};
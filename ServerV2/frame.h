@@ -0,0 +1,26 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/// <summary>
+/// Mensaje ya codificado y compartido entre todos los clientes que lo reciben.
+/// Es inmutable: el difusor lo construye una vez y cada cola de envío solo guarda
+/// una referencia, de modo que difundir a N clientes no copia los bytes N veces.
+/// </summary>
+using Frame = std::shared_ptr<const std::string>;
+
+/**
+ * @brief Crea un Frame a partir de los bytes indicados.
+ */
+inline Frame MakeFrame(const char* data, size_t length) {
+    return std::make_shared<const std::string>(data, length);
+}
+
+/**
+ * @brief Crea un Frame a partir de una cadena.
+ */
+inline Frame MakeFrame(const std::string& message) {
+    return std::make_shared<const std::string>(message);
+}
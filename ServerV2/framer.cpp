@@ -0,0 +1,213 @@
+﻿#include "framer.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FRAMER_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRAMER_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+#if defined(FRAMER_AVX2) || defined(FRAMER_SSE2)
+    // Índice del bit menos significativo activo de una máscara distinta de cero
+    inline unsigned LowestBit(unsigned mask) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (unsigned)index;
+#else
+        return (unsigned)__builtin_ctz(mask);
+#endif
+    }
+#endif
+}
+
+size_t FindTerminator(const char* data, size_t length) {
+    size_t i = 0;
+
+#if defined(FRAMER_AVX2)
+    const __m256i dots = _mm256_set1_epi8('.');
+    const __m256i newlines = _mm256_set1_epi8('\n');
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(block, dots), _mm256_cmpeq_epi8(block, newlines));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hits);
+        if (mask != 0) {
+            return i + LowestBit(mask);
+        }
+    }
+#endif
+
+#if defined(FRAMER_AVX2) || defined(FRAMER_SSE2)
+    const __m128i dots16 = _mm_set1_epi8('.');
+    const __m128i newlines16 = _mm_set1_epi8('\n');
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, dots16), _mm_cmpeq_epi8(block, newlines16));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return i + LowestBit(mask);
+        }
+    }
+#endif
+
+    // Resto (o plataformas sin SIMD)
+    for (; i < length; ++i) {
+        if (data[i] == '.' || data[i] == '\n') {
+            return i;
+        }
+    }
+    return length;
+}
+
+Framer::Framer() : head(0), tail(0), scanned(0), errors(0) {}
+
+char* Framer::WriteBuffer(size_t& available) {
+    size_t start = tail & MASK;
+    size_t free = CAPACITY - (tail - head);
+    available = free < CAPACITY - start ? free : CAPACITY - start;
+    return ring + start;
+}
+
+void Framer::Commit(size_t bytes) {
+    tail += bytes;
+}
+
+size_t Framer::Write(const char* data, size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        size_t available;
+        char* buffer = WriteBuffer(available);
+        if (available == 0) {
+            break;
+        }
+        size_t chunk = length - written < available ? length - written : available;
+        memcpy(buffer, data + written, chunk);
+        Commit(chunk);
+        written += chunk;
+    }
+    return written;
+}
+
+bool Framer::Next(RadarSample& sample) {
+    while (head != tail) {
+        size_t pending = tail - head;
+
+        // Busca el terminador a partir de lo ya revisado; el anillo puede dar dos tramos contiguos
+        size_t found = pending;
+        size_t offset = scanned;
+        while (offset < pending) {
+            size_t start = (head + offset) & MASK;
+            size_t span = pending - offset < CAPACITY - start ? pending - offset : CAPACITY - start;
+            size_t index = FindTerminator(ring + start, span);
+            if (index < span) {
+                found = offset + index;
+                break;
+            }
+            offset += span;
+        }
+
+        if (found == pending) {
+            // Línea incompleta: se espera a la siguiente lectura, salvo que ya sea demasiado larga
+            scanned = pending;
+            if (pending > MAX_RECORD) {
+                errors++;
+                head = tail;
+                scanned = 0;
+            }
+            return false;
+        }
+
+        bool parsed = false;
+        if (found > MAX_RECORD) {
+            errors++;
+        }
+        else {
+            // El registro puede cruzar el final del anillo: en ese caso se copia a un buffer local
+            char scratch[MAX_RECORD];
+            const char* record = ring + (head & MASK);
+            size_t start = head & MASK;
+            if (start + found > CAPACITY) {
+                size_t first = CAPACITY - start;
+                memcpy(scratch, ring + start, first);
+                memcpy(scratch + first, ring, found - first);
+                record = scratch;
+            }
+
+            size_t length = found;
+            while (length > 0 && (record[0] == '\r' || record[0] == ' ')) {
+                record++;
+                length--;
+            }
+            while (length > 0 && (record[length - 1] == '\r' || record[length - 1] == ' ')) {
+                length--;
+            }
+
+            // Los restos "\r\n" tras el '.' forman registros vacíos que simplemente se ignoran
+            if (length > 0) {
+                parsed = Parse(record, length, sample);
+                if (!parsed) {
+                    errors++;
+                }
+            }
+        }
+
+        head += found + 1;
+        scanned = 0;
+        if (parsed) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Framer::Parse(const char* record, size_t length, RadarSample& sample) {
+    unsigned values[2] = { 0, 0 };
+    size_t field = 0;
+    size_t digits = 0;
+
+    for (size_t i = 0; i < length; ++i) {
+        char c = record[i];
+        if (c >= '0' && c <= '9') {
+            values[field] = values[field] * 10 + (unsigned)(c - '0');
+            if (values[field] > 0xFFFF) {
+                return false;
+            }
+            digits++;
+        }
+        else if (c == ',' && field == 0 && digits > 0) {
+            field = 1;
+            digits = 0;
+        }
+        else {
+            return false;
+        }
+    }
+
+    if (field != 1 || digits == 0) {
+        return false;
+    }
+
+    sample.angle = (uint16_t)values[0];
+    sample.distance = (uint16_t)values[1];
+    return true;
+}
+
+uint64_t Framer::Errors() const {
+    return errors;
+}
+
+size_t Framer::Buffered() const {
+    return tail - head;
+}
+
+void Framer::Reset() {
+    head = tail = 0;
+    scanned = 0;
+}
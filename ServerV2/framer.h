@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "sample.h"
+
+/// <summary>
+/// Separador de tramas del puerto serie. Guarda los bytes en un anillo de tamaño fijo
+/// que se llena con lecturas en bloque y entrega las muestras "ángulo,distancia." ya
+/// interpretadas, sin reservar memoria por muestra. Las líneas que quedan partidas entre
+/// dos lecturas (o en el borde del anillo) se completan con la siguiente lectura.
+/// </summary>
+class Framer {
+public:
+    static const size_t CAPACITY = 4096; ///< Tamaño del anillo (potencia de dos).
+    static const size_t MAX_RECORD = 32; ///< Longitud máxima de un registro válido.
+
+    Framer();
+
+    /**
+     * @brief Devuelve el hueco contiguo libre del anillo para leer directamente en él.
+     * @param available Recibe el número de bytes que se pueden escribir.
+     * @return Puntero al inicio del hueco.
+     */
+    char* WriteBuffer(size_t& available);
+
+    /**
+     * @brief Confirma los bytes escritos en el hueco devuelto por WriteBuffer.
+     */
+    void Commit(size_t bytes);
+
+    /**
+     * @brief Copia datos al anillo (útil cuando los bytes no vienen de Serial).
+     * @return Número de bytes copiados (puede ser menor si el anillo está lleno).
+     */
+    size_t Write(const char* data, size_t length);
+
+    /**
+     * @brief Extrae la siguiente muestra completa.
+     * @param sample Recibe la muestra interpretada.
+     * @return true si había una muestra completa; false si hacen falta más datos.
+     */
+    bool Next(RadarSample& sample);
+
+    /**
+     * @brief Número de registros descartados por estar mal formados.
+     */
+    uint64_t Errors() const;
+
+    /**
+     * @brief Bytes pendientes de procesar en el anillo.
+     */
+    size_t Buffered() const;
+
+    /**
+     * @brief Descarta todo el contenido del anillo.
+     */
+    void Reset();
+
+private:
+    static const size_t MASK = CAPACITY - 1;
+
+    bool Parse(const char* record, size_t length, RadarSample& sample);
+
+    char ring[CAPACITY]; ///< Bytes recibidos.
+    size_t head;         ///< Posición (absoluta) del siguiente byte a procesar.
+    size_t tail;         ///< Posición (absoluta) del siguiente byte a escribir.
+    size_t scanned;      ///< Bytes desde head ya revisados sin encontrar terminador.
+    uint64_t errors;     ///< Registros descartados.
+};
+
+/**
+ * @brief Busca el primer terminador de registro ('.' o '\n') usando SIMD cuando está disponible.
+ * @return Índice del terminador, o length si no hay ninguno.
+ */
+size_t FindTerminator(const char* data, size_t length);
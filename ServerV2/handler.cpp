@@ -1,9 +1,12 @@
 #include "handler.h"
+#include <chrono>
+#include <thread>
 
-Handler::Handler(const std::string& comPort, unsigned int baudRate, Logger* logger, bool debug)
-    : comPort(comPort), baudRate(baudRate), logger(logger), debug(debug) {
+Handler::Handler(const std::string& comPort, unsigned int baudRate, Logger* logger, bool debug, MetricsRegistry* metrics)
+    : logger(logger), debug(debug), comPort(comPort), baudRate(baudRate), metrics(metrics), reportedErrors(0), rateSamples(0),
+      readAt(0), rateStart(std::chrono::steady_clock::now()) {
     // Se puede optar por abrir el puerto aqu, si se desea iniciar automticamente
-    if (!serialPort.openDevice(comPort.c_str(), baudRate)) {
+    if (serialPort.openDevice(comPort.c_str(), baudRate) != 1) {
         if (logger) {
             logger->Log("Error al intentar abrir el puerto en el constructor.", Logger::ERROR_LOG);
         }
@@ -22,11 +25,14 @@ void Handler::Debug(bool value) {
 // Mtodo para abrir el puerto serie
 bool Handler::Start() {
     if (serialPort.isDeviceOpen()) {
-        logger->Log("El puerto ya est abierto.", Logger::DEBUG);
+        LOG_DEBUG(logger, "El puerto ya est abierto.");
+        RegisterMetrics();
         return true;
     }
 
-    if (serialPort.openDevice(comPort.c_str(), baudRate) == 0) {
+    if (serialPort.openDevice(comPort.c_str(), baudRate) == 1) {
+        framer.Reset();
+        RegisterMetrics();
         logger->Log("Conexin establecida con Arduino en el puerto.", Logger::INFO);
         return true;
     }
@@ -36,41 +42,52 @@ bool Handler::Start() {
     }
 }
 
-// Mtodo para leer datos del Arduino
-std::string Handler::ReadFromArduino() {
+// Mtodo para leer una muestra del Arduino
+bool Handler::ReadSample(RadarSample& sample) {
     if (!serialPort.isDeviceOpen()) {
-        logger->Log("El puerto no est abierto.", Logger::DEBUG);
-        return "";
+        LOG_DEBUG(logger, "El puerto no est abierto.");
+        return false;
     }
 
-    std::string data;
-    char currentChar;
-    int result;
+    // Solo se llama al puerto cuando el anillo no contiene ninguna muestra completa;
+    // cada lectura trae todo lo que el controlador tenga en su buffer.
+    while (!framer.Next(sample)) {
+        size_t available;
+        char* buffer = framer.WriteBuffer(available);
 
-    for (int i = 0; i < 180; ++i) {
-        result = serialPort.readChar(&currentChar);
+        int result = serialPort.readBytes(buffer, (unsigned int)available, READ_TIMEOUT_MS);
         if (result < 0) {
-            logger->Log("Error al leer del Arduino.", Logger::ERROR_LOG);
-            return "";
+            // Tras un error el puerto responde al instante: se espera el mismo tiempo que una
+            // lectura sin datos para que el hilo lector no consuma toda la CPU.
+            LOG_LIMITED(logger, "Error al leer del Arduino.", Logger::ERROR_LOG);
+            std::this_thread::sleep_for(std::chrono::milliseconds((unsigned int)READ_TIMEOUT_MS));
+            return false;
         }
-
-        data += currentChar;
-
-        if (currentChar == '.') {
-            break;
+        if (result == 0) {
+            return false;
         }
+        framer.Commit((size_t)result);
+        readAt = MonotonicMicros();
+        bytesRead.Add((uint64_t)result);
+        UpdateRate();
     }
-    if (data.back() == '.') {
-        data.pop_back();
-    }
-    data.erase(std::remove_if(data.begin(), data.end(), [](char c) {
-        return c == '\n' || c == '\r';
-        }), data.end());
-    logger->Log("Datos de Arduino: " + data, Logger::DEBUG);
-    return data;
-}
 
+    // Solo operaciones relajadas: un incremento por muestra y otro si el Framer descart algo.
+    // La etapa de tramado va desde que el ltimo bloque ledo entr en el anillo.
+    sample.timestamp = MonotonicMicros();
+    framingLatency.Record(sample.timestamp > readAt ? sample.timestamp - readAt : 0);
+    samplesRead.Add();
+    uint64_t errors = framer.Errors();
+    if (errors != reportedErrors) {
+        framingErrors.Add(errors - reportedErrors);
+        reportedErrors = errors;
+    }
 
+    if (debug) {
+        LOG_DEBUG(logger, "Datos de Arduino: " + std::to_string(sample.angle) + "," + std::to_string(sample.distance));
+    }
+    return true;
+}
 
 // Mtodo para cerrar el puerto serie
 void Handler::Stop() {
@@ -78,18 +95,50 @@ void Handler::Stop() {
         serialPort.closeDevice();
         logger->Log("Conexin cerrada con Arduino.", Logger::INFO);
     }
+    if (metrics != nullptr) {
+        metrics->Remove(this);
+    }
+}
+
+// Publica los contadores del puerto; se quitan al cerrarlo
+void Handler::RegisterMetrics() {
+    if (metrics == nullptr) {
+        return;
+    }
+    std::string label = MetricsRegistry::Label("port", comPort);
+    metrics->Remove(this);
+    metrics->Add(this, "uar_serial_bytes_read_total", "Bytes leidos del puerto serie.", label, bytesRead);
+    metrics->Add(this, "uar_serial_samples_total", "Muestras completas leidas del puerto serie.", label, samplesRead);
+    metrics->Add(this, "uar_serial_framing_errors_total", "Registros mal formados descartados.", label, framingErrors);
+    metrics->Add(this, "uar_serial_samples_per_second", "Ritmo de muestras del puerto serie en el ultimo segundo.", label,
+        samplesPerSecond);
+    metrics->Add(this, "uar_latency_framing_us", "Microsegundos desde que llegan los bytes hasta que se completa la trama.", label,
+        framingLatency);
+}
+
+// Ritmo de muestras: se recalcula al leer del puerto, como mucho una vez por RATE_INTERVAL_MS
+void Handler::UpdateRate() {
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - rateStart).count();
+    if (elapsed < (long long)RATE_INTERVAL_MS) {
+        return;
+    }
+    uint64_t samples = samplesRead.Value();
+    samplesPerSecond.Set((int64_t)((samples - rateSamples) * 1000 / (uint64_t)elapsed));
+    rateSamples = samples;
+    rateStart = now;
 }
 
 // Mtodo para enviar un comando al Arduino
 void Handler::SendCommand(const std::string& command) {
     if (!serialPort.isDeviceOpen()) {
-        logger->Log("El puerto no est abierto.", Logger::DEBUG);
+        LOG_DEBUG(logger, "El puerto no est abierto.");
         return;
     }
 
     int result = serialPort.writeString(command.c_str());
     if (result >= 0) {
-        logger->Log("Comando enviado a Arduino: " + command, Logger::DEBUG);
+        LOG_DEBUG(logger, "Comando enviado a Arduino: " + command);
     }
     else {
         logger->Log("Error al enviar comando a Arduino.", Logger::ERROR_LOG);
@@ -1,13 +1,17 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 #include "serial.h"
+#include "framer.h"
+#include "metrics.h"
+#include "samplesource.h"
 #include "logger.h"
 
 /// <summary>
 /// Clase que maneja la comunicacin con un dispositivo Arduino a travs de un puerto serie.
 /// </summary>
-class Handler {
+class Handler : public SampleSource {
 public:
     /**
      * @brief Constructor de la clase Handler.
@@ -15,31 +19,36 @@ public:
      * @param baudRate Tasa de baudios para la comunicacin.
      * @param logger Instancia del logger para manejar mensajes de log.
      * @param debug Indica si se activa el modo de depuracin (por defecto es false).
+     * @param metrics Registro donde publicar los contadores del puerto mientras est abierto (opcional).
      */
-    Handler(const std::string& comPort, unsigned int baudRate, Logger* logger, bool debug = false);
+    Handler(const std::string& comPort, unsigned int baudRate, Logger* logger, bool debug = false, MetricsRegistry* metrics = nullptr);
 
     /**
      * @brief Propiedad para habilitar o deshabilitar el modo de depuracin.
      */
-    bool Debug() const;
-    void Debug(bool value);
+    bool Debug() const override;
+    void Debug(bool value) override;
 
     /**
      * @brief Abre el puerto serie para iniciar la comunicacin con Arduino.
      * @return true si se pudo abrir, false en caso contrario.
      */
-    bool Start();
+    bool Start() override;
 
     /**
-     * @brief Lee datos del Arduino hasta que se encuentra el terminador '.'.
-     * @return Una cadena que contiene los datos ledos, sin el terminador '.' al final.
+     * @brief Lee la siguiente muestra "ngulo,distancia." del Arduino.
+     * Los bytes se leen en bloque dentro del anillo del Framer y solo se vuelve a leer
+     * del puerto cuando no queda ninguna muestra completa en l. La muestra sale fechada
+     * (MonotonicMicros) en el momento en que se completa su trama.
+     * @param sample Recibe la muestra interpretada.
+     * @return true si se obtuvo una muestra; false si no llegaron datos a tiempo o hubo un error.
      */
-    std::string ReadFromArduino();
+    bool ReadSample(RadarSample& sample) override;
 
     /**
      * @brief Cierra el puerto serie, finalizando la comunicacin con Arduino.
      */
-    void Stop();
+    void Stop() override;
 
     /**
      * @brief Enva un comando al Arduino a travs del puerto serie.
@@ -48,9 +57,27 @@ public:
     void SendCommand(const std::string& command);
 
 private:
+    void RegisterMetrics();
+    void UpdateRate();
+
     Serial serialPort; ///< Objeto que representa el puerto serie para la comunicacin.
+    Framer framer;     ///< Anillo de bytes recibidos y separador de muestras.
     Logger* logger;    ///< Instancia del logger para manejar mensajes de log.
     bool debug;        ///< Indica si se debe activar el modo de depuracin.
     std::string comPort; ///< Nombre del puerto COM.
     unsigned int baudRate; ///< Tasa de baudios.
+
+    MetricsRegistry* metrics;  ///< Registro de mtricas, o nullptr.
+    Counter bytesRead;         ///< Bytes ledos del puerto.
+    Counter samplesRead;       ///< Muestras completas entregadas.
+    Counter framingErrors;     ///< Registros mal formados que descart el Framer.
+    Gauge samplesPerSecond;    ///< Ritmo de muestras en el ltimo RATE_INTERVAL_MS.
+    Histogram framingLatency;  ///< Microsegundos entre que llegan los bytes de una muestra y se completa su trama.
+    uint64_t reportedErrors;   ///< Errores del Framer ya sumados a framingErrors.
+    uint64_t rateSamples;      ///< Muestras al empezar la ventana del ritmo.
+    uint64_t readAt;           ///< Instante de la ltima lectura del puerto con datos.
+    std::chrono::steady_clock::time_point rateStart;
+
+    static const unsigned int READ_TIMEOUT_MS = 100; ///< Espera mxima por lectura, permite detener el hilo lector.
+    static const unsigned int RATE_INTERVAL_MS = 1000; ///< Ventana del ritmo de muestras.
 };
@@ -0,0 +1,688 @@
+﻿#include "history.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <map>
+#include <sstream>
+#include "capture.h"
+#include "sectorindex.h"
+#include "sweep.h"
+
+namespace {
+    const char* DATA_FILE = "history.dat";
+    const char* INDEX_FILE = "history.idx";
+    const char* MINUTES_FILE = "minutes.sum";
+    const char* HOURS_FILE = "hours.sum";
+
+    void PutVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back((char)(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back((char)value);
+    }
+
+    bool GetVarint(const char*& data, const char* end, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && data < end; shift += 7) {
+            uint8_t byte = (uint8_t)*data++;
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Zigzag: las diferencias pequeñas, positivas o negativas, quedan en pocos bytes
+    uint64_t Zigzag(int64_t value) {
+        return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    }
+
+    int64_t Unzigzag(uint64_t value) {
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    // Recorta un archivo de registros de size bytes a un múltiplo de size (un corte puede dejar uno a medias)
+    bool TrimRecords(const std::string& path, size_t size) {
+        std::error_code error;
+        uint64_t length = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+        if (error) {
+            return false;
+        }
+        if (length % size != 0) {
+            std::filesystem::resize_file(path, length - length % size, error);
+        }
+        return !error;
+    }
+}
+
+namespace history {
+    void EncodeChunk(const RadarSample* samples, size_t count, std::string& out) {
+        uint64_t time = 0;
+        for (size_t i = 0; i < count; ++i) {
+            PutVarint(out, Zigzag((int64_t)(samples[i].timestamp - time)));
+            time = samples[i].timestamp;
+        }
+        int64_t previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            PutVarint(out, Zigzag(samples[i].angle - previous));
+            previous = samples[i].angle;
+        }
+        previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            PutVarint(out, Zigzag(samples[i].distance - previous));
+            previous = samples[i].distance;
+        }
+        previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            PutVarint(out, Zigzag((int64_t)samples[i].sequence - previous));
+            previous = samples[i].sequence;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            PutVarint(out, samples[i].device);
+        }
+    }
+
+    bool DecodeChunk(const char* data, size_t length, size_t count, RadarSample* out) {
+        const char* end = data + length;
+        uint64_t value;
+        uint64_t time = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (!GetVarint(data, end, value)) {
+                return false;
+            }
+            time += (uint64_t)Unzigzag(value);
+            out[i].timestamp = time;
+        }
+        int64_t previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (!GetVarint(data, end, value)) {
+                return false;
+            }
+            previous += Unzigzag(value);
+            out[i].angle = (uint16_t)previous;
+        }
+        previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (!GetVarint(data, end, value)) {
+                return false;
+            }
+            previous += Unzigzag(value);
+            out[i].distance = (uint16_t)previous;
+        }
+        previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (!GetVarint(data, end, value)) {
+                return false;
+            }
+            previous += Unzigzag(value);
+            out[i].sequence = (uint32_t)previous;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (!GetVarint(data, end, value)) {
+                return false;
+            }
+            out[i].device = (uint16_t)value;
+        }
+        return data == end;
+    }
+
+    bool ParseTime(const std::string& text, uint64_t& micros) {
+        if (text.empty()) {
+            return false;
+        }
+
+        // Segundos desde 1970, con hasta seis decimales
+        if (text.find_first_not_of("0123456789.") == std::string::npos) {
+            size_t dot = text.find('.');
+            std::string seconds = text.substr(0, dot);
+            std::string fraction = dot == std::string::npos ? "" : text.substr(dot + 1);
+            if (seconds.empty() || seconds.size() > 11 || fraction.size() > 6 || fraction.find('.') != std::string::npos) {
+                return false;
+            }
+            fraction.resize(6, '0');
+            micros = std::stoull(seconds) * 1000000 + std::stoull(fraction);
+            return true;
+        }
+
+        // Hora local del servidor
+        std::tm local = {};
+        int second = 0;
+        char extra = 0;
+        int fields = sscanf(text.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d%c", &local.tm_year, &local.tm_mon, &local.tm_mday,
+            &local.tm_hour, &local.tm_min, &second, &extra);
+        if ((fields != 5 && fields != 6) || (fields == 5 && text.size() != 16) || local.tm_mon < 1 || local.tm_mon > 12 ||
+            local.tm_mday < 1 || local.tm_mday > 31 || local.tm_hour > 23 || local.tm_min > 59 || second < 0 || second > 59) {
+            return false;
+        }
+        local.tm_year -= 1900;
+        local.tm_mon -= 1;
+        local.tm_sec = second;
+        local.tm_isdst = -1;
+        std::time_t seconds = std::mktime(&local);
+        if (seconds < 0) {
+            return false;
+        }
+        micros = (uint64_t)seconds * 1000000;
+        return true;
+    }
+
+    std::string FormatTime(uint64_t micros) {
+        char text[32];
+        snprintf(text, sizeof(text), "%llu.%06llu", (unsigned long long)(micros / 1000000), (unsigned long long)(micros % 1000000));
+        return text;
+    }
+
+    bool ParseRequest(const std::string& text, Level& level, Query& query) {
+        std::istringstream stream(text);
+        std::vector<std::string> words;
+        std::string word;
+        while (stream >> word) {
+            words.push_back(word);
+        }
+        if (words.empty()) {
+            return false;
+        }
+
+        std::string first = words[0];
+        std::transform(first.begin(), first.end(), first.begin(), [](unsigned char c) { return (char)std::toupper(c); });
+        level = first == "MINUTES" ? MINUTES : first == "HOURS" ? HOURS : SAMPLES;
+        size_t next = level == SAMPLES ? 0 : 1;
+        if (words.size() < next + 2 || words.size() > next + 3 ||
+            !ParseTime(words[next], query.from) || !ParseTime(words[next + 1], query.to) || query.from >= query.to) {
+            return false;
+        }
+
+        // Sector opcional: "60-90" o "60-90/0-200", como en el comando SECTOR
+        if (words.size() == next + 3) {
+            const std::string& sector = words[next + 2];
+            size_t slash = sector.find('/');
+            if (!Sector::ParseRange(sector.substr(0, slash), SweepFrame::MAX_ANGLE, query.minAngle, query.maxAngle) ||
+                (slash != std::string::npos &&
+                    !Sector::ParseRange(sector.substr(slash + 1), Sector::MAX_DISTANCE, query.minDistance, query.maxDistance))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string FormatSample(const RadarSample& sample) {
+        return FormatTime(sample.timestamp) + "," + std::to_string(sample.device) + "," + std::to_string(sample.angle) + "," +
+            std::to_string(sample.distance) + "\n";
+    }
+
+    std::string FormatSummary(const Summary& summary) {
+        return std::to_string(summary.start / 1000000) + "," + std::to_string(summary.device) + "," + std::to_string(summary.count) +
+            "," + std::to_string(summary.minDistance) + "," + std::to_string(summary.count > 0 ? summary.sumDistance / summary.count : 0) +
+            "," + std::to_string(summary.maxDistance) + "\n";
+    }
+}
+
+HistoryStore::HistoryStore()
+    : open(false), running(false), dataSize(0), chunkStarted(0), storedSamples(0) {}
+
+HistoryStore::~HistoryStore() {
+    Close();
+}
+
+bool HistoryStore::Open(const std::string& path) {
+    Close();
+    std::error_code error;
+    std::filesystem::create_directories(path, error);
+    if (!std::filesystem::is_directory(path, error)) {
+        return false;
+    }
+    directory = path;
+
+    // Índice: solo cuentan las entradas cuyo bloque llegó entero a history.dat
+    uint64_t dataBytes = std::filesystem::exists(PathOf(DATA_FILE), error) ? std::filesystem::file_size(PathOf(DATA_FILE), error) : 0;
+    if (!TrimRecords(PathOf(INDEX_FILE), sizeof(history::ChunkInfo))) {
+        return false;
+    }
+    std::vector<history::ChunkInfo> loaded;
+    bool truncated = false;
+    {
+        std::ifstream input(PathOf(INDEX_FILE), std::ios::binary);
+        history::ChunkInfo info;
+        while (input.read((char*)&info, sizeof(info))) {
+            if (info.offset + info.bytes > dataBytes || info.count == 0 || info.count > history::CHUNK_SAMPLES) {
+                truncated = true;
+                break;
+            }
+            loaded.push_back(info);
+        }
+    }
+    dataSize = loaded.empty() ? 0 : loaded.back().offset + loaded.back().bytes;
+    if (truncated) {
+        std::filesystem::resize_file(PathOf(INDEX_FILE), loaded.size() * sizeof(history::ChunkInfo), error);
+    }
+    if (dataBytes > dataSize) {
+        std::filesystem::resize_file(PathOf(DATA_FILE), dataSize, error);
+    }
+    if (error || !TrimRecords(PathOf(MINUTES_FILE), sizeof(history::Summary)) ||
+        !TrimRecords(PathOf(HOURS_FILE), sizeof(history::Summary))) {
+        return false;
+    }
+
+    data.open(PathOf(DATA_FILE), std::ios::binary | std::ios::app);
+    indexFile.open(PathOf(INDEX_FILE), std::ios::binary | std::ios::app);
+    if (!data || !indexFile || !OpenPyramid(minutes, MINUTES_FILE, history::MINUTE_US) ||
+        !OpenPyramid(hours, HOURS_FILE, history::HOUR_US)) {
+        data.close();
+        indexFile.close();
+        minutes.file.close();
+        hours.file.close();
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        index = std::move(loaded);
+        storedSamples = 0;
+        for (const auto& info : index) {
+            storedSamples += info.count;
+        }
+    }
+    if (!ring) {
+        ring.reset(new SpscRing<RadarSample, RING_SIZE>());
+    }
+    chunk.clear();
+    chunk.reserve(history::CHUNK_SAMPLES);
+    running = true;
+    open = true;
+    writer = std::thread(&HistoryStore::Write, this);
+    server = std::thread(&HistoryStore::Serve, this);
+    return true;
+}
+
+void HistoryStore::Close() {
+    if (!open) {
+        return;
+    }
+
+    open = false;
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        running = false;
+    }
+    writerWake.notify_all();
+    taskReady.notify_all();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    if (server.joinable()) {
+        server.join();
+    }
+    data.close();
+    indexFile.close();
+    minutes.file.close();
+    hours.file.close();
+}
+
+bool HistoryStore::IsOpen() const {
+    return open;
+}
+
+const std::string& HistoryStore::Directory() const {
+    return directory;
+}
+
+void HistoryStore::Append(const RadarSample* samples, size_t count, uint64_t epoch) {
+    if (!open.load(std::memory_order_relaxed)) {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        RadarSample sample = samples[i];
+        sample.timestamp += epoch;
+        if (!ring->Push(sample)) {
+            dropped.Add();
+        }
+    }
+}
+
+size_t HistoryStore::Query(const history::Query& query, std::vector<RadarSample>& out, history::QueryStats& stats) const {
+    uint64_t begin = MonotonicMicros();
+
+    // Índice disperso: el último bloque que empieza antes de from y los siguientes hasta to. Si hay
+    // bloques anteriores que acaban después de from (muestras de varios radares que llegan
+    // desordenadas por unos milisegundos), también se incluyen
+    std::vector<history::ChunkInfo> candidates;
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        auto first = std::upper_bound(index.begin(), index.end(), query.from,
+            [](uint64_t time, const history::ChunkInfo& info) { return time < info.firstTime; });
+        if (first != index.begin()) {
+            --first;
+        }
+        while (first != index.begin() && (first - 1)->lastTime >= query.from) {
+            --first;
+        }
+        for (auto it = first; it != index.end() && it->firstTime < query.to; ++it) {
+            if (it->lastTime >= query.from) {
+                candidates.push_back(*it);
+            }
+        }
+    }
+    stats.chunks += candidates.size();
+
+    std::ifstream input(PathOf(DATA_FILE), std::ios::binary);
+    std::string buffer;
+    std::vector<RadarSample> samples(history::CHUNK_SAMPLES);
+    size_t added = 0;
+    for (const history::ChunkInfo& info : candidates) {
+        // Los mínimos y máximos del bloque permiten descartarlo sin leerlo
+        if (info.maxAngle < query.minAngle || info.minAngle > query.maxAngle || info.maxDistance < query.minDistance ||
+            info.minDistance > query.maxDistance || !(info.devices & query.devices)) {
+            stats.skipped++;
+            continue;
+        }
+
+        buffer.resize(info.bytes);
+        input.clear();
+        input.seekg((std::streamoff)info.offset);
+        if (!input.read(&buffer[0], info.bytes) ||
+            capture::Checksum(capture::CHECKSUM_SEED, buffer.data(), buffer.size()) != info.checksum ||
+            !history::DecodeChunk(buffer.data(), buffer.size(), info.count, samples.data())) {
+            stats.corrupt++;
+            continue;
+        }
+        stats.read++;
+        stats.bytes += info.bytes;
+
+        for (size_t i = 0; i < info.count; ++i) {
+            const RadarSample& sample = samples[i];
+            if (sample.timestamp < query.from || sample.timestamp >= query.to || sample.angle < query.minAngle ||
+                sample.angle > query.maxAngle || sample.distance < query.minDistance || sample.distance > query.maxDistance ||
+                sample.device >= history::MAX_DEVICES || !(query.devices & (1u << sample.device))) {
+                continue;
+            }
+            if (query.limit != 0 && added == query.limit) {
+                stats.next = sample.timestamp;
+                queryLatency.Record(MonotonicMicros() - begin);
+                return added;
+            }
+            out.push_back(sample);
+            added++;
+        }
+    }
+
+    queryLatency.Record(MonotonicMicros() - begin);
+    return added;
+}
+
+size_t HistoryStore::Summarize(history::Level level, const history::Query& query, std::vector<history::Summary>& out,
+    history::QueryStats& stats) const {
+    uint64_t begin = MonotonicMicros();
+    uint64_t span = level == history::HOURS ? history::HOUR_US : history::MINUTE_US;
+    std::ifstream input(PathOf(level == history::HOURS ? HOURS_FILE : MINUTES_FILE), std::ios::binary);
+    input.seekg(0, std::ios::end);
+    uint64_t records = input ? (uint64_t)input.tellg() / sizeof(history::Summary) : 0;
+
+    // Los registros van en orden de tiempo y tienen tamaño fijo: búsqueda binaria directamente en el archivo
+    auto readRecord = [&input](uint64_t position, history::Summary& record) {
+        input.clear();
+        input.seekg((std::streamoff)(position * sizeof(history::Summary)));
+        return (bool)input.read((char*)&record, sizeof(record));
+    };
+    uint64_t low = 0;
+    uint64_t high = records;
+    history::Summary record;
+    while (low < high) {
+        uint64_t middle = (low + high) / 2;
+        if (!readRecord(middle, record)) {
+            return 0;
+        }
+        if (record.start + span <= query.from) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    // Un resumen por intervalo y radar: se juntan los sectores que cortan el filtro de ángulos.
+    // Tras un reinicio puede haber dos registros del mismo minuto; también se juntan
+    std::map<std::pair<uint64_t, uint16_t>, history::Summary> merged;
+    uint64_t stoppedAt = 0;
+    input.clear();
+    input.seekg((std::streamoff)(low * sizeof(history::Summary)));
+    for (uint64_t position = low; position < records && input.read((char*)&record, sizeof(record)); ++position) {
+        stats.bytes += sizeof(record);
+        if (record.start >= query.to) {
+            break;
+        }
+        uint16_t firstAngle = (uint16_t)(record.sector * history::SECTOR_DEGREES);
+        if (record.device >= history::MAX_DEVICES || !(query.devices & (1u << record.device)) ||
+            firstAngle > query.maxAngle || firstAngle + history::SECTOR_DEGREES - 1 < query.minAngle) {
+            continue;
+        }
+        // Con límite se para en cuanto hay bastantes intervalos completos
+        if (query.limit != 0 && merged.size() >= query.limit && record.start > merged.rbegin()->first.first) {
+            stoppedAt = record.start;
+            break;
+        }
+
+        history::Summary& summary = merged[{ record.start, record.device }];
+        if (summary.count == 0) {
+            summary = record;
+            summary.sector = 0;
+            continue;
+        }
+        summary.count += record.count;
+        summary.sumDistance += record.sumDistance;
+        summary.minDistance = std::min(summary.minDistance, record.minDistance);
+        summary.maxDistance = std::max(summary.maxDistance, record.maxDistance);
+    }
+
+    size_t added = 0;
+    for (const auto& pair : merged) {
+        if (query.limit != 0 && added == query.limit) {
+            stats.next = pair.second.start;
+            break;
+        }
+        out.push_back(pair.second);
+        added++;
+    }
+    if (stats.next == 0) {
+        stats.next = stoppedAt;
+    }
+    stats.read += merged.size();
+
+    queryLatency.Record(MonotonicMicros() - begin);
+    return added;
+}
+
+bool HistoryStore::Post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        if (!running) {
+            return false;
+        }
+        tasks.push_back(std::move(task));
+    }
+    taskReady.notify_one();
+    return true;
+}
+
+uint64_t HistoryStore::Samples() const {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    return storedSamples;
+}
+
+size_t HistoryStore::ChunkCount() const {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    return index.size();
+}
+
+uint64_t HistoryStore::FirstTime() const {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    return index.empty() ? 0 : index.front().firstTime;
+}
+
+uint64_t HistoryStore::LastTime() const {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    return index.empty() ? 0 : index.back().lastTime;
+}
+
+void HistoryStore::Write() {
+    RadarSample batch[256];
+    for (;;) {
+        // Se mira running antes de vaciar el anillo: al cerrar ya no entra nada nuevo
+        bool stopping = !running.load();
+        size_t count = ring->Pop(batch, 256);
+        for (size_t i = 0; i < count; ++i) {
+            AddSample(batch[i]);
+        }
+        if (!chunk.empty() && MonotonicMicros() - chunkStarted >= history::CHUNK_AGE_US) {
+            FlushChunk();
+        }
+        if (count > 0) {
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+        std::unique_lock<std::mutex> lock(taskMutex);
+        writerWake.wait_for(lock, std::chrono::milliseconds(WRITER_WAIT_MS), [this]() { return !running; });
+    }
+
+    FlushChunk();
+    FlushSummary(minutes);
+    FlushSummary(hours);
+}
+
+void HistoryStore::Serve() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(taskMutex);
+            taskReady.wait(lock, [this]() { return !running || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void HistoryStore::AddSample(const RadarSample& sample) {
+    if (chunk.empty()) {
+        chunkStarted = MonotonicMicros();
+    }
+    chunk.push_back(sample);
+    if (chunk.size() == history::CHUNK_SAMPLES) {
+        FlushChunk();
+    }
+    AddSummary(minutes, sample);
+    AddSummary(hours, sample);
+}
+
+void HistoryStore::FlushChunk() {
+    if (chunk.empty()) {
+        return;
+    }
+
+    history::ChunkInfo info = {};
+    info.offset = dataSize;
+    info.count = (uint32_t)chunk.size();
+    info.firstTime = chunk[0].timestamp;
+    info.minAngle = info.minDistance = 0xFFFF;
+    for (const RadarSample& sample : chunk) {
+        info.lastTime = std::max(info.lastTime, sample.timestamp);
+        info.minAngle = std::min(info.minAngle, sample.angle);
+        info.maxAngle = std::max(info.maxAngle, sample.angle);
+        info.minDistance = std::min(info.minDistance, sample.distance);
+        info.maxDistance = std::max(info.maxDistance, sample.distance);
+        if (sample.device < history::MAX_DEVICES) {
+            info.devices |= 1u << sample.device;
+        }
+    }
+    encoded.clear();
+    history::EncodeChunk(chunk.data(), chunk.size(), encoded);
+    info.bytes = (uint32_t)encoded.size();
+    info.checksum = capture::Checksum(capture::CHECKSUM_SEED, encoded.data(), encoded.size());
+
+    // El bloque llega al disco antes que su entrada del índice
+    data.write(encoded.data(), (std::streamsize)encoded.size());
+    data.flush();
+    if (!data) {
+        dropped.Add(chunk.size());
+        chunk.clear();
+        data.clear();
+        dataSize = (uint64_t)data.tellp();
+        return;
+    }
+    dataSize += encoded.size();
+    indexFile.write((const char*)&info, sizeof(info));
+    indexFile.flush();
+
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        index.push_back(info);
+        storedSamples += info.count;
+    }
+    stored.Add(chunk.size());
+    bytes.Add(encoded.size());
+    chunks.Add();
+    chunk.clear();
+}
+
+void HistoryStore::AddSummary(Pyramid& level, const RadarSample& sample) {
+    if (sample.device >= history::MAX_DEVICES) {
+        return;
+    }
+
+    // Una muestra de otro radar que llega unos milisegundos tarde cuenta en el intervalo en curso,
+    // para que los registros sigan en orden de tiempo
+    uint64_t start = sample.timestamp - sample.timestamp % level.span;
+    if (start > level.start) {
+        FlushSummary(level);
+        level.start = start;
+    }
+
+    size_t sector = std::min((size_t)(sample.angle / history::SECTOR_DEGREES), history::SECTORS - 1);
+    history::Summary& summary = level.buckets[sample.device * history::SECTORS + sector];
+    if (summary.count == 0) {
+        summary = {};
+        summary.start = level.start;
+        summary.device = sample.device;
+        summary.sector = (uint16_t)sector;
+        summary.minDistance = summary.maxDistance = sample.distance;
+    }
+    summary.count++;
+    summary.sumDistance += sample.distance;
+    summary.minDistance = std::min(summary.minDistance, sample.distance);
+    summary.maxDistance = std::max(summary.maxDistance, sample.distance);
+}
+
+void HistoryStore::FlushSummary(Pyramid& level) {
+    bool written = false;
+    for (history::Summary& summary : level.buckets) {
+        if (summary.count > 0) {
+            level.file.write((const char*)&summary, sizeof(summary));
+            summary.count = 0;
+            written = true;
+        }
+    }
+    if (written) {
+        level.file.flush();
+    }
+}
+
+bool HistoryStore::OpenPyramid(Pyramid& level, const std::string& name, uint64_t span) {
+    level.span = span;
+    level.start = 0;
+    level.buckets.assign(history::MAX_DEVICES * history::SECTORS, history::Summary());
+    level.file.open(PathOf(name), std::ios::binary | std::ios::app);
+    return (bool)level.file;
+}
+
+std::string HistoryStore::PathOf(const std::string& name) const {
+    return (std::filesystem::path(directory) / name).string();
+}
@@ -0,0 +1,265 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+#include "sample.h"
+#include "spscring.h"
+
+/// <summary>
+/// Formato del histórico de muestras (un directorio con cuatro archivos):
+///
+/// - history.dat: bloques de hasta CHUNK_SAMPLES muestras seguidas. Cada bloque guarda sus
+///   columnas una detrás de otra (instante, ángulo, distancia, número de muestra y radar), cada
+///   valor como la diferencia con el anterior en zigzag y varint. Una barrida del servo cambia el
+///   ángulo de uno en uno y los instantes en unos milisegundos, así que casi todo ocupa uno o dos bytes.
+/// - history.idx: una ChunkInfo de 64 bytes por bloque, con su posición, su intervalo de tiempo y
+///   los mínimos y máximos de ángulo y distancia. Es el índice disperso: se carga entero al abrir y
+///   una consulta solo lee los bloques cuyo intervalo y cuyos límites pueden contener algo.
+/// - minutes.sum y hours.sum: la pirámide reducida, un Summary de 32 bytes por minuto (u hora),
+///   radar y sector de SECTOR_DEGREES grados con muestras, en orden de tiempo.
+///
+/// Los instantes son microsegundos desde 1970 (hora real), no el reloj monotónico de RadarSample,
+/// para que el histórico sobreviva a los reinicios del servidor. Cada entrada del índice se escribe
+/// después de su bloque, así que tras un corte se pierde como mucho el bloque en curso.
+/// </summary>
+namespace history {
+    const size_t CHUNK_SAMPLES = 4096;             ///< Muestras por bloque como máximo.
+    const uint64_t CHUNK_AGE_US = 60000000;        ///< Un bloque incompleto se escribe tras un minuto.
+    const uint64_t MINUTE_US = 60000000;
+    const uint64_t HOUR_US = 3600000000ull;
+    const uint16_t SECTOR_DEGREES = 10;            ///< Ancho de los sectores de la pirámide.
+    const size_t SECTORS = 181 / SECTOR_DEGREES + 1;
+    const size_t MAX_DEVICES = 32;                 ///< Radares que distingue el índice (un bit por radar).
+    const size_t MAX_REPLY_LINES = 1000;           ///< Líneas por respuesta a un cliente; el resto se pide con MORE.
+
+    /// Entrada del índice: un bloque de history.dat.
+    struct ChunkInfo {
+        uint64_t offset;      ///< Posición del bloque en history.dat.
+        uint32_t bytes;       ///< Tamaño codificado.
+        uint32_t count;       ///< Muestras del bloque.
+        uint64_t firstTime;   ///< Instante de la primera muestra (microsegundos desde 1970).
+        uint64_t lastTime;    ///< Mayor instante del bloque.
+        uint16_t minAngle;
+        uint16_t maxAngle;
+        uint16_t minDistance;
+        uint16_t maxDistance;
+        uint32_t devices;     ///< Radares con muestras en el bloque (un bit por radar).
+        uint32_t checksum;    ///< FNV-1a de los bytes del bloque.
+        uint8_t reserved[16];
+    };
+
+    static_assert(sizeof(ChunkInfo) == 64, "Las entradas del índice deben ocupar 64 bytes");
+
+    /// Un minuto (u hora) de un radar en un sector: cuántas muestras hubo y sus distancias.
+    struct Summary {
+        uint64_t start;        ///< Comienzo del intervalo (microsegundos desde 1970).
+        uint64_t sumDistance;  ///< Suma de las distancias, para la media.
+        uint32_t count;
+        uint16_t minDistance;
+        uint16_t maxDistance;
+        uint16_t device;
+        uint16_t sector;       ///< Ángulos de sector * SECTOR_DEGREES en adelante.
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Summary) == 32, "Los registros de la pirámide deben ocupar 32 bytes");
+
+    enum Level {
+        SAMPLES,   ///< Las muestras tal cual.
+        MINUTES,
+        HOURS
+    };
+
+    /// Consulta: intervalo [from, to) y, opcionalmente, un sector de ángulos y distancias y unos radares.
+    struct Query {
+        uint64_t from = 0;
+        uint64_t to = 0;
+        uint16_t minAngle = 0;
+        uint16_t maxAngle = 0xFFFF;
+        uint16_t minDistance = 0;
+        uint16_t maxDistance = 0xFFFF;
+        uint32_t devices = 0xFFFFFFFFu;
+        size_t limit = 0;      ///< Resultados como máximo; 0 sin límite.
+    };
+
+    /// Lo que costó una consulta.
+    struct QueryStats {
+        size_t chunks = 0;     ///< Bloques del intervalo de tiempo según el índice.
+        size_t skipped = 0;    ///< De esos, los descartados por sus mínimos y máximos sin leerlos.
+        size_t read = 0;       ///< Bloques leídos y descodificados.
+        size_t corrupt = 0;    ///< Bloques con la suma de comprobación incorrecta (se ignoran).
+        uint64_t bytes = 0;    ///< Bytes leídos de history.dat.
+        uint64_t next = 0;     ///< Con límite: instante del primer resultado que no cupo; 0 si no faltó ninguno.
+    };
+
+    /**
+     * @brief Codifica muestras (con instantes en hora real) como un bloque y lo añade a out.
+     */
+    void EncodeChunk(const RadarSample* samples, size_t count, std::string& out);
+
+    /**
+     * @brief Descodifica un bloque de count muestras.
+     * @return false si los datos no alcanzan o sobran.
+     */
+    bool DecodeChunk(const char* data, size_t length, size_t count, RadarSample* out);
+
+    /**
+     * @brief Interpreta un instante: segundos desde 1970 (con decimales opcionales) o la hora local
+     *        del servidor como "2025-03-14T02:00" o "2025-03-14T02:00:30".
+     * @param micros Recibe microsegundos desde 1970.
+     */
+    bool ParseTime(const std::string& text, uint64_t& micros);
+
+    /**
+     * @brief Escribe un instante como segundos desde 1970 con seis decimales (lo que entiende ParseTime).
+     */
+    std::string FormatTime(uint64_t micros);
+
+    /**
+     * @brief Interpreta una petición "[MINUTES|HOURS] desde hasta [a-b[/d1-d2]]" (mayúsculas o minúsculas),
+     *        sin el nombre del comando.
+     */
+    bool ParseRequest(const std::string& text, Level& level, Query& query);
+
+    /**
+     * @brief Línea de una muestra: "instante,radar,ángulo,distancia\n".
+     */
+    std::string FormatSample(const RadarSample& sample);
+
+    /**
+     * @brief Línea de un resumen: "comienzo,radar,muestras,mínima,media,máxima\n" (comienzo en segundos).
+     */
+    std::string FormatSummary(const Summary& summary);
+}
+
+/// <summary>
+/// Histórico de muestras en disco (ver el formato en history). El hilo de red entrega las muestras
+/// con Append, que solo las copia a un anillo y nunca espera; un hilo escritor propio las agrupa en
+/// bloques, las codifica y mantiene la pirámide de minutos y horas. Las consultas se pueden hacer
+/// desde cualquier hilo, o encargarse al hilo de consultas con Post para no bloquear al que pregunta.
+/// </summary>
+class HistoryStore {
+public:
+    static const size_t RING_SIZE = 65536;     ///< Muestras en vuelo hacia el escritor (más de un segundo a 50 kHz).
+    static const int WRITER_WAIT_MS = 50;      ///< Espera del escritor con el anillo vacío.
+
+    HistoryStore();
+    ~HistoryStore();
+
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    /**
+     * @brief Abre (o crea) el histórico del directorio, carga su índice y arranca los hilos.
+     *        Si un corte dejó registros a medias al final de algún archivo, se recortan.
+     */
+    bool Open(const std::string& directory);
+
+    /**
+     * @brief Escribe el bloque en curso y los resúmenes pendientes y detiene los hilos.
+     */
+    void Close();
+
+    bool IsOpen() const;
+    const std::string& Directory() const;
+
+    /**
+     * @brief Encola muestras para el escritor (solo desde un hilo, el de red). Si el anillo está
+     *        lleno las muestras se descartan y se cuentan en Dropped.
+     * @param epoch Hora real (microsegundos desde 1970) que corresponde al instante 0 de las muestras.
+     */
+    void Append(const RadarSample* samples, size_t count, uint64_t epoch);
+
+    /**
+     * @brief Muestras de la consulta en orden de tiempo; solo lee los bloques que pueden contenerlas.
+     * @return Número de muestras añadidas a out.
+     */
+    size_t Query(const history::Query& query, std::vector<RadarSample>& out, history::QueryStats& stats) const;
+
+    /**
+     * @brief Resúmenes de la pirámide que cortan la consulta, uno por intervalo y radar (se juntan
+     *        los sectores del filtro de ángulos; el de distancias no se aplica). El minuto (u hora) en
+     *        curso no aparece hasta que termina o se cierra el histórico.
+     * @return Número de resúmenes añadidos a out.
+     */
+    size_t Summarize(history::Level level, const history::Query& query, std::vector<history::Summary>& out,
+        history::QueryStats& stats) const;
+
+    /**
+     * @brief Ejecuta task en el hilo de consultas, en orden de llegada.
+     * @return false si el histórico está cerrado (task no se ejecutará).
+     */
+    bool Post(std::function<void()> task);
+
+    uint64_t Samples() const;     ///< Muestras en bloques ya escritos.
+    size_t ChunkCount() const;
+    uint64_t FirstTime() const;   ///< Primer instante guardado; 0 si está vacío.
+    uint64_t LastTime() const;
+
+    const Counter& Stored() const { return stored; }     ///< Muestras escritas desde Open.
+    const Counter& Dropped() const { return dropped; }   ///< Muestras descartadas por anillo lleno.
+    const Counter& Bytes() const { return bytes; }       ///< Bytes de bloques escritos desde Open.
+    const Counter& Chunks() const { return chunks; }     ///< Bloques escritos desde Open.
+    const Histogram& QueryLatency() const { return queryLatency; }  ///< Microsegundos por consulta.
+
+private:
+    /// Nivel de la pirámide en construcción: los resúmenes del intervalo en curso.
+    struct Pyramid {
+        uint64_t span = 0;
+        uint64_t start = 0;
+        std::ofstream file;
+        std::vector<history::Summary> buckets;   ///< MAX_DEVICES * SECTORS, por radar y sector.
+    };
+
+    void Write();
+    void Serve();
+    void AddSample(const RadarSample& sample);
+    void FlushChunk();
+    void AddSummary(Pyramid& level, const RadarSample& sample);
+    void FlushSummary(Pyramid& level);
+    bool OpenPyramid(Pyramid& level, const std::string& name, uint64_t span);
+    std::string PathOf(const std::string& name) const;
+
+    std::string directory;
+    std::atomic<bool> open;
+    std::atomic<bool> running;
+    std::unique_ptr<SpscRing<RadarSample, RING_SIZE>> ring;
+    std::thread writer;
+    std::thread server;
+
+    // Solo el hilo escritor
+    std::ofstream data;
+    std::ofstream indexFile;
+    uint64_t dataSize;
+    std::vector<RadarSample> chunk;
+    uint64_t chunkStarted;       ///< MonotonicMicros de la primera muestra del bloque en curso.
+    Pyramid minutes;
+    Pyramid hours;
+    std::string encoded;
+
+    mutable std::mutex indexMutex;           ///< Protege index y storedSamples.
+    std::vector<history::ChunkInfo> index;   ///< Índice disperso en memoria, en orden de escritura.
+    uint64_t storedSamples;
+
+    std::mutex taskMutex;
+    std::condition_variable taskReady;
+    std::condition_variable writerWake;
+    std::deque<std::function<void()>> tasks;
+
+    Counter stored;
+    Counter dropped;
+    Counter bytes;
+    Counter chunks;
+    mutable Histogram queryLatency;   ///< Se registra desde las consultas, que son const.
+};
@@ -1,6 +1,55 @@
 #include "logger.h"
+#include <chrono>
+#include <cstring>
 
-Logger::Logger(bool debug) : debug(debug) {}
+namespace {
+    int64_t NowMs() {
+        return (int64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+Logger::RateLimit::RateLimit(uint32_t perSecond)
+    : perSecond(perSecond), windowStart(0), count(0), skipped(0) {}
+
+bool Logger::RateLimit::Allow(uint32_t& suppressed) {
+    int64_t now = NowMs();
+    int64_t start = windowStart.load(std::memory_order_relaxed);
+    if (now - start >= 1000 && windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+        count.store(0, std::memory_order_relaxed);
+    }
+
+    if (count.fetch_add(1, std::memory_order_relaxed) >= perSecond) {
+        skipped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = skipped.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+Logger::Logger(bool debug)
+    : debug(debug), queue(new MpscQueue<Record, QUEUE_SIZE>()), enqueued(0), written(0), dropped(0),
+      running(true), sleeping(false) {
+    // Los prefijos con color se construyen una sola vez, no en cada mensaje.
+    prefixes[WARNING] = color::white(" [") + color::yellow("WARNING", true) + color::white("] ") + color::RESET;
+    prefixes[ERROR_LOG] = color::white(" [") + color::red("ERROR", true) + color::white("] ") + color::RESET;
+    prefixes[DEBUG] = color::white(" [") + color::green("DEBUG", true) + color::white("] ") + color::RESET;
+    prefixes[INFO] = color::white(" [") + color::cyan("INFO", true) + color::white("] ") + color::RESET;
+    prefixes[UNKNOWN] = color::white(" [") + color::white("UNKNOWN", true) + color::white("] ") + color::RESET;
+
+    writer = std::thread(&Logger::Run, this);
+}
+
+Logger::~Logger() {
+    running = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_one();
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
 
 bool Logger::Debug() const {
     return debug;
@@ -10,41 +59,121 @@ void Logger::Debug(bool value) {
     debug = value;
 }
 
+uint64_t Logger::Dropped() const {
+    return dropped;
+}
+
 void Logger::Log(const std::string& message, Severity severity) {
-    WriteLog(severity, message);
-}
-
-void Logger::WriteLog(Severity severity, const std::string& message) {
-    std::string severityStr;
-    std::string colorStr;
-
-    switch (severity) {
-    case Logger::WARNING:
-        severityStr = "WARNING";
-        colorStr = color::yellow(severityStr, true);
-        break;
-    case Logger::ERROR_LOG:
-        severityStr = "ERROR";
-        colorStr = color::red(severityStr, true);
-        break;
-    case Logger::DEBUG:
-        if (!debug) return;
-        severityStr = "DEBUG";
-        colorStr = color::green(severityStr, true);
-        break;
-    case Logger::INFO:
-        severityStr = "INFO";
-        colorStr = color::cyan(severityStr, true);
-        break;
-    case Logger::UNKNOWN:
-    default:
-        severityStr = "UNKNOWN";
-        colorStr = color::white(severityStr, true);
-        break;
-    }
-
-    std::cout << color::white(" [")
-        << colorStr
-        << color::white("] ")
-        << color::RESET << message << std::endl;
-}
\ No newline at end of file
+    if (!Enabled(severity)) return;
+    Enqueue(message.data(), message.size(), severity);
+}
+
+void Logger::Log(const char* message, Severity severity) {
+    if (!Enabled(severity)) return;
+    Enqueue(message, strlen(message), severity);
+}
+
+void Logger::Enqueue(const char* message, size_t length, Severity severity) {
+    if (severity < WARNING || severity > UNKNOWN) {
+        severity = UNKNOWN;
+    }
+
+    bool pushed = queue->Push([&](Record& record) {
+        record.severity = severity;
+        if (length > MAX_MESSAGE) {
+            // Se recorta y se marca el corte con "..."
+            memcpy(record.text, message, MAX_MESSAGE - 3);
+            memcpy(record.text + MAX_MESSAGE - 3, "...", 3);
+            length = MAX_MESSAGE;
+        }
+        else {
+            memcpy(record.text, message, length);
+        }
+        record.length = (uint32_t)length;
+    });
+
+    if (!pushed) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    enqueued.fetch_add(1, std::memory_order_seq_cst);
+
+    // Solo se toca el mutex si el escritor está dormido.
+    if (sleeping.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_one();
+    }
+}
+
+void Logger::Flush() {
+    uint64_t target = enqueued.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(mutex);
+    wake.notify_one();
+    drained.wait_for(lock, std::chrono::seconds(1), [&]() {
+        return written.load(std::memory_order_acquire) >= target || !running;
+    });
+}
+
+std::string Logger::WithSuppressed(const std::string& message, uint32_t suppressed) {
+    if (suppressed == 0) {
+        return message;
+    }
+    return message + " (" + std::to_string(suppressed) + " mensajes similares omitidos)";
+}
+
+void Logger::Run() {
+    const size_t BATCH = 256;
+    std::string output;
+    uint64_t reportedDrops = 0;
+
+    while (true) {
+        size_t count = 0;
+        while (count < BATCH && queue->Pop([&](const Record& record) { WriteLog(record, output); })) {
+            count++;
+        }
+
+        uint64_t drops = dropped.load(std::memory_order_relaxed);
+        if (drops != reportedDrops) {
+            Record record;
+            std::string text = "Cola de log llena: " + std::to_string(drops - reportedDrops) + " mensajes descartados.";
+            record.severity = WARNING;
+            record.length = (uint32_t)(text.size() < MAX_MESSAGE ? text.size() : MAX_MESSAGE);
+            memcpy(record.text, text.data(), record.length);
+            WriteLog(record, output);
+            reportedDrops = drops;
+        }
+
+        if (!output.empty()) {
+            // Un solo write y un solo flush por lote, en lugar de std::endl por mensaje.
+            std::cout.write(output.data(), (std::streamsize)output.size());
+            std::cout.flush();
+            output.clear();
+        }
+
+        if (count > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            written.fetch_add(count, std::memory_order_release);
+            drained.notify_all();
+            continue;
+        }
+
+        if (!running) {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        sleeping.store(true, std::memory_order_seq_cst);
+        // Se vuelve a mirar la cola tras anunciar que se duerme para no perder un aviso;
+        // el tiempo de espera acota cualquier carrera restante.
+        if (written.load(std::memory_order_relaxed) >= enqueued.load(std::memory_order_seq_cst) && running) {
+            wake.wait_for(lock, std::chrono::milliseconds(50));
+        }
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Logger::WriteLog(const Record& record, std::string& output) {
+    output += prefixes[record.severity];
+    output.append(record.text, record.length);
+    output += '\n';
+}
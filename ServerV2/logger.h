@@ -1,8 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <iostream>
 #include "color.h"
+#include "mpscqueue.h"
 
 class Logger {
 public:
@@ -15,18 +22,66 @@ public:
         UNKNOWN
     };
 
+    static const size_t MAX_MESSAGE = 240;   ///< Bytes de texto por registro; lo dems se recorta.
+    static const size_t QUEUE_SIZE = 1024;   ///< Registros pendientes mximos antes de descartar.
+
+    /// <summary>
+    /// Lmite de mensajes por segundo para un punto concreto del cdigo (ver LOG_LIMITED).
+    /// Evita que una avalancha de errores repetidos sature la consola y el hilo escritor.
+    /// </summary>
+    class RateLimit {
+    public:
+        explicit RateLimit(uint32_t perSecond = 5);
+
+        /**
+         * @brief Indica si el mensaje puede escribirse ahora.
+         * @param suppressed Recibe cuntos mensajes de este punto se omitieron desde el ltimo permitido.
+         */
+        bool Allow(uint32_t& suppressed);
+
+    private:
+        uint32_t perSecond;
+        std::atomic<int64_t> windowStart; ///< Inicio de la ventana actual (ms).
+        std::atomic<uint32_t> count;      ///< Mensajes permitidos en la ventana.
+        std::atomic<uint32_t> skipped;    ///< Mensajes omitidos pendientes de informar.
+    };
+
     /**
-     * @brief Constructor de Logger.
+     * @brief Constructor de Logger. Inicia el hilo que escribe los registros.
      * @param debug Indica si el modo de depuracin debe estar activado (por defecto es false).
      */
     Logger(bool debug = false);
+    ~Logger();
 
     /**
      * @brief Registra un mensaje con un nivel de severidad.
+     * Solo copia el texto a un registro de tamao fijo de la cola; el formato y la escritura
+     * se hacen en el hilo escritor. Si la cola est llena, el mensaje se descarta y se cuenta.
      * @param severity El nivel de severidad del mensaje.
      * @param message El mensaje a registrar.
      */
     void Log(const std::string& message, Severity severity);
+    void Log(const char* message, Severity severity);
+
+    /**
+     * @brief Indica si un nivel se registra. Permite evitar construir mensajes que se descartaran.
+     */
+    bool Enabled(Severity severity) const {
+#if defined(LOGGER_STRIP_DEBUG)
+        if (severity == DEBUG) return false;
+#endif
+        return severity != DEBUG || debug.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Espera a que el hilo escritor haya escrito todo lo encolado hasta ahora.
+     */
+    void Flush();
+
+    /**
+     * @brief Mensajes descartados porque la cola estaba llena.
+     */
+    uint64_t Dropped() const;
 
     /**
      * @brief Propiedad para habilitar o deshabilitar el modo de depuracin.
@@ -34,13 +89,72 @@ public:
     bool Debug() const;
     void Debug(bool value);
 
+    /**
+     * @brief Aade al mensaje el nmero de mensajes similares omitidos (usado por LOG_LIMITED).
+     */
+    static std::string WithSuppressed(const std::string& message, uint32_t suppressed);
+
 private:
-    bool debug; ///< Indica si el modo de depuracin est activado.
+    /// Registro de tamao fijo: encolarlo no reserva memoria.
+    struct Record {
+        Severity severity;
+        uint32_t length;
+        char text[MAX_MESSAGE];
+    };
+
+    std::atomic<bool> debug; ///< Indica si el modo de depuracin est activado.
+
+    void Enqueue(const char* message, size_t length, Severity severity);
+
+    /**
+     * @brief Bucle del hilo escritor: formatea los registros por lotes y los escribe de una vez.
+     */
+    void Run();
 
     /**
      * @brief Escribe el mensaje de registro formateado.
      * @param severity El nivel de severidad del mensaje.
      * @param message El mensaje a registrar.
      */
-    void WriteLog(Severity severity, const std::string& message);
-};
\ No newline at end of file
+    void WriteLog(const Record& record, std::string& output);
+
+    std::unique_ptr<MpscQueue<Record, QUEUE_SIZE>> queue;
+    std::string prefixes[UNKNOWN + 1];   ///< " [NIVEL] " ya coloreado para cada severidad.
+    std::atomic<uint64_t> enqueued;
+    std::atomic<uint64_t> written;       ///< Registros escritos (o descartados) por el hilo escritor.
+    std::atomic<uint64_t> dropped;
+    std::atomic<bool> running;
+    std::atomic<bool> sleeping;          ///< El hilo escritor est esperando en wake.
+    std::mutex mutex;
+    std::condition_variable wake;        ///< Despierta al hilo escritor.
+    std::condition_variable drained;     ///< Avisa a Flush de que se escribi un lote.
+    std::thread writer;
+};
+
+/**
+ * @brief Registra un mensaje de depuracin sin evaluar message si el nivel est desactivado.
+ * Con LOGGER_STRIP_DEBUG definido (por ejemplo, en una compilacin Release) desaparece por completo.
+ */
+#if defined(LOGGER_STRIP_DEBUG)
+#define LOG_DEBUG(logger, message) do { } while (0)
+#else
+#define LOG_DEBUG(logger, message) \
+    do { \
+        if ((logger)->Enabled(Logger::DEBUG)) { \
+            (logger)->Log((message), Logger::DEBUG); \
+        } \
+    } while (0)
+#endif
+
+/**
+ * @brief Registra un mensaje con un lmite de Logger::RateLimit por punto del cdigo.
+ * Los mensajes que superan el lmite se omiten y se cuentan en el siguiente que pase.
+ */
+#define LOG_LIMITED(logger, message, severity) \
+    do { \
+        static Logger::RateLimit logRateLimit; \
+        uint32_t logSuppressed; \
+        if ((logger)->Enabled(severity) && logRateLimit.Allow(logSuppressed)) { \
+            (logger)->Log(Logger::WithSuppressed((message), logSuppressed), (severity)); \
+        } \
+    } while (0)
@@ -1,7 +1,9 @@
 ﻿#include "CommandLineInterface.h"
+#include <clocale>
 #include <iostream>
-#include <Windows.h>
 #include <vector>
+#if defined(_WIN32) || defined(_WIN64)
+#include <Windows.h>
 #include "resource.h"
 
 void SetConsoleProperties() {
@@ -23,12 +25,17 @@ void SetConsoleProperties() {
     SetWindowLong(consoleWindow, GWL_STYLE, style);
     SetWindowPos(consoleWindow, NULL, 0, 0, 0, 0, SWP_NOZORDER | SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
 }
+#endif
 
 int main(int argc, char* argv[]) {
+#if defined(_WIN32) || defined(_WIN64)
     SetConsoleOutputCP(CP_UTF8);
+#endif
     setlocale(LC_ALL, "");
 
+#if defined(_WIN32) || defined(_WIN64)
     SetConsoleProperties();
+#endif
 
     CommandLineInterface cli;
     std::vector<std::string> args;
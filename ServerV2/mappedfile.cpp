@@ -0,0 +1,179 @@
+﻿#include "mappedfile.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+#if defined(_WIN32) || defined(_WIN64)
+    : file(INVALID_HANDLE_VALUE), mapping(nullptr),
+#else
+    : file(-1),
+#endif
+      data(nullptr), size(0), writable(false) {}
+
+MappedFile::~MappedFile() {
+    Close(size);
+}
+
+bool MappedFile::IsOpen() const {
+#if defined(_WIN32) || defined(_WIN64)
+    return file != INVALID_HANDLE_VALUE;
+#else
+    return file >= 0;
+#endif
+}
+
+bool MappedFile::Open(const std::string& path, bool writable) {
+    Close(size);
+    this->writable = writable;
+
+#if defined(_WIN32) || defined(_WIN64)
+    file = CreateFileA(path.c_str(), writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+        writable ? FILE_SHARE_READ : (FILE_SHARE_READ | FILE_SHARE_WRITE), nullptr,
+        writable ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    if (!writable) {
+        LARGE_INTEGER length;
+        if (!GetFileSizeEx((HANDLE)file, &length) || length.QuadPart == 0) {
+            Close();
+            return false;
+        }
+        size = (size_t)length.QuadPart;
+    }
+#else
+    file = writable ? open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) : open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    if (!writable) {
+        struct stat info;
+        if (fstat(file, &info) != 0 || info.st_size == 0) {
+            Close();
+            return false;
+        }
+        size = (size_t)info.st_size;
+    }
+#endif
+
+    if (!writable && !Map()) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::Resize(size_t newSize) {
+    if (!IsOpen() || !writable) {
+        return false;
+    }
+
+    Unmap();
+#if defined(_WIN32) || defined(_WIN64)
+    // En Windows, crear la proyección con un tamaño mayor amplía el archivo
+    size = newSize;
+#else
+    if (ftruncate(file, (off_t)newSize) != 0) {
+        return false;
+    }
+    size = newSize;
+#endif
+    return Map();
+}
+
+void MappedFile::Sync(size_t offset, size_t length) {
+    if (data == nullptr || offset >= size) {
+        return;
+    }
+    if (length > size - offset) {
+        length = size - offset;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    FlushViewOfFile(data + offset, length);
+#else
+    // msync exige una dirección alineada a página
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset / page * page;
+    msync(data + start, length + (offset - start), MS_ASYNC);
+#endif
+}
+
+void MappedFile::Close(size_t finalSize) {
+    if (!IsOpen()) {
+        return;
+    }
+
+    Unmap();
+#if defined(_WIN32) || defined(_WIN64)
+    if (writable) {
+        LARGE_INTEGER position;
+        position.QuadPart = (LONGLONG)finalSize;
+        SetFilePointerEx((HANDLE)file, position, nullptr, FILE_BEGIN);
+        SetEndOfFile((HANDLE)file);
+    }
+    CloseHandle((HANDLE)file);
+    file = INVALID_HANDLE_VALUE;
+#else
+    // Si no se puede recortar quedan ceros al final, que el lector ignora gracias a la cabecera
+    if (writable) {
+        int result = ftruncate(file, (off_t)finalSize);
+        (void)result;
+    }
+    close(file);
+    file = -1;
+#endif
+    size = 0;
+}
+
+bool MappedFile::Map() {
+    if (size == 0) {
+        return true;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    ULARGE_INTEGER length;
+    length.QuadPart = (ULONGLONG)size;
+    mapping = CreateFileMappingA((HANDLE)file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+        length.HighPart, length.LowPart, nullptr);
+    if (mapping == nullptr) {
+        return false;
+    }
+    data = (char*)MapViewOfFile((HANDLE)mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+    if (data == nullptr) {
+        CloseHandle((HANDLE)mapping);
+        mapping = nullptr;
+        return false;
+    }
+#else
+    void* address = mmap(nullptr, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, file, 0);
+    if (address == MAP_FAILED) {
+        return false;
+    }
+    data = (char*)address;
+#endif
+    return true;
+}
+
+void MappedFile::Unmap() {
+    if (data == nullptr) {
+        return;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mapping);
+    mapping = nullptr;
+#else
+    munmap(data, size);
+#endif
+    data = nullptr;
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// <summary>
+/// Archivo proyectado en memoria (mmap en POSIX, MapViewOfFile en Windows).
+/// En modo escritura el archivo se crea vacío y crece con Resize; al cerrarlo se recorta
+/// al tamaño realmente usado. En modo lectura se proyecta el archivo completo.
+/// </summary>
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Abre el archivo.
+     * @param writable true para crearlo (o vaciarlo) y escribir en él; false para leerlo.
+     * @return true si se pudo abrir (en lectura, además, no debe estar vacío).
+     */
+    bool Open(const std::string& path, bool writable);
+
+    /**
+     * @brief Cambia el tamaño del archivo y vuelve a proyectarlo. Solo en modo escritura.
+     *        Los punteros obtenidos antes con Data() dejan de ser válidos.
+     */
+    bool Resize(size_t size);
+
+    /**
+     * @brief Pide al sistema que escriba en disco el rango indicado, sin esperar.
+     */
+    void Sync(size_t offset, size_t length);
+
+    /**
+     * @brief Cierra el archivo. En modo escritura lo recorta a finalSize bytes.
+     */
+    void Close(size_t finalSize = 0);
+
+    char* Data() { return data; }
+    const char* Data() const { return data; }
+    size_t Size() const { return size; }
+    bool IsOpen() const;
+
+private:
+    bool Map();
+    void Unmap();
+
+#if defined(_WIN32) || defined(_WIN64)
+    void* file;     ///< HANDLE; se guarda como void* para no incluir windows.h aquí.
+    void* mapping;  ///< HANDLE de la proyección.
+#else
+    int file;
+#endif
+    char* data;
+    size_t size;
+    bool writable;
+};
@@ -0,0 +1,265 @@
+﻿#include "metrics.h"
+#include <algorithm>
+#include <cstdio>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+    // Posición del bit activo más alto (value != 0)
+    inline unsigned HighestBit(uint64_t value) {
+#if defined(_MSC_VER) && defined(_WIN64)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return (unsigned)index;
+#elif defined(__GNUC__)
+        return 63u - (unsigned)__builtin_clzll(value);
+#else
+        unsigned index = 0;
+        while (value >>= 1) {
+            index++;
+        }
+        return index;
+#endif
+    }
+
+    std::string FormatNumber(double value) {
+        char buffer[32];
+        if (value == (double)(int64_t)value) {
+            snprintf(buffer, sizeof(buffer), "%lld", (long long)value);
+        }
+        else {
+            snprintf(buffer, sizeof(buffer), "%.6g", value);
+        }
+        return buffer;
+    }
+
+    std::string Series(const std::string& name, const std::string& labels) {
+        return labels.empty() ? name : name + "{" + labels + "}";
+    }
+
+    const char* TypeName(MetricsRegistry::Type type) {
+        switch (type) {
+        case MetricsRegistry::COUNTER:
+            return "counter";
+        case MetricsRegistry::GAUGE:
+            return "gauge";
+        default:
+            return "histogram";
+        }
+    }
+}
+
+Histogram::Histogram() : count(0), sum(0), max(0) {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t Histogram::Count() const {
+    return count.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::Sum() const {
+    return sum.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::Max() const {
+    return max.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::Percentile(double quantile) const {
+    // Se suman los cubos en vez de usar count: mientras se escribe pueden no coincidir
+    uint64_t total = 0;
+    for (const auto& bucket : buckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(quantile * (double)total + 0.5);
+    rank = rank < 1 ? 1 : rank > total ? total : rank;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t limit = BucketLimit(i);
+            uint64_t largest = Max();
+            return limit < largest || largest == 0 ? limit : largest;
+        }
+    }
+    return Max();
+}
+
+uint64_t Histogram::BucketCount(size_t bucket) const {
+    return bucket < BUCKETS ? buckets[bucket].load(std::memory_order_relaxed) : 0;
+}
+
+size_t Histogram::Bucket(uint64_t value) {
+    // Por debajo de SUB_BUCKETS un cubo por valor; después SUB_BUCKETS por potencia de dos
+    if (value < SUB_BUCKETS) {
+        return (size_t)value;
+    }
+    unsigned exponent = HighestBit(value);
+    return (size_t)(exponent - SUB_BITS + 1) * SUB_BUCKETS + (size_t)((value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+}
+
+uint64_t Histogram::BucketLimit(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned shift = (unsigned)(bucket / SUB_BUCKETS) - 1;
+    uint64_t first = (uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return first + ((uint64_t)1 << shift) - 1;
+}
+
+void MetricsRegistry::Add(const void* owner, const std::string& name, const std::string& help, const std::string& labels, const Counter& counter) {
+    Insert(owner, name, help, labels, COUNTER, &counter);
+}
+
+void MetricsRegistry::Add(const void* owner, const std::string& name, const std::string& help, const std::string& labels, const Gauge& gauge) {
+    Insert(owner, name, help, labels, GAUGE, &gauge);
+}
+
+void MetricsRegistry::Add(const void* owner, const std::string& name, const std::string& help, const std::string& labels, const Histogram& histogram) {
+    Insert(owner, name, help, labels, HISTOGRAM, &histogram);
+}
+
+void MetricsRegistry::AddCollector(const void* owner, Collector collector) {
+    std::lock_guard<std::mutex> lock(mutex);
+    collectors.push_back({ owner, std::move(collector) });
+}
+
+void MetricsRegistry::Remove(const void* owner) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [owner](const Entry& entry) { return entry.owner == owner; }),
+        entries.end());
+    collectors.erase(std::remove_if(collectors.begin(), collectors.end(),
+        [owner](const CollectorEntry& entry) { return entry.owner == owner; }), collectors.end());
+}
+
+std::vector<MetricsRegistry::Value> MetricsRegistry::Collect() const {
+    std::vector<Value> values;
+    std::lock_guard<std::mutex> lock(mutex);
+    CollectLocked(values);
+    return values;
+}
+
+std::string MetricsRegistry::Prometheus() const {
+    std::string text;
+    std::vector<Value> values;
+    std::lock_guard<std::mutex> lock(mutex);
+    CollectLocked(values);
+
+    const std::string* family = nullptr;
+    for (const Value& value : values) {
+        if (family == nullptr || *family != value.name) {
+            family = &value.name;
+            text += "# HELP " + value.name + " " + value.help + "\n";
+            text += "# TYPE " + value.name + " " + TypeName(value.type) + "\n";
+        }
+        if (value.type != HISTOGRAM) {
+            text += Series(value.name, value.labels) + " " + FormatNumber(value.value) + "\n";
+            continue;
+        }
+
+        const Histogram* histogram = value.histogram.get();
+        if (histogram == nullptr) {
+            continue;
+        }
+
+        // Un límite por potencia de dos hasta el último cubo con medidas
+        size_t last = 0;
+        for (size_t i = 0; i < Histogram::BUCKETS; ++i) {
+            if (histogram->BucketCount(i) != 0) {
+                last = i;
+            }
+        }
+        std::string prefix = value.labels.empty() ? "" : value.labels + ",";
+        uint64_t cumulative = 0;
+        size_t end = (last / Histogram::SUB_BUCKETS + 1) * Histogram::SUB_BUCKETS;
+        for (size_t i = 0; i < end; ++i) {
+            cumulative += histogram->BucketCount(i);
+            if ((i + 1) % Histogram::SUB_BUCKETS == 0) {
+                text += value.name + "_bucket{" + prefix + "le=\"" + std::to_string(Histogram::BucketLimit(i)) + "\"} " +
+                    std::to_string(cumulative) + "\n";
+            }
+        }
+        text += value.name + "_bucket{" + prefix + "le=\"+Inf\"} " + std::to_string(cumulative) + "\n";
+        text += Series(value.name + "_sum", value.labels) + " " + std::to_string(value.sum) + "\n";
+        text += Series(value.name + "_count", value.labels) + " " + std::to_string(cumulative) + "\n";
+    }
+    return text;
+}
+
+std::string MetricsRegistry::Label(const std::string& name, const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (c == '\n') {
+            escaped += "\\n";
+        }
+        else {
+            escaped += c;
+        }
+    }
+    return name + "=\"" + escaped + "\"";
+}
+
+MetricsRegistry::Value MetricsRegistry::Make(const std::string& name, const std::string& help, const std::string& labels, Type type, double value) {
+    Value result = {};
+    result.name = name;
+    result.help = help;
+    result.labels = labels;
+    result.type = type;
+    result.value = value;
+    return result;
+}
+
+MetricsRegistry::Value MetricsRegistry::Make(const std::string& name, const std::string& help, const std::string& labels,
+    std::shared_ptr<const Histogram> histogram) {
+    Value result = Make(name, help, labels, HISTOGRAM, 0);
+    result.count = histogram->Count();
+    result.sum = histogram->Sum();
+    result.p50 = histogram->Percentile(0.5);
+    result.p99 = histogram->Percentile(0.99);
+    result.p999 = histogram->Percentile(0.999);
+    result.max = histogram->Max();
+    result.histogram = std::move(histogram);
+    return result;
+}
+
+void MetricsRegistry::Insert(const void* owner, const std::string& name, const std::string& help, const std::string& labels, Type type,
+    const void* metric) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back({ owner, name, help, labels, type, metric });
+}
+
+void MetricsRegistry::CollectLocked(std::vector<Value>& out) const {
+    for (const Entry& entry : entries) {
+        Value value = Make(entry.name, entry.help, entry.labels, entry.type, 0);
+        if (entry.type == COUNTER) {
+            value.value = (double)((const Counter*)entry.metric)->Value();
+        }
+        else if (entry.type == GAUGE) {
+            value.value = (double)((const Gauge*)entry.metric)->Value();
+        }
+        else {
+            // Sin propietario: el histograma registrado vive en su componente hasta Remove
+            value = Make(entry.name, entry.help, entry.labels,
+                std::shared_ptr<const Histogram>(std::shared_ptr<const Histogram>(), (const Histogram*)entry.metric));
+        }
+        out.push_back(value);
+    }
+    for (const CollectorEntry& entry : collectors) {
+        entry.collector(out);
+    }
+
+    // Prometheus pide las series de una misma métrica seguidas
+    std::stable_sort(out.begin(), out.end(), [](const Value& a, const Value& b) { return a.name < b.name; });
+}
@@ -0,0 +1,217 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Instante actual en microsegundos de reloj monotónico (steady_clock). Es la base común
+ *        con la que se fechan las muestras y se miden las latencias entre hilos.
+ */
+inline uint64_t MonotonicMicros() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// <summary>
+/// Contador que solo crece. Add es un fetch_add relajado: se puede usar desde cualquier hilo
+/// en el camino crítico.
+/// </summary>
+class Counter {
+public:
+    Counter() : value(0) {}
+
+    void Add(uint64_t amount = 1) {
+        value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    uint64_t Value() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> value;
+};
+
+/// <summary>
+/// Valor que sube y baja (clientes conectados, profundidad de una cola...).
+/// </summary>
+class Gauge {
+public:
+    Gauge() : value(0) {}
+
+    void Set(int64_t amount) {
+        value.store(amount, std::memory_order_relaxed);
+    }
+
+    void Add(int64_t amount) {
+        value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    int64_t Value() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> value;
+};
+
+/// <summary>
+/// Histograma logarítmico-lineal de enteros sin signo: cada potencia de dos se divide en
+/// SUB_BUCKETS cubos iguales, así que el error relativo de un percentil es como mucho
+/// 1 / SUB_BUCKETS (12,5 %) sea cual sea la escala, sin configurar límites. Record son tres
+/// fetch_add relajados (y una comparación para el máximo); los percentiles se calculan al leer.
+/// </summary>
+class Histogram {
+public:
+    static const unsigned SUB_BITS = 3;
+    static const size_t SUB_BUCKETS = (size_t)1 << SUB_BITS;
+    static const size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    Histogram();
+
+    void Record(uint64_t value) {
+        buckets[Bucket(value)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+        uint64_t seen = max.load(std::memory_order_relaxed);
+        while (value > seen && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t Count() const;
+    uint64_t Sum() const;
+    uint64_t Max() const;
+
+    /**
+     * @brief Valor por debajo del cual queda la fracción quantile de las medidas (0-1), con la
+     *        resolución de los cubos (se devuelve el mayor valor del cubo). 0 si está vacío.
+     */
+    uint64_t Percentile(double quantile) const;
+
+    /**
+     * @brief Medidas de un cubo.
+     */
+    uint64_t BucketCount(size_t bucket) const;
+
+    /**
+     * @brief Cubo de un valor.
+     */
+    static size_t Bucket(uint64_t value);
+
+    /**
+     * @brief Mayor valor que cae en el cubo.
+     */
+    static uint64_t BucketLimit(size_t bucket);
+
+private:
+    std::atomic<uint64_t> buckets[BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+};
+
+/// <summary>
+/// Registro de métricas del servidor. Los componentes guardan sus Counter, Gauge e Histogram
+/// como miembros (el camino crítico no pasa por aquí) y los registran con un nombre, una
+/// ayuda y etiquetas; los valores que ya existen en otro sitio (instantánea de clientes,
+/// anillos) se leen con colectores solo cuando alguien pide las métricas. Registrar, quitar
+/// y leer usan un mutex; son operaciones raras.
+/// </summary>
+class MetricsRegistry {
+public:
+    enum Type {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    /// Una serie leída del registro.
+    struct Value {
+        std::string name;
+        std::string help;
+        std::string labels;   ///< 'nombre="valor",...' ya escapado; vacío sin etiquetas.
+        Type type;
+        double value;         ///< Contadores y medidores.
+        uint64_t count;       ///< Histogramas: medidas, suma, percentiles y máximo.
+        uint64_t sum;
+        uint64_t p50;
+        uint64_t p99;
+        uint64_t p999;
+        uint64_t max;
+        std::shared_ptr<const Histogram> histogram; ///< Histogramas: los cubos. Si se registró con Add no es
+                                                    ///< propietario y solo vale mientras siga registrado.
+    };
+
+    /// Añade series calculadas en el momento de la lectura. Un histograma que el colector no
+    /// registró (por ejemplo, uno por cliente) se entrega como shared_ptr para que siga vivo.
+    using Collector = std::function<void(std::vector<Value>& out)>;
+
+    /**
+     * @brief Registra una métrica. owner identifica a quien la registró para quitarla con Remove;
+     *        la métrica debe seguir viva hasta entonces.
+     */
+    void Add(const void* owner, const std::string& name, const std::string& help, const std::string& labels, const Counter& counter);
+    void Add(const void* owner, const std::string& name, const std::string& help, const std::string& labels, const Gauge& gauge);
+    void Add(const void* owner, const std::string& name, const std::string& help, const std::string& labels, const Histogram& histogram);
+    void AddCollector(const void* owner, Collector collector);
+
+    /**
+     * @brief Quita todo lo registrado por owner.
+     */
+    void Remove(const void* owner);
+
+    /**
+     * @brief Lee todas las series, agrupadas por nombre.
+     */
+    std::vector<Value> Collect() const;
+
+    /**
+     * @brief Todas las métricas en el formato de texto de Prometheus (versión 0.0.4).
+     */
+    std::string Prometheus() const;
+
+    /**
+     * @brief Etiqueta 'nombre="valor"' con el valor escapado para Prometheus.
+     */
+    static std::string Label(const std::string& name, const std::string& value);
+
+    /**
+     * @brief Serie de un colector.
+     */
+    static Value Make(const std::string& name, const std::string& help, const std::string& labels, Type type, double value);
+
+    /**
+     * @brief Serie de histograma de un colector, con los percentiles ya calculados.
+     */
+    static Value Make(const std::string& name, const std::string& help, const std::string& labels,
+        std::shared_ptr<const Histogram> histogram);
+
+private:
+    struct Entry {
+        const void* owner;
+        std::string name;
+        std::string help;
+        std::string labels;
+        Type type;
+        const void* metric;
+    };
+
+    struct CollectorEntry {
+        const void* owner;
+        Collector collector;
+    };
+
+    void Insert(const void* owner, const std::string& name, const std::string& help, const std::string& labels, Type type, const void* metric);
+    void CollectLocked(std::vector<Value>& out) const;
+
+    mutable std::mutex mutex;
+    std::vector<Entry> entries;
+    std::vector<CollectorEntry> collectors;
+};
@@ -0,0 +1,162 @@
+﻿#include "metricsserver.h"
+#include <cstring>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <poll.h>
+#endif
+
+namespace {
+    /**
+     * @brief Espera a que el socket tenga algo que leer. Como Poller, usa poll (WSAPoll en Windows),
+     *        que no tiene el límite de FD_SETSIZE de select.
+     * @return true si se puede leer sin bloquear.
+     */
+    bool WaitReadable(SOCKET socket, int timeoutMs) {
+#if defined(_WIN32) || defined(_WIN64)
+        WSAPOLLFD entry = {};
+        entry.fd = socket;
+        entry.events = POLLRDNORM;
+        return WSAPoll(&entry, 1, timeoutMs) > 0;
+#else
+        pollfd entry = {};
+        entry.fd = socket;
+        entry.events = POLLIN;
+        return poll(&entry, 1, timeoutMs) > 0;
+#endif
+    }
+
+    void SendAll(SOCKET socket, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            int result = send(socket, data.data() + sent, (int)(data.size() - sent), net::SEND_FLAGS);
+            if (result <= 0) {
+                if (result < 0 && net::Interrupted(net::LastError())) {
+                    continue;
+                }
+                return;
+            }
+            sent += (size_t)result;
+        }
+    }
+}
+
+MetricsServer::MetricsServer(const MetricsRegistry& registry, Logger* logger)
+    : registry(registry), logger(logger), listenSocket(INVALID_SOCKET), isRunning(false), requests(0) {}
+
+MetricsServer::~MetricsServer() {
+    Stop();
+}
+
+bool MetricsServer::Start(int port) {
+    if (isRunning) {
+        return true;
+    }
+    if (!net::Startup()) {
+        logger->Log("Error al iniciar Winsock para las métricas.", Logger::ERROR_LOG);
+        return false;
+    }
+
+    listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET) {
+        logger->Log("Error al crear el socket de las métricas.", Logger::ERROR_LOG);
+        net::Cleanup();
+        return false;
+    }
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
+    // Solo local: las métricas no deben quedar expuestas en la red de la planta
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((unsigned short)port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (bind(listenSocket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR || listen(listenSocket, 4) == SOCKET_ERROR) {
+        logger->Log("No se pudo abrir el puerto de métricas " + std::to_string(port) + ".", Logger::ERROR_LOG);
+        closesocket(listenSocket);
+        listenSocket = INVALID_SOCKET;
+        net::Cleanup();
+        return false;
+    }
+
+    isRunning = true;
+    thread = std::thread(&MetricsServer::Run, this);
+    logger->Log("Métricas disponibles en http://127.0.0.1:" + std::to_string(port) + "/metrics", Logger::INFO);
+    return true;
+}
+
+void MetricsServer::Stop() {
+    if (!isRunning) {
+        return;
+    }
+    isRunning = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    closesocket(listenSocket);
+    listenSocket = INVALID_SOCKET;
+    net::Cleanup();
+}
+
+bool MetricsServer::IsRunning() const {
+    return isRunning;
+}
+
+uint64_t MetricsServer::Requests() const {
+    return requests.load(std::memory_order_relaxed);
+}
+
+void MetricsServer::Run() {
+    while (isRunning) {
+        if (!WaitReadable(listenSocket, TIMEOUT_MS)) {
+            continue;
+        }
+        SOCKET client = accept(listenSocket, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        Serve(client);
+        closesocket(client);
+    }
+}
+
+void MetricsServer::Serve(SOCKET client) {
+    // Basta con la línea de petición; se lee hasta el final de la cabecera o hasta MAX_REQUEST
+    char request[MAX_REQUEST];
+    size_t length = 0;
+    while (length < sizeof(request) - 1 && WaitReadable(client, TIMEOUT_MS * 5)) {
+        int result = recv(client, request + length, (int)(sizeof(request) - 1 - length), 0);
+        if (result <= 0) {
+            break;
+        }
+        length += (size_t)result;
+        request[length] = '\0';
+        if (strstr(request, "\r\n\r\n") != nullptr || strstr(request, "\n\n") != nullptr) {
+            break;
+        }
+    }
+    request[length] = '\0';
+
+    std::string status;
+    std::string body;
+    std::string type = "text/plain; charset=utf-8";
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET /metrics?", 13) == 0) {
+        status = "200 OK";
+        body = registry.Prometheus();
+        type = "text/plain; version=0.0.4; charset=utf-8";
+        requests.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (strncmp(request, "GET ", 4) == 0) {
+        status = "404 Not Found";
+        body = "Solo existe /metrics\n";
+    }
+    else {
+        status = "405 Method Not Allowed";
+        body = "Solo se admite GET\n";
+    }
+
+    SendAll(client, "HTTP/1.1 " + status + "\r\nContent-Type: " + type + "\r\nContent-Length: " + std::to_string(body.size()) +
+        "\r\nConnection: close\r\n\r\n" + body);
+}
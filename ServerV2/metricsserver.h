@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include "network.h"
+#include "metrics.h"
+#include "logger.h"
+
+/// <summary>
+/// Servidor HTTP mínimo que publica las métricas del registro en GET /metrics con el formato
+/// de texto de Prometheus. Escucha solo en 127.0.0.1 y atiende las peticiones de una en una
+/// en su propio hilo, así que nunca toca los hilos de lectura ni de red: cada petición solo
+/// lee los contadores.
+/// </summary>
+class MetricsServer {
+public:
+    static const int DEFAULT_PORT = 9465;
+    static const size_t MAX_REQUEST = 4096;  ///< Bytes máximos de la cabecera de una petición.
+    static const int TIMEOUT_MS = 200;       ///< Espera máxima de cada select; permite detener el hilo.
+
+    MetricsServer(const MetricsRegistry& registry, Logger* logger);
+    ~MetricsServer();
+
+    /**
+     * @brief Empieza a escuchar en 127.0.0.1:port.
+     * @return false si no se pudo abrir el puerto.
+     */
+    bool Start(int port);
+
+    /**
+     * @brief Cierra el puerto y espera al hilo.
+     */
+    void Stop();
+
+    bool IsRunning() const;
+
+    uint64_t Requests() const;  ///< Peticiones atendidas.
+
+private:
+    void Run();
+    void Serve(SOCKET client);
+
+    const MetricsRegistry& registry;
+    Logger* logger;
+    SOCKET listenSocket;
+    std::thread thread;
+    std::atomic<bool> isRunning;
+    std::atomic<uint64_t> requests;
+};
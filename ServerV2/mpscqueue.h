@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// Cola acotada sin bloqueos de varios productores y un consumidor (esquema de Vyukov:
+/// cada celda lleva un número de secuencia que indica si está libre o lista para leerse).
+/// La usa Logger: cualquier hilo encola un registro de tamaño fijo con un CAS y el hilo
+/// escritor los consume. Si la cola está llena, Push falla en lugar de esperar.
+/// </summary>
+template <typename T, size_t CAPACITY>
+class MpscQueue {
+    static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY debe ser potencia de dos");
+
+public:
+    MpscQueue() : enqueuePosition(0), dequeuePosition(0) {
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Reserva una celda y la rellena en su sitio con fill(T&). Desde cualquier hilo.
+     * @return false si la cola estaba llena.
+     */
+    template <typename Fill>
+    bool Push(Fill fill) {
+        Cell* cell;
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[position & MASK];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (difference < 0) {
+                return false;
+            }
+            else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        fill(cell->value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Entrega el elemento más antiguo a consume(const T&). Solo desde el hilo consumidor.
+     * @return false si no había ningún elemento listo.
+     */
+    template <typename Consume>
+    bool Pop(Consume consume) {
+        Cell& cell = cells[dequeuePosition & MASK];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if ((intptr_t)sequence - (intptr_t)(dequeuePosition + 1) < 0) {
+            return false;
+        }
+
+        consume(static_cast<const T&>(cell.value));
+        cell.sequence.store(dequeuePosition + CAPACITY, std::memory_order_release);
+        dequeuePosition++;
+        return true;
+    }
+
+private:
+    static const size_t MASK = CAPACITY - 1;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    Cell cells[CAPACITY];
+    alignas(64) std::atomic<size_t> enqueuePosition; ///< Compartida por los productores.
+    alignas(64) size_t dequeuePosition;              ///< Solo la usa el consumidor.
+};
@@ -0,0 +1,136 @@
+﻿#include "multicast.h"
+#include <cstring>
+
+namespace multicast {
+    size_t EncodeDatagram(uint32_t sequence, const RadarSample* samples, size_t count, char* out) {
+        out[0] = (char)MAGIC;
+        out[1] = (char)VERSION;
+        out[2] = 0;
+        out[3] = 0;
+        for (int i = 0; i < 4; ++i) {
+            out[4 + i] = (char)(sequence >> (i * 8));
+        }
+        return HEADER_SIZE + wire::EncodeSamples(samples, count, out + HEADER_SIZE, 0, wire::DEVICE_SAMPLES);
+    }
+
+    bool DecodeDatagram(const char* data, size_t length, uint32_t& sequence, wire::Message& message) {
+        if (length < HEADER_SIZE || (uint8_t)data[0] != MAGIC || (uint8_t)data[1] != VERSION) {
+            return false;
+        }
+        sequence = 0;
+        for (int i = 0; i < 4; ++i) {
+            sequence |= (uint32_t)(uint8_t)data[4 + i] << (i * 8);
+        }
+
+        size_t consumed = 0;
+        return wire::DecodeFrame(data + HEADER_SIZE, length - HEADER_SIZE, consumed, message) == wire::DECODED &&
+            message.header.type == wire::DEVICE_SAMPLES;
+    }
+
+    bool ParseAddress(const std::string& text, std::string& host, int& port) {
+        size_t colon = text.find(':');
+        host = text.substr(0, colon);
+        port = DEFAULT_PORT;
+        if (colon != std::string::npos) {
+            std::string number = text.substr(colon + 1);
+            if (number.empty() || number.size() > 5 || number.find_first_not_of("0123456789") != std::string::npos) {
+                return false;
+            }
+            port = std::stoi(number);
+        }
+
+        in_addr address;
+        return port > 0 && port <= 65535 && inet_pton(AF_INET, host.c_str(), &address) == 1;
+    }
+
+    bool IsMulticast(const std::string& host) {
+        in_addr address;
+        return inet_pton(AF_INET, host.c_str(), &address) == 1 && (ntohl(address.s_addr) >> 28) == 0xE;
+    }
+}
+
+MulticastSender::MulticastSender() : socket(INVALID_SOCKET), target(), sequence(0) {}
+
+MulticastSender::~MulticastSender() {
+    Close();
+}
+
+bool MulticastSender::Open(const std::string& host, int port, int ttl) {
+    Close();
+
+    target.sin_family = AF_INET;
+    target.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host.c_str(), &target.sin_addr) != 1) {
+        return false;
+    }
+
+    socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socket == INVALID_SOCKET) {
+        return false;
+    }
+
+    // Con multicast el TTL limita hasta dónde llega; la difusión de subred necesita SO_BROADCAST
+    if (multicast::IsMulticast(host)) {
+        unsigned char hops = (unsigned char)(ttl < 1 ? 1 : (ttl > 255 ? 255 : ttl));
+        setsockopt(socket, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char*>(&hops), sizeof(hops));
+    }
+    else {
+        int broadcast = 1;
+        setsockopt(socket, SOL_SOCKET, SO_BROADCAST, reinterpret_cast<const char*>(&broadcast), sizeof(broadcast));
+    }
+
+    // El hilo de red no puede esperar a la tarjeta: si el buffer está lleno se descarta el datagrama
+    if (!net::SetNonBlocking(socket)) {
+        Close();
+        return false;
+    }
+    sequence = 0;
+    return true;
+}
+
+void MulticastSender::Close() {
+    if (socket != INVALID_SOCKET) {
+        closesocket(socket);
+        socket = INVALID_SOCKET;
+    }
+}
+
+bool MulticastSender::IsOpen() const {
+    return socket != INVALID_SOCKET;
+}
+
+void MulticastSender::Send(const RadarSample* batch, size_t count) {
+    char buffer[multicast::MAX_DATAGRAM];
+    for (size_t start = 0; start < count; start += multicast::MAX_SAMPLES) {
+        size_t chunk = count - start < multicast::MAX_SAMPLES ? count - start : multicast::MAX_SAMPLES;
+        size_t length = multicast::EncodeDatagram(sequence++, batch + start, chunk, buffer);
+
+        int sent;
+        do {
+            sent = (int)sendto(socket, buffer, (int)length, 0, reinterpret_cast<const sockaddr*>(&target), sizeof(target));
+        } while (sent < 0 && net::Interrupted(net::LastError()));
+        if (sent < 0) {
+            // El número ya se consumió: el receptor lo verá como un datagrama perdido
+            errors.Add();
+            continue;
+        }
+        datagrams.Add();
+        samples.Add(chunk);
+    }
+}
+
+std::string MulticastSender::Address() const {
+    return net::FormatAddress(target);
+}
+
+const Counter& MulticastSender::Datagrams() const {
+    return datagrams;
+}
+
+const Counter& MulticastSender::Samples() const {
+    return samples;
+}
+
+const Counter& MulticastSender::Errors() const {
+    return errors;
+}
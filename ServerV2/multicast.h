@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "network.h"
+#include "wireformat.h"
+#include "metrics.h"
+#include "sample.h"
+
+/// <summary>
+/// Salida UDP opcional para repartir las muestras por la red local con un único envío por
+/// lote, sin importar cuántos receptores haya: a un grupo multicast (224.0.0.0-239.255.255.255),
+/// a la dirección de difusión de la subred o a un único equipo. Es una entrega sin garantías;
+/// los clientes que necesitan todas las muestras siguen usando TCP.
+///
+/// Datagrama (enteros en little-endian):
+///   0  u8   MAGIC ('U')
+///   1  u8   VERSION
+///   2  u16  reservado (0)
+///   4  u32  número de datagrama, consecutivo desde 0 al abrir la salida; los huecos indican
+///           datagramas perdidos y los números menores que el último, datagramas desordenados
+///   8  trama DEVICE_SAMPLES de wireformat.h con hasta MAX_SAMPLES muestras de todos los radares
+/// </summary>
+namespace multicast {
+    const uint8_t MAGIC = 'U';
+    const uint8_t VERSION = 1;
+    const size_t HEADER_SIZE = 8;
+    const size_t MAX_SAMPLES = 100;       ///< Por datagrama: 1424 bytes, caben en una trama Ethernet sin fragmentar.
+    const size_t MAX_DATAGRAM = HEADER_SIZE + wire::HEADER_SIZE + MAX_SAMPLES * wire::DEVICE_RECORD_SIZE;
+    const int DEFAULT_PORT = 27100;
+
+    /**
+     * @brief Codifica un datagrama.
+     * @param count Muestras (como máximo MAX_SAMPLES).
+     * @param out Buffer de al menos MAX_DATAGRAM bytes.
+     * @return Bytes escritos.
+     */
+    size_t EncodeDatagram(uint32_t sequence, const RadarSample* samples, size_t count, char* out);
+
+    /**
+     * @brief Decodifica un datagrama recibido.
+     * @param sequence Recibe el número de datagrama.
+     * @param message Recibe la cabecera y las muestras (se añaden al final de message.samples).
+     * @return false si no es un datagrama de esta versión o la trama no es válida.
+     */
+    bool DecodeDatagram(const char* data, size_t length, uint32_t& sequence, wire::Message& message);
+
+    /**
+     * @brief Interpreta "ip" o "ip:puerto" (DEFAULT_PORT si no lo lleva).
+     */
+    bool ParseAddress(const std::string& text, std::string& host, int& port);
+
+    /**
+     * @brief Indica si la dirección IPv4 pertenece al rango multicast.
+     */
+    bool IsMulticast(const std::string& host);
+}
+
+/// <summary>
+/// Envía los lotes de muestras en datagramas UDP (ver el namespace multicast). Solo debe
+/// usarse desde un hilo (el de red); los contadores se pueden leer desde cualquiera.
+/// </summary>
+class MulticastSender {
+public:
+    MulticastSender();
+    ~MulticastSender();
+
+    /**
+     * @brief Crea el socket UDP hacia la dirección indicada.
+     * @param ttl Saltos que puede dar un datagrama multicast (1: solo la subred local).
+     */
+    bool Open(const std::string& host, int port, int ttl = 1);
+
+    void Close();
+    bool IsOpen() const;
+
+    /**
+     * @brief Envía un lote en datagramas de hasta MAX_SAMPLES muestras: un sendto por datagrama.
+     *        Si el sistema no puede aceptarlo en ese momento, el datagrama se descarta y se cuenta.
+     */
+    void Send(const RadarSample* samples, size_t count);
+
+    std::string Address() const;               ///< "ip:puerto" de destino.
+    const Counter& Datagrams() const;          ///< Datagramas enviados.
+    const Counter& Samples() const;            ///< Muestras enviadas.
+    const Counter& Errors() const;             ///< Datagramas que el sistema no aceptó.
+
+private:
+    SOCKET socket;
+    sockaddr_in target;
+    uint32_t sequence;
+    Counter datagrams;
+    Counter samples;
+    Counter errors;
+};
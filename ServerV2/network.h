@@ -0,0 +1,131 @@
+﻿#pragma once
+
+// Capa mínima de compatibilidad entre Winsock y sockets POSIX.
+// Permite que Protocol y el bucle de eventos usen los mismos tipos (SOCKET,
+// INVALID_SOCKET, closesocket) en Windows y en Linux.
+
+#include <string>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <iphlpapi.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+
+typedef int SOCKET;
+
+#ifndef INVALID_SOCKET
+#define INVALID_SOCKET (-1)
+#endif
+
+#ifndef SOCKET_ERROR
+#define SOCKET_ERROR (-1)
+#endif
+
+inline int closesocket(SOCKET socket) {
+    return close(socket);
+}
+#endif
+
+namespace net {
+#if defined(_WIN32) || defined(_WIN64)
+    const int SEND_FLAGS = 0;
+#else
+    const int SEND_FLAGS = MSG_NOSIGNAL; ///< Evita SIGPIPE cuando el cliente ya cerró la conexión.
+#endif
+
+    /**
+     * @brief Inicializa la pila de red (WSAStartup en Windows, no hace nada en POSIX).
+     * @return true si la pila quedó lista para usarse.
+     */
+    inline bool Startup() {
+#if defined(_WIN32) || defined(_WIN64)
+        WSADATA wsaData;
+        return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Libera la pila de red (WSACleanup en Windows).
+     */
+    inline void Cleanup() {
+#if defined(_WIN32) || defined(_WIN64)
+        WSACleanup();
+#endif
+    }
+
+    /**
+     * @brief Cambia el socket a modo no bloqueante.
+     * @return true si se pudo cambiar el modo.
+     */
+    inline bool SetNonBlocking(SOCKET socket) {
+#if defined(_WIN32) || defined(_WIN64)
+        u_long mode = 1;
+        return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+        int flags = fcntl(socket, F_GETFL, 0);
+        return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+    }
+
+    /**
+     * @brief Desactiva el algoritmo de Nagle para que cada muestra salga sin esperar.
+     */
+    inline void SetNoDelay(SOCKET socket) {
+        int flag = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&flag), sizeof(flag));
+    }
+
+    /**
+     * @brief Convierte una dirección IPv4 a texto "ip:puerto".
+     */
+    inline std::string FormatAddress(const sockaddr_in& address) {
+        char ip[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &address.sin_addr, ip, sizeof(ip));
+        return std::string(ip) + ":" + std::to_string(ntohs(address.sin_port));
+    }
+
+    /**
+     * @brief Último código de error de la pila de sockets.
+     */
+    inline int LastError() {
+#if defined(_WIN32) || defined(_WIN64)
+        return WSAGetLastError();
+#else
+        return errno;
+#endif
+    }
+
+    /**
+     * @brief Indica si el error corresponde a una operación que se bloquearía.
+     */
+    inline bool WouldBlock(int error) {
+#if defined(_WIN32) || defined(_WIN64)
+        return error == WSAEWOULDBLOCK;
+#else
+        return error == EAGAIN || error == EWOULDBLOCK;
+#endif
+    }
+
+    /**
+     * @brief Indica si la llamada fue interrumpida y debe reintentarse.
+     */
+    inline bool Interrupted(int error) {
+#if defined(_WIN32) || defined(_WIN64)
+        return error == WSAEINTR;
+#else
+        return error == EINTR;
+#endif
+    }
+}
@@ -0,0 +1,304 @@
+﻿#include "noisefilter.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FILTER_SSE2
+#endif
+
+static_assert(NoiseFilter::MAX_DISTANCE < 0x8000, "las comparaciones SSE2 son con signo");
+
+namespace {
+    inline uint16_t Min(uint16_t a, uint16_t b) {
+        return a < b ? a : b;
+    }
+
+    inline uint16_t Max(uint16_t a, uint16_t b) {
+        return a > b ? a : b;
+    }
+
+#if defined(FILTER_SSE2)
+    inline __m128i Min(__m128i a, __m128i b) {
+        return _mm_min_epi16(a, b);
+    }
+
+    inline __m128i Max(__m128i a, __m128i b) {
+        return _mm_max_epi16(a, b);
+    }
+
+    inline unsigned BitCount(unsigned bits) {
+        unsigned count = 0;
+        for (; bits != 0; bits &= bits - 1) {
+            count++;
+        }
+        return count;
+    }
+#endif
+
+    // Redes de mínimos y máximos: sin saltos, igual para un valor que para ocho
+    template <typename T>
+    inline T Median3(T a, T b, T c) {
+        return Max(Min(a, b), Min(Max(a, b), c));
+    }
+
+    template <typename T>
+    inline T Median5(T a, T b, T c, T d, T e) {
+        return Median3(e, Max(Min(a, b), Min(c, d)), Min(Max(a, b), Max(c, d)));
+    }
+}
+
+NoiseFilter::NoiseFilter()
+    : stages(NONE), window(DEFAULT_WINDOW), smoothing(DEFAULT_SMOOTHING), outlierThreshold(DEFAULT_OUTLIER_CM),
+      restart(false), filtered(0), rejected(0) {
+    memset(history, 0, sizeof(history));
+    memset(average, 0, sizeof(average));
+    memset(reference, 0, sizeof(reference));
+    memset(rejects, 0, sizeof(rejects));
+    memset(known, 0, sizeof(known));
+}
+
+void NoiseFilter::Filter(RadarSample* samples, size_t count) {
+    Settings settings = Current();
+    if (settings.stages == NONE || count == 0) {
+        return;
+    }
+
+    uint64_t rejectedCount = 0;
+    uint16_t run[ANGLES];
+    size_t i = 0;
+    while (i < count) {
+        // Tramo de ángulos consecutivos en un mismo sentido (cada ángulo aparece una vez)
+        size_t end = i + 1;
+        int step = end < count ? (int)samples[end].angle - (int)samples[i].angle : 0;
+        if (samples[i].angle < ANGLES && (step == 1 || step == -1)) {
+            while (end < count && samples[end].angle < ANGLES && (int)samples[end].angle - (int)samples[end - 1].angle == step) {
+                end++;
+            }
+        }
+
+        size_t length = end - i;
+        if (length >= MIN_RUN) {
+            // ApplyRun quiere los ángulos crecientes; los tramos de vuelta se dan la vuelta
+            size_t first = step > 0 ? samples[i].angle : samples[end - 1].angle;
+            for (size_t k = 0; k < length; ++k) {
+                run[step > 0 ? k : length - 1 - k] = samples[i + k].distance;
+            }
+            Run(settings, first, run, length, rejectedCount);
+            for (size_t k = 0; k < length; ++k) {
+                samples[i + k].distance = run[step > 0 ? k : length - 1 - k];
+            }
+        }
+        else {
+            for (size_t k = i; k < end; ++k) {
+                samples[k].distance = Step(settings, samples[k].angle, samples[k].distance, rejectedCount);
+            }
+        }
+        i = end;
+    }
+
+    filtered.fetch_add(count, std::memory_order_relaxed);
+    if (rejectedCount > 0) {
+        rejected.fetch_add(rejectedCount, std::memory_order_relaxed);
+    }
+}
+
+uint16_t NoiseFilter::Apply(uint16_t angle, uint16_t distance) {
+    Settings settings = Current();
+    if (settings.stages == NONE) {
+        return distance;
+    }
+    uint64_t rejectedCount = 0;
+    distance = Step(settings, angle, distance, rejectedCount);
+    filtered.fetch_add(1, std::memory_order_relaxed);
+    if (rejectedCount > 0) {
+        rejected.fetch_add(rejectedCount, std::memory_order_relaxed);
+    }
+    return distance;
+}
+
+void NoiseFilter::ApplyRun(uint16_t first, uint16_t* distances, size_t count) {
+    Settings settings = Current();
+    if (settings.stages == NONE || first + count > ANGLES) {
+        return;
+    }
+    uint64_t rejectedCount = 0;
+    Run(settings, first, distances, count, rejectedCount);
+    filtered.fetch_add(count, std::memory_order_relaxed);
+    if (rejectedCount > 0) {
+        rejected.fetch_add(rejectedCount, std::memory_order_relaxed);
+    }
+}
+
+NoiseFilter::Settings NoiseFilter::Current() {
+    if (restart.load(std::memory_order_relaxed) && restart.exchange(false)) {
+        memset(known, 0, sizeof(known));
+    }
+    Settings settings;
+    settings.stages = stages.load(std::memory_order_relaxed);
+    settings.window = window.load(std::memory_order_relaxed);
+    settings.alpha = smoothing.load(std::memory_order_relaxed) / 100.0f;
+    settings.threshold = outlierThreshold.load(std::memory_order_relaxed);
+    return settings;
+}
+
+void NoiseFilter::Prime(size_t angle, uint16_t distance) {
+    // La primera lectura de un ángulo llena la ventana: la mediana sale bien desde el principio
+    for (size_t slot = 0; slot < MAX_WINDOW; ++slot) {
+        history[slot][angle] = distance;
+    }
+    average[angle] = (float)distance;
+    reference[angle] = distance;
+    rejects[angle] = 0;
+    known[angle] = 1;
+}
+
+uint16_t NoiseFilter::Step(const Settings& settings, size_t angle, uint16_t distance, uint64_t& rejectedCount) {
+    if (angle >= ANGLES) {
+        return distance;
+    }
+    uint16_t value = Min(distance, MAX_DISTANCE);
+    if (!known[angle]) {
+        Prime(angle, value);
+    }
+
+    if (settings.stages & OUTLIER) {
+        uint16_t last = reference[angle];
+        uint16_t jump = value > last ? value - last : last - value;
+        if (jump > settings.threshold && rejects[angle] < MAX_REJECTS) {
+            value = last;
+            rejects[angle]++;
+            rejectedCount++;
+        }
+        else {
+            rejects[angle] = 0;
+        }
+        reference[angle] = value;
+    }
+
+    if (settings.stages & MEDIAN) {
+        size_t newest = settings.window - 1;
+        for (size_t slot = 0; slot < newest; ++slot) {
+            history[slot][angle] = history[slot + 1][angle];
+        }
+        history[newest][angle] = value;
+        value = settings.window == 5
+            ? Median5(history[0][angle], history[1][angle], history[2][angle], history[3][angle], history[4][angle])
+            : Median3(history[0][angle], history[1][angle], history[2][angle]);
+    }
+
+    if (settings.stages & EMA) {
+        float smoothed = average[angle] + settings.alpha * ((float)value - average[angle]);
+        average[angle] = smoothed;
+        value = (uint16_t)(int)(smoothed + 0.5f);
+    }
+    return value;
+}
+
+void NoiseFilter::Run(const Settings& settings, size_t first, uint16_t* distances, size_t count, uint64_t& rejectedCount) {
+    for (size_t k = 0; k < count; ++k) {
+        distances[k] = Min(distances[k], MAX_DISTANCE);
+        if (!known[first + k]) {
+            Prime(first + k, distances[k]);
+        }
+    }
+
+    size_t k = 0;
+#if defined(FILTER_SSE2)
+    // Ocho ángulos por vuelta; cada etapa lee y escribe su array de estado en bloque
+    const __m128i threshold = _mm_set1_epi16((short)settings.threshold);
+    const __m128i patience = _mm_set1_epi16(MAX_REJECTS);
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 alpha = _mm_set1_ps(settings.alpha);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const size_t newest = settings.window - 1;
+
+    for (; k + 8 <= count; k += 8) {
+        size_t angle = first + k;
+        __m128i value = _mm_loadu_si128((const __m128i*)(distances + k));
+
+        if (settings.stages & OUTLIER) {
+            __m128i last = _mm_loadu_si128((const __m128i*)(reference + angle));
+            __m128i streak = _mm_loadu_si128((const __m128i*)(rejects + angle));
+            __m128i jump = _mm_max_epi16(_mm_sub_epi16(value, last), _mm_sub_epi16(last, value));
+            __m128i reject = _mm_and_si128(_mm_cmpgt_epi16(jump, threshold), _mm_cmplt_epi16(streak, patience));
+            value = _mm_or_si128(_mm_and_si128(reject, last), _mm_andnot_si128(reject, value));
+            _mm_storeu_si128((__m128i*)(rejects + angle), _mm_and_si128(reject, _mm_add_epi16(streak, one)));
+            _mm_storeu_si128((__m128i*)(reference + angle), value);
+            rejectedCount += BitCount((unsigned)_mm_movemask_epi8(reject)) / 2;
+        }
+
+        if (settings.stages & MEDIAN) {
+            __m128i slots[MAX_WINDOW];
+            for (size_t slot = 0; slot < newest; ++slot) {
+                slots[slot] = _mm_loadu_si128((const __m128i*)(history[slot + 1] + angle));
+                _mm_storeu_si128((__m128i*)(history[slot] + angle), slots[slot]);
+            }
+            slots[newest] = value;
+            _mm_storeu_si128((__m128i*)(history[newest] + angle), value);
+            value = settings.window == 5
+                ? Median5(slots[0], slots[1], slots[2], slots[3], slots[4])
+                : Median3(slots[0], slots[1], slots[2]);
+        }
+
+        if (settings.stages & EMA) {
+            __m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(value, zero));
+            __m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(value, zero));
+            __m128 lowAverage = _mm_loadu_ps(average + angle);
+            __m128 highAverage = _mm_loadu_ps(average + angle + 4);
+            lowAverage = _mm_add_ps(lowAverage, _mm_mul_ps(alpha, _mm_sub_ps(low, lowAverage)));
+            highAverage = _mm_add_ps(highAverage, _mm_mul_ps(alpha, _mm_sub_ps(high, highAverage)));
+            _mm_storeu_ps(average + angle, lowAverage);
+            _mm_storeu_ps(average + angle + 4, highAverage);
+            value = _mm_packs_epi32(_mm_cvttps_epi32(_mm_add_ps(lowAverage, half)), _mm_cvttps_epi32(_mm_add_ps(highAverage, half)));
+        }
+
+        _mm_storeu_si128((__m128i*)(distances + k), value);
+    }
+#endif
+    for (; k < count; ++k) {
+        distances[k] = Step(settings, first + k, distances[k], rejectedCount);
+    }
+}
+
+uint8_t NoiseFilter::Stages() const {
+    return stages;
+}
+
+void NoiseFilter::Stages(uint8_t value) {
+    stages = (uint8_t)(value & (OUTLIER | MEDIAN | EMA));
+    restart = true;
+}
+
+uint8_t NoiseFilter::Window() const {
+    return window;
+}
+
+void NoiseFilter::Window(uint8_t value) {
+    window = (uint8_t)(value >= 5 ? 5 : 3);
+    restart = true;
+}
+
+uint8_t NoiseFilter::Smoothing() const {
+    return smoothing;
+}
+
+void NoiseFilter::Smoothing(uint8_t value) {
+    smoothing = (uint8_t)(value < 1 ? 1 : value > 100 ? 100 : value);
+}
+
+uint16_t NoiseFilter::OutlierThreshold() const {
+    return outlierThreshold;
+}
+
+void NoiseFilter::OutlierThreshold(uint16_t value) {
+    outlierThreshold = Min(value, MAX_DISTANCE);
+}
+
+uint64_t NoiseFilter::Filtered() const {
+    return filtered.load(std::memory_order_relaxed);
+}
+
+uint64_t NoiseFilter::Rejected() const {
+    return rejected.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,116 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "sample.h"
+#include "sweep.h"
+
+/// <summary>
+/// Filtro de ruido por ángulo de un radar, entre la lectura del puerto serie y la publicación.
+/// El HC-SR04 da lecturas sueltas muy alejadas de las vecinas y el sketch devuelve maxDistance
+/// cuando pulseIn agota el tiempo, así que hay tres etapas que se activan por separado y se
+/// aplican en este orden:
+///   OUTLIER: una lectura que se aleja más de OutlierThreshold() de la última aceptada en ese
+///            ángulo se sustituye por ella; tras MAX_REJECTS rechazos seguidos se acepta (el
+///            cambio era real).
+///   MEDIAN:  mediana de las últimas Window() lecturas del ángulo (3 o 5).
+///   EMA:     media móvil exponencial con peso Smoothing() % para la lectura nueva.
+/// El estado son arrays contiguos indexados por ángulo. Las muestras de ángulos consecutivos
+/// (el servo avanza de grado en grado) se filtran juntas con SSE2, ocho ángulos por operación;
+/// el resultado es el mismo que muestra a muestra.
+/// Filter y Apply solo desde el hilo de red; la configuración y los contadores desde cualquier hilo.
+/// </summary>
+class NoiseFilter {
+public:
+    static const size_t ANGLES = SweepFrame::MAX_ANGLE + 1;
+    static const size_t MAX_WINDOW = 5;
+    static const uint16_t MAX_DISTANCE = 2047;       ///< Se recorta la entrada; el HC-SR04 no pasa de 400 cm.
+    static const uint8_t MAX_REJECTS = 2;            ///< Rechazos seguidos antes de aceptar un salto.
+    static const uint8_t DEFAULT_WINDOW = 3;
+    static const uint8_t DEFAULT_SMOOTHING = 30;
+    static const uint16_t DEFAULT_OUTLIER_CM = 15;
+    static const size_t MIN_RUN = 8;                 ///< Ángulos consecutivos a partir de los que se usa ApplyRun.
+
+    enum Stage : uint8_t {
+        NONE = 0,
+        OUTLIER = 1,
+        MEDIAN = 2,
+        EMA = 4
+    };
+
+    NoiseFilter();
+
+    /**
+     * @brief Filtra en su sitio la distancia de muestras de este radar, en el orden en que se leyeron.
+     *        Los tramos de al menos MIN_RUN ángulos consecutivos (en cualquier sentido) van por ApplyRun.
+     */
+    void Filter(RadarSample* samples, size_t count);
+
+    /**
+     * @brief Filtra una lectura y actualiza el estado de su ángulo. Los ángulos fuera de rango
+     *        se devuelven sin tocar.
+     */
+    uint16_t Apply(uint16_t angle, uint16_t distance);
+
+    /**
+     * @brief Filtra en su sitio una lectura por ángulo de first a first + count - 1, como si
+     *        se aplicaran una a una. Requiere first + count <= ANGLES.
+     */
+    void ApplyRun(uint16_t first, uint16_t* distances, size_t count);
+
+    /**
+     * @brief Propiedad de las etapas activas (combinación de Stage). Cambiarla reinicia el estado.
+     */
+    uint8_t Stages() const;
+    void Stages(uint8_t value);
+
+    /**
+     * @brief Propiedad del tamaño de la ventana de la mediana (3 o 5).
+     */
+    uint8_t Window() const;
+    void Window(uint8_t value);
+
+    /**
+     * @brief Propiedad del peso en % de la lectura nueva en la media exponencial (1-100).
+     */
+    uint8_t Smoothing() const;
+    void Smoothing(uint8_t value);
+
+    /**
+     * @brief Propiedad del salto en centímetros a partir del cual una lectura se rechaza.
+     */
+    uint16_t OutlierThreshold() const;
+    void OutlierThreshold(uint16_t value);
+
+    uint64_t Filtered() const;  ///< Muestras que pasaron por el filtro con alguna etapa activa.
+    uint64_t Rejected() const;  ///< Lecturas sustituidas por la etapa OUTLIER.
+
+private:
+    /// Configuración leída una vez por llamada.
+    struct Settings {
+        uint8_t stages;
+        uint8_t window;
+        float alpha;
+        uint16_t threshold;
+    };
+
+    Settings Current();
+    void Prime(size_t angle, uint16_t distance);
+    uint16_t Step(const Settings& settings, size_t angle, uint16_t distance, uint64_t& rejectedCount);
+    void Run(const Settings& settings, size_t first, uint16_t* distances, size_t count, uint64_t& rejectedCount);
+
+    alignas(16) uint16_t history[MAX_WINDOW][ANGLES];  ///< Últimas lecturas por ángulo, la más nueva en la posición Window() - 1.
+    alignas(16) float average[ANGLES];                 ///< Media exponencial por ángulo.
+    alignas(16) uint16_t reference[ANGLES];            ///< Última lectura aceptada por ángulo.
+    alignas(16) uint16_t rejects[ANGLES];              ///< Rechazos seguidos por ángulo.
+    uint8_t known[ANGLES];                             ///< 1 si el ángulo ya tiene estado.
+
+    std::atomic<uint8_t> stages;
+    std::atomic<uint8_t> window;
+    std::atomic<uint8_t> smoothing;
+    std::atomic<uint16_t> outlierThreshold;
+    std::atomic<bool> restart;                         ///< La configuración cambió; el hilo de red vacía el estado.
+    std::atomic<uint64_t> filtered;
+    std::atomic<uint64_t> rejected;
+};
@@ -0,0 +1,156 @@
+﻿#include "occupancy.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GRID_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GRID_NEON
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static_assert(OccupancyGrid::RANGE_BINS == 64, "dirty guarda una fila en un uint64_t");
+static_assert(OccupancyGrid::ANGLE_BINS <= 256, "los ángulos viajan en un byte");
+
+namespace {
+    // Posición del bit activo más bajo (bits != 0)
+    inline unsigned LowestBit(uint64_t bits) {
+#if defined(_MSC_VER) && defined(_WIN64)
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return (unsigned)index;
+#elif defined(__GNUC__)
+        return (unsigned)__builtin_ctzll(bits);
+#else
+        unsigned index = 0;
+        while (!(bits & 1)) {
+            bits >>= 1;
+            index++;
+        }
+        return index;
+#endif
+    }
+}
+
+OccupancyGrid::OccupancyGrid()
+    : lastTick(0), started(false), decay(DEFAULT_DECAY), maxRange(DEFAULT_MAX_RANGE), hits(0), ticks(0) {
+    memset(cells, 0, sizeof(cells));
+    memset(dirty, 0, sizeof(dirty));
+}
+
+void OccupancyGrid::Add(const RadarSample& sample) {
+    if (!started) {
+        lastTick = sample.timestamp;
+        started = true;
+    }
+
+    size_t range = sample.distance / CM_PER_BIN;
+    if (sample.angle >= ANGLE_BINS || range >= RANGE_BINS || sample.distance >= maxRange.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    cells[sample.angle * RANGE_BINS + range] = HIT;
+    dirty[sample.angle] |= 1ull << range;
+    hits.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool OccupancyGrid::TickDue(uint64_t now) const {
+    return started && now - lastTick >= (uint64_t)TICK_MS * 1000;
+}
+
+size_t OccupancyGrid::Tick(uint64_t now, GridCell* out, uint8_t& amount) {
+    const uint64_t period = (uint64_t)TICK_MS * 1000;
+    uint64_t elapsed = now > lastTick ? (now - lastTick) / period : 0;
+
+    // Tras una pausa larga basta con apagarlo todo; se conserva la cadencia si no
+    uint64_t total = elapsed * decay.load(std::memory_order_relaxed);
+    amount = (uint8_t)(total > 255 ? 255 : total);
+    lastTick = elapsed > 255 ? now : lastTick + elapsed * period;
+    if (amount > 0) {
+        Fade(cells, CELLS, amount);
+    }
+    ticks.fetch_add(elapsed, std::memory_order_relaxed);
+
+    size_t count = 0;
+    for (size_t angle = 0; angle < ANGLE_BINS; ++angle) {
+        uint64_t bits = dirty[angle];
+        if (bits == 0) {
+            continue;
+        }
+        dirty[angle] = 0;
+        const uint8_t* row = cells + angle * RANGE_BINS;
+        while (bits != 0) {
+            unsigned range = LowestBit(bits);
+            out[count++] = { (uint8_t)angle, (uint8_t)range, row[range] };
+            bits &= bits - 1;
+        }
+    }
+    return count;
+}
+
+size_t OccupancyGrid::Snapshot(GridCell* out) const {
+    size_t count = 0;
+    for (size_t angle = 0; angle < ANGLE_BINS; ++angle) {
+        const uint8_t* row = cells + angle * RANGE_BINS;
+        for (size_t range = 0; range < RANGE_BINS; ++range) {
+            if (row[range] != 0) {
+                out[count++] = { (uint8_t)angle, (uint8_t)range, row[range] };
+            }
+        }
+    }
+    return count;
+}
+
+uint8_t OccupancyGrid::Cell(size_t angle, size_t range) const {
+    return angle < ANGLE_BINS && range < RANGE_BINS ? cells[angle * RANGE_BINS + range] : 0;
+}
+
+void OccupancyGrid::Fade(uint8_t* cells, size_t count, uint8_t amount) {
+    size_t i = 0;
+#if defined(GRID_SSE2)
+    // Cuatro registros por vuelta: una fila de la rejilla
+    const __m128i step = _mm_set1_epi8((char)amount);
+    for (; i + 64 <= count; i += 64) {
+        __m128i* block = (__m128i*)(cells + i);
+        _mm_storeu_si128(block, _mm_subs_epu8(_mm_loadu_si128(block), step));
+        _mm_storeu_si128(block + 1, _mm_subs_epu8(_mm_loadu_si128(block + 1), step));
+        _mm_storeu_si128(block + 2, _mm_subs_epu8(_mm_loadu_si128(block + 2), step));
+        _mm_storeu_si128(block + 3, _mm_subs_epu8(_mm_loadu_si128(block + 3), step));
+    }
+#elif defined(GRID_NEON)
+    const uint8x16_t step = vdupq_n_u8(amount);
+    for (; i + 16 <= count; i += 16) {
+        vst1q_u8(cells + i, vqsubq_u8(vld1q_u8(cells + i), step));
+    }
+#endif
+    for (; i < count; ++i) {
+        cells[i] = (uint8_t)(cells[i] > amount ? cells[i] - amount : 0);
+    }
+}
+
+uint8_t OccupancyGrid::Decay() const {
+    return decay;
+}
+
+void OccupancyGrid::Decay(uint8_t value) {
+    decay = value;
+}
+
+uint16_t OccupancyGrid::MaxRange() const {
+    return maxRange;
+}
+
+void OccupancyGrid::MaxRange(uint16_t value) {
+    maxRange = value;
+}
+
+uint64_t OccupancyGrid::Hits() const {
+    return hits.load(std::memory_order_relaxed);
+}
+
+uint64_t OccupancyGrid::Ticks() const {
+    return ticks.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "sample.h"
+#include "sweep.h"
+
+/// Celda de la rejilla con su valor (el índice de ángulo es el grado; el de distancia, el centímetro).
+struct GridCell {
+    uint8_t angle;
+    uint8_t range;
+    uint8_t value;
+};
+
+/// <summary>
+/// Rejilla polar de ocupación de un radar: una fila por grado y una celda por centímetro,
+/// con la intensidad del último eco (HIT al recibirlo). Cada TICK_MS todas las celdas pierden
+/// Decay() de intensidad, así que los ecos viejos se van apagando como las líneas que la app
+/// dibuja con transparencia. Las filas ocupan RANGE_BINS bytes contiguos y alineados (una
+/// línea de caché), de modo que el envejecimiento es una resta con saturación vectorizada
+/// sobre un único bloque de memoria.
+/// Add, TickDue, Tick y Snapshot solo desde el hilo de red; la configuración y los contadores
+/// se pueden usar desde cualquier hilo.
+/// </summary>
+class OccupancyGrid {
+public:
+    static const size_t ANGLE_BINS = SweepFrame::MAX_ANGLE + 1;
+    static const size_t RANGE_BINS = 64;             ///< 0-63 cm; el sketch no pasa de maxDistance (50 cm).
+    static const size_t CELLS = ANGLE_BINS * RANGE_BINS;
+    static const uint8_t CM_PER_BIN = 1;
+    static const uint8_t HIT = 255;                  ///< Intensidad de una celda con eco nuevo.
+    static const uint32_t TICK_MS = 100;             ///< Periodo del envejecimiento.
+    static const uint8_t DEFAULT_DECAY = 8;          ///< Un eco se apaga en unos 3 s.
+    static const uint16_t DEFAULT_MAX_RANGE = 50;    ///< Distancia que el sketch devuelve sin eco.
+
+    OccupancyGrid();
+
+    /**
+     * @brief Marca el eco de la muestra. Las muestras sin eco (distancia >= MaxRange) o fuera
+     *        de la rejilla no cambian nada.
+     */
+    void Add(const RadarSample& sample);
+
+    /**
+     * @brief Indica si ha pasado al menos un TICK_MS desde el último envejecimiento.
+     * @param now Instante de la última muestra (microsegundos, como RadarSample::timestamp).
+     */
+    bool TickDue(uint64_t now) const;
+
+    /**
+     * @brief Envejece toda la rejilla por los periodos transcurridos y devuelve las celdas
+     *        que recibieron ecos desde el anterior, con su valor ya envejecido.
+     * @param out Buffer de al menos CELLS celdas.
+     * @param amount Recibe lo que se restó a todas las celdas. Un cliente que aplique primero
+     *        esa resta y después las celdas devueltas queda igual que la rejilla.
+     * @return Número de celdas devueltas.
+     */
+    size_t Tick(uint64_t now, GridCell* out, uint8_t& amount);
+
+    /**
+     * @brief Copia las celdas con intensidad distinta de 0.
+     * @param out Buffer de al menos CELLS celdas.
+     * @return Número de celdas copiadas.
+     */
+    size_t Snapshot(GridCell* out) const;
+
+    /**
+     * @brief Intensidad de una celda; solo desde el hilo de red.
+     */
+    uint8_t Cell(size_t angle, size_t range) const;
+
+    /**
+     * @brief Resta amount a count celdas sin bajar de 0 (SSE2 o NEON si están disponibles).
+     */
+    static void Fade(uint8_t* cells, size_t count, uint8_t amount);
+
+    /**
+     * @brief Propiedad de la intensidad que pierde cada celda por periodo.
+     */
+    uint8_t Decay() const;
+    void Decay(uint8_t value);
+
+    /**
+     * @brief Propiedad de la distancia a partir de la cual una muestra se considera sin eco.
+     */
+    uint16_t MaxRange() const;
+    void MaxRange(uint16_t value);
+
+    uint64_t Hits() const;   ///< Muestras con eco marcadas en la rejilla.
+    uint64_t Ticks() const;  ///< Periodos de envejecimiento aplicados.
+
+private:
+    alignas(64) uint8_t cells[CELLS];  ///< Fila por ángulo, RANGE_BINS celdas por fila.
+    uint64_t dirty[ANGLE_BINS];        ///< Un bit por celda de la fila con ecos desde el último Tick.
+    uint64_t lastTick;
+    bool started;
+
+    std::atomic<uint8_t> decay;
+    std::atomic<uint16_t> maxRange;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> ticks;
+};
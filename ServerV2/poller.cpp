@@ -0,0 +1,219 @@
+﻿#include "poller.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+
+Poller::Poller() : wakeupSocket(INVALID_SOCKET) {}
+
+Poller::~Poller() {
+    Close();
+}
+
+bool Poller::Open() {
+    // Socket UDP local conectado a sí mismo: Wakeup() se envía un byte y WSAPoll lo detecta.
+    wakeupSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (wakeupSocket == INVALID_SOCKET) {
+        return false;
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    int addrLen = sizeof(addr);
+
+    if (bind(wakeupSocket, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        getsockname(wakeupSocket, (sockaddr*)&addr, &addrLen) == SOCKET_ERROR ||
+        connect(wakeupSocket, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        !net::SetNonBlocking(wakeupSocket)) {
+        Close();
+        return false;
+    }
+
+    return Add(wakeupSocket, READ, WAKEUP_TAG);
+}
+
+void Poller::Close() {
+    if (wakeupSocket != INVALID_SOCKET) {
+        closesocket(wakeupSocket);
+        wakeupSocket = INVALID_SOCKET;
+    }
+    fds.clear();
+    tags.clear();
+}
+
+bool Poller::Add(SOCKET socket, unsigned events, uint64_t tag) {
+    WSAPOLLFD fd = {};
+    fd.fd = socket;
+    fd.events = (SHORT)(((events & READ) ? POLLRDNORM : 0) | ((events & WRITE) ? POLLWRNORM : 0));
+    fds.push_back(fd);
+    tags.push_back(tag);
+    return true;
+}
+
+bool Poller::Modify(SOCKET socket, unsigned events, uint64_t tag) {
+    for (size_t i = 0; i < fds.size(); ++i) {
+        if (fds[i].fd == socket) {
+            fds[i].events = (SHORT)(((events & READ) ? POLLRDNORM : 0) | ((events & WRITE) ? POLLWRNORM : 0));
+            tags[i] = tag;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Poller::Remove(SOCKET socket) {
+    for (size_t i = 0; i < fds.size(); ++i) {
+        if (fds[i].fd == socket) {
+            fds[i] = fds.back();
+            tags[i] = tags.back();
+            fds.pop_back();
+            tags.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+int Poller::Wait(std::vector<PollEvent>& out, int timeoutMs) {
+    out.clear();
+
+    int ready = WSAPoll(fds.data(), (ULONG)fds.size(), timeoutMs);
+    if (ready == SOCKET_ERROR) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < fds.size() && (int)out.size() < ready; ++i) {
+        SHORT revents = fds[i].revents;
+        if (revents == 0) {
+            continue;
+        }
+
+        if (tags[i] == WAKEUP_TAG) {
+            DrainWakeup();
+        }
+
+        unsigned events = 0;
+        if (revents & POLLRDNORM) events |= READ;
+        if (revents & POLLWRNORM) events |= WRITE;
+        if (revents & (POLLHUP | POLLERR | POLLNVAL)) events |= HANGUP;
+        out.push_back({ tags[i], events });
+    }
+
+    return (int)out.size();
+}
+
+void Poller::Wakeup() {
+    char byte = 1;
+    send(wakeupSocket, &byte, 1, 0);
+}
+
+void Poller::DrainWakeup() {
+    char buffer[64];
+    while (recv(wakeupSocket, buffer, sizeof(buffer), 0) > 0) {
+    }
+}
+
+#else
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace {
+    uint32_t ToEpoll(unsigned events) {
+        uint32_t result = EPOLLRDHUP;
+        if (events & Poller::READ) result |= EPOLLIN;
+        if (events & Poller::WRITE) result |= EPOLLOUT;
+        return result;
+    }
+}
+
+Poller::Poller() : epollFd(-1), wakeupFd(-1) {}
+
+Poller::~Poller() {
+    Close();
+}
+
+bool Poller::Open() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        return false;
+    }
+
+    wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeupFd < 0) {
+        Close();
+        return false;
+    }
+
+    return Add(wakeupFd, READ, WAKEUP_TAG);
+}
+
+void Poller::Close() {
+    if (wakeupFd >= 0) {
+        close(wakeupFd);
+        wakeupFd = -1;
+    }
+    if (epollFd >= 0) {
+        close(epollFd);
+        epollFd = -1;
+    }
+}
+
+bool Poller::Add(SOCKET socket, unsigned events, uint64_t tag) {
+    epoll_event ev = {};
+    ev.events = ToEpoll(events);
+    ev.data.u64 = tag;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &ev) == 0;
+}
+
+bool Poller::Modify(SOCKET socket, unsigned events, uint64_t tag) {
+    epoll_event ev = {};
+    ev.events = ToEpoll(events);
+    ev.data.u64 = tag;
+    return epoll_ctl(epollFd, EPOLL_CTL_MOD, socket, &ev) == 0;
+}
+
+bool Poller::Remove(SOCKET socket) {
+    return epoll_ctl(epollFd, EPOLL_CTL_DEL, socket, nullptr) == 0;
+}
+
+int Poller::Wait(std::vector<PollEvent>& out, int timeoutMs) {
+    const int maxEvents = 256;
+    buffer.resize(maxEvents * sizeof(epoll_event));
+    epoll_event* events = reinterpret_cast<epoll_event*>(buffer.data());
+
+    out.clear();
+
+    int ready = epoll_wait(epollFd, events, maxEvents, timeoutMs);
+    if (ready < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    for (int i = 0; i < ready; ++i) {
+        if (events[i].data.u64 == WAKEUP_TAG) {
+            DrainWakeup();
+        }
+
+        unsigned flags = 0;
+        if (events[i].events & EPOLLIN) flags |= READ;
+        if (events[i].events & EPOLLOUT) flags |= WRITE;
+        if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) flags |= HANGUP;
+        out.push_back({ events[i].data.u64, flags });
+    }
+
+    return ready;
+}
+
+void Poller::Wakeup() {
+    uint64_t one = 1;
+    ssize_t written = write(wakeupFd, &one, sizeof(one));
+    (void)written;
+}
+
+void Poller::DrainWakeup() {
+    uint64_t value;
+    ssize_t result = read(wakeupFd, &value, sizeof(value));
+    (void)result;
+}
+
+#endif
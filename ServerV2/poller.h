@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "network.h"
+
+/// <summary>
+/// Multiplexor de eventos de sockets. En Linux usa epoll; en Windows usa WSAPoll.
+/// Incluye un mecanismo de despertar (eventfd / socket UDP local) para que otros
+/// hilos puedan interrumpir la espera del bucle de eventos.
+/// </summary>
+class Poller {
+public:
+    /// Eventos que se pueden solicitar y que se reportan en PollEvent::events.
+    enum Events : unsigned {
+        READ = 1u << 0,   ///< Hay datos para leer (o una conexión pendiente en el socket de escucha).
+        WRITE = 1u << 1,  ///< El socket acepta más datos para enviar.
+        HANGUP = 1u << 2, ///< El otro extremo cerró la conexión o hubo un error.
+    };
+
+    /// Etiqueta reservada para los eventos de despertar.
+    static const uint64_t WAKEUP_TAG = ~0ull;
+
+    struct PollEvent {
+        uint64_t tag;    ///< Etiqueta asociada al socket al registrarlo.
+        unsigned events; ///< Combinación de valores de Events.
+    };
+
+    Poller();
+    ~Poller();
+
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+
+    /**
+     * @brief Crea el descriptor del multiplexor y el canal de despertar.
+     * @return true si se pudo inicializar.
+     */
+    bool Open();
+
+    /**
+     * @brief Libera el multiplexor y el canal de despertar.
+     */
+    void Close();
+
+    /**
+     * @brief Registra un socket con los eventos indicados.
+     * @param socket Socket a vigilar.
+     * @param events Combinación de READ y WRITE.
+     * @param tag Valor que se devolverá en cada evento de este socket.
+     */
+    bool Add(SOCKET socket, unsigned events, uint64_t tag);
+
+    /**
+     * @brief Cambia los eventos (y la etiqueta) de un socket ya registrado.
+     */
+    bool Modify(SOCKET socket, unsigned events, uint64_t tag);
+
+    /**
+     * @brief Deja de vigilar un socket.
+     */
+    bool Remove(SOCKET socket);
+
+    /**
+     * @brief Espera eventos.
+     * @param out Vector donde se devuelven los eventos (se limpia en cada llamada).
+     * @param timeoutMs Tiempo máximo de espera; -1 espera indefinidamente.
+     * @return Número de eventos, o -1 si ocurrió un error.
+     */
+    int Wait(std::vector<PollEvent>& out, int timeoutMs);
+
+    /**
+     * @brief Despierta al hilo bloqueado en Wait. Se puede llamar desde cualquier hilo.
+     */
+    void Wakeup();
+
+private:
+    void DrainWakeup();
+
+#if defined(_WIN32) || defined(_WIN64)
+    std::vector<WSAPOLLFD> fds;  ///< Sockets registrados para WSAPoll.
+    std::vector<uint64_t> tags;  ///< Etiquetas paralelas a fds.
+    SOCKET wakeupSocket;         ///< Socket UDP conectado a sí mismo para despertar.
+#else
+    int epollFd;                 ///< Descriptor de epoll.
+    int wakeupFd;                ///< eventfd usado para despertar.
+    std::vector<uint8_t> buffer; ///< Buffer reutilizado para epoll_wait.
+#endif
+};
@@ -1,13 +1,235 @@
 #include "protocol.h"
+#if defined(_WIN32) || defined(_WIN64)
 #pragma comment(lib, "Ws2_32.lib")
+#endif
 
-Protocol::Protocol(const std::string& host, int port, Handler* arduinoHandler, int maxConnections, Logger* logger, bool debug)
-    : arduinoHandler(arduinoHandler), maxConnections(maxConnections), logger(logger), debug(debug), isRunning(false) {
+namespace {
+    /**
+     * @brief Comprueba si data empieza por la lnea indicada, terminada en "\n" o "\r\n".
+     * @return Bytes que ocupa la lnea, o 0 si no coincide.
+     */
+    size_t MatchLine(const char* data, size_t length, const std::string& line) {
+        if (length < line.size() || line.compare(0, line.size(), data, line.size()) != 0) {
+            return 0;
+        }
+
+        size_t position = line.size();
+        if (position < length && data[position] == '\r') {
+            position++;
+        }
+        if (position == length || data[position] != '\n') {
+            return 0;
+        }
+        return position + 1;
+    }
+
+    /**
+     * @brief Comprueba si data empieza por una orden con argumentos, completa y que empieza por prefix.
+     * @param argument Recibe lo que sigue a prefix, sin el "\n" ni el "\r" final.
+     * @return Bytes que ocupa la lnea, o 0 si data no empieza por prefix o est incompleta.
+     */
+    size_t MatchCommand(const char* data, size_t length, const std::string& prefix, std::string& argument) {
+        if (length < prefix.size() || prefix.compare(0, prefix.size(), data, prefix.size()) != 0) {
+            return 0;
+        }
+
+        size_t end = prefix.size();
+        while (end < length && data[end] != '\n') {
+            end++;
+        }
+        if (end == length) {
+            return 0;
+        }
+        argument.assign(data + prefix.size(), end - prefix.size());
+        if (!argument.empty() && argument.back() == '\r') {
+            argument.pop_back();
+        }
+        return end + 1;
+    }
+
+    /// Comienzos de las lneas de control: lo que empieza as se guarda hasta que llega su salto de lnea.
+    const char* const COMMANDS[] = { "PROTO BIN/", "MODE ", "GRID", "OBJECTS ", "RATE ", "SECTOR ", "SUBSCRIBE ",
+        "HISTORY ", "SNAPSHOT" };
+
+    /**
+     * @brief Indica si una lnea sin terminar puede ser (o ser el principio de) una lnea de control.
+     */
+    bool IsCommandStart(const char* data, size_t length) {
+        for (const char* command : COMMANDS) {
+            size_t common = std::min(length, strlen(command));
+            if (memcmp(data, command, common) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Reconoce la lnea "SUBSCRIBE ALL" o "SUBSCRIBE 0,2,5" al principio de data.
+     * @param devices Recibe los radares pedidos (un bit por radar); con ALL, all.
+     * @param valid Recibe false si la lista no se entiende o nombra radares que no existen.
+     * @return Bytes que ocupa la lnea, o 0 si data no empieza por "SUBSCRIBE " o est incompleta.
+     */
+    size_t ParseSubscribe(const char* data, size_t length, uint32_t all, size_t deviceCount, uint32_t& devices, bool& valid) {
+        std::string list;
+        size_t used = MatchCommand(data, length, "SUBSCRIBE ", list);
+        if (used == 0) {
+            return 0;
+        }
+
+        devices = 0;
+        valid = true;
+        if (list == "ALL") {
+            devices = all;
+        }
+        else {
+            size_t start = 0;
+            while (valid && start <= list.size()) {
+                size_t comma = list.find(',', start);
+                std::string item = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+                valid = !item.empty() && item.size() <= 2 && item.find_first_not_of("0123456789") == std::string::npos &&
+                    (size_t)std::stoi(item) < deviceCount;
+                if (valid) {
+                    devices |= 1u << std::stoi(item);
+                }
+                start = comma == std::string::npos ? list.size() + 1 : comma + 1;
+            }
+        }
+        return used;
+    }
+
+    /**
+     * @brief Reconoce la lnea "RATE OFF", "RATE 5", "RATE 5 LATEST" o "RATE 5 NEAREST" al principio de data.
+     * @param rate Recibe las entregas por segundo pedidas; 0 con OFF.
+     * @param nearest Recibe true con NEAREST.
+     * @param valid Recibe false si la lnea no se entiende o la tasa est fuera de 1-maxRate.
+     * @return Bytes que ocupa la lnea, o 0 si data no empieza por "RATE " o est incompleta.
+     */
+    size_t ParseRate(const char* data, size_t length, uint32_t maxRate, uint32_t& rate, bool& nearest, bool& valid) {
+        std::string line;
+        size_t used = MatchCommand(data, length, "RATE ", line);
+        if (used == 0) {
+            return 0;
+        }
+
+        rate = 0;
+        nearest = false;
+        valid = true;
+        if (line != "OFF") {
+            size_t space = line.find(' ');
+            std::string number = line.substr(0, space);
+            std::string mode = space == std::string::npos ? "" : line.substr(space + 1);
+            valid = !number.empty() && number.size() <= 4 && number.find_first_not_of("0123456789") == std::string::npos &&
+                (mode.empty() || mode == "LATEST" || mode == "NEAREST");
+            if (valid) {
+                rate = (uint32_t)std::stoul(number);
+                nearest = mode == "NEAREST";
+                valid = rate >= 1 && rate <= maxRate;
+            }
+        }
+        return used;
+    }
+
+    /**
+     * @brief Reconoce la lnea "SECTOR OFF" o "SECTOR 30-90,120-150/0-200" al principio de data:
+     *        intervalos de ngulos separados por comas, cada uno con una banda de distancias opcional.
+     * @param sectors Recibe los sectores pedidos; vaco con OFF.
+     * @param valid Recibe false si la lnea no se entiende, hay ms de maxSectors o algn intervalo est
+     *        fuera de rango o al revs.
+     * @return Bytes que ocupa la lnea, o 0 si data no empieza por "SECTOR " o est incompleta.
+     */
+    size_t ParseSectors(const char* data, size_t length, size_t maxSectors, std::vector<Sector>& sectors, bool& valid) {
+        std::string list;
+        size_t used = MatchCommand(data, length, "SECTOR ", list);
+        if (used == 0) {
+            return 0;
+        }
+
+        sectors.clear();
+        valid = true;
+        if (list != "OFF") {
+            size_t start = 0;
+            while (valid && start <= list.size()) {
+                size_t comma = list.find(',', start);
+                std::string item = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+                size_t slash = item.find('/');
+                Sector sector = { 0, 0, 0, Sector::MAX_DISTANCE };
+                valid = sectors.size() < maxSectors &&
+                    Sector::ParseRange(item.substr(0, slash), SweepFrame::MAX_ANGLE, sector.minAngle, sector.maxAngle) &&
+                    (slash == std::string::npos ||
+                        Sector::ParseRange(item.substr(slash + 1), Sector::MAX_DISTANCE, sector.minDistance, sector.maxDistance));
+                if (valid) {
+                    sectors.push_back(sector);
+                }
+                start = comma == std::string::npos ? list.size() + 1 : comma + 1;
+            }
+        }
+        return used;
+    }
+
+    std::string SectorList(const std::vector<Sector>& sectors) {
+        std::string list;
+        for (const Sector& sector : sectors) {
+            list += (list.empty() ? "" : ",") + std::to_string(sector.minAngle) + "-" + std::to_string(sector.maxAngle);
+            if (sector.minDistance != 0 || sector.maxDistance != Sector::MAX_DISTANCE) {
+                list += "/" + std::to_string(sector.minDistance) + "-" + std::to_string(sector.maxDistance);
+            }
+        }
+        return list;
+    }
+
+    /**
+     * @brief Reconoce la lnea "HISTORY desde hasta [a-b[/d1-d2]]" (o "HISTORY MINUTES ..." y
+     *        "HISTORY HOURS ...") al principio de data.
+     * @param valid Recibe false si la peticin no se entiende (ver history::ParseRequest).
+     * @return Bytes que ocupa la lnea, o 0 si data no empieza por "HISTORY " o est incompleta.
+     */
+    size_t ParseHistory(const char* data, size_t length, history::Level& level, history::Query& query, bool& valid) {
+        std::string request;
+        size_t used = MatchCommand(data, length, "HISTORY ", request);
+        if (used == 0) {
+            return 0;
+        }
+        valid = history::ParseRequest(request, level, query);
+        return used;
+    }
+
+    uint64_t WallClockMicros() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    std::string DeviceList(uint32_t devices) {
+        std::string list;
+        for (int device = 0; device < 32; ++device) {
+            if (devices & (1u << device)) {
+                list += (list.empty() ? "" : ",") + std::to_string(device);
+            }
+        }
+        return list;
+    }
+}
+
+Protocol::Protocol(const std::string& host, int port, const std::vector<SampleSource*>& sources, int maxConnections, Logger* logger,
+    bool debug, SendQueue::Policy slowClientPolicy, MetricsRegistry* metrics)
+    : serverSocket(INVALID_SOCKET), isRunning(false), startMicros(0), network(logger, maxConnections, slowClientPolicy), wrapNext(0),
+      wallStart(0), metrics(metrics),
+      maxConnections(maxConnections), logger(logger), debug(debug) {
 
     this->port = std::to_string(port);
 
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+    for (size_t i = 0; i < sources.size() && i < MAX_DEVICES; ++i) {
+        std::unique_ptr<Device> device(new Device());
+        device->id = (uint16_t)i;
+        device->source = sources[i];
+        devices.push_back(std::move(device));
+    }
+    gridCells.resize(OccupancyGrid::CELLS);
+    if (sources.size() > MAX_DEVICES) {
+        logger->Log("Solo se admiten " + std::to_string(MAX_DEVICES) + " radares; se ignoran los dems.", Logger::WARNING);
+    }
+
+    if (!net::Startup()) {
         logger->Log("Error al iniciar Winsock.", Logger::ERROR_LOG);
         return;
     }
@@ -16,7 +238,7 @@ Protocol::Protocol(const std::string& host, int port, Handler* arduinoHandler, i
     serverSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (serverSocket == INVALID_SOCKET) {
         logger->Log("Error al crear el socket del servidor.", Logger::ERROR_LOG);
-        WSACleanup();
+        net::Cleanup();
         return;
     }
 
@@ -26,17 +248,25 @@ Protocol::Protocol(const std::string& host, int port, Handler* arduinoHandler, i
     if (inet_pton(AF_INET, host.c_str(), &servAddr.sin_addr) <= 0) {
         logger->Log("Error al convertir la direccin IP.", Logger::ERROR_LOG);
         closesocket(serverSocket);
-        WSACleanup();
+        serverSocket = INVALID_SOCKET;
+        net::Cleanup();
         return;
     }
 
     servAddr.sin_port = htons(port);
 
+#if !defined(_WIN32) && !defined(_WIN64)
+    // Permite reiniciar el servidor sin esperar a que expire TIME_WAIT.
+    int reuse = 1;
+    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
     // Vincula el socket
     if (bind(serverSocket, (sockaddr*)&servAddr, sizeof(servAddr)) == SOCKET_ERROR) {
         logger->Log("Error al vincular el socket del servidor.", Logger::ERROR_LOG);
         closesocket(serverSocket);
-        WSACleanup();
+        serverSocket = INVALID_SOCKET;
+        net::Cleanup();
         return;
     }
 
@@ -44,7 +274,8 @@ Protocol::Protocol(const std::string& host, int port, Handler* arduinoHandler, i
     if (listen(serverSocket, SOMAXCONN) == SOCKET_ERROR) {
         logger->Log("Error al iniciar la escucha en el socket del servidor.", Logger::ERROR_LOG);
         closesocket(serverSocket);
-        WSACleanup();
+        serverSocket = INVALID_SOCKET;
+        net::Cleanup();
         return;
     }
 }
@@ -57,16 +288,172 @@ void Protocol::Debug(bool value) {
     debug = value;
 }
 
+std::shared_ptr<const std::vector<EventLoop::ClientInfo>> Protocol::Clients() const {
+    return network.Clients();
+}
+
+size_t Protocol::QueuedSamples() const {
+    size_t queued = 0;
+    for (const auto& device : devices) {
+        queued += device->samples.Size();
+    }
+    return queued;
+}
+
+size_t Protocol::PeakQueuedSamples() const {
+    size_t peak = 0;
+    for (const auto& device : devices) {
+        if (device->samples.Peak() > peak) {
+            peak = device->samples.Peak();
+        }
+    }
+    return peak;
+}
+
+uint64_t Protocol::DroppedSamples() const {
+    uint64_t dropped = 0;
+    for (const auto& device : devices) {
+        dropped += device->samples.Overruns();
+    }
+    return dropped;
+}
+
+size_t Protocol::DeviceCount() const {
+    return devices.size();
+}
+
+uint32_t Protocol::Subscription(EventLoop::Channel channel) {
+    return (uint32_t)(channel >> SUBSCRIPTION_SHIFT);
+}
+
+bool Protocol::Includes(EventLoop::Channel channel, uint16_t device) {
+    uint32_t subscription = Subscription(channel);
+    return subscription == 0 ? device == 0 : (subscription >> device) & 1;
+}
+
+uint32_t Protocol::Rate(EventLoop::Channel channel) {
+    return (uint32_t)((channel & RATE_BITS) >> RATE_SHIFT);
+}
+
+uint32_t Protocol::View(EventLoop::Channel channel) {
+    return (uint32_t)((channel & VIEW_BITS) >> VIEW_SHIFT);
+}
+
+bool Protocol::LastSweep(SweepFrame& sweep, size_t device) const {
+    return device < devices.size() && devices[device]->sweeps.Copy(sweep);
+}
+
+NoiseFilter& Protocol::Noise(size_t device) {
+    return devices[device < devices.size() ? device : 0]->noise;
+}
+
+DeltaFilter& Protocol::Delta(size_t device) {
+    return devices[device < devices.size() ? device : 0]->delta;
+}
+
+OccupancyGrid& Protocol::Grid(size_t device) {
+    return devices[device < devices.size() ? device : 0]->grid;
+}
+
+ObjectTracker& Protocol::Tracker(size_t device) {
+    return devices[device < devices.size() ? device : 0]->tracker;
+}
+
+const HistoryStore& Protocol::Archive() const {
+    return archive;
+}
+
+bool Protocol::Capture(const std::string& path) {
+    if (isRunning) {
+        logger->Log("La captura debe configurarse antes de iniciar el servidor.", Logger::WARNING);
+        return false;
+    }
+    if (!capture.Open(path)) {
+        logger->Log("No se pudo crear el archivo de captura " + path + ".", Logger::ERROR_LOG);
+        return false;
+    }
+
+    logger->Log("Grabando las muestras en " + path + ".", Logger::INFO);
+    return true;
+}
+
+bool Protocol::Multicast(const std::string& host, int port, int ttl) {
+    if (isRunning) {
+        logger->Log("La salida UDP debe configurarse antes de iniciar el servidor.", Logger::WARNING);
+        return false;
+    }
+    if (!udpOutput.Open(host, port, ttl)) {
+        logger->Log("No se pudo abrir la salida UDP hacia " + host + ":" + std::to_string(port) + ".", Logger::ERROR_LOG);
+        return false;
+    }
+
+    logger->Log("Enviando las muestras por UDP a " + udpOutput.Address() + (multicast::IsMulticast(host) ?
+        " (multicast, TTL " + std::to_string(ttl) + ")." : "."), Logger::INFO);
+    return true;
+}
+
+bool Protocol::History(const std::string& directory) {
+    if (isRunning) {
+        logger->Log("El histrico debe configurarse antes de iniciar el servidor.", Logger::WARNING);
+        return false;
+    }
+    if (!archive.Open(directory)) {
+        logger->Log("No se pudo abrir el histrico en " + directory + ".", Logger::ERROR_LOG);
+        return false;
+    }
+
+    logger->Log("Guardando el histrico en " + directory + " (" + std::to_string(archive.Samples()) + " muestras en " +
+        std::to_string(archive.ChunkCount()) + " bloques).", Logger::INFO);
+    return true;
+}
+
 bool Protocol::Start() {
     if (isRunning) {
         logger->Log("El servidor ya est en ejecucin.", Logger::WARNING);
         return false;
     }
 
+    if (serverSocket == INVALID_SOCKET) {
+        logger->Log("El socket del servidor no est disponible. El servidor no se iniciar.", Logger::ERROR_LOG);
+        return false;
+    }
+
+    if (devices.empty()) {
+        logger->Log("No hay ningn radar configurado. El servidor no se iniciar.", Logger::ERROR_LOG);
+        return false;
+    }
+
     isRunning = true;
 
-    if (!arduinoHandler->Start()) {
-        logger->Log("No se pudo establecer conexin con el Arduino. El servidor no se iniciar.", Logger::ERROR_LOG);
+    for (size_t i = 0; i < devices.size(); ++i) {
+        if (!devices[i]->source->Start()) {
+            logger->Log("No se pudo iniciar el origen de muestras del radar " + std::to_string(i) +
+                " (Arduino o captura). El servidor no se iniciar.", Logger::ERROR_LOG);
+            while (i-- > 0) {
+                devices[i]->source->Stop();
+            }
+            isRunning = false;
+            return false;
+        }
+    }
+
+    // Un nico hilo de red atiende la aceptacin, lectura y envo a todos los clientes
+    network.OnData([this](EventLoop::ClientId client, const char* data, size_t length) {
+        HandleClient(client, data, length);
+    });
+    network.OnWakeup([this]() {
+        PublishSamples();
+    });
+    network.OnAccept([this](EventLoop::ClientId client) {
+        AcceptClient(client);
+    });
+    network.OnClose([this](EventLoop::ClientId client) {
+        CloseClient(client);
+    });
+    if (!network.Start(serverSocket)) {
+        for (auto& device : devices) {
+            device->source->Stop();
+        }
         isRunning = false;
         return false;
     }
@@ -74,84 +461,1143 @@ bool Protocol::Start() {
     logger->Log("Servidor TCP ejecutandose en " + color::BRIGHT_YELLOW + GetLocalIPAddress() + ":" +
         port + color::RESET + ", esperando conexiones...", Logger::INFO);
 
-    // Inicia hilos para aceptar clientes y leer datos de Arduino
-    std::thread(&Protocol::AcceptClients, this).detach();
-    std::thread(&Protocol::ReadAndBroadcastArduinoData, this).detach();
+    RegisterMetrics();
+
+    // Un hilo lector por radar; solo leen y encolan, la red va en su propio hilo
+    startMicros = MonotonicMicros();
+    wallStart = WallClockMicros();
+    for (auto& device : devices) {
+        device->reader = std::thread(&Protocol::ReadSamples, this, std::ref(*device));
+    }
+    if (devices.size() > 1) {
+        logger->Log("Leyendo de " + std::to_string(devices.size()) + " radares.", Logger::INFO);
+    }
 
     return true;
 }
 
 void Protocol::Stop() {
     isRunning = false;
+    if (metrics != nullptr) {
+        metrics->Remove(this);
+    }
+
+    for (auto& device : devices) {
+        if (device->reader.joinable()) {
+            device->reader.join();
+        }
+    }
 
-    for (SOCKET client : clients) {
-        closesocket(client);
+    // El hilo de consultas del histrico despierta al bucle al terminar cada respuesta, as que
+    // se detiene antes que l
+    if (archive.IsOpen()) {
+        archive.Close();
+        logger->Log("Histrico cerrado: " + std::to_string(archive.Samples()) + " muestras en " +
+            std::to_string(archive.ChunkCount()) + " bloques" + (archive.Dropped().Value() > 0 ? ", " +
+            std::to_string(archive.Dropped().Value()) + " descartadas." : std::string(".")), Logger::INFO);
+    }
+    network.Stop();
+    {
+        std::lock_guard<std::mutex> lock(historyMutex);
+        historyReplies.clear();
+    }
+    webSockets.clear();
+    lines.clear();
+    newcomers.clear();
+    snapshots.clear();
+    webSocketCount.Set(0);
+    for (auto& pair : wrapCache) {
+        pair = {};
+    }
+    for (auto& device : devices) {
+        device->source->Stop();
+    }
+    if (DroppedSamples() > 0) {
+        logger->Log("Muestras descartadas por cola llena: " + std::to_string(DroppedSamples()), Logger::WARNING);
+    }
+    if (capture.IsOpen()) {
+        capture.Close();
+        logger->Log("Captura guardada en " + capture.Path() + ": " + std::to_string(capture.Samples()) + " muestras.", Logger::INFO);
+    }
+    if (udpOutput.IsOpen()) {
+        udpOutput.Close();
+        logger->Log("Salida UDP cerrada: " + std::to_string(udpOutput.Datagrams().Value()) + " datagramas, " +
+            std::to_string(udpOutput.Errors().Value()) + " descartados.", Logger::INFO);
     }
-    arduinoHandler->Stop();
     closesocket(serverSocket);
-    WSACleanup();
+    serverSocket = INVALID_SOCKET;
+    net::Cleanup();
     logger->Log("Servidor TCP detenido.", Logger::INFO);
 }
 
-void Protocol::AcceptClients() {
+void Protocol::AcceptClient(EventLoop::ClientId client) {
+    // Un navegador enva la peticin de WebSocket nada ms conectar: hasta entonces (o hasta que
+    // pase UPGRADE_WAIT_US) no recibe difusiones, para no mezclar muestras con la respuesta HTTP
+    network.SetChannel(client, PENDING_CHANNEL);
+    newcomers.push_back({ client, MonotonicMicros() });
+    ScheduleWake();
+}
+
+void Protocol::CloseClient(EventLoop::ClientId client) {
+    auto webSocket = webSockets.find(client);
+    if (webSocket != webSockets.end()) {
+        if (webSocket->second.upgraded) {
+            webSocketCount.Add(-1);
+        }
+        webSockets.erase(webSocket);
+    }
+    lines.erase(client);
+    for (size_t i = 0; i < newcomers.size(); ++i) {
+        if (newcomers[i].id == client) {
+            newcomers.erase(newcomers.begin() + i);
+            break;
+        }
+    }
+}
+
+void Protocol::Admit(EventLoop::ClientId client) {
+    for (size_t i = 0; i < newcomers.size(); ++i) {
+        if (newcomers[i].id == client) {
+            newcomers.erase(newcomers.begin() + i);
+            break;
+        }
+    }
+    network.SetChannel(client, network.GetChannel(client) & ~PENDING_CHANNEL);
+
+    // La instantnea sale en la prxima publicacin, antes que cualquier muestra nueva y ya con el
+    // formato y los radares que haya pedido el cliente en sus primeras lneas
+    snapshots.push_back(client);
+    network.Wakeup();
+}
+
+void Protocol::AdmitNewcomers() {
+    // Los clientes TCP que no envan nada empiezan a recibir al acabar la espera; una peticin HTTP
+    // que para entonces no termin se rechaza, para que un cliente lento no quede pendiente para siempre
+    uint64_t now = MonotonicMicros();
+    size_t kept = 0;
+    for (size_t i = 0; i < newcomers.size(); ++i) {
+        EventLoop::ClientId client = newcomers[i].id;
+        if (now - newcomers[i].connectedAt < UPGRADE_WAIT_US) {
+            newcomers[kept++] = newcomers[i];
+        }
+        else if (webSockets.find(client) != webSockets.end()) {
+            LOG_LIMITED(logger, "Peticin HTTP sin terminar a tiempo, se cierra la conexin.", Logger::WARNING);
+            network.Send(client, ws::TimeoutReply());
+            network.Disconnect(client);
+        }
+        else {
+            network.SetChannel(client, network.GetChannel(client) & ~PENDING_CHANNEL);
+            snapshots.push_back(client);
+        }
+    }
+    newcomers.resize(kept);
+}
+
+void Protocol::HandleClient(EventLoop::ClientId client, const char* data, size_t length) {
+    auto webSocket = webSockets.find(client);
+    if (webSocket != webSockets.end()) {
+        HandleWebSocket(client, webSocket->second, data, length);
+        return;
+    }
+
+    // Una lnea puede llegar partida en varias lecturas: lo que queda sin terminar espera a la siguiente.
+    // Mientras tanto el cliente no se admite, para que su instantnea salga ya en el formato que pida
+    std::string& partial = lines[client];
+    partial.append(data, length);
+
+    // Un navegador empieza con "GET "; cualquier otra cosa es un cliente TCP de los de siempre. Si la
+    // primera lectura es ms corta, se guarda hasta que haya bytes suficientes para distinguirlos
+    bool pending = (network.GetChannel(client) & PENDING_CHANNEL) != 0;
+    if (pending) {
+        std::string key;
+        size_t consumed = 0;
+        ws::UpgradeResult result = ws::ParseUpgrade(partial.data(), partial.size(), key, consumed);
+        if (result == ws::UNDECIDED) {
+            return;
+        }
+        if (result != ws::NOT_HTTP) {
+            std::string request;
+            request.swap(partial);
+            lines.erase(client);
+            webSocket = webSockets.emplace(client, WebSocketClient()).first;
+            HandleWebSocket(client, webSocket->second, request.data(), request.size());
+            return;
+        }
+    }
+    HandleLines(client, partial);
+    bool complete = partial.empty();
+    if (complete) {
+        lines.erase(client);
+    }
+    if (pending && complete) {
+        Admit(client);
+    }
+}
+
+void Protocol::HandleWebSocket(EventLoop::ClientId client, WebSocketClient& state, const char* data, size_t length) {
+    state.buffer.append(data, length);
+
+    if (!state.upgraded) {
+        std::string key;
+        size_t consumed = 0;
+        ws::UpgradeResult result = ws::ParseUpgrade(state.buffer.data(), state.buffer.size(), key, consumed);
+        if (result == ws::PARTIAL) {
+            return;
+        }
+        if (result != ws::UPGRADE) {
+            logger->Log("Peticin HTTP rechazada: no es un WebSocket.", Logger::WARNING);
+            network.Send(client, ws::RejectReply());
+            network.Disconnect(client);
+            return;
+        }
+
+        network.Send(client, ws::HandshakeReply(key));
+        state.upgraded = true;
+        state.buffer.erase(0, consumed);
+        network.SetChannel(client, network.GetChannel(client) | WEBSOCKET_CHANNEL);
+        Admit(client);
+        webSocketCount.Add(1);
+        logger->Log("Cliente conectado por WebSocket.", Logger::INFO);
+    }
+
+    // Cada mensaje completo (los fragmentos se juntan) se trata como los datos de un cliente TCP
+    size_t start = 0;
+    ws::Message frame;
+    while (start < state.buffer.size()) {
+        size_t consumed = 0;
+        ws::DecodeResult result = ws::DecodeFrame(state.buffer.data() + start, state.buffer.size() - start, consumed, frame);
+        if (result == ws::INCOMPLETE) {
+            break;
+        }
+        if (result == ws::INVALID) {
+            LOG_LIMITED(logger, "Trama WebSocket invlida, se cierra la conexin.", Logger::WARNING);
+            network.Send(client, ws::EncodeClose(ws::CLOSE_PROTOCOL_ERROR));
+            network.Disconnect(client);
+            return;
+        }
+        start += consumed;
+
+        if (frame.opcode == ws::PING) {
+            network.Send(client, ws::EncodeFrame(ws::PONG, frame.payload.data(), frame.payload.size()));
+            continue;
+        }
+        if (frame.opcode == ws::PONG) {
+            continue;
+        }
+        if (frame.opcode == ws::CLOSE) {
+            network.Send(client, ws::EncodeClose(ws::CLOSE_NORMAL));
+            network.Disconnect(client);
+            return;
+        }
+
+        // Un mensaje fragmentado empieza con TEXT o BINARY y sigue con CONTINUATION hasta la trama
+        // final (RFC 6455, 5.4); cualquier otra secuencia es un error de protocolo
+        if ((frame.opcode == ws::CONTINUATION) != state.fragmented) {
+            LOG_LIMITED(logger, "Fragmentos WebSocket fuera de orden, se cierra la conexin.", Logger::WARNING);
+            network.Send(client, ws::EncodeClose(ws::CLOSE_PROTOCOL_ERROR));
+            network.Disconnect(client);
+            return;
+        }
+        state.fragmented = !frame.final;
+
+        state.message += frame.payload;
+        if (state.message.size() > ws::MAX_PAYLOAD) {
+            network.Send(client, ws::EncodeClose(ws::CLOSE_TOO_BIG));
+            network.Disconnect(client);
+            return;
+        }
+        if (frame.final) {
+            // Cada mensaje es completo: su ltima lnea no necesita salto de lnea
+            std::string message;
+            message.swap(state.message);
+            if (!message.empty() && message.back() != '\n') {
+                message += '\n';
+            }
+            HandleLines(client, message);
+        }
+    }
+    state.buffer.erase(0, start);
+}
+
+void Protocol::HandleLines(EventLoop::ClientId client, std::string& pending) {
+    // Solo las lneas completas pueden ser de control; el texto entre ellas (la identificacin del
+    // dispositivo) se trata junto, como llegaba antes
+    size_t start = 0;
+    size_t text = 0;
+    size_t end;
+    while ((end = pending.find('\n', start)) != std::string::npos) {
+        if (HandleControl(client, pending.data() + start, end + 1 - start) > 0) {
+            if (text < start) {
+                HandleMessage(client, pending.data() + text, start - text);
+            }
+            text = end + 1;
+        }
+        start = end + 1;
+    }
+
+    // Un final sin salto de lnea se guarda si puede ser una lnea de control a medias; cualquier otro
+    // texto se trata ya, porque la aplicacin enva su identificacin sin salto de lnea
+    size_t rest = pending.size() - start;
+    size_t stop = rest > 0 && rest < MAX_LINE && IsCommandStart(pending.data() + start, rest) ? start : pending.size();
+    if (text < stop) {
+        HandleMessage(client, pending.data() + text, stop - text);
+    }
+    pending.erase(0, stop);
+}
+
+void Protocol::HandleMessage(EventLoop::ClientId client, const char* data, size_t length) {
+    std::string message(data, length);
+    logger->Log("[" + color::CYAN + "CLIENT" + color::RESET + "] " + message, Logger::INFO);
+
+    // Lo primero que enva la aplicacin al conectarse identifica al dispositivo
+    if (!network.HasDevice(client)) {
+        size_t end = message.find_last_not_of("\r\n ");
+        if (end != std::string::npos) {
+            network.SetDevice(client, message.substr(0, end + 1));
+        }
+    }
+
+    Reply(client, "Datos recibidos: ");
+    LOG_DEBUG(logger, "[CLIENT] Datos enviados.");
+}
+
+size_t Protocol::HandleControl(EventLoop::ClientId client, const char* data, size_t length) {
+    EventLoop::Channel channel = network.GetChannel(client);
+
+    // Negociacin del formato binario (ver wireformat.h); se conservan el modo delta y los radares
+    int requested = 0;
+    size_t used = wire::ParseHandshake(data, length, requested);
+    if (used > 0) {
+        int version = wire::Negotiate(requested);
+        Send(client, wire::HandshakeReply(version));
+        SetChannel(client, (EventLoop::Channel)((channel & ~BINARY_CHANNEL) | (version > 0 ? BINARY_CHANNEL : TEXT_CHANNEL)));
+        logger->Log(version > 0 ? "Cliente en formato binario v" + std::to_string(version) + "." :
+            std::string("Cliente en formato de texto (versin binaria no soportada)."), Logger::INFO);
+        return used;
+    }
+
+    // Modo delta: solo se envan los cambios, ms un fotograma clave peridico
+    if ((used = MatchLine(data, length, "MODE DELTA")) > 0) {
+        Reply(client, "MODE DELTA\n");
+        // El modo delta y la tasa limitada se excluyen: la ventana ya resume los cambios
+        SetChannel(client, (EventLoop::Channel)((channel & ~(RATE_BITS | NEAREST_CHANNEL)) | DELTA_CHANNEL));
+        logger->Log("Cliente en modo delta.", Logger::INFO);
+        return used;
+    }
+    if ((used = MatchLine(data, length, "MODE FULL")) > 0) {
+        Reply(client, "MODE FULL\n");
+        SetChannel(client, (EventLoop::Channel)(channel & ~DELTA_CHANNEL));
+        logger->Log("Cliente en modo completo.", Logger::INFO);
+        return used;
+    }
+
+    // Rejilla de ocupacin (solo en binario): "GRID" pide una instantnea y "GRID ON" adems
+    // las actualizaciones de cada periodo, que se aplican sobre la instantnea
+    bool gridOn = false;
+    if ((used = MatchLine(data, length, "GRID")) > 0 || (gridOn = (used = MatchLine(data, length, "GRID ON")) > 0)) {
+        if (!(channel & BINARY_CHANNEL)) {
+            Reply(client, "GRID ERROR\n");
+            return used;
+        }
+        SendGrid(client, channel);
+        if (gridOn) {
+            SetChannel(client, (EventLoop::Channel)(channel | GRID_CHANNEL));
+            logger->Log("Cliente recibe la rejilla de ocupacin.", Logger::INFO);
+        }
+        return used;
+    }
+    // Objetos seguidos (solo en binario), junto a las muestras o en su lugar
+    bool only = false;
+    if ((used = MatchLine(data, length, "OBJECTS ON")) > 0 || (only = (used = MatchLine(data, length, "OBJECTS ONLY")) > 0)) {
+        if (!(channel & BINARY_CHANNEL)) {
+            Reply(client, "OBJECTS ERROR\n");
+            return used;
+        }
+        Reply(client, only ? "OBJECTS ONLY\n" : "OBJECTS ON\n");
+        SetChannel(client, (EventLoop::Channel)((channel & ~OBJECTS_ONLY_CHANNEL) | OBJECTS_CHANNEL | (only ? OBJECTS_ONLY_CHANNEL : 0)));
+        logger->Log(only ? "Cliente recibe solo los objetos seguidos." : "Cliente recibe los objetos seguidos.", Logger::INFO);
+        return used;
+    }
+    if ((used = MatchLine(data, length, "OBJECTS OFF")) > 0) {
+        Reply(client, "OBJECTS OFF\n");
+        SetChannel(client, (EventLoop::Channel)(channel & ~(OBJECTS_CHANNEL | OBJECTS_ONLY_CHANNEL)));
+        return used;
+    }
+    // Instantnea de la ltima muestra de cada ngulo, como la que se recibe al conectar. Un cliente
+    // an sin admitir ya la recibir al admitirse: pedirla otra vez la duplicara
+    if ((used = MatchLine(data, length, "SNAPSHOT")) > 0) {
+        if (!(channel & PENDING_CHANNEL)) {
+            snapshots.push_back(client);
+            network.Wakeup();
+        }
+        return used;
+    }
+    if ((used = MatchLine(data, length, "GRID OFF")) > 0) {
+        Reply(client, "GRID OFF\n");
+        SetChannel(client, (EventLoop::Channel)(channel & ~GRID_CHANNEL));
+        return used;
+    }
+
+    // Tasa mxima: el cliente recibe una ventana reducida cada 1/rate segundos en lugar de cada muestra
+    uint32_t rate = 0;
+    bool nearest = false;
+    bool valid = false;
+    if ((used = ParseRate(data, length, Decimator::MAX_RATE, rate, nearest, valid)) > 0) {
+        if (!valid) {
+            Reply(client, "RATE ERROR\n");
+            return used;
+        }
+        Reply(client, rate == 0 ? std::string("RATE OFF\n") : "RATE " + std::to_string(rate) + (nearest ? " NEAREST\n" : " LATEST\n"));
+        EventLoop::Channel limited = (EventLoop::Channel)rate << RATE_SHIFT | (nearest ? NEAREST_CHANNEL : 0);
+        SetChannel(client, (channel & ~(RATE_BITS | NEAREST_CHANNEL | (rate != 0 ? DELTA_CHANNEL : 0))) | limited);
+        logger->Log(rate == 0 ? std::string("Cliente sin lmite de tasa.") : "Cliente limitado a " + std::to_string(rate) +
+            " entregas por segundo (" + (nearest ? "distancia mnima" : "ltimo valor") + " por ngulo).", Logger::INFO);
+        return used;
+    }
+
+    // Sectores: el cliente solo recibe las muestras de sus intervalos de ngulos y distancias
+    std::vector<Sector> requestedSectors;
+    if ((used = ParseSectors(data, length, SectorIndex::MAX_SECTORS, requestedSectors, valid)) > 0) {
+        uint32_t view = 0;
+        if (valid && !requestedSectors.empty() && (view = sectors.Acquire(requestedSectors)) == 0) {
+            // Puede haber vistas de clientes que ya cambiaron de sectores y an no se liberaron
+            network.Channels(channels);
+            UpdateViews();
+            view = sectors.Acquire(requestedSectors);
+        }
+        if (!valid || (!requestedSectors.empty() && view == 0)) {
+            Reply(client, "SECTOR ERROR\n");
+            return used;
+        }
+        Reply(client, "SECTOR " + (view == 0 ? std::string("OFF") : SectorList(requestedSectors)) + "\n");
+        SetChannel(client, (channel & ~VIEW_BITS) | (EventLoop::Channel)view << VIEW_SHIFT);
+        logger->Log(view == 0 ? std::string("Cliente recibe todos los ngulos.") : "Cliente suscrito a los sectores " +
+            SectorList(requestedSectors) + ".", Logger::INFO);
+        return used;
+    }
+
+    // Consulta del histrico: la resuelve el hilo de consultas y la respuesta llega despus, entre
+    // "HISTORY BEGIN" y "HISTORY END n" (o "HISTORY MORE n desde" si no cupo entera)
+    history::Level level = history::SAMPLES;
+    history::Query query;
+    if ((used = ParseHistory(data, length, level, query, valid)) > 0) {
+        // Solo los radares que recibe el cliente en directo: sin suscripcin, el radar 0 (como en Includes)
+        uint32_t subscribed = Subscription(channel);
+        query.devices = subscribed != 0 ? subscribed : 1u;
+        query.limit = history::MAX_REPLY_LINES;
+        if (!valid || !archive.IsOpen() ||
+            !archive.Post([this, client, level, query]() { QueryHistory(client, level, query); })) {
+            Reply(client, "HISTORY ERROR\n");
+        }
+        return used;
+    }
+
+    // Suscripcin a varios radares: las muestras pasan a llevar el radar de cada una
+    uint32_t all = devices.size() >= 32 ? 0xFFFFFFFFu : (1u << devices.size()) - 1;
+    uint32_t subscription = 0;
+    if ((used = ParseSubscribe(data, length, all, devices.size(), subscription, valid)) > 0) {
+        if (!valid || subscription == 0) {
+            Reply(client, "SUBSCRIBE ERROR\n");
+            return used;
+        }
+        uint64_t format = channel & ((1ull << SUBSCRIPTION_SHIFT) - 1);
+        Reply(client, "SUBSCRIBE " + (subscription == all ? std::string("ALL") : DeviceList(subscription)) + "\n");
+        SetChannel(client, format | ((EventLoop::Channel)subscription << SUBSCRIPTION_SHIFT));
+        logger->Log("Cliente suscrito a los radares " + DeviceList(subscription) + ".", Logger::INFO);
+        return used;
+    }
+    return 0;
+}
+
+void Protocol::SetChannel(EventLoop::ClientId client, EventLoop::Channel channel) {
+    // Quien entra en el modo delta (o cambia de radares) necesita un fotograma clave para partir de algo
+    if ((channel & DELTA_CHANNEL) && channel != network.GetChannel(client)) {
+        for (auto& device : devices) {
+            if (Includes(channel, device->id)) {
+                device->delta.RequestKeyframe();
+            }
+        }
+    }
+    network.SetChannel(client, channel);
+}
+
+void Protocol::Reply(EventLoop::ClientId client, const std::string& message) {
+    // A un cliente binario no se le puede mezclar texto suelto en el flujo
+    Send(client, (network.GetChannel(client) & BINARY_CHANNEL) ? wire::EncodeText(message) : message);
+}
+
+void Protocol::Send(EventLoop::ClientId client, const std::string& message) {
+    EventLoop::Channel channel = network.GetChannel(client);
+    if (channel & WEBSOCKET_CHANNEL) {
+        ws::Opcode opcode = (channel & BINARY_CHANNEL) ? ws::BINARY : ws::TEXT;
+        network.Send(client, ws::EncodeFrame(opcode, message.data(), message.size()));
+    }
+    else {
+        network.Send(client, message);
+    }
+}
+
+void Protocol::Publish(const Frame& frame, EventLoop::Channel channel, uint64_t stamp) {
+    if (channel & PENDING_CHANNEL) {
+        return;
+    }
+    if (!(channel & WEBSOCKET_CHANNEL)) {
+        network.Publish(frame, channel, stamp);
+        return;
+    }
+
+    // Un barrido o unos objetos van a varios canales seguidos: se envuelven una sola vez y la
+    // trama resultante se comparte entre todos los clientes WebSocket
+    for (const auto& pair : wrapCache) {
+        if (pair.first == frame) {
+            network.Publish(pair.second, channel, stamp);
+            return;
+        }
+    }
+    Frame wrapped = ws::WrapFrame((channel & BINARY_CHANNEL) ? ws::BINARY : ws::TEXT, frame);
+    wrapCache[wrapNext++ % WRAP_CACHE] = { frame, wrapped };
+    network.Publish(wrapped, channel, stamp);
+}
+
+void Protocol::Publish(const char* data, size_t length, EventLoop::Channel channel, uint64_t stamp) {
+    if (channel & PENDING_CHANNEL) {
+        return;
+    }
+    if (channel & WEBSOCKET_CHANNEL) {
+        ws::Opcode opcode = (channel & BINARY_CHANNEL) ? ws::BINARY : ws::TEXT;
+        network.Publish(std::make_shared<const std::string>(ws::EncodeFrame(opcode, data, length)), channel, stamp);
+    }
+    else {
+        network.Publish(MakeFrame(data, length), channel, stamp);
+    }
+}
+
+void Protocol::ReadSamples(Device& device) {
+    RadarSample sample;
+    bool overrun = false;
+    uint64_t read = 0;
+
+    // ReadSample espera como mximo unos 100 ms, as que no hace falta dormir
     while (isRunning) {
-        if (clients.size() >= maxConnections) {
-            logger->Log("Nmero mximo de conexiones alcanzado.", Logger::WARNING);
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+        sample.timestamp = 0;
+        if (!device.source->ReadSample(sample)) {
+            continue;
+        }
+        sample.device = device.id;
+        sample.sequence = device.nextSequence++;
+
+        // Handler fecha la muestra al completar la trama; el resto de los orgenes, aqu
+        uint64_t framed = sample.timestamp != 0 ? sample.timestamp : MonotonicMicros();
+        sample.timestamp = framed > startMicros ? framed - startMicros : 0;
+        read++;
+        device.read.Add();
+
+        if (!device.samples.Push(sample)) {
+            // El hilo de red no da abasto: se descarta la muestra en lugar de frenar la lectura
+            if (!overrun) {
+                LOG_LIMITED(logger, "Cola de muestras llena, se descartan muestras del radar " + std::to_string(device.id) + ".",
+                    Logger::WARNING);
+                overrun = true;
+            }
+            continue;
+        }
+        overrun = false;
+
+        if (device.samples.NeedsSignal()) {
+            network.Wakeup();
+        }
+    }
+
+    // Ritmo real de lectura, til para medir el lmite del servidor con orgenes rpidos
+    double seconds = (double)(MonotonicMicros() - startMicros) / 1e6;
+    if (read > 0 && seconds > 0) {
+        std::string name = devices.size() > 1 ? "Radar " + std::to_string(device.id) + ": muestras ledas: " : "Muestras ledas: ";
+        logger->Log(name + std::to_string(read) + " en " + std::to_string((int)seconds) + " s (" +
+            std::to_string((uint64_t)(read / seconds)) + " muestras/s).", Logger::INFO);
+    }
+}
+
+size_t Protocol::MergeSamples(RadarSample* out, size_t max) {
+    // Con un nico radar no hay nada que mezclar
+    if (devices.size() == 1) {
+        return devices[0]->samples.Pop(out, max);
+    }
+
+    // Mezcla por instante de lectura: cada anillo ya est en orden, as que basta con tomar
+    // siempre la muestra ms antigua de las cabezas. Un radar sin muestras encoladas an puede
+    // tener una en camino fechada hasta REORDER_US atrs; lo que sea ms reciente espera al
+    // siguiente despertar para no salir antes que ella.
+    uint64_t now = MonotonicMicros() - startMicros;
+    uint64_t horizon = now > REORDER_US ? now - REORDER_US : 0;
+
+    size_t count = 0;
+    while (count < max) {
+        Device* next = nullptr;
+        uint64_t limit = UINT64_MAX;
+        for (auto& device : devices) {
+            if (device->pendingCount == 0) {
+                device->pendingStart = 0;
+                device->pendingCount = device->samples.Pop(device->pending, PUBLISH_BATCH);
+                if (device->pendingCount == 0) {
+                    limit = horizon < limit ? horizon : limit;
+                    continue;
+                }
+            }
+            uint64_t head = device->pending[device->pendingStart].timestamp;
+            limit = head < limit ? head : limit;
+            if (next == nullptr || head < next->pending[next->pendingStart].timestamp) {
+                next = device.get();
+            }
+        }
+        if (next == nullptr || next->pending[next->pendingStart].timestamp > limit) {
+            break;
+        }
+
+        out[count++] = next->pending[next->pendingStart++];
+        next->pendingCount--;
+    }
+    return count;
+}
+
+void Protocol::ScheduleWake() {
+    // Lo que MergeSamples retuvo, las ventanas de tasa abiertas y los clientes por admitir salen en
+    // cuanto pasa su espera, aunque ningn radar vuelva a despertar al bucle (por ejemplo, con un
+    // radar parado)
+    uint64_t deadline = 0;
+    for (auto& device : devices) {
+        if (device->pendingCount > 0) {
+            uint64_t due = startMicros + device->pending[device->pendingStart].timestamp + REORDER_US;
+            deadline = deadline == 0 || due < deadline ? due : deadline;
+        }
+    }
+    for (const RateClass& rateClass : rateClasses) {
+        if (rateClass.decimator->Deadline() != 0) {
+            uint64_t due = startMicros + rateClass.decimator->Deadline() + REORDER_US;
+            deadline = deadline == 0 || due < deadline ? due : deadline;
+        }
+    }
+    for (const Newcomer& newcomer : newcomers) {
+        uint64_t due = newcomer.connectedAt + UPGRADE_WAIT_US;
+        deadline = deadline == 0 || due < deadline ? due : deadline;
+    }
+    network.WakeAt(deadline);
+}
+
+void Protocol::PublishSamples() {
+    RadarSample batch[PUBLISH_BATCH];
+    RadarSample changes[PUBLISH_BATCH];
+
+    for (auto& device : devices) {
+        device->samples.ResetSignal();
+    }
+
+    // Cada canal (formato, modo y radares) se codifica solo si hay algn cliente en l
+    AdmitNewcomers();
+    SendHistoryReplies();
+    network.Channels(channels);
+    UpdateRateClasses();
+    UpdateViews();
+    SendSnapshots();
+    bool delta = false;
+    for (EventLoop::Channel channel : channels) {
+        delta = delta || (channel & DELTA_CHANNEL);
+    }
+    bool sectored = !views.empty();
+
+    // Todas las muestras acumuladas desde el ltimo despertar viajan en un nico Frame por canal
+    size_t count;
+    while ((count = MergeSamples(batch, PUBLISH_BATCH)) > 0) {
+        batchSizes.Record(count);
+
+        // Etapa de cola: desde que se complet la trama hasta que el hilo de red la toma
+        uint64_t now = MonotonicMicros() - startMicros;
+        for (size_t i = 0; i < count; ++i) {
+            queueingLatency.Record(now > batch[i].timestamp ? now - batch[i].timestamp : 0);
+        }
+        if (capture.IsOpen()) {
+            for (size_t i = 0; i < count; ++i) {
+                if (!capture.Append(batch[i])) {
+                    logger->Log("No se pudo ampliar el archivo de captura; la grabacin se detiene.", Logger::ERROR_LOG);
+                    break;
+                }
+            }
+        }
+
+        // La captura guarda las lecturas tal cual; todo lo dems ve las filtradas
+        for (size_t i = 0; i < count;) {
+            size_t end = i + 1;
+            while (end < count && batch[end].device == batch[i].device) {
+                end++;
+            }
+            devices[batch[i].device]->noise.Filter(batch + i, end - i);
+            i = end;
+        }
+
+        // Un envo por cada MAX_SAMPLES muestras, haya los receptores que haya
+        if (udpOutput.IsOpen()) {
+            udpOutput.Send(batch, count);
+        }
+        // El histrico solo copia el lote a su anillo; lo codifica y escribe su propio hilo
+        archive.Append(batch, count, wallStart);
+
+        size_t changed = 0;
+        if (delta) {
+            for (size_t i = 0; i < count; ++i) {
+                if (devices[batch[i].device]->delta.Accept(batch[i])) {
+                    changes[changed++] = batch[i];
+                }
+            }
+        }
+
+        // El lote se reparte una vez entre las vistas de sectores, no una vez por cliente
+        if (sectored) {
+            sectors.Select(batch, count, selection);
+            sectors.Select(changes, changed, changeSelection);
+        }
+        for (EventLoop::Channel channel : channels) {
+            if (Rate(channel) != 0) {
+                continue;
+            }
+            if (channel & DELTA_CHANNEL) {
+                PublishSelection(changes, changed, changeSelection, channel, 0);
+            }
+            else {
+                PublishSelection(batch, count, selection, channel, 0);
+            }
+        }
+
+        // Cada clase de tasa reduce el lote una vez, sea cual sea el nmero de clientes
+        for (const RateClass& rateClass : rateClasses) {
+            for (size_t i = 0; i < count; ++i) {
+                if (rateClass.decimator->Add(batch[i])) {
+                    PublishWindow(rateClass);
+                }
+            }
+        }
+
+        // Cada barrido completo viaja en un nico mensaje, despus de las muestras que lo forman
+        for (size_t i = 0; i < count; ++i) {
+            Device& device = *devices[batch[i].device];
+            device.latest = batch[i].timestamp;
+            if (batch[i].angle <= SweepFrame::MAX_ANGLE) {
+                device.current[batch[i].angle] = batch[i];
+                device.seen[batch[i].angle] = true;
+            }
+            device.grid.Add(batch[i]);
+            if (device.sweeps.Add(batch[i])) {
+                PublishSweep(device);
+            }
+        }
+    }
+
+    // Una ventana de tasa se cierra tambin sin muestras de la siguiente, en cuanto ya no puede
+    // llegar ninguna ms de ella (la misma espera de REORDER_US que en MergeSamples)
+    uint64_t elapsed = MonotonicMicros() - startMicros;
+    uint64_t settled = elapsed > REORDER_US ? elapsed - REORDER_US : 0;
+    for (const RateClass& rateClass : rateClasses) {
+        if (rateClass.decimator->Flush(settled)) {
+            PublishWindow(rateClass);
+        }
+    }
+    ScheduleWake();
+
+    // La rejilla envejece aunque nadie la reciba, para que las instantneas estn al da
+    for (auto& device : devices) {
+        if (device->grid.TickDue(device->latest)) {
+            PublishGrid(*device);
+        }
+    }
+
+    if (!delta) {
+        return;
+    }
+    for (auto& device : devices) {
+        if (device->latest > 0 && device->delta.KeyframeDue(device->latest)) {
+            size_t keyframe = device->delta.Keyframe(changes, device->latest);
+            if (sectored) {
+                sectors.Select(changes, keyframe, changeSelection);
+            }
+            for (EventLoop::Channel channel : channels) {
+                if (channel & DELTA_CHANNEL) {
+                    PublishSelection(changes, keyframe, changeSelection, channel, wire::FLAG_KEYFRAME);
+                }
+            }
+        }
+    }
+}
+
+void Protocol::PublishSweep(Device& device) {
+    // Los objetos se siguen aunque nadie los reciba, para poder consultarlos desde la consola
+    TrackedObject objects[ObjectTracker::MAX_TRACKS];
+    size_t tracked = device.tracker.Update(device.sweeps.Last(), objects);
+
+    char buffer[wire::HEADER_SIZE + wire::SWEEP_HEADER_SIZE + (SweepFrame::MAX_ANGLE + 1) * 6];
+    Frame sweepFrame;
+    Frame objectsFrame;
+    for (EventLoop::Channel channel : channels) {
+        if (!(channel & BINARY_CHANNEL) || !Includes(channel, device.id)) {
             continue;
         }
+        if (!(channel & OBJECTS_ONLY_CHANNEL)) {
+            if (!sweepFrame) {
+                sweepFrame = MakeFrame(buffer, wire::EncodeSweep(device.sweeps.Last(), buffer));
+            }
+            Publish(sweepFrame, channel, startMicros + device.latest);
+        }
+        if (channel & OBJECTS_CHANNEL) {
+            if (!objectsFrame) {
+                objectsFrame = MakeFrame(buffer, wire::EncodeObjects(device.id, objects, tracked, buffer));
+            }
+            Publish(objectsFrame, channel, startMicros + device.latest);
+        }
+    }
+}
+
+void Protocol::PublishGrid(Device& device) {
+    uint8_t decay = 0;
+    size_t count = device.grid.Tick(device.latest, gridCells.data(), decay);
+    if (count == 0 && decay == 0) {
+        return;
+    }
+
+    Frame frame;
+    for (EventLoop::Channel channel : channels) {
+        if ((channel & GRID_CHANNEL) && (channel & BINARY_CHANNEL) && Includes(channel, device.id)) {
+            if (!frame) {
+                std::string buffer(wire::GridFrameSize(count), '\0');
+                wire::EncodeGrid(device.id, device.latest, decay, gridCells.data(), count, &buffer[0]);
+                frame = std::make_shared<const std::string>(std::move(buffer));
+            }
+            Publish(frame, channel);
+        }
+    }
+}
 
-        SOCKET clientSocket = accept(serverSocket, nullptr, nullptr);
-        if (clientSocket != INVALID_SOCKET) {
-            clients.push_back(clientSocket);
-            logger->Log("Cliente conectado.",Logger::INFO);
-            std::thread(&Protocol::HandleClient, this, clientSocket).detach();
+void Protocol::SendGrid(EventLoop::ClientId client, EventLoop::Channel channel) {
+    for (auto& device : devices) {
+        if (Includes(channel, device->id)) {
+            size_t count = device->grid.Snapshot(gridCells.data());
+            std::string buffer(wire::GridFrameSize(count), '\0');
+            wire::EncodeGrid(device->id, device->latest, 0, gridCells.data(), count, &buffer[0], wire::FLAG_KEYFRAME);
+            Send(client, buffer);
+        }
+    }
+}
+
+void Protocol::SendSnapshots() {
+    // Todo lo publicado hasta aqu ya est en las tablas por ngulo y nada de ello lleg a estos
+    // clientes; lo siguiente que publique este bucle s les llegar: ni huecos ni repeticiones
+    for (EventLoop::ClientId client : snapshots) {
+        SendSnapshot(client);
+    }
+    snapshots.clear();
+}
+
+void Protocol::SendSnapshot(EventLoop::ClientId client) {
+    // El cliente puede haberse ido entre que se admiti y esta publicacin
+    if (!network.IsConnected(client)) {
+        return;
+    }
+    EventLoop::Channel channel = network.GetChannel(client);
+    if (channel & (OBJECTS_ONLY_CHANNEL | PENDING_CHANNEL)) {
+        return;
+    }
+
+    // Mismo formato que las muestras en directo; en binario, con FLAG_KEYFRAME. Un radar siempre
+    // cabe en un mensaje; con muchos radares se reparten para no pasar de SNAPSHOT_MAX_BYTES
+    uint32_t subscription = Subscription(channel);
+    wire::FrameType type = subscription != 0 ? wire::DEVICE_SAMPLES : wire::SAMPLES;
+    size_t perSample = (channel & BINARY_CHANNEL) ? wire::SamplesFrameSize(1, type) - wire::HEADER_SIZE : 24;
+    size_t maxSamples = SNAPSHOT_MAX_BYTES / perSample;
+    auto flush = [&]() {
+        if (snapshotSamples.empty()) {
+            return;
+        }
+        std::string message;
+        if (channel & BINARY_CHANNEL) {
+            message.resize(wire::SamplesFrameSize(snapshotSamples.size(), type));
+            wire::EncodeSamples(snapshotSamples.data(), snapshotSamples.size(), &message[0], wire::FLAG_KEYFRAME, type);
         }
         else {
-            logger->Log("Error al aceptar la conexin del cliente.", Logger::ERROR_LOG);
+            char line[24];
+            for (const RadarSample& sample : snapshotSamples) {
+                message.append(line, subscription != 0 ? FormatDeviceSample(sample, line) : FormatSample(sample, line));
+            }
+        }
+        Send(client, message);
+        snapshotSamples.clear();
+    };
+
+    uint32_t view = View(channel);
+    snapshotSamples.clear();
+    for (const auto& device : devices) {
+        if (!Includes(channel, device->id)) {
+            continue;
+        }
+        if (snapshotSamples.size() + SweepFrame::MAX_ANGLE + 1 > maxSamples) {
+            flush();
+        }
+        for (uint16_t angle = 0; angle <= SweepFrame::MAX_ANGLE; ++angle) {
+            const RadarSample& sample = device->current[angle];
+            if (!device->seen[angle] || (view != 0 && std::none_of(sectors.Sectors(view).begin(), sectors.Sectors(view).end(),
+                [&sample](const Sector& sector) { return sector.Contains(sample); }))) {
+                continue;
+            }
+            snapshotSamples.push_back(sample);
         }
     }
+    flush();
+    snapshotsSent.Add();
 }
 
-void Protocol::HandleClient(SOCKET clientSocket) {
-    char buffer[1024];
-    int bytesRead;
+void Protocol::QueryHistory(EventLoop::ClientId client, history::Level level, const history::Query& query) {
+    // Hilo de consultas del histrico: la respuesta se trocea en mensajes de HISTORY_PIECE bytes, que
+    // caben en la cola de envo del cliente junto a las difusiones
+    std::vector<HistoryReply> pieces;
+    std::string text = "HISTORY BEGIN\n";
+    history::QueryStats stats;
+    size_t lines = 0;
+    auto add = [&](const std::string& line) {
+        text += line;
+        if (text.size() >= HISTORY_PIECE) {
+            pieces.push_back({ client, std::move(text) });
+            text.clear();
+        }
+    };
+    if (level == history::SAMPLES) {
+        std::vector<RadarSample> found;
+        lines = archive.Query(query, found, stats);
+        for (const RadarSample& sample : found) {
+            add(history::FormatSample(sample));
+        }
+    }
+    else {
+        std::vector<history::Summary> found;
+        lines = archive.Summarize(level, query, found, stats);
+        for (const history::Summary& summary : found) {
+            add(history::FormatSummary(summary));
+        }
+    }
+    text += stats.next != 0 ? "HISTORY MORE " + std::to_string(lines) + " " + history::FormatTime(stats.next) + "\n" :
+        "HISTORY END " + std::to_string(lines) + "\n";
+    pieces.push_back({ client, std::move(text) });
 
-    try {
-        while ((bytesRead = recv(clientSocket, buffer, sizeof(buffer), 0)) > 0) {
-            std::string data(buffer, bytesRead);
-            logger->Log("[" + color::CYAN + "CLIENT" + color::RESET + "] " + data, Logger::INFO);
+    {
+        std::lock_guard<std::mutex> lock(historyMutex);
+        for (auto& piece : pieces) {
+            historyReplies.push_back(std::move(piece));
+        }
+    }
+    network.Wakeup();
+    LOG_DEBUG(logger, "Consulta del histrico: " + std::to_string(lines) + " lneas, " + std::to_string(stats.read) + " de " +
+        std::to_string(stats.chunks) + " bloques ledos.");
+}
 
-            std::string response = "Datos recibidos: ";
-            send(clientSocket, response.c_str(), response.length(), 0);
-            logger->Log("[CLIENT] Datos enviados.", Logger::DEBUG);
+void Protocol::SendHistoryReplies() {
+    std::vector<HistoryReply> ready;
+    {
+        std::lock_guard<std::mutex> lock(historyMutex);
+        if (historyReplies.empty()) {
+            return;
         }
+        ready.swap(historyReplies);
+    }
+    for (const HistoryReply& reply : ready) {
+        Reply(reply.client, reply.text);
     }
-    catch (const std::exception& ex) {
-        logger->Log("Error en el cliente: " + std::string(ex.what()), Logger::ERROR_LOG);
+}
+
+void Protocol::PublishBatch(const RadarSample* batch, size_t count, EventLoop::Channel channel, uint8_t flags) {
+    if (channel & (OBJECTS_ONLY_CHANNEL | PENDING_CHANNEL)) {
+        return;
     }
 
-    closesocket(clientSocket);
-    clients.erase(std::remove(clients.begin(), clients.end(), clientSocket), clients.end());
-    logger->Log("Cliente desconectado.",Logger::WARNING);
+    // Solo las muestras de los radares del canal; sin suscripcin, solo las del radar 0
+    RadarSample selected[PUBLISH_BATCH];
+    uint32_t subscription = Subscription(channel);
+    uint32_t all = devices.size() >= 32 ? 0xFFFFFFFFu : (1u << devices.size()) - 1;
+    if ((subscription & all) != all) {
+        size_t kept = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (Includes(channel, batch[i].device)) {
+                selected[kept++] = batch[i];
+            }
+        }
+        batch = selected;
+        count = kept;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    // Las muestras ya vienen en orden: la primera es la que ms lleva esperando. Los
+    // fotogramas clave repiten el estado y las ventanas de tasa esperan a propsito: no cuentan.
+    uint64_t stamp = (flags & wire::FLAG_KEYFRAME) || Rate(channel) != 0 ? 0 : startMicros + batch[0].timestamp;
+    if (channel & BINARY_CHANNEL) {
+        char buffer[wire::HEADER_SIZE + PUBLISH_BATCH * wire::DEVICE_RECORD_SIZE];
+        wire::FrameType type = subscription != 0 ? wire::DEVICE_SAMPLES : wire::SAMPLES;
+        Publish(buffer, wire::EncodeSamples(batch, count, buffer, flags, type), channel, stamp);
+    }
+    else {
+        char buffer[PUBLISH_BATCH * 24];
+        size_t length = 0;
+        for (size_t i = 0; i < count; ++i) {
+            length += subscription != 0 ? FormatDeviceSample(batch[i], buffer + length) : FormatSample(batch[i], buffer + length);
+        }
+        Publish(buffer, length, channel, stamp);
+    }
 }
 
-void Protocol::ReadAndBroadcastArduinoData() {
-    while (isRunning) {
-        std::string arduinoData = arduinoHandler->ReadFromArduino();
-        if (!arduinoData.empty()) {
-            arduinoData.erase(std::remove(arduinoData.begin(), arduinoData.end(), '.'), arduinoData.end());
-            BroadcastToClients(arduinoData + '\n');
+void Protocol::PublishSelection(const RadarSample* batch, size_t count, const SectorIndex::Selection& selection,
+    EventLoop::Channel channel, uint8_t flags) {
+    uint32_t view = View(channel);
+    if (view != 0) {
+        PublishBatch(selection.Samples(view), selection.Count(view), channel, flags);
+    }
+    else {
+        PublishBatch(batch, count, channel, flags);
+    }
+}
+
+void Protocol::UpdateViews() {
+    // Las vistas que ya no usa ningn canal se liberan para que otros conjuntos de sectores quepan
+    views.clear();
+    for (EventLoop::Channel channel : channels) {
+        uint32_t view = View(channel);
+        if (view != 0 && std::find(views.begin(), views.end(), view) == views.end()) {
+            views.push_back(view);
+        }
+    }
+    sectors.Prune(views);
+    sectorViewCount.Set((int64_t)sectors.Views());
+}
+
+void Protocol::UpdateRateClasses() {
+    // Se crea una reduccin por cada combinacin de tasa y modo en uso y se quitan las que ya
+    // no tienen clientes; suele haber muy pocas, as que bastan bsquedas lineales
+    size_t kept = 0;
+    for (size_t i = 0; i < rateClasses.size(); ++i) {
+        bool used = false;
+        for (EventLoop::Channel channel : channels) {
+            used = used || (channel & (RATE_BITS | NEAREST_CHANNEL)) == rateClasses[i].key;
+        }
+        if (used) {
+            rateClasses[kept++] = std::move(rateClasses[i]);
+        }
+    }
+    rateClasses.resize(kept);
+
+    for (EventLoop::Channel channel : channels) {
+        if (Rate(channel) == 0) {
+            continue;
+        }
+        EventLoop::Channel key = channel & (RATE_BITS | NEAREST_CHANNEL);
+        bool found = false;
+        for (const RateClass& rateClass : rateClasses) {
+            found = found || rateClass.key == key;
+        }
+        if (!found) {
+            Decimator::Mode mode = (channel & NEAREST_CHANNEL) ? Decimator::NEAREST : Decimator::LATEST;
+            rateClasses.push_back({ key, std::unique_ptr<Decimator>(new Decimator(Rate(channel), mode, devices.size())) });
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
+    rateClassCount.Set((int64_t)rateClasses.size());
 }
 
-void Protocol::BroadcastToClients(const std::string& message) {
-    for (SOCKET client : clients) {
-        if (client != INVALID_SOCKET) {
-            send(client, message.c_str(), message.length(), 0);
-            logger->Log("Mensaje enviado a un cliente: " + message, Logger::DEBUG);
+void Protocol::PublishWindow(const RateClass& rateClass) {
+    const std::vector<RadarSample>& window = rateClass.decimator->Closed();
+    rateLimitedSamples.Add(window.size());
+    for (size_t start = 0; start < window.size(); start += PUBLISH_BATCH) {
+        size_t count = window.size() - start < PUBLISH_BATCH ? window.size() - start : PUBLISH_BATCH;
+        if (!views.empty()) {
+            sectors.Select(window.data() + start, count, changeSelection);
+        }
+        for (EventLoop::Channel channel : channels) {
+            if ((channel & (RATE_BITS | NEAREST_CHANNEL)) == rateClass.key) {
+                PublishSelection(window.data() + start, count, changeSelection, channel, 0);
+            }
+        }
+    }
+}
+
+void Protocol::RegisterMetrics() {
+    if (metrics == nullptr) {
+        return;
+    }
+
+    // Lo que ya se cuenta en otro sitio se lee con el colector solo al pedir las mtricas
+    metrics->Remove(this);
+    for (const auto& device : devices) {
+        metrics->Add(this, "uar_samples_read_total", "Muestras leidas de cada radar.",
+            MetricsRegistry::Label("radar", std::to_string(device->id)), device->read);
+    }
+    metrics->Add(this, "uar_publish_batch_samples", "Muestras por lote publicado a los clientes.", "", batchSizes);
+    metrics->Add(this, "uar_rate_limited_samples_total", "Muestras entregadas en ventanas de tasa limitada (una vez por clase).",
+        "", rateLimitedSamples);
+    metrics->Add(this, "uar_rate_classes", "Combinaciones de tasa y modo pedidas por los clientes.", "", rateClassCount);
+    metrics->Add(this, "uar_multicast_datagrams_total", "Datagramas enviados por la salida UDP.", "", udpOutput.Datagrams());
+    metrics->Add(this, "uar_multicast_samples_total", "Muestras enviadas por la salida UDP.", "", udpOutput.Samples());
+    metrics->Add(this, "uar_multicast_errors_total", "Datagramas que el sistema no acepto (se descartan).", "", udpOutput.Errors());
+    metrics->Add(this, "uar_history_samples_total", "Muestras escritas en el historico.", "", archive.Stored());
+    metrics->Add(this, "uar_history_dropped_total", "Muestras que no cupieron en el anillo del historico.", "", archive.Dropped());
+    metrics->Add(this, "uar_history_bytes_total", "Bytes de bloques comprimidos escritos en el historico.", "", archive.Bytes());
+    metrics->Add(this, "uar_history_chunks_total", "Bloques escritos en el historico.", "", archive.Chunks());
+    metrics->Add(this, "uar_history_query_us", "Microsegundos por consulta al historico.", "", archive.QueryLatency());
+    metrics->Add(this, "uar_snapshots_total", "Instantaneas de la ultima muestra de cada angulo enviadas a clientes.", "",
+        snapshotsSent);
+    metrics->Add(this, "uar_websocket_clients", "Clientes conectados por WebSocket.", "", webSocketCount);
+    metrics->Add(this, "uar_sector_views", "Conjuntos de sectores distintos pedidos por los clientes.", "", sectorViewCount);
+    metrics->Add(this, "uar_latency_queueing_us", "Microsegundos desde que se completa la trama hasta que la toma el hilo de red.",
+        "", queueingLatency);
+    metrics->Add(this, "uar_latency_send_us", "Microsegundos desde que se encola un mensaje hasta que llega al kernel.", "",
+        network.SendLatency());
+    metrics->Add(this, "uar_latency_total_us", "Microsegundos desde que se completa la trama hasta que llega al kernel.", "",
+        network.TotalLatency());
+    metrics->AddCollector(this, [this](std::vector<MetricsRegistry::Value>& out) { CollectMetrics(out); });
+}
+
+void Protocol::CollectMetrics(std::vector<MetricsRegistry::Value>& out) const {
+    using Registry = MetricsRegistry;
+    out.push_back(Registry::Make("uar_clients_connected", "Clientes conectados.", "", Registry::GAUGE, (double)network.ClientCount()));
+    out.push_back(Registry::Make("uar_connections_accepted_total", "Conexiones aceptadas.", "", Registry::COUNTER,
+        (double)network.Accepted()));
+    out.push_back(Registry::Make("uar_bytes_sent_total", "Bytes entregados al kernel para todos los clientes.", "", Registry::COUNTER,
+        (double)network.BytesSent()));
+    out.push_back(Registry::Make("uar_messages_sent_total", "Mensajes enviados por completo a todos los clientes.", "",
+        Registry::COUNTER, (double)network.MessagesSent()));
+    out.push_back(Registry::Make("uar_messages_dropped_total", "Mensajes descartados por clientes lentos.", "", Registry::COUNTER,
+        (double)network.DroppedMessages()));
+    out.push_back(Registry::Make("uar_send_errors_total", "Envios fallidos (el cliente se desconecta).", "", Registry::COUNTER,
+        (double)network.SendErrors()));
+
+    for (const auto& device : devices) {
+        std::string radar = Registry::Label("radar", std::to_string(device->id));
+        out.push_back(Registry::Make("uar_sample_queue_depth", "Muestras en el anillo entre el lector y el hilo de red.", radar,
+            Registry::GAUGE, (double)device->samples.Size()));
+        out.push_back(Registry::Make("uar_sample_queue_peak", "Maximo de muestras en el anillo desde el arranque.", radar,
+            Registry::GAUGE, (double)device->samples.Peak()));
+        out.push_back(Registry::Make("uar_samples_dropped_total", "Muestras descartadas por anillo lleno.", radar,
+            Registry::COUNTER, (double)device->samples.Overruns()));
+    }
+
+    // Por cliente, desde la instantnea de EventLoop (se refresca como mucho cada segundo)
+    auto clients = network.Clients();
+    for (const auto& client : *clients) {
+        std::string labels = Registry::Label("client", std::to_string(client.id)) + "," + Registry::Label("address", client.address) +
+            "," + Registry::Label("device", client.device);
+        out.push_back(Registry::Make("uar_client_bytes_sent_total", "Bytes entregados al kernel por cliente.", labels,
+            Registry::COUNTER, (double)client.bytesSent));
+        out.push_back(Registry::Make("uar_client_messages_sent_total", "Mensajes enviados por cliente.", labels,
+            Registry::COUNTER, (double)client.messagesSent));
+        out.push_back(Registry::Make("uar_client_messages_dropped_total", "Mensajes descartados por cliente lento.", labels,
+            Registry::COUNTER, (double)client.dropped));
+        out.push_back(Registry::Make("uar_client_queue_messages", "Mensajes en la cola de envio del cliente.", labels,
+            Registry::GAUGE, (double)client.queued));
+        out.push_back(Registry::Make("uar_client_queue_bytes", "Bytes en la cola de envio del cliente.", labels,
+            Registry::GAUGE, (double)client.queuedBytes));
+        if (client.latency) {
+            out.push_back(Registry::Make("uar_client_latency_us", "Microsegundos desde que se completa la trama hasta que llega al "
+                "kernel, por cliente.", labels, client.latency));
         }
     }
 }
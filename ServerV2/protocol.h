@@ -1,38 +1,243 @@
 #pragma once
 
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#include <iphlpapi.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <thread>
-#include "handler.h"
+#include <unordered_map>
+#include "network.h"
+#include "eventloop.h"
+#include "spscring.h"
+#include "sweep.h"
+#include "deltafilter.h"
+#include "noisefilter.h"
+#include "decimator.h"
+#include "sectorindex.h"
+#include "occupancy.h"
+#include "tracker.h"
+#include "wireformat.h"
+#include "websocket.h"
+#include "samplesource.h"
+#include "capture.h"
+#include "history.h"
+#include "multicast.h"
+#include "metrics.h"
 #include "logger.h"
 
 class Protocol {
 public:
-    Protocol(const std::string& host, int port, Handler* arduinoHandler, int maxConnections, Logger* logger, bool debug);
+    static const EventLoop::Channel TEXT_CHANNEL = 0;   ///< Clientes que reciben "ángulo,distancia\n".
+    static const EventLoop::Channel BINARY_CHANNEL = 1; ///< Clientes que negociaron el formato de wireformat.h.
+    static const EventLoop::Channel DELTA_CHANNEL = 2;  ///< Se combina con el formato: clientes en modo delta.
+    static const EventLoop::Channel GRID_CHANNEL = 4;   ///< Se combina con el formato: clientes con "GRID ON".
+    static const EventLoop::Channel OBJECTS_CHANNEL = 8;       ///< Clientes con "OBJECTS ON": reciben los objetos seguidos.
+    static const EventLoop::Channel OBJECTS_ONLY_CHANNEL = 16; ///< Con OBJECTS_CHANNEL: sin muestras ni barridos.
+    static const EventLoop::Channel NEAREST_CHANNEL = 32;      ///< Con una tasa: la menor distancia de cada ángulo en vez de la última.
+    static const EventLoop::Channel WEBSOCKET_CHANNEL = 128;   ///< Se combina con el resto: cada mensaje va en una trama WebSocket.
+    static const size_t MAX_DEVICES = 32;               ///< Radares como máximo (uno por bit de la suscripción).
+
+    /**
+     * @param sources Un origen de muestras por radar; el índice es el identificador del radar.
+     * @param metrics Registro donde publicar los contadores mientras el servidor esté en marcha (opcional).
+     */
+    Protocol(const std::string& host, int port, const std::vector<SampleSource*>& sources, int maxConnections, Logger* logger,
+        bool debug, SendQueue::Policy slowClientPolicy = SendQueue::DROP_OLDEST, MetricsRegistry* metrics = nullptr);
     bool Start();
+
+    // Graba todas las muestras leídas en un archivo de captura; antes de Start
+    bool Capture(const std::string& path);
+
+    // Envía además todas las muestras filtradas por UDP (multicast, difusión de subred o un
+    // único equipo); antes de Start
+    bool Multicast(const std::string& host, int port, int ttl = 1);
+
+    // Guarda las muestras filtradas en el histórico del directorio y atiende "HISTORY"; antes de Start
+    bool History(const std::string& directory);
     void Stop();
 
     bool Debug() const;
     void Debug(bool value);
 
+    // Clientes conectados (instantánea, se puede consultar desde cualquier hilo)
+    std::shared_ptr<const std::vector<EventLoop::ClientInfo>> Clients() const;
+
+    // Estado de los anillos de muestras entre los lectores serie y el hilo de red (todos los radares)
+    size_t QueuedSamples() const;
+    size_t PeakQueuedSamples() const;
+    uint64_t DroppedSamples() const;
+
+    size_t DeviceCount() const;
+
+    // Radares a los que está suscrito un canal (un bit por radar); 0 si el cliente no envió
+    // "SUBSCRIBE" y recibe solo el radar 0 con el formato de siempre
+    static uint32_t Subscription(EventLoop::Channel channel);
+    static bool Includes(EventLoop::Channel channel, uint16_t device);
+
+    // Entregas de muestras por segundo que pidió un canal con "RATE"; 0 si recibe todas
+    static uint32_t Rate(EventLoop::Channel channel);
+
+    // Vista de sectores de un canal (ver SectorIndex); 0 si el cliente no envió "SECTOR" y recibe todos los ángulos
+    static uint32_t View(EventLoop::Channel channel);
+
+    // Último barrido completo de un radar (se puede consultar desde cualquier hilo)
+    bool LastSweep(SweepFrame& sweep, size_t device = 0) const;
+
+    // Configuración y contadores del filtro de ruido de un radar (se pueden usar desde cualquier hilo)
+    NoiseFilter& Noise(size_t device = 0);
+
+    // Configuración y contadores del modo delta de un radar (se pueden usar desde cualquier hilo)
+    DeltaFilter& Delta(size_t device = 0);
+
+    // Configuración y contadores de la rejilla de ocupación de un radar (se pueden usar desde cualquier hilo)
+    OccupancyGrid& Grid(size_t device = 0);
+
+    // Objetos seguidos por un radar (se pueden consultar desde cualquier hilo)
+    ObjectTracker& Tracker(size_t device = 0);
+
+    // Histórico de muestras (cerrado si no se configuró con History); se puede consultar desde cualquier hilo
+    const HistoryStore& Archive() const;
+
 private:
-    void AcceptClients();
-    void HandleClient(SOCKET clientSocket);
-    void ReadAndBroadcastArduinoData();
-    void BroadcastToClients(const std::string& message);
+    static const size_t PUBLISH_BATCH = 256;
+    static const int SUBSCRIPTION_SHIFT = 32;  ///< Posición de los bits de radares dentro del canal.
+    static const int RATE_SHIFT = 8;           ///< Posición de la tasa pedida dentro del canal (12 bits).
+    static const EventLoop::Channel RATE_BITS = (EventLoop::Channel)0xFFF << RATE_SHIFT;
+    static const int VIEW_SHIFT = 20;          ///< Posición de la vista de sectores dentro del canal (8 bits).
+    static const EventLoop::Channel VIEW_BITS = (EventLoop::Channel)0xFF << VIEW_SHIFT;
+    static const uint64_t REORDER_US = 5000;   ///< Retraso máximo entre que un lector fecha una muestra y la encola.
+    static const EventLoop::Channel PENDING_CHANNEL = 64;  ///< Recién conectados: aún no se sabe si son WebSocket.
+    static const uint64_t UPGRADE_WAIT_US = 200000;        ///< Espera máxima por la petición de WebSocket completa tras conectar.
+    static const size_t WRAP_CACHE = 4;                    ///< Tramas WebSocket recientes que se reutilizan.
+    static const size_t HISTORY_PIECE = 8192;              ///< Bytes por mensaje de una respuesta a "HISTORY".
+    static const size_t SNAPSHOT_MAX_BYTES = SendQueue::MAX_BYTES / 2;  ///< Con más radares, un mensaje por grupo de radares.
+    static const size_t MAX_LINE = 1024;                   ///< Bytes que se guardan de una línea de control sin terminar.
+
+    /// <summary>
+    /// Un radar: su origen de muestras, el hilo que lo lee y el anillo hacia el hilo de red,
+    /// más el estado por ángulo (filtro, barridos y modo delta) que solo toca el hilo de red.
+    /// </summary>
+    struct Device {
+        uint16_t id;
+        SampleSource* source;
+        std::thread reader;
+        SpscRing<RadarSample, 4096> samples;
+        NoiseFilter noise;
+        SweepAssembler sweeps;
+        DeltaFilter delta;
+        OccupancyGrid grid;
+        ObjectTracker tracker;
+        Counter read;                        ///< Muestras leídas del origen (hilo lector).
+        uint32_t nextSequence = 0;
+        uint64_t latest = 0;                 ///< Instante de la última muestra publicada.
+        RadarSample current[SweepFrame::MAX_ANGLE + 1];  ///< Última muestra publicada de cada ángulo.
+        bool seen[SweepFrame::MAX_ANGLE + 1] = {};       ///< Ángulos de current que ya tienen muestra.
+        RadarSample pending[PUBLISH_BATCH];  ///< Sacadas del anillo y aún sin mezclar.
+        size_t pendingStart = 0;
+        size_t pendingCount = 0;
+    };
+
+    /// Clientes que pidieron la misma tasa y el mismo modo: comparten la reducción de cada ventana.
+    struct RateClass {
+        EventLoop::Channel key;  ///< Bits de tasa y NEAREST_CHANNEL del canal.
+        std::unique_ptr<Decimator> decimator;
+    };
+
+    /// Estado de un cliente que empezó con una petición HTTP (solo el hilo de red).
+    struct WebSocketClient {
+        std::string buffer;     ///< Bytes recibidos aún sin procesar (petición o tramas).
+        std::string message;    ///< Fragmentos del mensaje en curso.
+        bool fragmented = false; ///< Hay un mensaje a medias: solo pueden seguir tramas CONTINUATION.
+        bool upgraded = false;  ///< Ya se respondió "101 Switching Protocols".
+    };
+
+    /// Parte de una respuesta a "HISTORY", preparada en el hilo de consultas del histórico.
+    struct HistoryReply {
+        EventLoop::ClientId client;
+        std::string text;
+    };
+
+    /// Cliente recién aceptado que aún no recibe difusiones.
+    struct Newcomer {
+        EventLoop::ClientId id;
+        uint64_t connectedAt;   ///< MonotonicMicros al aceptarlo.
+    };
+
+    void AcceptClient(EventLoop::ClientId client);
+    void CloseClient(EventLoop::ClientId client);
+    void Admit(EventLoop::ClientId client);
+    void AdmitNewcomers();
+    void HandleClient(EventLoop::ClientId client, const char* data, size_t length);
+    void HandleWebSocket(EventLoop::ClientId client, WebSocketClient& state, const char* data, size_t length);
+    void HandleLines(EventLoop::ClientId client, std::string& pending);
+    void HandleMessage(EventLoop::ClientId client, const char* data, size_t length);
+    size_t HandleControl(EventLoop::ClientId client, const char* data, size_t length);
+    void SetChannel(EventLoop::ClientId client, EventLoop::Channel channel);
+    void Reply(EventLoop::ClientId client, const std::string& message);
+    void Send(EventLoop::ClientId client, const std::string& message);
+    void Publish(const Frame& frame, EventLoop::Channel channel, uint64_t stamp = 0);
+    void Publish(const char* data, size_t length, EventLoop::Channel channel, uint64_t stamp = 0);
+    void ReadSamples(Device& device);
+    void PublishSamples();
+    size_t MergeSamples(RadarSample* out, size_t max);
+    void ScheduleWake();
+    void PublishBatch(const RadarSample* batch, size_t count, EventLoop::Channel channel, uint8_t flags);
+    void PublishSelection(const RadarSample* batch, size_t count, const SectorIndex::Selection& selection, EventLoop::Channel channel,
+        uint8_t flags);
+    void UpdateViews();
+    void UpdateRateClasses();
+    void PublishWindow(const RateClass& rateClass);
+    void PublishSweep(Device& device);
+    void PublishGrid(Device& device);
+    void SendGrid(EventLoop::ClientId client, EventLoop::Channel channel);
+    void SendSnapshots();
+    void SendSnapshot(EventLoop::ClientId client);
+    void QueryHistory(EventLoop::ClientId client, history::Level level, const history::Query& query);
+    void SendHistoryReplies();
+    void RegisterMetrics();
+    void CollectMetrics(std::vector<MetricsRegistry::Value>& out) const;
     std::string GetLocalIPAddress();
 
     SOCKET serverSocket;
-    Handler* arduinoHandler;
-    bool isRunning;
-    std::vector<SOCKET> clients;
+    std::vector<std::unique_ptr<Device>> devices;
+    std::atomic<bool> isRunning;
+    uint64_t startMicros;                            ///< Origen común de los instantes de todos los radares (MonotonicMicros).
+    EventLoop network;
+    std::vector<EventLoop::Channel> channels;        ///< Canales con clientes en la publicación en curso.
+    std::vector<RateClass> rateClasses;              ///< Reducciones de los canales con tasa (hilo de red).
+    SectorIndex sectors;                             ///< Sectores pedidos por los clientes (hilo de red).
+    SectorIndex::Selection selection;                ///< Reparto por vistas del lote en curso (hilo de red).
+    SectorIndex::Selection changeSelection;          ///< Lo mismo para los cambios del modo delta y las ventanas de tasa.
+    std::vector<uint32_t> views;                     ///< Vistas con clientes en la publicación en curso.
+    std::unordered_map<EventLoop::ClientId, WebSocketClient> webSockets;  ///< Clientes HTTP/WebSocket (hilo de red).
+    std::unordered_map<EventLoop::ClientId, std::string> lines;  ///< Líneas a medias de los clientes TCP (hilo de red).
+    std::vector<Newcomer> newcomers;                 ///< Clientes en PENDING_CHANNEL (hilo de red).
+    std::vector<EventLoop::ClientId> snapshots;      ///< Clientes admitidos que esperan su instantánea (hilo de red).
+    std::vector<RadarSample> snapshotSamples;        ///< Muestras de la instantánea en curso (hilo de red).
+    std::pair<Frame, Frame> wrapCache[WRAP_CACHE];   ///< Tramas originales y su versión WebSocket (hilo de red).
+    size_t wrapNext;
+    std::vector<GridCell> gridCells;                 ///< Celdas de la rejilla que se están codificando (hilo de red).
+    CaptureWriter capture; ///< Solo la usa el hilo de red mientras el servidor está en marcha.
+    MulticastSender udpOutput;                       ///< Salida UDP opcional (hilo de red).
+    HistoryStore archive;                            ///< Histórico opcional; el hilo de red solo encola en él.
+    uint64_t wallStart;                              ///< Hora real (microsegundos desde 1970) de startMicros.
+    std::mutex historyMutex;                         ///< Protege historyReplies.
+    std::vector<HistoryReply> historyReplies;        ///< Respuestas listas para enviar desde el hilo de red.
+    MetricsRegistry* metrics;                        ///< Registro de métricas, o nullptr.
+    Histogram batchSizes;                            ///< Muestras por lote publicado (hilo de red).
+    Histogram queueingLatency;                       ///< Microsegundos entre la trama y el hilo de red, por muestra.
+    Counter rateLimitedSamples;                      ///< Muestras entregadas en ventanas de tasa limitada (una vez por clase).
+    Gauge rateClassCount;                            ///< Clases de tasa activas.
+    Gauge sectorViewCount;                           ///< Conjuntos de sectores distintos en uso.
+    Gauge webSocketCount;                            ///< Clientes conectados por WebSocket.
+    Counter snapshotsSent;                           ///< Instantáneas enviadas a clientes recién admitidos o que la pidieron.
     int maxConnections;
     std::string port;
     Logger* logger;
     bool debug;
     sockaddr_in servAddr; 
-};
\ No newline at end of file
+};
@@ -0,0 +1,193 @@
+﻿#include "replay.h"
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+ReplaySource::ReplaySource(const std::string& path, double speed, Logger* logger, bool debug)
+    : path(path), speed(speed), logger(logger), debug(debug), records(nullptr), recordSize(0), count(0), position(0), loops(0),
+      firstTimestamp(0) {}
+
+bool ReplaySource::Debug() const {
+    return debug;
+}
+
+void ReplaySource::Debug(bool value) {
+    debug = value;
+}
+
+bool ReplaySource::Start() {
+    if (records != nullptr) {
+        return true;
+    }
+
+    if (!file.Open(path, false)) {
+        logger->Log("No se pudo abrir la captura " + path + ".", Logger::ERROR_LOG);
+        return false;
+    }
+
+    capture::Header header;
+    if (file.Size() < sizeof(header)) {
+        logger->Log("La captura " + path + " está vacía o incompleta.", Logger::ERROR_LOG);
+        file.Close();
+        return false;
+    }
+    memcpy(&header, file.Data(), sizeof(header));
+    // La versión 1 no guardaba el radar: sus registros son los 16 primeros bytes de RadarSample
+    size_t expected = header.version == 1 ? capture::RECORD_SIZE_V1 : sizeof(RadarSample);
+    if (memcmp(header.magic, capture::MAGIC, sizeof(header.magic)) != 0 || header.version == 0 ||
+        header.version > capture::VERSION || header.headerSize < sizeof(header) || header.recordSize != expected ||
+        header.headerSize > file.Size()) {
+        logger->Log("El archivo " + path + " no es una captura válida.", Logger::ERROR_LOG);
+        file.Close();
+        return false;
+    }
+
+    // Los registros empiezan en un múltiplo de 64 bytes del mapeo, así que están alineados
+    records = (const char*)file.Data() + header.headerSize;
+    recordSize = expected;
+    count = (file.Size() - header.headerSize) / recordSize;
+    if (header.records < count) {
+        count = (size_t)header.records;
+    }
+    count = Validate();
+
+    RadarSample scratch;
+    size_t first = 0;
+    while (first < count && Record(first, scratch).angle == capture::SYNC_ANGLE) {
+        first++;
+    }
+    if (first == count) {
+        logger->Log("La captura " + path + " no contiene muestras.", Logger::ERROR_LOG);
+        Stop();
+        return false;
+    }
+
+    firstTimestamp = Record(first, scratch).timestamp;
+    position = 0;
+    loops = 0;
+    origin = std::chrono::steady_clock::now();
+    logger->Log("Reproduciendo la captura " + path + " (" + std::to_string(count) + " registros) a velocidad " +
+        SpeedName(speed) + ".", Logger::INFO);
+    return true;
+}
+
+bool ReplaySource::ReadSample(RadarSample& sample) {
+    if (records == nullptr) {
+        std::this_thread::sleep_for(std::chrono::milliseconds((unsigned int)MAX_WAIT_MS));
+        return false;
+    }
+
+    // Los puntos de sincronización no son muestras; al final se vuelve a empezar
+    RadarSample scratch;
+    while (position >= count || Record(position, scratch).angle == capture::SYNC_ANGLE) {
+        if (position >= count) {
+            position = 0;
+            loops++;
+            origin = std::chrono::steady_clock::now();
+            LOG_DEBUG(logger, "Captura reiniciada (vuelta " + std::to_string(loops) + ").");
+            continue;
+        }
+        position++;
+    }
+
+    const RadarSample& record = Record(position, scratch);
+    if (speed > 0) {
+        uint64_t elapsed = record.timestamp > firstTimestamp ? record.timestamp - firstTimestamp : 0;
+        auto due = origin + std::chrono::microseconds((long long)(elapsed / speed));
+        auto now = std::chrono::steady_clock::now();
+        if (due > now) {
+            // Las esperas largas se reparten en varias lecturas para poder detener el hilo
+            if (due - now > std::chrono::milliseconds((unsigned int)MAX_WAIT_MS)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds((unsigned int)MAX_WAIT_MS));
+                return false;
+            }
+            std::this_thread::sleep_until(due);
+        }
+    }
+
+    sample = record;
+    position++;
+    if (debug) {
+        LOG_DEBUG(logger, "Datos de captura: " + std::to_string(sample.angle) + "," + std::to_string(sample.distance));
+    }
+    return true;
+}
+
+void ReplaySource::Stop() {
+    if (records == nullptr) {
+        return;
+    }
+
+    records = nullptr;
+    count = 0;
+    file.Close();
+    logger->Log("Reproducción de la captura detenida.", Logger::INFO);
+}
+
+bool ReplaySource::ParseSpeed(const std::string& text, double& speed) {
+    std::string value = text.rfind("--", 0) == 0 ? text.substr(2) : text;
+    if (value == "max") {
+        speed = 0;
+        return true;
+    }
+    if (!value.empty() && value.back() == 'x') {
+        value.pop_back();
+    }
+
+    try {
+        size_t used = 0;
+        double parsed = std::stod(value, &used);
+        if (used != value.size() || parsed <= 0) {
+            return false;
+        }
+        speed = parsed;
+        return true;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+std::string ReplaySource::SpeedName(double speed) {
+    if (speed <= 0) {
+        return "max";
+    }
+    std::ostringstream name;
+    name << speed << "x";
+    return name.str();
+}
+
+size_t ReplaySource::Validate() {
+    uint32_t checksum = capture::CHECKSUM_SEED;
+    size_t valid = 0;
+
+    RadarSample scratch;
+
+    for (size_t i = 0; i < count; ++i) {
+        const RadarSample& record = Record(i, scratch);
+        if (record.angle != capture::SYNC_ANGLE) {
+            checksum = capture::Checksum(checksum, records + i * recordSize, recordSize);
+            continue;
+        }
+
+        if (record.sequence != checksum) {
+            logger->Log("La captura " + path + " tiene un bloque dañado; se reproducirán " + std::to_string(valid) +
+                " de " + std::to_string(count) + " registros.", Logger::WARNING);
+            return valid;
+        }
+        checksum = capture::CHECKSUM_SEED;
+        valid = i + 1;
+    }
+    return valid;
+}
+
+const RadarSample& ReplaySource::Record(size_t index, RadarSample& scratch) const {
+    const char* record = records + index * recordSize;
+    if (recordSize == sizeof(RadarSample)) {
+        return *(const RadarSample*)record;
+    }
+
+    memcpy(&scratch, record, recordSize);
+    scratch.device = 0;
+    return scratch;
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include <chrono>
+#include <string>
+#include "capture.h"
+#include "samplesource.h"
+#include "logger.h"
+
+/// <summary>
+/// Origen de muestras que reproduce un archivo de captura en lugar de leer el Arduino.
+/// Respeta los intervalos grabados multiplicados por la velocidad (1x, Nx) o entrega las
+/// muestras tan rápido como se pidan (velocidad 0). Al llegar al final vuelve a empezar,
+/// así que sirve también como generador de carga.
+/// </summary>
+class ReplaySource : public SampleSource {
+public:
+    /**
+     * @brief Constructor de ReplaySource.
+     * @param path Archivo de captura.
+     * @param speed Factor de velocidad; 0 reproduce sin esperas.
+     * @param logger Instancia del logger para manejar mensajes de log.
+     * @param debug Indica si se activa el modo de depuración.
+     */
+    ReplaySource(const std::string& path, double speed, Logger* logger, bool debug = false);
+
+    bool Debug() const override;
+    void Debug(bool value) override;
+
+    /**
+     * @brief Abre y valida la captura. Si un bloque no coincide con su suma de comprobación,
+     *        se reproduce solo hasta el bloque anterior.
+     */
+    bool Start() override;
+    bool ReadSample(RadarSample& sample) override;
+    void Stop() override;
+
+    /**
+     * @brief Interpreta una velocidad: "1", "10", "0.5", "max" (con o sin "--" delante).
+     * @param speed Recibe el factor (0 para "max").
+     */
+    static bool ParseSpeed(const std::string& text, double& speed);
+
+    /**
+     * @brief Velocidad en texto para mostrarla ("max" o "Nx").
+     */
+    static std::string SpeedName(double speed);
+
+private:
+    static const unsigned int MAX_WAIT_MS = 100; ///< Espera máxima por lectura, permite detener el hilo lector.
+
+    size_t Validate();
+    const RadarSample& Record(size_t index, RadarSample& scratch) const;
+
+    std::string path;
+    double speed;
+    Logger* logger;
+    bool debug;
+
+    MappedFile file;
+    const char* records;
+    size_t recordSize;   ///< sizeof(RadarSample), o RECORD_SIZE_V1 en capturas de la versión 1.
+    size_t count;        ///< Registros válidos (incluidos los de sincronización).
+    size_t position;
+    uint64_t loops;
+    uint64_t firstTimestamp;
+    std::chrono::steady_clock::time_point origin; ///< Instante real que corresponde a firstTimestamp.
+};
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// Muestra del radar ya interpretada: ángulo del servo, distancia medida y cuándo se leyó.
+/// </summary>
+struct RadarSample {
+    uint16_t angle;    ///< Ángulo del servo en grados (15-165 en el sketch actual).
+    uint16_t distance; ///< Distancia en centímetros (maxDistance si no hubo eco).
+    uint32_t sequence; ///< Número de muestra del radar asignado al leerla; los huecos indican muestras descartadas.
+    uint64_t timestamp; ///< Instante de lectura en microsegundos de reloj monotónico (steady_clock).
+    uint16_t device;   ///< Radar que tomó la muestra (índice en Protocol; 0 con un único Arduino).
+};
+
+/**
+ * @brief Escribe la muestra en el formato de texto que reciben los clientes ("ángulo,distancia\n").
+ * @param sample Muestra a formatear.
+ * @param out Buffer de al menos 16 bytes.
+ * @return Número de bytes escritos.
+ */
+inline size_t FormatSample(const RadarSample& sample, char* out) {
+    char digits[5];
+    size_t length = 0;
+
+    unsigned value = sample.angle;
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (count > 0) {
+        out[length++] = digits[--count];
+    }
+
+    out[length++] = ',';
+
+    value = sample.distance;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (count > 0) {
+        out[length++] = digits[--count];
+    }
+
+    out[length++] = '\n';
+    return length;
+}
+
+/**
+ * @brief Como FormatSample, pero con el radar delante ("radar:ángulo,distancia\n"), para los
+ *        clientes suscritos a varios radares.
+ * @param out Buffer de al menos 24 bytes.
+ * @return Número de bytes escritos.
+ */
+inline size_t FormatDeviceSample(const RadarSample& sample, char* out) {
+    char digits[5];
+    size_t length = 0;
+    size_t count = 0;
+
+    unsigned value = sample.device;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (count > 0) {
+        out[length++] = digits[--count];
+    }
+
+    out[length++] = ':';
+    return length + FormatSample(sample, out + length);
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "sample.h"
+
+/// <summary>
+/// Origen de las muestras que Protocol difunde: el Arduino por el puerto serie (Handler)
+/// o una captura grabada (ReplaySource). Protocol solo usa esta interfaz, de modo que
+/// cualquier origen puede sustituir al hardware.
+/// </summary>
+class SampleSource {
+public:
+    virtual ~SampleSource() {}
+
+    /**
+     * @brief Prepara el origen para empezar a leer.
+     * @return true si está listo.
+     */
+    virtual bool Start() = 0;
+
+    /**
+     * @brief Lee la siguiente muestra. No debe bloquear mucho más de 100 ms, para que el
+     *        hilo lector pueda detenerse a tiempo. Si el origen conoce el instante en que se
+     *        completó la muestra lo deja en sample.timestamp (MonotonicMicros); si lo deja a 0,
+     *        Protocol la fecha al recibirla.
+     * @return true si se obtuvo una muestra.
+     */
+    virtual bool ReadSample(RadarSample& sample) = 0;
+
+    /**
+     * @brief Libera el origen.
+     */
+    virtual void Stop() = 0;
+
+    /**
+     * @brief Propiedad para habilitar o deshabilitar el modo de depuración.
+     */
+    virtual bool Debug() const = 0;
+    virtual void Debug(bool value) = 0;
+};
@@ -0,0 +1,101 @@
+﻿#include "scene.h"
+
+namespace {
+    // Objetos fijos de la escena: [desde, hasta) grados a una distancia en cm
+    struct Obstacle {
+        uint16_t from;
+        uint16_t to;
+        uint16_t distance;
+    };
+
+    const Obstacle OBSTACLES[] = {
+        { 30, 45, 42 },   // pared
+        { 100, 110, 25 }, // mueble
+    };
+
+    const int MIN_TARGET_DISTANCE = 80;  // décimas de cm
+    const int MAX_TARGET_DISTANCE = 450;
+}
+
+SyntheticScene::SyntheticScene(size_t targets, uint32_t seed)
+    : targetCount(targets < MAX_TARGETS ? targets : MAX_TARGETS), seed(seed), angle(MIN_ANGLE), forward(true), sweeps(0) {
+    for (size_t i = 0; i < targetCount; ++i) {
+        Target& target = this->targets[i];
+        target.angle = (int)(MIN_ANGLE + Random() % (MAX_ANGLE - MIN_ANGLE)) * 10;
+        target.distance = MIN_TARGET_DISTANCE + (int)(Random() % (MAX_TARGET_DISTANCE - MIN_TARGET_DISTANCE));
+        target.angleStep = (int)(Random() % 31) - 15;
+        target.distanceStep = (int)(Random() % 21) - 10;
+        target.width = 3 + (int)(Random() % 4);
+    }
+}
+
+void SyntheticScene::Next(RadarSample& sample) {
+    sample.angle = angle;
+    sample.distance = Distance(angle);
+
+    // Mismo recorrido que moveServo(): de grado en grado y cambio de sentido en los extremos
+    if (forward ? angle >= MAX_ANGLE : angle <= MIN_ANGLE) {
+        forward = !forward;
+        sweeps++;
+        MoveTargets();
+    }
+    angle = (uint16_t)(forward ? angle + 1 : angle - 1);
+}
+
+size_t SyntheticScene::Targets() const {
+    return targetCount;
+}
+
+uint64_t SyntheticScene::Sweeps() const {
+    return sweeps;
+}
+
+void SyntheticScene::MoveTargets() {
+    for (size_t i = 0; i < targetCount; ++i) {
+        Target& target = targets[i];
+
+        // Rebotan en los límites del barrido y del alcance
+        target.angle += target.angleStep;
+        if (target.angle < MIN_ANGLE * 10 || target.angle > MAX_ANGLE * 10) {
+            target.angleStep = -target.angleStep;
+            target.angle += 2 * target.angleStep;
+        }
+        target.distance += target.distanceStep;
+        if (target.distance < MIN_TARGET_DISTANCE || target.distance > MAX_TARGET_DISTANCE) {
+            target.distanceStep = -target.distanceStep;
+            target.distance += 2 * target.distanceStep;
+        }
+    }
+}
+
+uint32_t SyntheticScene::Random() {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 16;
+}
+
+uint16_t SyntheticScene::Distance(uint16_t angle) {
+    // Se devuelve el eco más cercano, como el primer rebote que mide el sensor
+    int nearest = NO_ECHO * 10;
+    for (size_t i = 0; i < targetCount; ++i) {
+        const Target& target = targets[i];
+        int offset = angle * 10 - target.angle;
+        if (offset < 0) {
+            offset = -offset;
+        }
+        if (offset * 2 <= target.width * 10 && target.distance < nearest) {
+            nearest = target.distance;
+        }
+    }
+    for (const Obstacle& obstacle : OBSTACLES) {
+        if (angle >= obstacle.from && angle < obstacle.to && obstacle.distance * 10 < nearest) {
+            nearest = obstacle.distance * 10;
+        }
+    }
+    if (nearest == NO_ECHO * 10) {
+        return NO_ECHO;
+    }
+
+    // Ruido de medida de +-1 cm sobre los ecos
+    int distance = (nearest + 5) / 10 + (int)(Random() % 3) - 1;
+    return (uint16_t)(distance > 1 ? distance : 1);
+}
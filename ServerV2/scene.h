@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "sample.h"
+
+/// <summary>
+/// Escena simulada para generar muestras sin hardware: un barrido de MIN_ANGLE a MAX_ANGLE
+/// y vuelta, de grado en grado como el sketch, sobre un fondo sin eco (el sketch devuelve
+/// maxDistance) con algunos objetos fijos y varios blancos que se mueven.
+/// Los blancos avanzan una vez por barrido, de modo que la escena cambia igual a 30
+/// muestras por segundo que a un millón. Es determinista: la misma semilla da siempre las
+/// mismas muestras.
+/// </summary>
+class SyntheticScene {
+public:
+    static const uint16_t MIN_ANGLE = 15;
+    static const uint16_t MAX_ANGLE = 165;
+    static const uint16_t NO_ECHO = 50;     ///< maxDistance del sketch.
+    static const size_t MAX_TARGETS = 8;
+
+    /**
+     * @brief Crea la escena.
+     * @param targets Número de blancos en movimiento (como máximo MAX_TARGETS).
+     * @param seed Semilla del ruido y de la posición inicial de los blancos.
+     */
+    explicit SyntheticScene(size_t targets = 3, uint32_t seed = 1);
+
+    /**
+     * @brief Genera la siguiente muestra del barrido. Solo rellena angle y distance.
+     */
+    void Next(RadarSample& sample);
+
+    size_t Targets() const;
+    uint64_t Sweeps() const; ///< Barridos completados.
+
+private:
+    struct Target {
+        int angle;      ///< Centro del blanco en décimas de grado.
+        int distance;   ///< Distancia en décimas de centímetro.
+        int angleStep;  ///< Avance por barrido en décimas de grado.
+        int distanceStep;
+        int width;      ///< Anchura angular en grados.
+    };
+
+    void MoveTargets();
+    uint32_t Random();
+    uint16_t Distance(uint16_t angle);
+
+    Target targets[MAX_TARGETS];
+    size_t targetCount;
+    uint32_t seed;
+    uint16_t angle;
+    bool forward;
+    uint64_t sweeps;
+};
@@ -0,0 +1,137 @@
+﻿#include "sectorindex.h"
+#include <algorithm>
+
+bool Sector::ParseRange(const std::string& text, unsigned long max, uint16_t& low, uint16_t& high) {
+    size_t dash = text.find('-');
+    std::string first = text.substr(0, dash);
+    std::string second = dash == std::string::npos ? first : text.substr(dash + 1);
+    for (const std::string& number : { first, second }) {
+        if (number.empty() || number.size() > 5 || number.find_first_not_of("0123456789") != std::string::npos ||
+            std::stoul(number) > max) {
+            return false;
+        }
+    }
+    low = (uint16_t)std::stoul(first);
+    high = (uint16_t)std::stoul(second);
+    return low <= high;
+}
+
+const RadarSample* SectorIndex::Selection::Samples(uint32_t view) const {
+    return view < samples.size() ? samples[view].data() : nullptr;
+}
+
+size_t SectorIndex::Selection::Count(uint32_t view) const {
+    return view < samples.size() ? samples[view].size() : 0;
+}
+
+SectorIndex::SectorIndex() : views(1), active(0), offsets() {}
+
+uint32_t SectorIndex::Acquire(const std::vector<Sector>& sectors) {
+    if (sectors.empty()) {
+        return 0;
+    }
+
+    uint32_t free = 0;
+    for (uint32_t view = 1; view < views.size(); ++view) {
+        if (views[view] == sectors) {
+            return view;
+        }
+        if (free == 0 && views[view].empty()) {
+            free = view;
+        }
+    }
+    if (free == 0) {
+        if (views.size() > MAX_VIEWS) {
+            return 0;
+        }
+        free = (uint32_t)views.size();
+        views.emplace_back();
+    }
+
+    views[free] = sectors;
+    active++;
+    Rebuild();
+    return free;
+}
+
+void SectorIndex::Prune(const std::vector<uint32_t>& used) {
+    bool changed = false;
+    for (uint32_t view = 1; view < views.size(); ++view) {
+        if (!views[view].empty() && std::find(used.begin(), used.end(), view) == used.end()) {
+            views[view].clear();
+            active--;
+            changed = true;
+        }
+    }
+    if (changed) {
+        Rebuild();
+    }
+}
+
+void SectorIndex::Select(const RadarSample* batch, size_t count, Selection& out) const {
+    if (out.samples.size() < views.size()) {
+        out.samples.resize(views.size());
+    }
+    for (uint32_t view : out.touched) {
+        out.samples[view].clear();
+    }
+    out.touched.clear();
+
+    for (size_t i = 0; i < count; ++i) {
+        const RadarSample& sample = batch[i];
+        if (sample.angle >= ANGLES) {
+            continue;
+        }
+
+        // Las entradas de una vista van seguidas: si dos sectores suyos se solapan, la muestra
+        // se añade una sola vez
+        uint32_t last = 0;
+        for (uint32_t e = offsets[sample.angle]; e < offsets[sample.angle + 1]; ++e) {
+            const Entry& entry = entries[e];
+            if (entry.view == last || sample.distance < entry.minDistance || sample.distance > entry.maxDistance) {
+                continue;
+            }
+            std::vector<RadarSample>& selected = out.samples[entry.view];
+            if (selected.empty()) {
+                out.touched.push_back(entry.view);
+            }
+            selected.push_back(sample);
+            last = entry.view;
+        }
+    }
+}
+
+size_t SectorIndex::Views() const {
+    return active;
+}
+
+const std::vector<Sector>& SectorIndex::Sectors(uint32_t view) const {
+    return view < views.size() ? views[view] : views[0];
+}
+
+void SectorIndex::Rebuild() {
+    // Dos pasadas: contar las entradas de cada ángulo y después colocarlas (como un CSR)
+    uint32_t counts[ANGLES] = {};
+    for (uint32_t view = 1; view < views.size(); ++view) {
+        for (const Sector& sector : views[view]) {
+            for (uint32_t angle = sector.minAngle; angle <= sector.maxAngle && angle < ANGLES; ++angle) {
+                counts[angle]++;
+            }
+        }
+    }
+    offsets[0] = 0;
+    for (size_t angle = 0; angle < ANGLES; ++angle) {
+        offsets[angle + 1] = offsets[angle] + counts[angle];
+    }
+
+    entries.resize(offsets[ANGLES]);
+    uint32_t next[ANGLES];
+    std::copy(offsets, offsets + ANGLES, next);
+    for (uint32_t view = 1; view < views.size(); ++view) {
+        for (const Sector& sector : views[view]) {
+            for (uint32_t angle = sector.minAngle; angle <= sector.maxAngle && angle < ANGLES; ++angle) {
+                entries[next[angle]++] = { view, sector.minDistance, sector.maxDistance };
+            }
+        }
+    }
+}
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sample.h"
+#include "sweep.h"
+
+/// <summary>
+/// Zona de interés de un cliente: un intervalo cerrado de ángulos y otro de distancias.
+/// </summary>
+struct Sector {
+    static const uint16_t MAX_DISTANCE = 0xFFFF;
+
+    uint16_t minAngle;
+    uint16_t maxAngle;
+    uint16_t minDistance;
+    uint16_t maxDistance;
+
+    bool Contains(const RadarSample& sample) const {
+        return sample.angle >= minAngle && sample.angle <= maxAngle && sample.distance >= minDistance &&
+            sample.distance <= maxDistance;
+    }
+
+    bool operator==(const Sector& other) const {
+        return minAngle == other.minAngle && maxAngle == other.maxAngle && minDistance == other.minDistance &&
+            maxDistance == other.maxDistance;
+    }
+
+    /**
+     * @brief Lee un intervalo "a-b" o un único número, sin signos ni espacios, como los de "SECTOR"
+     *        y "HISTORY".
+     * @return false si no se entiende, algún extremo pasa de max o a es mayor que b.
+     */
+    static bool ParseRange(const std::string& text, unsigned long max, uint16_t& low, uint16_t& high);
+};
+
+/// <summary>
+/// Índice de intervalos de las suscripciones por sectores ("SECTOR"). Los clientes con los
+/// mismos sectores comparten una vista (identificador 1-MAX_VIEWS que Protocol guarda en el
+/// canal), así que cada muestra se reparte una vez por vista y no por cliente. Como los
+/// ángulos son pocos y discretos, cada intervalo de ángulos se expande al reconstruir el
+/// índice en una entrada por ángulo que cubre (con su banda de distancias): repartir una
+/// muestra consulta solo las entradas de su ángulo, sin recorrer las vistas que no la
+/// contienen. Reconstruir es raro (solo cuando aparece o desaparece una vista). Solo desde
+/// el hilo de red.
+/// </summary>
+class SectorIndex {
+public:
+    static const uint32_t MAX_VIEWS = 255;     ///< Conjuntos de sectores distintos a la vez.
+    static const size_t MAX_SECTORS = 8;       ///< Sectores por cliente.
+    static const size_t ANGLES = SweepFrame::MAX_ANGLE + 1;
+
+    /// Muestras de un lote que caen en cada vista.
+    class Selection {
+    public:
+        const RadarSample* Samples(uint32_t view) const;
+        size_t Count(uint32_t view) const;
+
+    private:
+        friend class SectorIndex;
+        std::vector<std::vector<RadarSample>> samples;  ///< Por vista.
+        std::vector<uint32_t> touched;                  ///< Vistas con alguna muestra en el último lote.
+    };
+
+    SectorIndex();
+
+    /**
+     * @brief Vista de un conjunto de sectores; conjuntos iguales (en el mismo orden) comparten vista.
+     * @return Identificador de 1 a MAX_VIEWS, o 0 si no caben más vistas o sectors está vacío.
+     */
+    uint32_t Acquire(const std::vector<Sector>& sectors);
+
+    /**
+     * @brief Libera las vistas que no estén en used y reconstruye el índice si cambió algo.
+     */
+    void Prune(const std::vector<uint32_t>& used);
+
+    /**
+     * @brief Reparte un lote entre las vistas. Las muestras de ángulos fuera de rango no caen
+     *        en ningún sector.
+     */
+    void Select(const RadarSample* batch, size_t count, Selection& out) const;
+
+    size_t Views() const;  ///< Vistas en uso.
+
+    /**
+     * @brief Sectores de una vista (vacío si no existe).
+     */
+    const std::vector<Sector>& Sectors(uint32_t view) const;
+
+private:
+    /// Un sector de una vista en un ángulo concreto.
+    struct Entry {
+        uint32_t view;
+        uint16_t minDistance;
+        uint16_t maxDistance;
+    };
+
+    void Rebuild();
+
+    std::vector<std::vector<Sector>> views;  ///< Sectores de cada vista; vacío si la vista está libre (la 0 nunca se usa).
+    size_t active;                           ///< Vistas en uso.
+    uint32_t offsets[ANGLES + 1];            ///< Entradas de cada ángulo: de offsets[a] a offsets[a + 1].
+    std::vector<Entry> entries;              ///< Por ángulo y, dentro de cada ángulo, por vista.
+};
@@ -0,0 +1,213 @@
+﻿#include "sendqueue.h"
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <sys/uio.h>
+#endif
+
+SendQueue::SendQueue() : stamps(), queuedAt(), head(0), count(0), offset(0), bytes(0), dropped(0), sent(0), messages(0) {}
+
+bool SendQueue::Push(const Frame& frame, Policy policy, uint64_t stamp, uint64_t queuedAt) {
+    size_t size = frame->size();
+
+    if (count == MAX_FRAMES || bytes + size > MAX_BYTES) {
+        if (policy == DISCONNECT) {
+            return false;
+        }
+
+        if (policy == COALESCE_LATEST) {
+            // Solo se conserva el mensaje a medio enviar, si lo hay, para no cortar el flujo.
+            while (count > (offset > 0 ? 1u : 0u)) {
+                DropOne();
+            }
+        }
+        else {
+            while (count > (offset > 0 ? 1u : 0u) && (count == MAX_FRAMES || bytes + size > MAX_BYTES)) {
+                DropOne();
+            }
+        }
+
+        // Un único mensaje mayor que el límite no se puede encolar de ninguna forma.
+        if (count == MAX_FRAMES || bytes + size > MAX_BYTES) {
+            dropped++;
+            return true;
+        }
+    }
+
+    size_t slot = (head + count) & MASK;
+    frames[slot] = frame;
+    stamps[slot] = stamp;
+    this->queuedAt[slot] = queuedAt;
+    count++;
+    bytes += size;
+    return true;
+}
+
+void SendQueue::DropOne() {
+    if (offset > 0) {
+        // El primero ya salió en parte: se descarta el segundo y el primero ocupa su lugar.
+        Frame& second = frames[(head + 1) & MASK];
+        bytes -= second->size();
+        second = std::move(frames[head & MASK]);
+        stamps[(head + 1) & MASK] = stamps[head & MASK];
+        queuedAt[(head + 1) & MASK] = queuedAt[head & MASK];
+    }
+    else {
+        Frame& first = frames[head & MASK];
+        bytes -= first->size();
+        first.reset();
+    }
+    head++;
+    count--;
+    dropped++;
+}
+
+void SendQueue::Consume(size_t written, const Latency* latency) {
+    uint64_t now = 0;
+    sent += written;
+    while (written > 0) {
+        Frame& first = frames[head & MASK];
+        size_t remaining = first->size() - offset;
+        if (written < remaining) {
+            offset += written;
+            bytes -= written;
+            return;
+        }
+
+        // El mensaje acaba de llegar entero al kernel: aquí termina su latencia
+        uint64_t stamp = stamps[head & MASK];
+        if (stamp != 0 && latency != nullptr) {
+            now = now != 0 ? now : MonotonicMicros();
+            if (latency->send != nullptr) {
+                latency->send->Record(now > queuedAt[head & MASK] ? now - queuedAt[head & MASK] : 0);
+            }
+            uint64_t total = now > stamp ? now - stamp : 0;
+            if (latency->total != nullptr) {
+                latency->total->Record(total);
+            }
+            if (latency->client != nullptr) {
+                latency->client->Record(total);
+            }
+        }
+
+        written -= remaining;
+        bytes -= remaining;
+        first.reset();
+        head++;
+        count--;
+        offset = 0;
+        messages++;
+    }
+}
+
+SendQueue::FlushResult SendQueue::Flush(SOCKET socket, const Latency* latency) {
+    while (count > 0) {
+        size_t batch = count < MAX_BATCH ? count : MAX_BATCH;
+
+#if defined(_WIN32) || defined(_WIN64)
+        WSABUF buffers[MAX_BATCH];
+        for (size_t i = 0; i < batch; ++i) {
+            const std::string& data = *frames[(head + i) & MASK];
+            size_t skip = (i == 0) ? offset : 0;
+            buffers[i].buf = const_cast<char*>(data.data() + skip);
+            buffers[i].len = (ULONG)(data.size() - skip);
+        }
+
+        DWORD written = 0;
+        if (WSASend(socket, buffers, (DWORD)batch, &written, 0, nullptr, nullptr) == SOCKET_ERROR) {
+            int error = net::LastError();
+            if (net::Interrupted(error)) {
+                continue;
+            }
+            return net::WouldBlock(error) ? PENDING : FAILED;
+        }
+#else
+        iovec buffers[MAX_BATCH];
+        for (size_t i = 0; i < batch; ++i) {
+            const std::string& data = *frames[(head + i) & MASK];
+            size_t skip = (i == 0) ? offset : 0;
+            buffers[i].iov_base = const_cast<char*>(data.data() + skip);
+            buffers[i].iov_len = data.size() - skip;
+        }
+
+        // sendmsg en lugar de writev para poder pasar MSG_NOSIGNAL.
+        msghdr message = {};
+        message.msg_iov = buffers;
+        message.msg_iovlen = batch;
+        ssize_t written = sendmsg(socket, &message, net::SEND_FLAGS);
+        if (written < 0) {
+            int error = net::LastError();
+            if (net::Interrupted(error)) {
+                continue;
+            }
+            return net::WouldBlock(error) ? PENDING : FAILED;
+        }
+#endif
+
+        if (written == 0) {
+            return PENDING;
+        }
+        Consume((size_t)written, latency);
+    }
+    return FLUSHED;
+}
+
+void SendQueue::Clear() {
+    while (count > 0) {
+        frames[head & MASK].reset();
+        head++;
+        count--;
+    }
+    offset = 0;
+    bytes = 0;
+}
+
+bool SendQueue::Empty() const {
+    return count == 0;
+}
+
+size_t SendQueue::Bytes() const {
+    return bytes;
+}
+
+uint64_t SendQueue::Dropped() const {
+    return dropped;
+}
+
+uint64_t SendQueue::Sent() const {
+    return sent;
+}
+
+uint64_t SendQueue::Messages() const {
+    return messages;
+}
+
+size_t SendQueue::Count() const {
+    return count;
+}
+
+bool SendQueue::ParsePolicy(const std::string& name, Policy& policy) {
+    if (name == "drop") {
+        policy = DROP_OLDEST;
+    }
+    else if (name == "latest") {
+        policy = COALESCE_LATEST;
+    }
+    else if (name == "disconnect") {
+        policy = DISCONNECT;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+const char* SendQueue::PolicyName(Policy policy) {
+    switch (policy) {
+    case DROP_OLDEST:
+        return "drop";
+    case COALESCE_LATEST:
+        return "latest";
+    default:
+        return "disconnect";
+    }
+}
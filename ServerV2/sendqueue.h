@@ -0,0 +1,119 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "network.h"
+#include "frame.h"
+#include "metrics.h"
+
+/// <summary>
+/// Cola de envío acotada de un cliente. Guarda referencias a Frames compartidos y los
+/// envía juntos con una sola llamada scatter-gather (sendmsg en POSIX, WSASend en Windows).
+/// Cuando el cliente no consume a tiempo, la política configurada decide qué se descarta,
+/// así la memoria por cliente no crece y un cliente lento no retrasa a los demás.
+/// </summary>
+class SendQueue {
+public:
+    /// Qué hacer cuando la cola de un cliente se llena.
+    enum Policy {
+        DROP_OLDEST,     ///< Descarta los mensajes más antiguos y conserva los nuevos.
+        COALESCE_LATEST, ///< Descarta todo lo pendiente y deja solo el último mensaje.
+        DISCONNECT       ///< Cierra la conexión del cliente.
+    };
+
+    /// Resultado de Flush.
+    enum FlushResult {
+        FLUSHED, ///< Se envió todo lo pendiente.
+        PENDING, ///< El socket no acepta más datos; quedan mensajes en la cola.
+        FAILED   ///< Error de envío: la conexión debe cerrarse.
+    };
+
+    /// Histogramas donde Flush anota, al entregar al kernel el último byte de un mensaje fechado,
+    /// cuántos microsegundos pasaron. Cualquiera puede ser nullptr.
+    struct Latency {
+        Histogram* send;    ///< Desde que se encoló.
+        Histogram* total;   ///< Desde que se completó la trama de su muestra más antigua.
+        Histogram* client;  ///< Lo mismo que total, solo para el cliente de esta cola.
+    };
+
+    static const size_t MAX_FRAMES = 256;        ///< Mensajes pendientes máximos (potencia de dos).
+    static const size_t MAX_BYTES = 64 * 1024;   ///< Bytes pendientes máximos.
+    static const size_t MAX_BATCH = 64;          ///< Mensajes por llamada de envío.
+
+    SendQueue();
+
+    /**
+     * @brief Añade un mensaje aplicando la política si la cola está llena.
+     * @param stamp Instante (MonotonicMicros) en que se completó la trama de la muestra más
+     *        antigua del mensaje; 0 si no se mide su latencia.
+     * @param queuedAt Instante en que se encoló, para la latencia de envío.
+     * @return false si, según la política, el cliente debe desconectarse.
+     */
+    bool Push(const Frame& frame, Policy policy, uint64_t stamp = 0, uint64_t queuedAt = 0);
+
+    /**
+     * @brief Envía todo lo posible sin bloquear.
+     * @param latency Dónde anotar la latencia de los mensajes fechados que se terminan de enviar.
+     */
+    FlushResult Flush(SOCKET socket, const Latency* latency = nullptr);
+
+    /**
+     * @brief Descarta todos los mensajes pendientes.
+     */
+    void Clear();
+
+    bool Empty() const;
+
+    /**
+     * @brief Bytes pendientes de enviar.
+     */
+    size_t Bytes() const;
+
+    /**
+     * @brief Mensajes descartados por la política desde que se creó la cola.
+     */
+    uint64_t Dropped() const;
+
+    /**
+     * @brief Bytes enviados en total desde que se creó la cola.
+     */
+    uint64_t Sent() const;
+
+    /**
+     * @brief Mensajes enviados por completo desde que se creó la cola.
+     */
+    uint64_t Messages() const;
+
+    /**
+     * @brief Mensajes pendientes de enviar.
+     */
+    size_t Count() const;
+
+    /**
+     * @brief Convierte el nombre de una política ("drop", "latest", "disconnect").
+     * @return true si el nombre es válido.
+     */
+    static bool ParsePolicy(const std::string& name, Policy& policy);
+
+    /**
+     * @brief Nombre de la política para mostrarlo en la configuración.
+     */
+    static const char* PolicyName(Policy policy);
+
+private:
+    static const size_t MASK = MAX_FRAMES - 1;
+
+    void DropOne();
+    void Consume(size_t written, const Latency* latency);
+
+    Frame frames[MAX_FRAMES]; ///< Anillo de referencias a mensajes.
+    uint64_t stamps[MAX_FRAMES];   ///< Instante de la muestra más antigua de cada mensaje (0 sin medir).
+    uint64_t queuedAt[MAX_FRAMES]; ///< Instante en que se encoló cada mensaje fechado.
+    size_t head;              ///< Índice (absoluto) del mensaje más antiguo.
+    size_t count;             ///< Mensajes en la cola.
+    size_t offset;            ///< Bytes ya enviados del mensaje más antiguo.
+    size_t bytes;             ///< Bytes pendientes (sin contar offset).
+    uint64_t dropped;         ///< Mensajes descartados.
+    uint64_t sent;            ///< Bytes enviados.
+    uint64_t messages;        ///< Mensajes enviados.
+};
@@ -1,5 +1,7 @@
 #include "serial.h"
 
+#if defined(_WIN32) || defined(_WIN64)
+
 // Constructor
 Serial::Serial() {
     currentStateRTS = true;
@@ -17,6 +19,7 @@ char Serial::openDevice(const char* device, const unsigned int baudRate,
     SerialDataBits dataBits,
     SerialParity parity,
     SerialStopBits stopBits) {
+    closeDevice();
     hSerial = CreateFileA(device, GENERIC_READ | GENERIC_WRITE, 0, 0, OPEN_EXISTING, 0, 0);
     if (hSerial == INVALID_HANDLE_VALUE) {
         return (GetLastError() == ERROR_FILE_NOT_FOUND) ? -1 : -2;
@@ -25,7 +28,10 @@ char Serial::openDevice(const char* device, const unsigned int baudRate,
     DCB dcbSerialParams;
     dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
 
-    if (!GetCommState(hSerial, &dcbSerialParams)) return -3;
+    if (!GetCommState(hSerial, &dcbSerialParams)) {
+        closeDevice();
+        return -3;
+    }
 
     // Configuracin de la velocidad de baudios
     switch (baudRate) {
@@ -44,7 +50,14 @@ char Serial::openDevice(const char* device, const unsigned int baudRate,
     case 115200: dcbSerialParams.BaudRate = CBR_115200; break;
     case 128000: dcbSerialParams.BaudRate = CBR_128000; break;
     case 256000: dcbSerialParams.BaudRate = CBR_256000; break;
-    default: return -4;
+    default:
+        // El controlador acepta tasas no estndar directamente en BaudRate
+        if (baudRate == 0) {
+            closeDevice();
+            return -4;
+        }
+        dcbSerialParams.BaudRate = baudRate;
+        break;
     }
 
     // Configuracin de los bits de datos
@@ -55,7 +68,7 @@ char Serial::openDevice(const char* device, const unsigned int baudRate,
     case SERIAL_DATABITS_7: byteSize = 7; break;
     case SERIAL_DATABITS_8: byteSize = 8; break;
     case SERIAL_DATABITS_16: byteSize = 16; break;
-    default: return -7;
+    default: closeDevice(); return -7;
     }
 
     // Configuracin de los bits de parada
@@ -64,7 +77,7 @@ char Serial::openDevice(const char* device, const unsigned int baudRate,
     case SERIAL_STOPBITS_1: stopBitsValue = ONESTOPBIT; break;
     case SERIAL_STOPBITS_1_5: stopBitsValue = ONE5STOPBITS; break;
     case SERIAL_STOPBITS_2: stopBitsValue = TWOSTOPBITS; break;
-    default: return -8;
+    default: closeDevice(); return -8;
     }
 
     // Configuracin de la paridad
@@ -75,7 +88,7 @@ char Serial::openDevice(const char* device, const unsigned int baudRate,
     case SERIAL_PARITY_ODD: parityValue = ODDPARITY; break;
     case SERIAL_PARITY_MARK: parityValue = MARKPARITY; break;
     case SERIAL_PARITY_SPACE: parityValue = SPACEPARITY; break;
-    default: return -9;
+    default: closeDevice(); return -9;
     }
 
     // Asignar configuraciones a dcbSerialParams
@@ -84,23 +97,41 @@ char Serial::openDevice(const char* device, const unsigned int baudRate,
     dcbSerialParams.Parity = parityValue;
 
     // Aplicar configuraciones
-    if (!SetCommState(hSerial, &dcbSerialParams)) return -5;
+    if (!SetCommState(hSerial, &dcbSerialParams)) {
+        closeDevice();
+        return -5;
+    }
 
-    // Inicializacin de timeouts
-    COMMTIMEOUTS timeouts;
+    // Inicializacin de timeouts (una sola vez). Con ReadIntervalTimeout y
+    // ReadTotalTimeoutMultiplier en MAXDWORD, ReadFile devuelve de inmediato lo que
+    // haya en el buffer del controlador o espera como mximo ReadTotalTimeoutConstant
+    // a que llegue el primer byte.
     memset(&timeouts, 0, sizeof(timeouts)); // Inicializa la estructura
-    timeouts.ReadIntervalTimeout = 50; // Ejemplo, establece un valor predeterminado
-    timeouts.ReadTotalTimeoutConstant = MAXDWORD;
-    timeouts.ReadTotalTimeoutMultiplier = 10; // Ejemplo, establece un valor predeterminado
+    timeouts.ReadIntervalTimeout = MAXDWORD;
+    timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+    timeouts.ReadTotalTimeoutConstant = MAXDWORD - 1;
     timeouts.WriteTotalTimeoutConstant = MAXDWORD;
     timeouts.WriteTotalTimeoutMultiplier = 10; // Ejemplo, establece un valor predeterminado
 
     // Aplicar timeouts
-    if (!SetCommTimeouts(hSerial, &timeouts)) return -6;
+    if (!SetCommTimeouts(hSerial, &timeouts)) {
+        closeDevice();
+        return -6;
+    }
 
     return 1;
 }
 
+// Cambia el timeout de lectura solo si es distinto del que ya est aplicado
+bool Serial::setReadTimeout(DWORD timeOutMs) {
+    // 0 significa esperar indefinidamente (MAXDWORD no es vlido en este modo)
+    DWORD constant = (timeOutMs == 0) ? MAXDWORD - 1 : timeOutMs;
+    if (timeouts.ReadTotalTimeoutConstant == constant) return true;
+
+    timeouts.ReadTotalTimeoutConstant = constant;
+    return SetCommTimeouts(hSerial, &timeouts) != 0;
+}
+
 // Comprobar si el dispositivo est abierto
 bool Serial::isDeviceOpen() {
     return hSerial != INVALID_HANDLE_VALUE;
@@ -108,6 +139,7 @@ bool Serial::isDeviceOpen() {
 
 // Cerrar el dispositivo
 void Serial::closeDevice() {
+    if (hSerial == INVALID_HANDLE_VALUE) return;
     CloseHandle(hSerial);
     hSerial = INVALID_HANDLE_VALUE;
 }
@@ -139,9 +171,7 @@ int Serial::writeBytes(const void* buffer, const unsigned int nbBytes) {
 int Serial::readChar(char* pByte, unsigned int timeOutMs) {
     DWORD dwBytesRead = 0;
 
-    timeouts.ReadTotalTimeoutConstant = timeOutMs;
-
-    if (!SetCommTimeouts(hSerial, &timeouts)) return -1;
+    if (!setReadTimeout(timeOutMs)) return -1;
 
     if (!ReadFile(hSerial, pByte, 1, &dwBytesRead, NULL)) return -2;
 
@@ -150,6 +180,316 @@ int Serial::readChar(char* pByte, unsigned int timeOutMs) {
     return 1;
 }
 
+// Leer bytes
+int Serial::readBytes(void* buffer, unsigned int maxNbBytes, unsigned int timeOutMs, unsigned int sleepDurationUs) {
+    UNUSED(sleepDurationUs);
+
+    DWORD dwBytesRead = 0;
+
+    if (!setReadTimeout((DWORD)timeOutMs)) return -1;
+
+    if (!ReadFile(hSerial, buffer, (DWORD)maxNbBytes, &dwBytesRead, NULL)) return -2;
+
+    return dwBytesRead;
+}
+
+// Limpiar el receptor
+char Serial::flushReceiver() {
+    return PurgeComm(hSerial, PURGE_RXCLEAR);
+}
+
+// Comprobar disponibilidad de datos
+int Serial::available() {
+    DWORD commErrors;
+    COMSTAT commStatus;
+    ClearCommError(hSerial, &commErrors, &commStatus);
+    return commStatus.cbInQue;
+}
+
+#else
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <cerrno>
+#include <sys/ioctl.h>
+
+#if defined(__linux__)
+#include <asm/ioctls.h>
+
+// Estructura termios2 del kernel. No se incluye <asm/termbits.h> porque
+// redefine struct termios y choca con <termios.h>.
+struct termios2 {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t c_line;
+    cc_t c_cc[19];
+    speed_t c_ispeed;
+    speed_t c_ospeed;
+};
+
+#ifndef BOTHER
+#define BOTHER 0010000
+#endif
+#endif
+
+// Convierte la tasa de baudios a la constante de termios (0 si no es estndar)
+static speed_t standardBaudRate(unsigned int baudRate) {
+    switch (baudRate) {
+    case 50: return B50;
+    case 75: return B75;
+    case 110: return B110;
+    case 134: return B134;
+    case 150: return B150;
+    case 200: return B200;
+    case 300: return B300;
+    case 600: return B600;
+    case 1200: return B1200;
+    case 1800: return B1800;
+    case 2400: return B2400;
+    case 4800: return B4800;
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+#if defined(B460800)
+    case 460800: return B460800;
+    case 500000: return B500000;
+    case 576000: return B576000;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    case 1152000: return B1152000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+#endif
+    default: return 0;
+    }
+}
+
+// Constructor
+Serial::Serial() {
+    currentStateRTS = true;
+    currentStateDTR = true;
+    fd = -1;
+}
+
+// Destructor
+Serial::~Serial() {
+    closeDevice();
+}
+
+// Funcin para abrir el dispositivo
+char Serial::openDevice(const char* device, const unsigned int baudRate,
+    SerialDataBits dataBits,
+    SerialParity parity,
+    SerialStopBits stopBits) {
+    closeDevice();
+
+    // El descriptor queda en modo no bloqueante: las esperas se hacen con poll()
+    fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return (errno == ENOENT) ? -1 : -2;
+    }
+
+    termios options;
+    if (tcgetattr(fd, &options) != 0) {
+        closeDevice();
+        return -3;
+    }
+
+    // Modo crudo: sin eco, sin procesamiento de fin de lnea ni control de flujo
+    cfmakeraw(&options);
+    options.c_cflag |= (CLOCAL | CREAD);
+    options.c_cflag &= ~CRTSCTS;
+    options.c_iflag &= ~(IXON | IXOFF | IXANY);
+
+    // Configuracin de los bits de datos (termios no admite 16 bits)
+    options.c_cflag &= ~CSIZE;
+    switch (dataBits) {
+    case SERIAL_DATABITS_5: options.c_cflag |= CS5; break;
+    case SERIAL_DATABITS_6: options.c_cflag |= CS6; break;
+    case SERIAL_DATABITS_7: options.c_cflag |= CS7; break;
+    case SERIAL_DATABITS_8: options.c_cflag |= CS8; break;
+    default: closeDevice(); return -7;
+    }
+
+    // Configuracin de los bits de parada (1.5 no existe en termios)
+    switch (stopBits) {
+    case SERIAL_STOPBITS_1: options.c_cflag &= ~CSTOPB; break;
+    case SERIAL_STOPBITS_2: options.c_cflag |= CSTOPB; break;
+    default: closeDevice(); return -8;
+    }
+
+    // Configuracin de la paridad
+    options.c_cflag &= ~(PARENB | PARODD);
+#if defined(CMSPAR)
+    options.c_cflag &= ~CMSPAR;
+#endif
+    switch (parity) {
+    case SERIAL_PARITY_NONE: break;
+    case SERIAL_PARITY_EVEN: options.c_cflag |= PARENB; break;
+    case SERIAL_PARITY_ODD: options.c_cflag |= (PARENB | PARODD); break;
+#if defined(CMSPAR)
+    case SERIAL_PARITY_MARK: options.c_cflag |= (PARENB | PARODD | CMSPAR); break;
+    case SERIAL_PARITY_SPACE: options.c_cflag |= (PARENB | CMSPAR); break;
+#endif
+    default: closeDevice(); return -9;
+    }
+
+    // Los timeouts se gestionan con poll(); read() nunca bloquea
+    options.c_cc[VMIN] = 0;
+    options.c_cc[VTIME] = 0;
+
+    // Configuracin de la velocidad de baudios
+    speed_t speed = standardBaudRate(baudRate);
+    if (speed != 0) {
+        cfsetispeed(&options, speed);
+        cfsetospeed(&options, speed);
+    }
+    else if (baudRate == 0) {
+        closeDevice();
+        return -4;
+    }
+
+    // Aplicar configuraciones
+    if (tcsetattr(fd, TCSANOW, &options) != 0) {
+        closeDevice();
+        return -5;
+    }
+
+    // Tasas no estndar (por ejemplo 250000 o 1000000 en adaptadores USB)
+    if (speed == 0) {
+#if defined(__linux__)
+        termios2 options2;
+        if (ioctl(fd, TCGETS2, &options2) != 0) {
+            closeDevice();
+            return -4;
+        }
+        options2.c_cflag &= ~CBAUD;
+        options2.c_cflag |= BOTHER;
+        options2.c_ispeed = baudRate;
+        options2.c_ospeed = baudRate;
+        if (ioctl(fd, TCSETS2, &options2) != 0) {
+            closeDevice();
+            return -4;
+        }
+#else
+        closeDevice();
+        return -4;
+#endif
+    }
+
+    tcflush(fd, TCIOFLUSH);
+    return 1;
+}
+
+// Comprobar si el dispositivo est abierto
+bool Serial::isDeviceOpen() {
+    return fd >= 0;
+}
+
+// Cerrar el dispositivo
+void Serial::closeDevice() {
+    if (fd < 0) return;
+    close(fd);
+    fd = -1;
+}
+
+// Espera a que el dispositivo est listo (0 en timeout, <0 en error)
+int Serial::waitDevice(short events, const unsigned int timeOutMs) {
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+
+    int ready;
+    do {
+        ready = poll(&pfd, 1, timeOutMs == 0 ? -1 : (int)timeOutMs);
+    } while (ready < 0 && errno == EINTR);
+
+    if (ready < 0) return -1;
+    if (ready == 0) return 0;
+    if (pfd.revents & (POLLERR | POLLNVAL)) return -1;
+    return 1;
+}
+
+// Escribir un carcter
+int Serial::writeChar(const char byte) {
+    return writeBytes(&byte, 1);
+}
+
+// Escribir una cadena
+int Serial::writeString(const char* receivedString) {
+    return writeBytes(receivedString, strlen(receivedString));
+}
+
+// Escribir bytes
+int Serial::writeBytes(const void* buffer, const unsigned int nbBytes) {
+    const char* data = static_cast<const char*>(buffer);
+    unsigned int written = 0;
+
+    while (written < nbBytes) {
+        ssize_t result = write(fd, data + written, nbBytes - written);
+        if (result > 0) {
+            written += (unsigned int)result;
+            continue;
+        }
+        if (result < 0 && errno == EINTR) continue;
+        if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (waitDevice(POLLOUT, 0) < 0) return -1;
+            continue;
+        }
+        return -1;
+    }
+    return 1;
+}
+
+// Leer un carcter
+int Serial::readChar(char* pByte, unsigned int timeOutMs) {
+    int result = readBytes(pByte, 1, timeOutMs);
+    if (result < 0) return -2;
+    return result;
+}
+
+// Leer bytes: una sola llamada a read() cuando ya hay datos en el buffer del kernel
+int Serial::readBytes(void* buffer, unsigned int maxNbBytes, unsigned int timeOutMs, unsigned int sleepDurationUs) {
+    UNUSED(sleepDurationUs);
+
+    bool waited = false;
+    while (true) {
+        ssize_t result = read(fd, buffer, maxNbBytes);
+        if (result > 0) return (int)result;
+        if (result < 0 && errno == EINTR) continue;
+        if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+
+        // Si poll() indic datos y read() no devuelve nada, el dispositivo se desconect
+        if (result == 0 && waited) return -1;
+
+        int ready = waitDevice(POLLIN, timeOutMs);
+        if (ready <= 0) return ready == 0 ? 0 : -1;
+        waited = true;
+    }
+}
+
+// Limpiar el receptor
+char Serial::flushReceiver() {
+    return tcflush(fd, TCIFLUSH) == 0;
+}
+
+// Comprobar disponibilidad de datos
+int Serial::available() {
+    int bytes = 0;
+    if (ioctl(fd, FIONREAD, &bytes) != 0) return -1;
+    return bytes;
+}
+
+#endif
+
 // Leer una cadena sin tiempo de espera
 int Serial::readStringNoTimeOut(char* receivedString, char finalChar, unsigned int maxNbBytes) {
     unsigned int NbBytes = 0;
@@ -206,31 +546,3 @@ int Serial::readString(char* receivedString, char finalChar, unsigned int maxNbB
 
     return -3;
 }
-
-// Leer bytes
-int Serial::readBytes(void* buffer, unsigned int maxNbBytes, unsigned int timeOutMs, unsigned int sleepDurationUs) {
-    UNUSED(sleepDurationUs);
-
-    DWORD dwBytesRead = 0;
-
-    timeouts.ReadTotalTimeoutConstant = (DWORD)timeOutMs;
-
-    if (!SetCommTimeouts(hSerial, &timeouts)) return -1;
-
-    if (!ReadFile(hSerial, buffer, (DWORD)maxNbBytes, &dwBytesRead, NULL)) return -2;
-
-    return dwBytesRead;
-}
-
-// Limpiar el receptor
-char Serial::flushReceiver() {
-    return PurgeComm(hSerial, PURGE_RXCLEAR);
-}
-
-// Comprobar disponibilidad de datos
-int Serial::available() {
-    DWORD commErrors;
-    COMSTAT commStatus;
-    ClearCommError(hSerial, &commErrors, &commStatus);
-    return commStatus.cbInQue;
-}
@@ -1,6 +1,10 @@
 #pragma once
 
+#if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
+#else
+#include <time.h>
+#endif
 #include <iostream>
 #include <cstring> // Para memset
 
@@ -40,14 +44,24 @@ enum SerialParity {
 class Timer {
 public:
     void initTimer() {
-        startTime = GetTickCount();
+        startTime = tickCount();
     }
 
     unsigned long elapsedTime_ms() {
-        return GetTickCount() - startTime;
+        return tickCount() - startTime;
     }
 
 private:
+    static unsigned long tickCount() {
+#if defined(_WIN32) || defined(_WIN64)
+        return GetTickCount();
+#else
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (unsigned long)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+#endif
+    }
+
     unsigned long startTime;
 };
 
@@ -78,6 +92,8 @@ public:
         unsigned int maxNbBytes, const unsigned int timeOutMs = 0);
 
     // Read/Write operation on bytes
+    // readBytes returns whatever the driver has buffered (up to maxNbBytes) in a
+    // single read, waiting at most timeOutMs for the first byte (0 = wait forever).
     int writeBytes(const void* buffer, const unsigned int nbBytes);
     int readBytes(void* buffer, unsigned int maxNbBytes,
         const unsigned int timeOutMs = 0, unsigned int sleepDurationUs = 100);
@@ -109,8 +125,16 @@ private:
     bool currentStateDTR;
     Timer timer;
 #if defined(_WIN32) || defined(_WIN64)
+    // Applies the read timeout only when it differs from the one already set
+    bool setReadTimeout(DWORD timeOutMs);
+
     HANDLE hSerial; // Handle on serial device
     COMMTIMEOUTS timeouts; // For setting serial port timeouts
+#else
+    // Waits until the device is readable (or writable); 0 on timeout, <0 on error
+    int waitDevice(short events, const unsigned int timeOutMs);
+
+    int fd; // File descriptor of the serial device
 #endif
 };
 
@@ -0,0 +1,132 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/// <summary>
+/// Contenedor con inserción y borrado en O(1) que entrega identificadores estables.
+/// Cada identificador lleva la generación de su hueco: cuando un elemento se borra y el
+/// hueco se reutiliza, los identificadores antiguos dejan de ser válidos en lugar de
+/// apuntar al elemento nuevo. Los elementos no se mueven nunca (los huecos viven en un
+/// deque) y los ocupados se recorren en un vector compacto.
+/// </summary>
+template <typename T>
+class SlotMap {
+public:
+    using Handle = uint64_t;                ///< Generación en los 32 bits altos, hueco en los bajos.
+    static const Handle INVALID = ~0ull;
+
+    /**
+     * @brief Inserta un elemento construido por defecto.
+     * @return Identificador del elemento nuevo.
+     */
+    Handle Insert() {
+        uint32_t index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else {
+            index = (uint32_t)slots.size();
+            slots.emplace_back();
+        }
+
+        Slot& slot = slots[index];
+        slot.used = true;
+        slot.dense = (uint32_t)dense.size();
+        dense.push_back(index);
+        return MakeHandle(index, slot.generation);
+    }
+
+    /**
+     * @brief Borra el elemento si el identificador sigue siendo válido.
+     * @return true si se borró.
+     */
+    bool Remove(Handle handle) {
+        Slot* slot = Find(handle);
+        if (slot == nullptr) {
+            return false;
+        }
+
+        // El último del vector compacto ocupa la posición del borrado.
+        uint32_t last = dense.back();
+        dense[slot->dense] = last;
+        slots[last].dense = slot->dense;
+        dense.pop_back();
+
+        slot->value = T();
+        slot->used = false;
+        slot->generation++;
+        freeSlots.push_back((uint32_t)(handle & 0xFFFFFFFFu));
+        return true;
+    }
+
+    /**
+     * @brief Devuelve el elemento o nullptr si el identificador ya no es válido.
+     */
+    T* Get(Handle handle) {
+        Slot* slot = Find(handle);
+        return slot ? &slot->value : nullptr;
+    }
+
+    /**
+     * @brief Número de elementos.
+     */
+    size_t Size() const {
+        return dense.size();
+    }
+
+    /**
+     * @brief Elemento en la posición i del recorrido compacto (0 <= i < Size()).
+     */
+    T& At(size_t i) {
+        return slots[dense[i]].value;
+    }
+
+    /**
+     * @brief Identificador del elemento en la posición i del recorrido compacto.
+     */
+    Handle HandleAt(size_t i) const {
+        uint32_t index = dense[i];
+        return MakeHandle(index, slots[index].generation);
+    }
+
+    /**
+     * @brief Borra todos los elementos e invalida sus identificadores.
+     */
+    void Clear() {
+        while (!dense.empty()) {
+            Remove(HandleAt(dense.size() - 1));
+        }
+    }
+
+private:
+    struct Slot {
+        T value = T();
+        uint32_t generation = 0;
+        uint32_t dense = 0;
+        bool used = false;
+    };
+
+    static Handle MakeHandle(uint32_t index, uint32_t generation) {
+        return ((Handle)generation << 32) | index;
+    }
+
+    Slot* Find(Handle handle) {
+        uint32_t index = (uint32_t)(handle & 0xFFFFFFFFu);
+        if (index >= slots.size()) {
+            return nullptr;
+        }
+        Slot& slot = slots[index];
+        if (!slot.used || slot.generation != (uint32_t)(handle >> 32)) {
+            return nullptr;
+        }
+        return &slot;
+    }
+
+    std::deque<Slot> slots;          ///< Huecos; un deque no mueve los elementos al crecer.
+    std::vector<uint32_t> dense;     ///< Huecos ocupados, para recorrerlos sin saltos.
+    std::vector<uint32_t> freeSlots; ///< Huecos libres para reutilizar.
+};
@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// Anillo sin bloqueos de un productor y un consumidor. Lo usa Protocol para pasar las
+/// muestras del hilo lector del puerto serie al hilo de red sin mutex: el productor solo
+/// escribe tail y el consumidor solo escribe head. Si el anillo se llena, la muestra nueva
+/// se descarta y se cuenta como desbordamiento, para que el lector nunca se bloquee.
+/// </summary>
+template <typename T, size_t CAPACITY>
+class SpscRing {
+    static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY debe ser potencia de dos");
+
+public:
+    SpscRing() : head(0), cachedTail(0), tail(0), cachedHead(0), peak(0), overruns(0), signaled(false) {}
+
+    /**
+     * @brief Añade un elemento (solo desde el hilo productor).
+     * @return false si el anillo estaba lleno; el elemento se descarta y se cuenta.
+     */
+    bool Push(const T& item) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead == CAPACITY) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead == CAPACITY) {
+                overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        items[position & MASK] = item;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Extrae hasta max elementos (solo desde el hilo consumidor).
+     * @return Número de elementos copiados en out.
+     */
+    size_t Pop(T* out, size_t max) {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (cachedTail == position) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (cachedTail == position) {
+                return 0;
+            }
+        }
+
+        // La ocupación máxima se mide aquí, con el tail recién leído por el consumidor.
+        size_t count = cachedTail - position;
+        if (count > peak.load(std::memory_order_relaxed)) {
+            peak.store(count, std::memory_order_relaxed);
+        }
+        if (count > max) {
+            count = max;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = items[(position + i) & MASK];
+        }
+        head.store(position + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief Indica al productor si debe despertar al consumidor tras un Push.
+     * Solo devuelve true una vez hasta que el consumidor llame a ResetSignal, así una
+     * ráfaga de muestras produce una sola notificación.
+     */
+    bool NeedsSignal() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return !signaled.exchange(true, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief El consumidor la llama al despertar, antes de vaciar el anillo.
+     */
+    void ResetSignal() {
+        signaled.store(false, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /**
+     * @brief Elementos en el anillo (aproximado si se consulta desde otro hilo).
+     */
+    size_t Size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Ocupación máxima observada desde la creación.
+     */
+    size_t Peak() const {
+        return peak.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Elementos descartados porque el anillo estaba lleno.
+     */
+    uint64_t Overruns() const {
+        return overruns.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t Capacity() {
+        return CAPACITY;
+    }
+
+private:
+    static const size_t MASK = CAPACITY - 1;
+
+    // head y tail en líneas de caché separadas para que productor y consumidor no compitan.
+    alignas(64) std::atomic<size_t> head; ///< Siguiente posición a leer (la escribe el consumidor).
+    size_t cachedTail;                    ///< Copia de tail del consumidor.
+    alignas(64) std::atomic<size_t> tail; ///< Siguiente posición a escribir (la escribe el productor).
+    size_t cachedHead;                    ///< Copia de head del productor.
+    alignas(64) std::atomic<size_t> peak;
+    std::atomic<uint64_t> overruns;
+    std::atomic<bool> signaled;           ///< Ya hay una notificación pendiente para el consumidor.
+    alignas(64) T items[CAPACITY];
+};
@@ -0,0 +1,134 @@
+﻿#include "sweep.h"
+#include <cstring>
+#include <thread>
+
+void SweepFrame::Clear() {
+    sequence = 0;
+    device = 0;
+    direction = 0;
+    minAngle = MAX_ANGLE;
+    maxAngle = 0;
+    count = 0;
+    startTime = 0;
+    endTime = 0;
+    for (uint16_t angle = 0; angle <= MAX_ANGLE; ++angle) {
+        distance[angle] = MISSING;
+    }
+    memset(timestamp, 0, sizeof(timestamp));
+}
+
+SweepAssembler::SweepAssembler() : front(-1), back(0), completed(0), active(false), lastAngle(0) {
+    versions[0] = 0;
+    versions[1] = 0;
+    frames[0].Clear();
+    frames[1].Clear();
+}
+
+bool SweepAssembler::Add(const RadarSample& sample) {
+    if (sample.angle > SweepFrame::MAX_ANGLE) {
+        return false;
+    }
+
+    if (!active) {
+        Begin(sample);
+        return false;
+    }
+
+    // El servo se detiene un instante en los extremos: el mismo ángulo repetido no cambia el sentido
+    if (sample.angle == lastAngle) {
+        Store(sample);
+        return false;
+    }
+
+    int8_t direction = sample.angle > lastAngle ? 1 : -1;
+    SweepFrame& frame = frames[back];
+    if (frame.direction == 0 || frame.direction == direction) {
+        frame.direction = direction;
+        Store(sample);
+        return false;
+    }
+
+    // Cambio de sentido: el barrido en curso termina en la muestra anterior
+    bool done = frame.count >= MIN_SAMPLES;
+    if (done) {
+        Complete();
+    }
+    Begin(sample);
+    frames[back].direction = direction;
+    return done;
+}
+
+const SweepFrame& SweepAssembler::Last() const {
+    // Sin barridos completos, el buffer que no se está escribiendo sigue vacío
+    int index = front.load(std::memory_order_relaxed);
+    return frames[index < 0 ? back ^ 1 : index];
+}
+
+bool SweepAssembler::Copy(SweepFrame& out) const {
+    while (true) {
+        int index = front.load(std::memory_order_acquire);
+        if (index < 0) {
+            return false;
+        }
+
+        uint32_t version = versions[index].load(std::memory_order_acquire);
+        if (version & 1) {
+            // El escritor acaba de empezar a reutilizar este buffer; el nuevo front ya está publicado
+            std::this_thread::yield();
+            continue;
+        }
+
+        out = frames[index];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (versions[index].load(std::memory_order_relaxed) == version) {
+            return true;
+        }
+    }
+}
+
+uint32_t SweepAssembler::Completed() const {
+    return completed;
+}
+
+void SweepAssembler::Begin(const RadarSample& sample) {
+    // Se marca el buffer como "en escritura" antes de tocarlo (si un barrido corto se
+    // descartó, ya lo estaba)
+    uint32_t version = versions[back].load(std::memory_order_relaxed);
+    if ((version & 1) == 0) {
+        versions[back].store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    frames[back].Clear();
+    active = true;
+    Store(sample);
+}
+
+void SweepAssembler::Store(const RadarSample& sample) {
+    SweepFrame& frame = frames[back];
+    if (frame.count == 0) {
+        frame.startTime = sample.timestamp;
+        frame.device = sample.device;
+    }
+    frame.distance[sample.angle] = sample.distance;
+    frame.timestamp[sample.angle] = sample.timestamp;
+    if (sample.angle < frame.minAngle) {
+        frame.minAngle = sample.angle;
+    }
+    if (sample.angle > frame.maxAngle) {
+        frame.maxAngle = sample.angle;
+    }
+    frame.endTime = sample.timestamp;
+    if (frame.count < 0xFFFF) {
+        frame.count++;
+    }
+    lastAngle = sample.angle;
+}
+
+void SweepAssembler::Complete() {
+    frames[back].sequence = completed.load(std::memory_order_relaxed);
+    versions[back].store(versions[back].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    front.store(back, std::memory_order_release);
+    back ^= 1;
+    completed.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "sample.h"
+
+/// <summary>
+/// Barrido completo del radar (de un extremo al otro del servo) guardado por ángulo.
+/// Los datos van en arrays contiguos indexados por ángulo (estructura de arrays), de modo
+/// que recorrer todas las distancias de un barrido es una lectura secuencial.
+/// </summary>
+struct SweepFrame {
+    static const uint16_t MAX_ANGLE = 180;     ///< Ángulo máximo del servo.
+    static const uint16_t MISSING = 0xFFFF;    ///< Distancia de un ángulo sin muestra en este barrido.
+
+    uint32_t sequence;   ///< Número de barrido, consecutivo desde el arranque.
+    uint16_t device;     ///< Radar que hizo el barrido.
+    int8_t direction;    ///< 1 si el ángulo crece, -1 si decrece.
+    uint16_t minAngle;   ///< Menor ángulo con muestra.
+    uint16_t maxAngle;   ///< Mayor ángulo con muestra.
+    uint16_t count;      ///< Muestras recibidas (puede haber ángulos repetidos).
+    uint64_t startTime;  ///< Instante de la primera muestra (microsegundos, como RadarSample).
+    uint64_t endTime;    ///< Instante de la última muestra.
+
+    uint16_t distance[MAX_ANGLE + 1];   ///< Distancia por ángulo, MISSING si no hubo muestra.
+    uint64_t timestamp[MAX_ANGLE + 1];  ///< Instante de la muestra de cada ángulo.
+
+    /**
+     * @brief Deja el barrido vacío (todos los ángulos en MISSING).
+     */
+    void Clear();
+};
+
+/// <summary>
+/// Agrupa las muestras en barridos detectando los cambios de sentido del servo.
+/// Usa dos SweepFrame: en uno se escribe el barrido en curso y el otro guarda el último
+/// completo. Al completar un barrido se intercambian, así que el que escribe nunca espera
+/// a los lectores; los lectores de otros hilos usan Copy, que repite la copia si coincide
+/// con un intercambio (contador de versión por buffer, como un seqlock).
+/// Add y Last solo deben usarse desde un mismo hilo (el de red).
+/// </summary>
+class SweepAssembler {
+public:
+    static const uint16_t MIN_SAMPLES = 8;  ///< Barridos más cortos se descartan (ruido o arranque).
+
+    SweepAssembler();
+
+    /**
+     * @brief Añade una muestra al barrido en curso.
+     * @return true si la muestra cerró un barrido; el barrido completo queda en Last().
+     */
+    bool Add(const RadarSample& sample);
+
+    /**
+     * @brief Último barrido completo (vacío si aún no hay ninguno). Solo desde el hilo que llama a Add.
+     */
+    const SweepFrame& Last() const;
+
+    /**
+     * @brief Copia el último barrido completo. Se puede llamar desde cualquier hilo.
+     * @return false si todavía no se completó ningún barrido.
+     */
+    bool Copy(SweepFrame& out) const;
+
+    /**
+     * @brief Barridos completados desde el arranque.
+     */
+    uint32_t Completed() const;
+
+private:
+    void Begin(const RadarSample& sample);
+    void Store(const RadarSample& sample);
+    void Complete();
+
+    SweepFrame frames[2];
+    std::atomic<uint32_t> versions[2];  ///< Impar mientras se escribe el buffer.
+    std::atomic<int> front;             ///< Índice del último barrido completo (-1 si no hay).
+    int back;                           ///< Índice del barrido en curso.
+    std::atomic<uint32_t> completed;
+
+    bool active;        ///< Hay un barrido en curso.
+    uint16_t lastAngle;
+};
@@ -0,0 +1,104 @@
+﻿#include "synthetic.h"
+#include <thread>
+
+SyntheticSource::SyntheticSource(uint32_t rate, size_t targets, Logger* logger, bool debug, uint32_t seed)
+    : rate(rate == 0 ? 1 : (rate > MAX_RATE ? MAX_RATE : rate)), logger(logger), debug(debug), running(false),
+      scene(targets, seed), generated(0), skipped(0) {}
+
+bool SyntheticSource::Debug() const {
+    return debug;
+}
+
+void SyntheticSource::Debug(bool value) {
+    debug = value;
+}
+
+bool SyntheticSource::Start() {
+    if (running) {
+        return true;
+    }
+
+    running = true;
+    generated = 0;
+    skipped = 0;
+    origin = std::chrono::steady_clock::now();
+    logger->Log("Generando muestras sintéticas: " + std::to_string(rate) + " muestras/s, " +
+        std::to_string(scene.Targets()) + " blancos en movimiento.", Logger::INFO);
+    return true;
+}
+
+bool SyntheticSource::ReadSample(RadarSample& sample) {
+    if (!running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds((unsigned int)MAX_WAIT_MS));
+        return false;
+    }
+
+    // La muestra n corresponde al instante origin + n / rate. Se entrega con hasta SLACK_US
+    // de adelanto para no dormir por cada muestra cuando el ritmo es alto.
+    auto due = origin + std::chrono::microseconds((long long)(generated * 1000000 / rate));
+    auto now = std::chrono::steady_clock::now();
+    if (due > now + std::chrono::microseconds((unsigned int)SLACK_US)) {
+        auto wake = due - std::chrono::microseconds((unsigned int)SLACK_US);
+        if (wake - now > std::chrono::milliseconds((unsigned int)MAX_WAIT_MS)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds((unsigned int)MAX_WAIT_MS));
+            return false;
+        }
+        std::this_thread::sleep_until(wake);
+    }
+    else if (now - due > std::chrono::milliseconds((unsigned int)MAX_LAG_MS)) {
+        // El consumidor no llega al ritmo pedido: se sigue desde ahora en lugar de soltar
+        // de golpe todo lo atrasado
+        origin = now;
+        generated = 0;
+        skipped++;
+        LOG_LIMITED(logger, "El servidor no alcanza " + std::to_string(rate) + " muestras/s; se descarta el retraso.",
+            Logger::WARNING);
+    }
+
+    scene.Next(sample);
+    generated++;
+    if (debug) {
+        LOG_DEBUG(logger, "Datos sintéticos: " + std::to_string(sample.angle) + "," + std::to_string(sample.distance));
+    }
+    return true;
+}
+
+void SyntheticSource::Stop() {
+    if (!running) {
+        return;
+    }
+
+    running = false;
+    logger->Log("Generador sintético detenido tras " + std::to_string(scene.Sweeps()) + " barridos.", Logger::INFO);
+    if (skipped > 0) {
+        logger->Log("El generador tuvo que descartar su retraso " + std::to_string(skipped) +
+            " veces: el ritmo pedido supera lo que procesa el servidor.", Logger::WARNING);
+    }
+}
+
+bool SyntheticSource::ParseRate(const std::string& text, uint32_t& rate) {
+    std::string value = text.rfind("--", 0) == 0 ? text.substr(2) : text;
+    uint64_t scale = 1;
+    if (!value.empty() && (value.back() == 'k' || value.back() == 'K')) {
+        scale = 1000;
+        value.pop_back();
+    }
+    else if (!value.empty() && (value.back() == 'm' || value.back() == 'M')) {
+        scale = 1000000;
+        value.pop_back();
+    }
+
+    try {
+        size_t used = 0;
+        double parsed = std::stod(value, &used);
+        double scaled = parsed * scale;
+        if (used != value.size() || scaled < 1 || scaled > MAX_RATE) {
+            return false;
+        }
+        rate = (uint32_t)scaled;
+        return true;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
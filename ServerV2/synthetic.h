@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include <chrono>
+#include <string>
+#include "samplesource.h"
+#include "scene.h"
+#include "logger.h"
+
+/// <summary>
+/// Origen de muestras sintético: genera en el propio proceso la escena de SyntheticScene
+/// al ritmo pedido, desde unas pocas muestras por segundo hasta MAX_RATE. Sirve para medir
+/// cuánto aguanta el servidor sin el límite de los 9600 baudios del Arduino.
+/// </summary>
+class SyntheticSource : public SampleSource {
+public:
+    static const uint32_t MAX_RATE = 1000000;   ///< Muestras por segundo.
+    static const uint32_t DEFAULT_RATE = 33;    ///< Ritmo del sketch (servoInterval de 30 ms).
+
+    /**
+     * @brief Constructor de SyntheticSource.
+     * @param rate Muestras por segundo (1 a MAX_RATE).
+     * @param targets Blancos en movimiento de la escena.
+     * @param logger Instancia del logger para manejar mensajes de log.
+     * @param debug Indica si se activa el modo de depuración.
+     * @param seed Semilla de la escena; con varios radares cada uno lleva la suya.
+     */
+    SyntheticSource(uint32_t rate, size_t targets, Logger* logger, bool debug = false, uint32_t seed = 1);
+
+    bool Debug() const override;
+    void Debug(bool value) override;
+
+    bool Start() override;
+    bool ReadSample(RadarSample& sample) override;
+    void Stop() override;
+
+    /**
+     * @brief Interpreta un ritmo: "1000", "50k", "1m" (con o sin "--" delante).
+     */
+    static bool ParseRate(const std::string& text, uint32_t& rate);
+
+private:
+    static const unsigned int MAX_WAIT_MS = 100; ///< Espera máxima por lectura, permite detener el hilo lector.
+    static const unsigned int SLACK_US = 1000;   ///< Adelanto permitido para no dormir por cada muestra.
+    static const unsigned int MAX_LAG_MS = 1000; ///< Retraso a partir del cual se deja de intentar recuperarlo.
+
+    uint32_t rate;
+    Logger* logger;
+    bool debug;
+    bool running;
+
+    SyntheticScene scene;
+    uint64_t generated;   ///< Muestras generadas desde origin.
+    uint64_t skipped;     ///< Veces que se abandonó el retraso acumulado.
+    std::chrono::steady_clock::time_point origin;
+};
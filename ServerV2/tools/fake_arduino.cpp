@@ -0,0 +1,163 @@
+﻿// Arduino simulado sobre un pseudoterminal (solo Linux/macOS).
+//
+// Crea un pty y escribe en él las muestras de SyntheticScene con el mismo formato que
+// printData() del sketch ("ángulo,distancia.\r\n"), de modo que el servidor las lee por el
+// camino real: Serial, Framer y Handler. Muestra en la primera línea la ruta del esclavo
+// para pasarla al servidor con -c. Un pty no tiene límite de baudios, así que con "max"
+// mide cuánto lee el servidor por el puerto serie.
+// En Windows se puede conseguir lo mismo con un par de puertos virtuales (com0com).
+//
+// Compilar:
+//   g++ -std=c++17 -O2 -I.. fake_arduino.cpp ../scene.cpp -o fake_arduino
+// Uso:
+//   ./fake_arduino [muestras_por_segundo=33|max] [blancos=3] [enlace]
+//   (enlace: ruta opcional de un enlace simbólico estable al esclavo, p. ej. /tmp/ttyRADAR)
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "scene.h"
+
+namespace {
+    const size_t MAX_LINE = 16;     // "165,50.\r\n" con margen
+    const size_t BATCH = 1024;      // Muestras por escritura como máximo
+
+    volatile std::sig_atomic_t running = 1;
+
+    void OnSignal(int) {
+        running = 0;
+    }
+
+    size_t FormatLine(const RadarSample& sample, char* out) {
+        return (size_t)snprintf(out, MAX_LINE, "%u,%u.\r\n", (unsigned)sample.angle, (unsigned)sample.distance);
+    }
+
+    bool WriteAll(int fd, const char* data, size_t length) {
+        while (length > 0) {
+            // Una señal puede cortar la escritura a medias: se comprueba running en cada vuelta
+            ssize_t written = running ? write(fd, data, length) : -1;
+            if (written < 0) {
+                if (errno == EINTR && running) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            length -= (size_t)written;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint64_t rate = 33;
+    if (argc > 1 && strcmp(argv[1], "max") == 0) {
+        rate = 0;
+    }
+    else if (argc > 1) {
+        rate = strtoull(argv[1], nullptr, 10);
+        if (rate == 0) {
+            fprintf(stderr, "Ritmo inválido: %s\n", argv[1]);
+            return 1;
+        }
+    }
+    size_t targets = argc > 2 ? (size_t)atoi(argv[2]) : 3;
+    std::string link = argc > 3 ? argv[3] : "";
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    std::string slavePath = ptsname(master);
+
+    // Se mantiene abierto el esclavo en modo crudo: así no hay eco de vuelta hacia el
+    // maestro y el pty sigue vivo aunque el servidor cierre y vuelva a abrir el puerto
+    int slave = open(slavePath.c_str(), O_RDWR | O_NOCTTY);
+    termios options;
+    if (slave < 0 || tcgetattr(slave, &options) != 0) {
+        perror("open");
+        return 1;
+    }
+    cfmakeraw(&options);
+    tcsetattr(slave, TCSANOW, &options);
+
+    if (!link.empty()) {
+        unlink(link.c_str());
+        if (symlink(slavePath.c_str(), link.c_str()) != 0) {
+            perror("symlink");
+            return 1;
+        }
+    }
+
+    printf("%s\n", link.empty() ? slavePath.c_str() : link.c_str());
+    fflush(stdout);
+
+    // Sin SA_RESTART, para que la señal interrumpa un write bloqueado si nadie lee el puerto
+    struct sigaction action = {};
+    action.sa_handler = OnSignal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    SyntheticScene scene(targets);
+    char buffer[BATCH * MAX_LINE];
+    uint64_t written = 0;
+    uint64_t reported = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+
+    while (running) {
+        // Muestras que ya deberían haberse enviado según el ritmo pedido
+        auto now = std::chrono::steady_clock::now();
+        uint64_t due = BATCH;
+        if (rate > 0) {
+            uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+            uint64_t target = elapsed * rate / 1000000 + 1;
+            due = target > written ? target - written : 0;
+            if (due == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(1000000 / rate < 1000 ? 1000000 / rate : 1000));
+                continue;
+            }
+            if (due > BATCH) {
+                due = BATCH;
+            }
+        }
+
+        size_t length = 0;
+        for (uint64_t i = 0; i < due; ++i) {
+            RadarSample sample;
+            scene.Next(sample);
+            length += FormatLine(sample, buffer + length);
+        }
+        if (!WriteAll(master, buffer, length)) {
+            break;
+        }
+        written += due;
+
+        if (now - lastReport >= std::chrono::seconds(1)) {
+            double seconds = std::chrono::duration<double>(now - lastReport).count();
+            fprintf(stderr, "%llu muestras/s\n", (unsigned long long)((written - reported) / seconds));
+            reported = written;
+            lastReport = now;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "Enviadas %llu muestras en %.1f s (%.0f muestras/s).\n", (unsigned long long)written, seconds,
+        seconds > 0 ? written / seconds : 0.0);
+
+    if (!link.empty()) {
+        unlink(link.c_str());
+    }
+    close(slave);
+    close(master);
+    return 0;
+}
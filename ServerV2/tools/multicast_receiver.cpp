@@ -0,0 +1,175 @@
+﻿// Receptor de la salida UDP del servidor (solo Linux/macOS).
+//
+// Se une al grupo multicast (o escucha la difusión de subred / los datagramas dirigidos a
+// este equipo) en el puerto indicado, decodifica los datagramas de multicast.h y cada
+// segundo muestra cuántos datagramas y muestras llegaron, cuántos se perdieron (huecos en
+// el número de datagrama), cuántos llegaron desordenados (un número menor que el último
+// visto; si estaba contado como perdido deja de estarlo) y cuántos repetidos. Al terminar
+// con Ctrl+C imprime el total.
+//
+// Compilar (o cmake --build build --target multicast_receiver):
+//   g++ -std=c++17 -O2 -I.. multicast_receiver.cpp ../multicast.cpp ../wireformat.cpp ../sweep.cpp -o multicast_receiver
+// Uso:
+//   ./multicast_receiver [ip[:puerto]=239.255.42.1:27100] [interfaz=0.0.0.0]
+//   (en el servidor: multicast 239.255.42.1:27100)
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "multicast.h"
+
+namespace {
+    const uint32_t WINDOW = 4096;  // Datagramas recientes que se recuerdan para reconocer repetidos y desordenados
+
+    volatile std::sig_atomic_t running = 1;
+
+    void OnSignal(int) {
+        running = 0;
+    }
+
+    struct Totals {
+        uint64_t datagrams = 0;
+        uint64_t samples = 0;
+        uint64_t lost = 0;
+        uint64_t reordered = 0;
+        uint64_t duplicated = 0;
+        uint64_t invalid = 0;
+        uint64_t restarts = 0;
+    };
+
+    /// Sigue los números de datagrama: huecos, llegadas tardías y repetidos.
+    class SequenceTracker {
+    public:
+        SequenceTracker() : seen(WINDOW), started(false), highest(0) {}
+
+        void Add(uint32_t sequence, Totals& totals) {
+            int32_t ahead = (int32_t)(sequence - highest);
+            if (!started || ahead < -(int32_t)WINDOW) {
+                // Primer datagrama, o el servidor se reinició y volvió a empezar por 0
+                totals.restarts += started ? 1 : 0;
+                started = true;
+                highest = sequence;
+                std::fill(seen.begin(), seen.end(), false);
+                seen[sequence % WINDOW] = true;
+                return;
+            }
+
+            if (ahead > 0) {
+                if (ahead > (int32_t)WINDOW) {
+                    std::fill(seen.begin(), seen.end(), false);
+                }
+                for (uint32_t skipped = highest + 1; skipped != sequence && ahead <= (int32_t)WINDOW; ++skipped) {
+                    seen[skipped % WINDOW] = false;
+                }
+                totals.lost += (uint64_t)(ahead - 1);
+                highest = sequence;
+                seen[sequence % WINDOW] = true;
+                return;
+            }
+
+            if (seen[sequence % WINDOW]) {
+                totals.duplicated++;
+                return;
+            }
+            // Llega tarde: estaba contado como perdido
+            seen[sequence % WINDOW] = true;
+            totals.reordered++;
+            totals.lost--;
+        }
+
+    private:
+        std::vector<bool> seen;
+        bool started;
+        uint32_t highest;
+    };
+}
+
+int main(int argc, char** argv) {
+    std::string host;
+    int port = 0;
+    if (!multicast::ParseAddress(argc > 1 ? argv[1] : "239.255.42.1", host, port)) {
+        fprintf(stderr, "Dirección inválida: %s\n", argv[1]);
+        return 1;
+    }
+    std::string interfaceAddress = argc > 2 ? argv[2] : "0.0.0.0";
+
+    SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_port = htons((uint16_t)port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(s, (sockaddr*)&local, sizeof(local)) != 0) {
+        perror("bind");
+        return 1;
+    }
+
+    if (multicast::IsMulticast(host)) {
+        ip_mreq membership = {};
+        inet_pton(AF_INET, host.c_str(), &membership.imr_multiaddr);
+        inet_pton(AF_INET, interfaceAddress.c_str(), &membership.imr_interface);
+        if (setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+            perror("IP_ADD_MEMBERSHIP");
+            return 1;
+        }
+    }
+
+    // Buffer amplio: a ritmos altos el kernel descarta datagramas si el receptor se retrasa
+    int buffer = 4 << 20;
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    timeval timeout = { 0, 200000 };
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    printf("Escuchando %s:%d (Ctrl+C para terminar)\n", host.c_str(), port);
+    printf("%10s %12s %10s %12s %10s\n", "datagr./s", "muestras/s", "perdidos", "desordenados", "repetidos");
+
+    Totals totals;
+    Totals last;
+    SequenceTracker tracker;
+    wire::Message message;
+    char datagram[65536];
+    auto reportTime = std::chrono::steady_clock::now();
+
+    while (running) {
+        ssize_t length = recv(s, datagram, sizeof(datagram), 0);
+        if (length > 0) {
+            uint32_t sequence = 0;
+            message.samples.clear();
+            if (!multicast::DecodeDatagram(datagram, (size_t)length, sequence, message)) {
+                totals.invalid++;
+            }
+            else {
+                totals.datagrams++;
+                totals.samples += message.samples.size();
+                tracker.Add(sequence, totals);
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - reportTime).count();
+        if (elapsed >= 1.0) {
+            printf("%10.0f %12.0f %10lld %12llu %10llu\n", (totals.datagrams - last.datagrams) / elapsed,
+                (totals.samples - last.samples) / elapsed, (long long)(totals.lost - last.lost),
+                (unsigned long long)(totals.reordered - last.reordered), (unsigned long long)(totals.duplicated - last.duplicated));
+            fflush(stdout);
+            last = totals;
+            reportTime = now;
+        }
+    }
+
+    uint64_t expected = totals.datagrams - totals.duplicated + totals.lost;
+    printf("\nTotal: %llu datagramas, %llu muestras, %llu perdidos (%.3f%%), %llu desordenados, %llu repetidos, "
+        "%llu inválidos, %llu reinicios\n", (unsigned long long)totals.datagrams, (unsigned long long)totals.samples,
+        (unsigned long long)totals.lost, expected > 0 ? 100.0 * totals.lost / expected : 0.0,
+        (unsigned long long)totals.reordered, (unsigned long long)totals.duplicated, (unsigned long long)totals.invalid,
+        (unsigned long long)totals.restarts);
+    closesocket(s);
+    return 0;
+}
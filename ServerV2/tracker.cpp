@@ -0,0 +1,184 @@
+﻿#include "tracker.h"
+#include <algorithm>
+
+const float ObjectTracker::ALPHA = 0.5f;
+const float ObjectTracker::BETA = 0.2f;
+const float ObjectTracker::GATE_DEG = 8.0f;
+const float ObjectTracker::GATE_CM = 8.0f;
+
+ObjectTracker::ObjectTracker()
+    : trackCount(0), nextId(1), confirmedCount(0), maxRange(DEFAULT_MAX_RANGE), sweeps(0), created(0) {}
+
+size_t ObjectTracker::Cluster(const SweepFrame& sweep, SweepCluster* out) const {
+    const uint16_t limit = maxRange.load(std::memory_order_relaxed);
+    size_t count = 0;
+
+    // Grupo en curso: sumas para las medias, se cierra al primer ángulo que no encaja
+    bool open = false;
+    uint16_t first = 0;
+    uint16_t previous = 0;
+    uint16_t previousDistance = 0;
+    uint16_t nearest = 0;
+    uint32_t angleSum = 0;
+    uint32_t distanceSum = 0;
+    uint64_t timeSum = 0;
+
+    for (uint32_t angle = sweep.minAngle; angle <= (uint32_t)sweep.maxAngle + 1 && count < MAX_CLUSTERS; ++angle) {
+        bool echo = angle <= sweep.maxAngle && sweep.distance[angle] != SweepFrame::MISSING && sweep.distance[angle] < limit;
+        uint16_t distance = echo ? sweep.distance[angle] : 0;
+
+        if (open && echo && angle == (uint32_t)previous + 1u &&
+            (distance > previousDistance ? distance - previousDistance : previousDistance - distance) <= JOIN_CM) {
+            previous = (uint16_t)angle;
+            previousDistance = distance;
+            nearest = distance < nearest ? distance : nearest;
+            angleSum += angle;
+            distanceSum += distance;
+            timeSum += sweep.timestamp[angle];
+            continue;
+        }
+
+        if (open) {
+            uint32_t width = (uint32_t)previous - first + 1;
+            if (width >= MIN_WIDTH) {
+                SweepCluster& cluster = out[count++];
+                cluster.firstAngle = first;
+                cluster.lastAngle = previous;
+                cluster.angle = (float)angleSum / (float)width;
+                cluster.distance = (float)distanceSum / (float)width;
+                cluster.nearest = nearest;
+                cluster.time = timeSum / width;
+            }
+            open = false;
+        }
+        if (echo) {
+            open = true;
+            first = previous = (uint16_t)angle;
+            previousDistance = nearest = distance;
+            angleSum = angle;
+            distanceSum = distance;
+            timeSum = sweep.timestamp[angle];
+        }
+    }
+    return count;
+}
+
+size_t ObjectTracker::Update(const SweepFrame& sweep, TrackedObject* out) {
+    size_t clusterCount = Cluster(sweep, clusters);
+
+    // Posibles asociaciones dentro de la ventana, de la más cercana a la más lejana
+    size_t pairCount = 0;
+    for (size_t t = 0; t < trackCount; ++t) {
+        const TrackedObject& track = tracks[t];
+        for (size_t c = 0; c < clusterCount; ++c) {
+            const SweepCluster& cluster = clusters[c];
+            float dt = cluster.time > track.time ? (float)(cluster.time - track.time) / 1e6f : 0.0f;
+            float angleError = (cluster.angle - (track.angle + track.angleRate * dt)) / GATE_DEG;
+            float distanceError = (cluster.distance - (track.distance + track.rangeRate * dt)) / GATE_CM;
+            float cost = angleError * angleError + distanceError * distanceError;
+            if (cost <= 1.0f) {
+                pairs[pairCount++] = { cost, (uint8_t)t, (uint8_t)c };
+            }
+        }
+    }
+    std::sort(pairs, pairs + pairCount, [](const Pair& a, const Pair& b) { return a.cost < b.cost; });
+
+    // Asociación voraz: cada objeto y cada grupo se usan una sola vez
+    bool trackUsed[MAX_TRACKS] = {};
+    bool clusterUsed[MAX_CLUSTERS] = {};
+    for (size_t i = 0; i < pairCount; ++i) {
+        const Pair& pair = pairs[i];
+        if (trackUsed[pair.track] || clusterUsed[pair.cluster]) {
+            continue;
+        }
+        trackUsed[pair.track] = true;
+        clusterUsed[pair.cluster] = true;
+
+        // Filtro alfa-beta sobre ángulo y distancia
+        TrackedObject& track = tracks[pair.track];
+        const SweepCluster& cluster = clusters[pair.cluster];
+        float dt = cluster.time > track.time ? (float)(cluster.time - track.time) / 1e6f : 0.0f;
+        float predictedAngle = track.angle + track.angleRate * dt;
+        float predictedDistance = track.distance + track.rangeRate * dt;
+        float angleResidual = cluster.angle - predictedAngle;
+        float distanceResidual = cluster.distance - predictedDistance;
+        track.angle = predictedAngle + ALPHA * angleResidual;
+        track.distance = predictedDistance + ALPHA * distanceResidual;
+        if (dt > 0.0f) {
+            track.angleRate += BETA * angleResidual / dt;
+            track.rangeRate += BETA * distanceResidual / dt;
+        }
+        track.firstAngle = cluster.firstAngle;
+        track.lastAngle = cluster.lastAngle;
+        track.hits = (uint16_t)(track.hits < 0xFFFF ? track.hits + 1 : track.hits);
+        track.misses = 0;
+        track.time = cluster.time;
+    }
+
+    // Los objetos que no se vieron envejecen; se quitan sin mantener el orden
+    for (size_t t = trackCount; t-- > 0;) {
+        if (trackUsed[t]) {
+            continue;
+        }
+        if (++tracks[t].misses > MAX_MISSES) {
+            tracks[t] = tracks[--trackCount];
+        }
+    }
+
+    // Los grupos sin objeto empiezan uno nuevo, todavía sin confirmar
+    for (size_t c = 0; c < clusterCount && trackCount < MAX_TRACKS; ++c) {
+        if (clusterUsed[c]) {
+            continue;
+        }
+        const SweepCluster& cluster = clusters[c];
+        TrackedObject& track = tracks[trackCount++];
+        track.id = nextId++;
+        track.device = sweep.device;
+        track.angle = cluster.angle;
+        track.distance = cluster.distance;
+        track.angleRate = 0.0f;
+        track.rangeRate = 0.0f;
+        track.firstAngle = cluster.firstAngle;
+        track.lastAngle = cluster.lastAngle;
+        track.hits = 1;
+        track.misses = 0;
+        track.time = cluster.time;
+        created.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t count = 0;
+    for (size_t t = 0; t < trackCount; ++t) {
+        if (tracks[t].hits >= CONFIRM_HITS) {
+            out[count++] = tracks[t];
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(published);
+        std::copy(out, out + count, confirmed);
+        confirmedCount = count;
+    }
+    sweeps.fetch_add(1, std::memory_order_relaxed);
+    return count;
+}
+
+size_t ObjectTracker::Copy(TrackedObject* out) const {
+    std::lock_guard<std::mutex> lock(published);
+    std::copy(confirmed, confirmed + confirmedCount, out);
+    return confirmedCount;
+}
+
+uint16_t ObjectTracker::MaxRange() const {
+    return maxRange;
+}
+
+void ObjectTracker::MaxRange(uint16_t value) {
+    maxRange = value;
+}
+
+uint64_t ObjectTracker::Sweeps() const {
+    return sweeps.load(std::memory_order_relaxed);
+}
+
+uint64_t ObjectTracker::Created() const {
+    return created.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,109 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "sweep.h"
+
+/// Grupo de ángulos contiguos de un barrido con distancias parecidas: un objeto visto una vez.
+struct SweepCluster {
+    uint16_t firstAngle;
+    uint16_t lastAngle;
+    float angle;          ///< Ángulo central en grados.
+    float distance;       ///< Distancia media en centímetros.
+    uint16_t nearest;     ///< Distancia mínima del grupo.
+    uint64_t time;        ///< Instante medio de las muestras del grupo.
+};
+
+/// Objeto seguido a lo largo de los barridos.
+struct TrackedObject {
+    uint32_t id;          ///< Identificador estable mientras se siga el objeto.
+    uint16_t device;      ///< Radar que lo ve.
+    float angle;          ///< Ángulo estimado en grados.
+    float distance;       ///< Distancia estimada en centímetros.
+    float angleRate;      ///< Grados por segundo.
+    float rangeRate;      ///< Centímetros por segundo (negativo si se acerca).
+    uint16_t firstAngle;  ///< Extensión en la última observación.
+    uint16_t lastAngle;
+    uint16_t hits;        ///< Barridos en los que se vio.
+    uint8_t misses;       ///< Barridos seguidos sin verlo.
+    uint64_t time;        ///< Instante de la última observación.
+};
+
+/// <summary>
+/// Detección y seguimiento de objetos por barrido. Agrupa los ángulos contiguos con eco
+/// cuyas distancias no saltan más de JOIN_CM (una pasada sobre el barrido), asocia cada grupo
+/// con el objeto seguido más cercano a su posición prevista y actualiza la posición y las
+/// velocidades con un filtro alfa-beta. Todo trabaja sobre arrays de tamaño fijo, sin
+/// reservar memoria por barrido.
+/// Update solo desde el hilo de red; Copy y la configuración desde cualquier hilo.
+/// </summary>
+class ObjectTracker {
+public:
+    static const size_t MAX_CLUSTERS = 32;       ///< Grupos como máximo por barrido.
+    static const size_t MAX_TRACKS = 32;         ///< Objetos seguidos a la vez.
+    static const uint16_t JOIN_CM = 3;           ///< Salto máximo de distancia entre ángulos vecinos del mismo objeto.
+    static const uint16_t MIN_WIDTH = 2;         ///< Ángulos mínimos de un grupo (uno suelto suele ser ruido).
+    static const uint16_t CONFIRM_HITS = 2;      ///< Barridos antes de publicar un objeto.
+    static const uint8_t MAX_MISSES = 3;         ///< Barridos sin verlo antes de olvidarlo.
+    static const uint16_t DEFAULT_MAX_RANGE = 50;
+
+    ObjectTracker();
+
+    /**
+     * @brief Agrupa los ángulos con eco del barrido.
+     * @param out Buffer de al menos MAX_CLUSTERS grupos.
+     * @return Número de grupos.
+     */
+    size_t Cluster(const SweepFrame& sweep, SweepCluster* out) const;
+
+    /**
+     * @brief Incorpora un barrido completo: agrupa, asocia y actualiza los objetos seguidos.
+     * @param out Buffer de al menos MAX_TRACKS objetos; recibe los confirmados.
+     * @return Número de objetos confirmados.
+     */
+    size_t Update(const SweepFrame& sweep, TrackedObject* out);
+
+    /**
+     * @brief Copia los objetos confirmados tras el último Update. Se puede llamar desde cualquier hilo.
+     * @param out Buffer de al menos MAX_TRACKS objetos.
+     */
+    size_t Copy(TrackedObject* out) const;
+
+    /**
+     * @brief Propiedad de la distancia a partir de la cual un ángulo se considera sin eco.
+     */
+    uint16_t MaxRange() const;
+    void MaxRange(uint16_t value);
+
+    uint64_t Sweeps() const;   ///< Barridos procesados.
+    uint64_t Created() const;  ///< Objetos nuevos desde el arranque.
+
+private:
+    static const float ALPHA;     ///< Peso de la medida en la posición.
+    static const float BETA;      ///< Peso de la medida en la velocidad.
+    static const float GATE_DEG;  ///< Distancia máxima a la posición prevista para asociar.
+    static const float GATE_CM;
+
+    /// Posible asociación entre un objeto y un grupo.
+    struct Pair {
+        float cost;
+        uint8_t track;
+        uint8_t cluster;
+    };
+
+    SweepCluster clusters[MAX_CLUSTERS];
+    TrackedObject tracks[MAX_TRACKS];
+    Pair pairs[MAX_TRACKS * MAX_CLUSTERS];
+    size_t trackCount;
+    uint32_t nextId;
+
+    mutable std::mutex published;               ///< Protege confirmed/confirmedCount para Copy.
+    TrackedObject confirmed[MAX_TRACKS];
+    size_t confirmedCount;
+
+    std::atomic<uint16_t> maxRange;
+    std::atomic<uint64_t> sweeps;
+    std::atomic<uint64_t> created;
+};
@@ -0,0 +1,291 @@
+﻿#include "websocket.h"
+#include <cctype>
+#include <cstring>
+
+namespace {
+    const char* GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    uint32_t RotateLeft(uint32_t value, int bits) {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    /// SHA-1 de un mensaje corto; solo se usa para la clave del handshake.
+    void Sha1(const std::string& message, uint8_t digest[20]) {
+        uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+        // Relleno: un bit a 1, ceros hasta 56 mod 64 y la longitud en bits (big-endian)
+        std::string data = message;
+        uint64_t bits = (uint64_t)message.size() * 8;
+        data += (char)0x80;
+        while (data.size() % 64 != 56) {
+            data += (char)0;
+        }
+        for (int i = 7; i >= 0; --i) {
+            data += (char)(bits >> (i * 8));
+        }
+
+        for (size_t block = 0; block < data.size(); block += 64) {
+            uint32_t w[80];
+            for (int i = 0; i < 16; ++i) {
+                const uint8_t* p = (const uint8_t*)data.data() + block + i * 4;
+                w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+            }
+            for (int i = 16; i < 80; ++i) {
+                w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            }
+
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; ++i) {
+                uint32_t f, k;
+                if (i < 20) {
+                    f = (b & c) | (~b & d);
+                    k = 0x5A827999;
+                }
+                else if (i < 40) {
+                    f = b ^ c ^ d;
+                    k = 0x6ED9EBA1;
+                }
+                else if (i < 60) {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8F1BBCDC;
+                }
+                else {
+                    f = b ^ c ^ d;
+                    k = 0xCA62C1D6;
+                }
+                uint32_t temp = RotateLeft(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = RotateLeft(b, 30);
+                b = a;
+                a = temp;
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+        }
+
+        for (int i = 0; i < 5; ++i) {
+            digest[i * 4] = (uint8_t)(h[i] >> 24);
+            digest[i * 4 + 1] = (uint8_t)(h[i] >> 16);
+            digest[i * 4 + 2] = (uint8_t)(h[i] >> 8);
+            digest[i * 4 + 3] = (uint8_t)h[i];
+        }
+    }
+
+    std::string Base64(const uint8_t* data, size_t length) {
+        static const char* ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        for (size_t i = 0; i < length; i += 3) {
+            uint32_t group = (uint32_t)data[i] << 16;
+            if (i + 1 < length) {
+                group |= (uint32_t)data[i + 1] << 8;
+            }
+            if (i + 2 < length) {
+                group |= data[i + 2];
+            }
+            out += ALPHABET[(group >> 18) & 63];
+            out += ALPHABET[(group >> 12) & 63];
+            out += i + 1 < length ? ALPHABET[(group >> 6) & 63] : '=';
+            out += i + 2 < length ? ALPHABET[group & 63] : '=';
+        }
+        return out;
+    }
+
+    std::string Lower(std::string text) {
+        for (char& c : text) {
+            c = (char)std::tolower((unsigned char)c);
+        }
+        return text;
+    }
+
+    std::string Trim(const std::string& text) {
+        size_t start = text.find_first_not_of(" \t");
+        size_t end = text.find_last_not_of(" \t\r");
+        return start == std::string::npos ? std::string() : text.substr(start, end - start + 1);
+    }
+}
+
+namespace ws {
+    UpgradeResult ParseUpgrade(const char* data, size_t length, std::string& key, size_t& consumed) {
+        // Un cliente TCP puede empezar igual ("G" de un dispositivo "Galaxy..."): con menos de 4 bytes
+        // no se decide
+        const char* method = "GET ";
+        size_t prefix = length < 4 ? length : 4;
+        if (std::memcmp(data, method, prefix) != 0) {
+            return NOT_HTTP;
+        }
+        if (prefix < 4) {
+            return UNDECIDED;
+        }
+
+        const char* end = nullptr;
+        for (size_t i = 0; i + 4 <= length; ++i) {
+            if (std::memcmp(data + i, "\r\n\r\n", 4) == 0) {
+                end = data + i + 4;
+                break;
+            }
+        }
+        if (end == nullptr) {
+            return length >= MAX_HANDSHAKE ? REJECTED : PARTIAL;
+        }
+
+        // Cabeceras sin distinguir mayúsculas; Connection puede llevar varios valores ("keep-alive, Upgrade")
+        bool upgrade = false;
+        bool connection = false;
+        bool version = false;
+        key.clear();
+        std::string request(data, end - data);
+        size_t line = request.find("\r\n") + 2;
+        while (line < request.size()) {
+            size_t next = request.find("\r\n", line);
+            std::string header = request.substr(line, next - line);
+            size_t colon = header.find(':');
+            if (colon != std::string::npos) {
+                std::string name = Lower(Trim(header.substr(0, colon)));
+                std::string value = Trim(header.substr(colon + 1));
+                if (name == "upgrade") {
+                    upgrade = Lower(value) == "websocket";
+                }
+                else if (name == "connection") {
+                    connection = Lower(value).find("upgrade") != std::string::npos;
+                }
+                else if (name == "sec-websocket-key") {
+                    key = value;
+                }
+                else if (name == "sec-websocket-version") {
+                    version = value == "13";
+                }
+            }
+            line = next + 2;
+        }
+
+        if (!upgrade || !connection || !version || key.size() != 24) {
+            return REJECTED;
+        }
+        consumed = (size_t)(end - data);
+        return UPGRADE;
+    }
+
+    std::string AcceptKey(const std::string& key) {
+        uint8_t digest[20];
+        Sha1(key + GUID, digest);
+        return Base64(digest, sizeof(digest));
+    }
+
+    std::string HandshakeReply(const std::string& key) {
+        return "HTTP/1.1 101 Switching Protocols\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Accept: " + AcceptKey(key) + "\r\n\r\n";
+    }
+
+    std::string RejectReply() {
+        return "HTTP/1.1 426 Upgrade Required\r\n"
+            "Sec-WebSocket-Version: 13\r\n"
+            "Connection: close\r\n"
+            "Content-Length: 0\r\n\r\n";
+    }
+
+    std::string TimeoutReply() {
+        return "HTTP/1.1 408 Request Timeout\r\n"
+            "Connection: close\r\n"
+            "Content-Length: 0\r\n\r\n";
+    }
+
+    size_t HeaderSize(size_t length) {
+        return length < 126 ? 2 : (length <= 0xFFFF ? 4 : 10);
+    }
+
+    size_t EncodeHeader(Opcode opcode, size_t length, char* out) {
+        out[0] = (char)(0x80 | opcode);
+        if (length < 126) {
+            out[1] = (char)length;
+            return 2;
+        }
+        if (length <= 0xFFFF) {
+            out[1] = (char)126;
+            out[2] = (char)(length >> 8);
+            out[3] = (char)length;
+            return 4;
+        }
+        out[1] = (char)127;
+        for (int i = 0; i < 8; ++i) {
+            out[2 + i] = (char)((uint64_t)length >> ((7 - i) * 8));
+        }
+        return 10;
+    }
+
+    std::string EncodeFrame(Opcode opcode, const char* data, size_t length) {
+        std::string frame(HeaderSize(length) + length, '\0');
+        size_t header = EncodeHeader(opcode, length, &frame[0]);
+        if (length > 0) {
+            std::memcpy(&frame[header], data, length);
+        }
+        return frame;
+    }
+
+    Frame WrapFrame(Opcode opcode, const Frame& frame) {
+        return std::make_shared<const std::string>(EncodeFrame(opcode, frame->data(), frame->size()));
+    }
+
+    std::string EncodeClose(uint16_t status) {
+        char payload[2] = { (char)(status >> 8), (char)status };
+        return EncodeFrame(CLOSE, payload, sizeof(payload));
+    }
+
+    DecodeResult DecodeFrame(const char* data, size_t length, size_t& consumed, Message& message) {
+        if (length < 2) {
+            return INCOMPLETE;
+        }
+        const uint8_t* bytes = (const uint8_t*)data;
+        uint8_t opcode = bytes[0] & 0x0F;
+        bool final = (bytes[0] & 0x80) != 0;
+        bool masked = (bytes[1] & 0x80) != 0;
+        bool control = (opcode & 0x08) != 0;
+
+        // Los clientes siempre enmascaran; los bits reservados no se negocian
+        if ((bytes[0] & 0x70) != 0 || !masked || (opcode > BINARY && opcode < CLOSE) || opcode > PONG) {
+            return INVALID;
+        }
+
+        size_t header = 2;
+        uint64_t payload = bytes[1] & 0x7F;
+        if (payload == 126) {
+            if (length < 4) {
+                return INCOMPLETE;
+            }
+            payload = (uint64_t)bytes[2] << 8 | bytes[3];
+            header = 4;
+        }
+        else if (payload == 127) {
+            if (length < 10) {
+                return INCOMPLETE;
+            }
+            payload = 0;
+            for (int i = 0; i < 8; ++i) {
+                payload = payload << 8 | bytes[2 + i];
+            }
+            header = 10;
+        }
+        if (payload > MAX_PAYLOAD || (control && (payload > 125 || !final))) {
+            return INVALID;
+        }
+        if (length < header + 4 + payload) {
+            return INCOMPLETE;
+        }
+
+        const uint8_t* mask = bytes + header;
+        const uint8_t* source = mask + 4;
+        message.opcode = (Opcode)opcode;
+        message.final = final;
+        message.payload.resize((size_t)payload);
+        for (size_t i = 0; i < payload; ++i) {
+            message.payload[i] = (char)(source[i] ^ mask[i & 3]);
+        }
+        consumed = header + 4 + (size_t)payload;
+        return DECODED;
+    }
+}
@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "frame.h"
+
+/// <summary>
+/// WebSocket (RFC 6455) sobre el mismo puerto que los clientes TCP, para los paneles web.
+///
+/// Un navegador se conecta y envía una petición HTTP "GET ... Upgrade: websocket" con la
+/// cabecera Sec-WebSocket-Key; el servidor responde "101 Switching Protocols" con la clave
+/// de aceptación (SHA-1 + base64) y a partir de ahí todo viaja en tramas WebSocket. Cada
+/// mensaje que recibiría un cliente TCP (líneas de texto o tramas de wireformat.h) va en una
+/// trama de texto o binaria, según el formato negociado; el cliente envía los mismos comandos
+/// ("PROTO BIN/1", "SECTOR ...", ...) como mensajes de texto.
+///
+/// Solo se implementa lo que necesita el servidor: las tramas del servidor van sin máscara y
+/// sin fragmentar; las del cliente llegan enmascaradas y pueden venir fragmentadas; ping se
+/// contesta con pong y close con close.
+/// </summary>
+namespace ws {
+    const size_t MAX_HANDSHAKE = 8192;     ///< Bytes máximos de la petición HTTP.
+    const size_t MAX_PAYLOAD = 65536;      ///< Datos máximos de un mensaje del cliente.
+    const size_t MAX_HEADER_SIZE = 14;     ///< Cabecera más larga de una trama (con longitud de 64 bits y máscara).
+    const uint16_t CLOSE_NORMAL = 1000;
+    const uint16_t CLOSE_PROTOCOL_ERROR = 1002;
+    const uint16_t CLOSE_TOO_BIG = 1009;
+
+    enum Opcode : uint8_t {
+        CONTINUATION = 0x0,
+        TEXT = 0x1,
+        BINARY = 0x2,
+        CLOSE = 0x8,
+        PING = 0x9,
+        PONG = 0xA
+    };
+
+    enum UpgradeResult {
+        NOT_HTTP,    ///< data no empieza por "GET ": es un cliente TCP normal.
+        UNDECIDED,   ///< Menos de 4 bytes y todos coinciden con "GET ": aún no se sabe.
+        PARTIAL,     ///< Petición HTTP sin terminar; hay que esperar a recibir más.
+        UPGRADE,     ///< Petición de WebSocket completa y válida.
+        REJECTED     ///< Petición HTTP que no es un WebSocket válido.
+    };
+
+    enum DecodeResult {
+        DECODED,     ///< Trama completa.
+        INCOMPLETE,  ///< Faltan bytes; hay que esperar a recibir más.
+        INVALID      ///< Los bytes no son una trama válida (o supera MAX_PAYLOAD).
+    };
+
+    /// Trama recibida de un cliente, ya sin máscara.
+    struct Message {
+        Opcode opcode;
+        bool final;               ///< Último fragmento del mensaje.
+        std::string payload;
+    };
+
+    /**
+     * @brief Reconoce una petición de WebSocket al principio de data.
+     * @param key Recibe la cabecera Sec-WebSocket-Key (con UPGRADE).
+     * @param consumed Recibe los bytes de la petición, hasta la línea en blanco incluida (con UPGRADE).
+     */
+    UpgradeResult ParseUpgrade(const char* data, size_t length, std::string& key, size_t& consumed);
+
+    /**
+     * @brief Valor de Sec-WebSocket-Accept para una clave: base64(SHA-1(clave + GUID)).
+     */
+    std::string AcceptKey(const std::string& key);
+
+    /**
+     * @brief Respuesta "101 Switching Protocols" a una petición con la clave indicada.
+     */
+    std::string HandshakeReply(const std::string& key);
+
+    /**
+     * @brief Respuesta HTTP con la que se rechaza una petición que no es un WebSocket.
+     */
+    std::string RejectReply();
+
+    /**
+     * @brief Respuesta HTTP con la que se cierra una petición que no terminó a tiempo.
+     */
+    std::string TimeoutReply();
+
+    /**
+     * @brief Bytes que ocupa la cabecera de una trama del servidor con length bytes de datos.
+     */
+    size_t HeaderSize(size_t length);
+
+    /**
+     * @brief Escribe la cabecera de una trama del servidor (sin máscara, FIN activado).
+     * @param out Buffer de al menos HeaderSize(length) bytes.
+     * @return Bytes escritos.
+     */
+    size_t EncodeHeader(Opcode opcode, size_t length, char* out);
+
+    /**
+     * @brief Codifica un mensaje completo en una trama del servidor.
+     */
+    std::string EncodeFrame(Opcode opcode, const char* data, size_t length);
+
+    /**
+     * @brief Envuelve un mensaje ya codificado en una trama; el resultado se comparte entre
+     *        todos los clientes WebSocket igual que el original entre los TCP.
+     */
+    Frame WrapFrame(Opcode opcode, const Frame& frame);
+
+    /**
+     * @brief Trama close con un código de estado.
+     */
+    std::string EncodeClose(uint16_t status);
+
+    /**
+     * @brief Decodifica la trama del cliente que empieza en data. Las tramas sin máscara, con
+     *        bits reservados o de control fragmentadas son inválidas.
+     * @param consumed Recibe los bytes que ocupa la trama (solo con DECODED).
+     * @param message Recibe el tipo, si es el último fragmento y los datos sin máscara.
+     */
+    DecodeResult DecodeFrame(const char* data, size_t length, size_t& consumed, Message& message);
+}
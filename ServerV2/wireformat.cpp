@@ -0,0 +1,350 @@
+﻿#include "wireformat.h"
+#include <cstring>
+
+namespace {
+    const char HANDSHAKE_PREFIX[] = "PROTO BIN/";
+
+    // Se escribe byte a byte para no depender del orden de bytes ni de la alineación del host.
+    inline void Store16(char* out, uint16_t value) {
+        out[0] = (char)(value & 0xFF);
+        out[1] = (char)(value >> 8);
+    }
+
+    inline void Store32(char* out, uint32_t value) {
+        out[0] = (char)(value & 0xFF);
+        out[1] = (char)((value >> 8) & 0xFF);
+        out[2] = (char)((value >> 16) & 0xFF);
+        out[3] = (char)(value >> 24);
+    }
+
+    inline void Store64(char* out, uint64_t value) {
+        Store32(out, (uint32_t)value);
+        Store32(out + 4, (uint32_t)(value >> 32));
+    }
+
+    inline uint16_t Load16(const char* in) {
+        const unsigned char* bytes = (const unsigned char*)in;
+        return (uint16_t)(bytes[0] | (bytes[1] << 8));
+    }
+
+    inline uint32_t Load32(const char* in) {
+        const unsigned char* bytes = (const unsigned char*)in;
+        return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    }
+
+    inline uint64_t Load64(const char* in) {
+        return (uint64_t)Load32(in) | ((uint64_t)Load32(in + 4) << 32);
+    }
+
+    // Redondea y satura a un entero de 16 bits con signo
+    inline int16_t Clamp16(float value) {
+        float rounded = value < 0 ? value - 0.5f : value + 0.5f;
+        return (int16_t)(rounded > 32767.0f ? 32767 : (rounded < -32768.0f ? -32768 : (int)rounded));
+    }
+
+    void StoreHeader(char* out, wire::FrameType type, uint32_t length, uint64_t baseTime, uint8_t flags = 0) {
+        out[0] = (char)wire::MAGIC;
+        out[1] = (char)wire::VERSION;
+        out[2] = (char)type;
+        out[3] = (char)flags;
+        Store32(out + 4, length);
+        Store64(out + 8, baseTime);
+    }
+}
+
+namespace wire {
+    size_t EncodeSamples(const RadarSample* samples, size_t count, char* out, uint8_t flags, FrameType type) {
+        // El instante base es el menor: en un fotograma clave las muestras no van en orden de lectura
+        uint64_t baseTime = count > 0 ? samples[0].timestamp : 0;
+        for (size_t i = 1; i < count; ++i) {
+            if (samples[i].timestamp < baseTime) {
+                baseTime = samples[i].timestamp;
+            }
+        }
+        size_t recordSize = type == DEVICE_SAMPLES ? DEVICE_RECORD_SIZE : RECORD_SIZE;
+        StoreHeader(out, type, (uint32_t)(count * recordSize), baseTime, flags);
+
+        char* record = out + HEADER_SIZE;
+        for (size_t i = 0; i < count; ++i) {
+            const RadarSample& sample = samples[i];
+            uint64_t offset = sample.timestamp > baseTime ? sample.timestamp - baseTime : 0;
+            Store16(record, sample.angle);
+            Store16(record + 2, sample.distance);
+            Store32(record + 4, sample.sequence);
+            Store32(record + 8, offset > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)offset);
+            if (type == DEVICE_SAMPLES) {
+                Store16(record + 12, sample.device);
+            }
+            record += recordSize;
+        }
+        return SamplesFrameSize(count, type);
+    }
+
+    size_t SweepFrameSize(const SweepFrame& sweep) {
+        size_t angles = sweep.maxAngle >= sweep.minAngle ? sweep.maxAngle - sweep.minAngle + 1 : 0;
+        return HEADER_SIZE + SWEEP_HEADER_SIZE + angles * 6;
+    }
+
+    size_t EncodeSweep(const SweepFrame& sweep, char* out) {
+        size_t size = SweepFrameSize(sweep);
+        size_t angles = (size - HEADER_SIZE - SWEEP_HEADER_SIZE) / 6;
+        StoreHeader(out, SWEEP, (uint32_t)(size - HEADER_SIZE), sweep.startTime);
+
+        char* fields = out + HEADER_SIZE;
+        Store32(fields, sweep.sequence);
+        Store16(fields + 4, sweep.minAngle);
+        Store16(fields + 6, (uint16_t)angles);
+        fields[8] = (char)sweep.direction;
+        fields[9] = (char)(uint8_t)sweep.device;
+        Store16(fields + 10, sweep.count);
+        uint64_t duration = sweep.endTime - sweep.startTime;
+        Store32(fields + 12, duration > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)duration);
+
+        // Como en SweepFrame, primero todas las distancias y luego todos los instantes
+        char* distances = fields + SWEEP_HEADER_SIZE;
+        char* offsets = distances + angles * 2;
+        for (size_t i = 0; i < angles; ++i) {
+            size_t angle = sweep.minAngle + i;
+            uint64_t offset = sweep.distance[angle] == SweepFrame::MISSING ? 0 : sweep.timestamp[angle] - sweep.startTime;
+            Store16(distances + i * 2, sweep.distance[angle]);
+            Store32(offsets + i * 4, offset > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)offset);
+        }
+        return size;
+    }
+
+    size_t EncodeGrid(uint16_t device, uint64_t time, uint8_t decay, const GridCell* cells, size_t count, char* out,
+        uint8_t flags) {
+        StoreHeader(out, GRID, (uint32_t)(GRID_HEADER_SIZE + count * GRID_RECORD_SIZE), time, flags);
+
+        char* fields = out + HEADER_SIZE;
+        fields[0] = (char)(uint8_t)device;
+        fields[1] = (char)decay;
+        fields[2] = (char)(uint8_t)OccupancyGrid::ANGLE_BINS;
+        fields[3] = (char)(uint8_t)OccupancyGrid::RANGE_BINS;
+        fields[4] = (char)OccupancyGrid::CM_PER_BIN;
+        fields[5] = 0;
+        Store16(fields + 6, (uint16_t)count);
+
+        char* record = fields + GRID_HEADER_SIZE;
+        for (size_t i = 0; i < count; ++i) {
+            record[0] = (char)cells[i].angle;
+            record[1] = (char)cells[i].range;
+            record[2] = (char)cells[i].value;
+            record += GRID_RECORD_SIZE;
+        }
+        return GridFrameSize(count);
+    }
+
+    size_t EncodeObjects(uint16_t device, const TrackedObject* objects, size_t count, char* out) {
+        uint64_t baseTime = count > 0 ? objects[0].time : 0;
+        for (size_t i = 1; i < count; ++i) {
+            if (objects[i].time < baseTime) {
+                baseTime = objects[i].time;
+            }
+        }
+        StoreHeader(out, OBJECTS, (uint32_t)(OBJECTS_HEADER_SIZE + count * OBJECT_RECORD_SIZE), baseTime);
+
+        char* fields = out + HEADER_SIZE;
+        fields[0] = (char)(uint8_t)device;
+        fields[1] = (char)(uint8_t)count;
+        Store16(fields + 2, 0);
+
+        char* record = fields + OBJECTS_HEADER_SIZE;
+        for (size_t i = 0; i < count; ++i) {
+            const TrackedObject& object = objects[i];
+            uint64_t offset = object.time - baseTime;
+            Store32(record, object.id);
+            Store16(record + 4, object.angle <= 0 ? 0 : (uint16_t)(object.angle * 100.0f + 0.5f));
+            Store16(record + 6, object.distance <= 0 ? 0 : (uint16_t)(object.distance * 10.0f + 0.5f));
+            Store16(record + 8, (uint16_t)Clamp16(object.rangeRate * 10.0f));
+            Store16(record + 10, (uint16_t)Clamp16(object.angleRate * 100.0f));
+            record[12] = (char)(uint8_t)object.firstAngle;
+            record[13] = (char)(uint8_t)object.lastAngle;
+            record[14] = (char)(uint8_t)(object.hits > 255 ? 255 : object.hits);
+            record[15] = (char)object.misses;
+            Store32(record + 16, offset > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)offset);
+            record += OBJECT_RECORD_SIZE;
+        }
+        return ObjectsFrameSize(count);
+    }
+
+    std::string EncodeText(const std::string& message) {
+        std::string frame(HEADER_SIZE + message.size(), '\0');
+        StoreHeader(&frame[0], TEXT, (uint32_t)message.size(), 0);
+        memcpy(&frame[HEADER_SIZE], message.data(), message.size());
+        return frame;
+    }
+
+    DecodeResult DecodeFrame(const char* data, size_t length, size_t& consumed, Message& message) {
+        if (length < HEADER_SIZE) {
+            return length > 0 && (uint8_t)data[0] != MAGIC ? INVALID : INCOMPLETE;
+        }
+        if ((uint8_t)data[0] != MAGIC || (uint8_t)data[1] == 0 || (uint8_t)data[1] > VERSION) {
+            return INVALID;
+        }
+
+        Header& header = message.header;
+        header.version = (uint8_t)data[1];
+        header.type = (FrameType)(uint8_t)data[2];
+        header.flags = (uint8_t)data[3];
+        header.length = Load32(data + 4);
+        header.baseTime = Load64(data + 8);
+
+        if (header.length > MAX_LENGTH) {
+            return INVALID;
+        }
+        size_t recordSize = header.type == DEVICE_SAMPLES ? DEVICE_RECORD_SIZE : RECORD_SIZE;
+        if ((header.type == SAMPLES || header.type == DEVICE_SAMPLES) &&
+            (header.length % recordSize != 0 || header.length / recordSize > MAX_RECORDS)) {
+            return INVALID;
+        }
+        if (header.type == SWEEP && header.length < SWEEP_HEADER_SIZE) {
+            return INVALID;
+        }
+        if (header.type == GRID && (header.length < GRID_HEADER_SIZE || (header.length - GRID_HEADER_SIZE) % GRID_RECORD_SIZE != 0)) {
+            return INVALID;
+        }
+        if (header.type == OBJECTS &&
+            (header.length < OBJECTS_HEADER_SIZE || (header.length - OBJECTS_HEADER_SIZE) % OBJECT_RECORD_SIZE != 0)) {
+            return INVALID;
+        }
+        if (length - HEADER_SIZE < header.length) {
+            return INCOMPLETE;
+        }
+
+        const char* payload = data + HEADER_SIZE;
+        if (header.type == SAMPLES || header.type == DEVICE_SAMPLES) {
+            std::vector<RadarSample>& samples = message.samples;
+            size_t count = header.length / recordSize;
+            samples.reserve(samples.size() + count);
+            for (size_t i = 0; i < count; ++i) {
+                const char* record = payload + i * recordSize;
+                RadarSample sample;
+                sample.angle = Load16(record);
+                sample.distance = Load16(record + 2);
+                sample.sequence = Load32(record + 4);
+                sample.timestamp = header.baseTime + Load32(record + 8);
+                sample.device = header.type == DEVICE_SAMPLES ? Load16(record + 12) : 0;
+                samples.push_back(sample);
+            }
+        }
+        else if (header.type == TEXT) {
+            message.text.assign(payload, header.length);
+        }
+        else if (header.type == SWEEP) {
+            SweepFrame& sweep = message.sweep;
+            size_t first = Load16(payload + 4);
+            size_t angles = Load16(payload + 6);
+            if (angles == 0 || first + angles - 1 > SweepFrame::MAX_ANGLE ||
+                header.length != SWEEP_HEADER_SIZE + angles * 6) {
+                return INVALID;
+            }
+
+            sweep.Clear();
+            sweep.sequence = Load32(payload);
+            sweep.device = (uint8_t)payload[9];
+            sweep.minAngle = (uint16_t)first;
+            sweep.maxAngle = (uint16_t)(first + angles - 1);
+            sweep.direction = (int8_t)payload[8];
+            sweep.count = Load16(payload + 10);
+            sweep.startTime = header.baseTime;
+            sweep.endTime = header.baseTime + Load32(payload + 12);
+
+            const char* distances = payload + SWEEP_HEADER_SIZE;
+            const char* offsets = distances + angles * 2;
+            for (size_t i = 0; i < angles; ++i) {
+                sweep.distance[first + i] = Load16(distances + i * 2);
+                sweep.timestamp[first + i] = header.baseTime + Load32(offsets + i * 4);
+            }
+        }
+        else if (header.type == GRID) {
+            GridUpdate& grid = message.grid;
+            size_t count = Load16(payload + 6);
+            if (header.length != GRID_HEADER_SIZE + count * GRID_RECORD_SIZE) {
+                return INVALID;
+            }
+
+            grid.device = (uint8_t)payload[0];
+            grid.decay = (uint8_t)payload[1];
+            grid.angleBins = (uint8_t)payload[2];
+            grid.rangeBins = (uint8_t)payload[3];
+            grid.cmPerBin = (uint8_t)payload[4];
+            grid.cells.resize(count);
+            const char* record = payload + GRID_HEADER_SIZE;
+            for (size_t i = 0; i < count; ++i) {
+                grid.cells[i] = { (uint8_t)record[0], (uint8_t)record[1], (uint8_t)record[2] };
+                record += GRID_RECORD_SIZE;
+            }
+        }
+        else if (header.type == OBJECTS) {
+            size_t count = (uint8_t)payload[1];
+            if (header.length != OBJECTS_HEADER_SIZE + count * OBJECT_RECORD_SIZE) {
+                return INVALID;
+            }
+
+            message.objects.resize(count);
+            const char* record = payload + OBJECTS_HEADER_SIZE;
+            for (size_t i = 0; i < count; ++i) {
+                TrackedObject& object = message.objects[i];
+                object.id = Load32(record);
+                object.device = (uint8_t)payload[0];
+                object.angle = Load16(record + 4) / 100.0f;
+                object.distance = Load16(record + 6) / 10.0f;
+                object.rangeRate = (int16_t)Load16(record + 8) / 10.0f;
+                object.angleRate = (int16_t)Load16(record + 10) / 100.0f;
+                object.firstAngle = (uint8_t)record[12];
+                object.lastAngle = (uint8_t)record[13];
+                object.hits = (uint8_t)record[14];
+                object.misses = (uint8_t)record[15];
+                object.time = header.baseTime + Load32(record + 16);
+                record += OBJECT_RECORD_SIZE;
+            }
+        }
+
+        consumed = HEADER_SIZE + header.length;
+        return DECODED;
+    }
+
+    size_t ParseHandshake(const char* data, size_t length, int& version) {
+        const size_t prefixLength = sizeof(HANDSHAKE_PREFIX) - 1;
+        if (length <= prefixLength || memcmp(data, HANDSHAKE_PREFIX, prefixLength) != 0) {
+            return 0;
+        }
+
+        size_t position = prefixLength;
+        int value = 0;
+        while (position < length && data[position] >= '0' && data[position] <= '9' && value < 1000) {
+            value = value * 10 + (data[position] - '0');
+            position++;
+        }
+        if (position == prefixLength) {
+            return 0;
+        }
+
+        // La línea termina en "\n" o "\r\n"; sin el salto de línea aún no está completa
+        if (position < length && data[position] == '\r') {
+            position++;
+        }
+        if (position == length || data[position] != '\n') {
+            return 0;
+        }
+        position++;
+
+        version = value;
+        return position;
+    }
+
+    int Negotiate(int requested) {
+        if (requested <= 0) {
+            return 0;
+        }
+        return requested < VERSION ? requested : VERSION;
+    }
+
+    std::string HandshakeReply(int version) {
+        if (version <= 0) {
+            return "PROTO TEXT\n";
+        }
+        return std::string(HANDSHAKE_PREFIX) + std::to_string(version) + "\n";
+    }
+}
@@ -0,0 +1,234 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sample.h"
+#include "sweep.h"
+#include "occupancy.h"
+#include "tracker.h"
+
+/// <summary>
+/// Formato binario opcional para enviar muestras a los clientes.
+///
+/// Negociación: tras conectarse, el cliente envía la línea "PROTO BIN/n\n" con la
+/// versión más alta que entiende. El servidor responde con una línea de texto:
+/// "PROTO BIN/n\n" con la versión elegida, a partir de la cual todo lo que recibe
+/// el cliente son tramas binarias, o "PROTO TEXT\n" si no puede atenderla y sigue en texto.
+/// Los clientes que no negocian siguen recibiendo "ángulo,distancia\n".
+///
+/// Trama (todos los enteros en little-endian):
+///   cabecera de HEADER_SIZE bytes
+///     0  u8   MAGIC ('R')
+///     1  u8   versión
+///     2  u8   tipo (FrameType)
+///     3  u8   indicadores (FLAG_KEYFRAME)
+///     4  u32  bytes de datos que siguen a la cabecera
+///     8  u64  instante base en microsegundos (SAMPLES y SWEEP; 0 en TEXT)
+///   datos
+///     SAMPLES: registros de RECORD_SIZE bytes
+///       0  u16  ángulo
+///       2  u16  distancia
+///       4  u32  número de muestra
+///       8  u32  microsegundos desde el instante base
+///     DEVICE_SAMPLES: registros de DEVICE_RECORD_SIZE bytes, como SAMPLES seguidos de
+///       12 u16  radar
+///       Solo los reciben los clientes que se suscribieron a radares con "SUBSCRIBE".
+///     Con FLAG_KEYFRAME, SAMPLES y DEVICE_SAMPLES llevan la última muestra de cada ángulo: el
+///       fotograma clave del modo delta o la instantánea que recibe cada cliente antes del directo
+///       (y al pedirla con "SNAPSHOT").
+///     TEXT: mensaje de texto sin terminador (por ejemplo, las respuestas a los comandos)
+///     SWEEP: barrido completo (ver SweepFrame), con n ángulos consecutivos
+///       0  u32  número de barrido
+///       4  u16  primer ángulo
+///       6  u16  n
+///       8  i8   sentido (1 o -1)
+///       9  u8   radar (0 con un único Arduino)
+///       10 u16  muestras recibidas
+///       12 u32  duración en microsegundos
+///       16 u16  distancias[n] (SweepFrame::MISSING si el ángulo no tuvo muestra)
+///       16+2n u32 microsegundos desde el instante base[n]
+///     GRID: celdas de la rejilla de ocupación de un radar (ver OccupancyGrid)
+///       0  u8   radar
+///       1  u8   intensidad que hay que restar antes a todas las celdas (0 en una instantánea)
+///       2  u8   ángulos de la rejilla
+///       3  u8   celdas de distancia por ángulo
+///       4  u8   centímetros por celda
+///       5  u8   reservado
+///       6  u16  n
+///       8  n registros de GRID_RECORD_SIZE bytes: u8 ángulo, u8 celda de distancia, u8 intensidad
+///       Con FLAG_KEYFRAME es una instantánea: las celdas que no aparecen valen 0.
+///       Solo los reciben los clientes que la piden con "GRID" o "GRID ON".
+///     OBJECTS: objetos seguidos por un radar tras cada barrido (ver ObjectTracker)
+///       0  u8   radar
+///       1  u8   n
+///       2  u16  reservado
+///       4  n registros de OBJECT_RECORD_SIZE bytes
+///         0  u32  identificador del objeto
+///         4  u16  ángulo en centésimas de grado
+///         6  u16  distancia en milímetros
+///         8  i16  velocidad radial en mm/s (negativa si se acerca)
+///         10 i16  velocidad angular en centésimas de grado por segundo
+///         12 u8   primer ángulo
+///         13 u8   último ángulo
+///         14 u8   barridos en los que se vio (hasta 255)
+///         15 u8   barridos seguidos sin verlo
+///         16 u32  microsegundos desde el instante base hasta la última observación
+///       Solo los reciben los clientes que los piden con "OBJECTS ON" u "OBJECTS ONLY".
+/// Un cliente debe saltarse (con la longitud de la cabecera) las tramas de tipo desconocido.
+/// </summary>
+namespace wire {
+    const uint8_t MAGIC = 'R';
+    const uint8_t VERSION = 1;            ///< Versión más alta que entiende el servidor.
+    const size_t HEADER_SIZE = 16;
+    const size_t RECORD_SIZE = 12;
+    const size_t DEVICE_RECORD_SIZE = 14;
+    const size_t MAX_RECORDS = 4096;      ///< Registros máximos por trama que acepta el decodificador.
+    const size_t SWEEP_HEADER_SIZE = 16;  ///< Campos fijos al principio de los datos de SWEEP.
+    const uint32_t MAX_LENGTH = 1 << 20;  ///< Datos máximos por trama que acepta el decodificador.
+    const uint8_t FLAG_KEYFRAME = 1;      ///< SAMPLES con todos los ángulos conocidos (fotograma clave del modo delta o
+                                          ///< instantánea al conectar), o GRID completa.
+    const size_t GRID_HEADER_SIZE = 8;    ///< Campos fijos al principio de los datos de GRID.
+    const size_t GRID_RECORD_SIZE = 3;
+    const size_t OBJECTS_HEADER_SIZE = 4; ///< Campos fijos al principio de los datos de OBJECTS.
+    const size_t OBJECT_RECORD_SIZE = 20;
+
+    enum FrameType : uint8_t {
+        SAMPLES = 1,
+        TEXT = 2,
+        SWEEP = 3,
+        DEVICE_SAMPLES = 4,
+        GRID = 5,
+        OBJECTS = 6
+    };
+
+    /// Cabecera de una trama ya decodificada.
+    struct Header {
+        uint8_t version;
+        FrameType type;
+        uint8_t flags;
+        uint32_t length;   ///< Bytes de datos tras la cabecera.
+        uint64_t baseTime;
+    };
+
+    /// Celdas de una trama GRID.
+    struct GridUpdate {
+        uint16_t device;
+        uint8_t decay;
+        uint8_t angleBins;
+        uint8_t rangeBins;
+        uint8_t cmPerBin;
+        std::vector<GridCell> cells;
+    };
+
+    /// Contenido de una trama decodificada; solo se rellena el campo de su tipo.
+    struct Message {
+        Header header;
+        std::vector<RadarSample> samples; ///< SAMPLES y DEVICE_SAMPLES (se añaden al final, no se vacía).
+        std::string text;                 ///< TEXT
+        SweepFrame sweep;                 ///< SWEEP
+        GridUpdate grid;                  ///< GRID
+        std::vector<TrackedObject> objects; ///< OBJECTS (se vacía en cada trama)
+    };
+
+    enum DecodeResult {
+        DECODED,    ///< Trama completa.
+        INCOMPLETE, ///< Faltan bytes; hay que esperar a recibir más.
+        INVALID     ///< Los bytes no son una trama válida.
+    };
+
+    /**
+     * @brief Bytes que ocupa una trama SAMPLES (o DEVICE_SAMPLES) con count muestras.
+     */
+    inline size_t SamplesFrameSize(size_t count, FrameType type = SAMPLES) {
+        return HEADER_SIZE + count * (type == DEVICE_SAMPLES ? DEVICE_RECORD_SIZE : RECORD_SIZE);
+    }
+
+    /**
+     * @brief Codifica varias muestras en una única trama SAMPLES o DEVICE_SAMPLES.
+     * @param samples Muestras; la más antigua fija el instante base.
+     * @param count Número de muestras.
+     * @param out Buffer de al menos SamplesFrameSize(count, type) bytes.
+     * @param flags Indicadores de la cabecera (por ejemplo, FLAG_KEYFRAME).
+     * @param type SAMPLES, o DEVICE_SAMPLES para incluir el radar de cada muestra.
+     * @return Bytes escritos.
+     */
+    size_t EncodeSamples(const RadarSample* samples, size_t count, char* out, uint8_t flags = 0, FrameType type = SAMPLES);
+
+    /**
+     * @brief Bytes que ocupa la trama SWEEP de un barrido.
+     */
+    size_t SweepFrameSize(const SweepFrame& sweep);
+
+    /**
+     * @brief Codifica un barrido completo en una trama SWEEP.
+     * @param out Buffer de al menos SweepFrameSize(sweep) bytes.
+     * @return Bytes escritos.
+     */
+    size_t EncodeSweep(const SweepFrame& sweep, char* out);
+
+    /**
+     * @brief Bytes que ocupa una trama GRID con count celdas.
+     */
+    inline size_t GridFrameSize(size_t count) {
+        return HEADER_SIZE + GRID_HEADER_SIZE + count * GRID_RECORD_SIZE;
+    }
+
+    /**
+     * @brief Codifica celdas de la rejilla de ocupación en una trama GRID.
+     * @param time Instante de la última muestra incluida (va como instante base).
+     * @param decay Intensidad que el cliente debe restar a todas las celdas antes de aplicar estas.
+     * @param flags FLAG_KEYFRAME si las celdas son una instantánea completa.
+     * @param out Buffer de al menos GridFrameSize(count) bytes.
+     * @return Bytes escritos.
+     */
+    size_t EncodeGrid(uint16_t device, uint64_t time, uint8_t decay, const GridCell* cells, size_t count, char* out,
+        uint8_t flags = 0);
+
+    /**
+     * @brief Bytes que ocupa una trama OBJECTS con count objetos.
+     */
+    inline size_t ObjectsFrameSize(size_t count) {
+        return HEADER_SIZE + OBJECTS_HEADER_SIZE + count * OBJECT_RECORD_SIZE;
+    }
+
+    /**
+     * @brief Codifica los objetos seguidos de un radar en una trama OBJECTS.
+     * @param out Buffer de al menos ObjectsFrameSize(count) bytes.
+     * @return Bytes escritos.
+     */
+    size_t EncodeObjects(uint16_t device, const TrackedObject* objects, size_t count, char* out);
+
+    /**
+     * @brief Codifica un mensaje de texto en una trama TEXT.
+     */
+    std::string EncodeText(const std::string& message);
+
+    /**
+     * @brief Decodifica la trama que empieza en data.
+     * Las tramas de tipo desconocido se decodifican sin contenido para poder saltarlas.
+     * @param consumed Recibe los bytes que ocupa la trama (solo con DECODED).
+     * @param message Recibe la cabecera y el contenido.
+     */
+    DecodeResult DecodeFrame(const char* data, size_t length, size_t& consumed, Message& message);
+
+    /**
+     * @brief Reconoce la línea de negociación "PROTO BIN/n\n" al principio de data.
+     * @param version Recibe la versión pedida por el cliente.
+     * @return Bytes que ocupa la línea, incluido el salto de línea; 0 si data no empieza por ella o
+     *         aún no llegó el salto de línea.
+     */
+    size_t ParseHandshake(const char* data, size_t length, int& version);
+
+    /**
+     * @brief Elige la versión con la que se atenderá al cliente.
+     * @return La versión binaria acordada, o 0 si el cliente debe seguir en texto.
+     */
+    int Negotiate(int requested);
+
+    /**
+     * @brief Línea con la que el servidor confirma la versión acordada ("PROTO TEXT\n" con 0).
+     */
+    std::string HandshakeReply(int version);
+}